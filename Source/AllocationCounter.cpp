@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.cpp
+// ============
+// count the heap allocations made through operator new
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// declaration of global variables
+namespace
+{
+	// constant-initialized, so allocations made while other globals
+	// are constructed are counted too
+	std::atomic<unsigned long long> g_AllocationCount(0);
+
+	// count one allocation and take the memory from malloc()
+	void* CountedAllocate(std::size_t size)
+	{
+		g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+		return(std::malloc((size == 0) ? 1 : size));
+	}
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method is used for reading the number of heap
+ *  allocations made so far.
+ ***********************************************************/
+unsigned long long AllocationCounter::GetCount()
+{
+	return(g_AllocationCount.load(std::memory_order_relaxed));
+}
+
+// replacements of the global allocation functions; the nothrow
+// forms return NULL and the others throw when malloc() fails
+void* operator new(std::size_t size)
+{
+	void* pMemory = CountedAllocate(size);
+	if (pMemory == NULL)
+	{
+		throw std::bad_alloc();
+	}
+
+	return(pMemory);
+}
+
+void* operator new[](std::size_t size)
+{
+	return(operator new(size));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory, std::size_t) noexcept
+{
+	std::free(pMemory);
+}
@@ -0,0 +1,27 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// count the heap allocations made through operator new
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  AllocationCounter
+ *
+ *  AllocationCounter.cpp replaces the global operator new
+ *  and delete with versions that count every allocation
+ *  before calling malloc() and free().  Reading the count
+ *  before and after a piece of code shows how many heap
+ *  allocations it made, on any thread; memory taken with
+ *  malloc() directly, e.g. inside the driver, is not seen.
+ ***********************************************************/
+class AllocationCounter
+{
+public:
+	// allocations made through operator new since startup
+	static unsigned long long GetCount();
+};
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// atomicfile.cpp
+// ============
+// replace a file with a completely written one in a single step
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AtomicFile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#include <cstdio>
+
+/***********************************************************
+ *  GetTempFile()
+ *
+ *  This method is used for naming the temporary file a
+ *  target is written under.  It lies in the same directory,
+ *  so moving it over the target never copies the data.
+ ***********************************************************/
+std::string AtomicFile::GetTempFile(const std::string& filename)
+{
+	return(filename + ".tmp");
+}
+
+/***********************************************************
+ *  Replace()
+ *
+ *  This method is used for moving a completely written
+ *  temporary file over its target.  The target is never
+ *  removed first: MoveFileEx() and rename() replace it in
+ *  the same step, and leave it as it was when they fail.
+ ***********************************************************/
+bool AtomicFile::Replace(const std::string& tempFile, const std::string& filename)
+{
+#ifdef _WIN32
+	bool bReplaced = (MoveFileExA(tempFile.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0);
+#else
+	bool bReplaced = (std::rename(tempFile.c_str(), filename.c_str()) == 0);
+#endif
+	if (!bReplaced)
+	{
+		std::remove(tempFile.c_str());
+	}
+
+	return(bReplaced);
+}
@@ -0,0 +1,34 @@
+///////////////////////////////////////////////////////////////////////////////
+// atomicfile.h
+// ============
+// replace a file with a completely written one in a single step
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+/***********************************************************
+ *  AtomicFile
+ *
+ *  This class is used by the writers of cache and scene
+ *  files.  A file is written under a temporary name next to
+ *  its target and then moved over the target in one step,
+ *  so a reader finds either the old file or the new one,
+ *  never half a file or none at all.  On Windows the target
+ *  may still be mapped by a reader that opened it with
+ *  FILE_SHARE_DELETE.
+ ***********************************************************/
+class AtomicFile
+{
+public:
+	// temporary name a file is written under before it replaces
+	// the target
+	static std::string GetTempFile(const std::string& filename);
+	// move a completely written temporary file over the target;
+	// the temporary file is removed when that fails
+	static bool Replace(const std::string& tempFile, const std::string& filename);
+};
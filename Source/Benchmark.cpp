@@ -0,0 +1,329 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.cpp
+// ============
+// command line benchmark mode settings and the machine-readable run report
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// report names of the profiled sections and passes
+	const char* g_SectionNames[FrameProfiler::SECTION_COUNT] =
+	{
+		"frame",
+		"shadow",
+		"scene",
+		"swap"
+	};
+	const char* g_PassNames[FrameProfiler::PASS_COUNT] =
+	{
+		"shadow",
+		"lit"
+	};
+
+	// read the integer value that follows an option
+	bool ReadIntOption(int argc, char* argv[], int& i, int minimum, int& value)
+	{
+		if (i + 1 >= argc)
+		{
+			std::cout << "Missing value for " << argv[i] << std::endl;
+			return(false);
+		}
+		value = atoi(argv[++i]);
+		if (value < minimum)
+		{
+			std::cout << "Invalid value for " << argv[i - 1] << ": " << argv[i] << std::endl;
+			return(false);
+		}
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Benchmark::Benchmark()
+{
+	m_bEnabled = false;
+	m_frameCount = 600;
+	m_warmupFrames = 60;
+	m_sceneCopies = 1;
+	m_fixedTimeStep = 1.0f / 60.0f;
+	m_reportFile = "benchmark_report.json";
+}
+
+/***********************************************************
+ *  ParseArguments()
+ *
+ *  This method is used for reading the benchmark options
+ *  from the command line.  Options it does not know are
+ *  left for other parts of the program; the ones it reads
+ *  are marked in usedArguments, with their values, so that
+ *  main() can report any argument nobody read.
+ ***********************************************************/
+bool Benchmark::ParseArguments(int argc, char* argv[], std::vector<bool>& usedArguments)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		int option = i;
+		if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			m_bEnabled = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0)
+		{
+			if (!ReadIntOption(argc, argv, i, 1, m_frameCount))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0)
+		{
+			if (!ReadIntOption(argc, argv, i, 0, m_warmupFrames))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--copies") == 0)
+		{
+			if (!ReadIntOption(argc, argv, i, 1, m_sceneCopies))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--report") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				std::cout << "Missing value for --report" << std::endl;
+				return(false);
+			}
+			m_reportFile = argv[++i];
+		}
+		else
+		{
+			continue;
+		}
+
+		for (int used = option; used <= i; used++)
+		{
+			usedArguments[used] = true;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsEnabled()
+ *
+ *  This method is used for checking whether --benchmark
+ *  was given.
+ ***********************************************************/
+bool Benchmark::IsEnabled() const
+{
+	return(m_bEnabled);
+}
+
+/***********************************************************
+ *  GetSceneCopies()
+ *
+ *  This method is used for reading how many copies of the
+ *  scene file the scene should contain.
+ ***********************************************************/
+int Benchmark::GetSceneCopies() const
+{
+	return(m_sceneCopies);
+}
+
+/***********************************************************
+ *  GetFixedTimeStep()
+ *
+ *  This method is used for reading the simulated seconds
+ *  between two benchmark frames.
+ ***********************************************************/
+float Benchmark::GetFixedTimeStep() const
+{
+	return(m_fixedTimeStep);
+}
+
+/***********************************************************
+ *  GetTotalFrames()
+ *
+ *  This method is used for reading the number of frames to
+ *  render, warm-up frames included.
+ ***********************************************************/
+int Benchmark::GetTotalFrames() const
+{
+	return(m_warmupFrames + m_frameCount);
+}
+
+/***********************************************************
+ *  ComputePercentiles()
+ *
+ *  This method is used for sorting a set of values and
+ *  reading nearest-rank percentiles from it.
+ ***********************************************************/
+Benchmark::PERCENTILES Benchmark::ComputePercentiles(std::vector<float>& values)
+{
+	PERCENTILES stats;
+	if (values.empty())
+	{
+		return(stats);
+	}
+
+	std::sort(values.begin(), values.end());
+
+	double sum = 0.0;
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		sum += values[i];
+	}
+
+	size_t count = values.size();
+	stats.minMs = values.front();
+	stats.maxMs = values.back();
+	stats.avgMs = (float)(sum / (double)count);
+	stats.p50Ms = values[(count * 50 + 99) / 100 - 1];
+	stats.p90Ms = values[(count * 90 + 99) / 100 - 1];
+	stats.p95Ms = values[(count * 95 + 99) / 100 - 1];
+	stats.p99Ms = values[(count * 99 + 99) / 100 - 1];
+
+	return(stats);
+}
+
+/***********************************************************
+ *  WritePercentiles()
+ *
+ *  This method is used for writing one set of percentiles
+ *  as a JSON object.
+ ***********************************************************/
+void Benchmark::WritePercentiles(std::ostream& out, const PERCENTILES& stats)
+{
+	out << "{\"min\":" << stats.minMs
+		<< ",\"avg\":" << stats.avgMs
+		<< ",\"p50\":" << stats.p50Ms
+		<< ",\"p90\":" << stats.p90Ms
+		<< ",\"p95\":" << stats.p95Ms
+		<< ",\"p99\":" << stats.p99Ms
+		<< ",\"max\":" << stats.maxMs << "}";
+}
+
+/***********************************************************
+ *  WriteReport()
+ *
+ *  This method is used for writing the JSON report of a run:
+ *  its settings, the CPU and GPU time percentiles of every
+ *  section and the average counters of every pass, over the
+ *  frames after the warm-up.
+ ***********************************************************/
+bool Benchmark::WriteReport(const FrameProfiler& profiler) const
+{
+	// the frames after the warm-up
+	std::vector<FrameProfiler::FRAME_SAMPLE> frames;
+	const std::vector<FrameProfiler::FRAME_SAMPLE>& kept = profiler.GetKeptFrames();
+	for (size_t i = 0; i < kept.size(); i++)
+	{
+		if (kept[i].frameIndex >= (unsigned long long)m_warmupFrames)
+		{
+			frames.push_back(kept[i]);
+		}
+	}
+
+	std::ofstream out(m_reportFile.c_str(), std::ios::out | std::ios::trunc);
+	if (!out.is_open())
+	{
+		std::cout << "Could not write benchmark report:" << m_reportFile << std::endl;
+		return(false);
+	}
+
+	unsigned int objectCount = 0;
+	if (!frames.empty())
+	{
+		const FrameProfiler::PASS_COUNTERS& lit = frames.back().counters[FrameProfiler::PASS_LIT];
+		objectCount = lit.objectsDrawn + lit.objectsCulled;
+	}
+
+	out << "{\n";
+	out << "  \"frames\": " << frames.size() << ",\n";
+	out << "  \"warmup_frames\": " << m_warmupFrames << ",\n";
+	out << "  \"scene_copies\": " << m_sceneCopies << ",\n";
+	out << "  \"objects\": " << objectCount << ",\n";
+	out << "  \"fixed_timestep_ms\": " << (m_fixedTimeStep * 1000.0f) << ",\n";
+	out << "  \"gpu_timing\": " << (profiler.HasGpuTiming() ? "true" : "false") << ",\n";
+
+	// CPU time of every section
+	out << "  \"cpu_ms\": {";
+	for (int section = 0; section < FrameProfiler::SECTION_COUNT; section++)
+	{
+		std::vector<float> values;
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			values.push_back(frames[i].cpuMs[section]);
+		}
+		out << ((section == 0) ? "\n" : ",\n") << "    \"" << g_SectionNames[section] << "\": ";
+		WritePercentiles(out, ComputePercentiles(values));
+	}
+	out << "\n  },\n";
+
+	// GPU time of the sections that were timed on the GPU
+	out << "  \"gpu_ms\": {";
+	bool bFirst = true;
+	for (int section = 0; section < FrameProfiler::SECTION_COUNT; section++)
+	{
+		std::vector<float> values;
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			if (frames[i].bGpuTimed[section])
+				values.push_back(frames[i].gpuMs[section]);
+		}
+		if (values.empty())
+			continue;
+
+		out << (bFirst ? "\n" : ",\n") << "    \"" << g_SectionNames[section] << "\": ";
+		WritePercentiles(out, ComputePercentiles(values));
+		bFirst = false;
+	}
+	out << "\n  },\n";
+
+	// average work per frame of every pass
+	out << "  \"passes\": {";
+	for (int pass = 0; pass < FrameProfiler::PASS_COUNT; pass++)
+	{
+		double sums[7] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			const FrameProfiler::PASS_COUNTERS& c = frames[i].counters[pass];
+			sums[0] += c.drawCalls;
+			sums[1] += c.triangles;
+			sums[2] += c.uniformUploads;
+			sums[3] += c.textureBinds;
+			sums[4] += c.objectsDrawn;
+			sums[5] += c.objectsCulled;
+			sums[6] += c.allocations;
+		}
+		double scale = frames.empty() ? 0.0 : 1.0 / (double)frames.size();
+
+		out << ((pass == 0) ? "\n" : ",\n") << "    \"" << g_PassNames[pass] << "\": {"
+			<< "\"draws\":" << sums[0] * scale
+			<< ",\"triangles\":" << sums[1] * scale
+			<< ",\"uniform_uploads\":" << sums[2] * scale
+			<< ",\"texture_binds\":" << sums[3] * scale
+			<< ",\"objects_drawn\":" << sums[4] * scale
+			<< ",\"objects_culled\":" << sums[5] * scale
+			<< ",\"allocations\":" << sums[6] * scale << "}";
+	}
+	out << "\n  }\n";
+	out << "}\n";
+
+	std::cout << "INFO: Benchmark report written to " << m_reportFile << std::endl;
+
+	return(true);
+}
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.h
+// ============
+// command line benchmark mode settings and the machine-readable run report
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameProfiler.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  Benchmark
+ *
+ *  This class holds the settings of a benchmark run, read
+ *  from the command line:
+ *
+ *    --benchmark           run the benchmark instead of the
+ *                          interactive loop
+ *    --frames N            measured frames (default 600)
+ *    --warmup N            frames rendered before measuring
+ *                          (default 60)
+ *    --copies K            copies of the scene file laid out
+ *                          side by side (default 1)
+ *    --report FILE         JSON report written at the end
+ *                          (default benchmark_report.json)
+ *
+ *  A run uses a hidden window, no vsync, a fixed time step
+ *  and a scripted camera, so runs can be compared directly.
+ ***********************************************************/
+class Benchmark
+{
+public:
+	// constructor
+	Benchmark();
+
+private:
+	bool m_bEnabled;
+	int m_frameCount;
+	int m_warmupFrames;
+	int m_sceneCopies;
+	float m_fixedTimeStep;
+	std::string m_reportFile;
+
+	// percentiles of one measured value over the run
+	struct PERCENTILES
+	{
+		float minMs = 0.0f;
+		float avgMs = 0.0f;
+		float p50Ms = 0.0f;
+		float p90Ms = 0.0f;
+		float p95Ms = 0.0f;
+		float p99Ms = 0.0f;
+		float maxMs = 0.0f;
+	};
+
+	// sort the values and read the percentiles from them
+	static PERCENTILES ComputePercentiles(std::vector<float>& values);
+	// write one percentiles object of the report
+	static void WritePercentiles(std::ostream& out, const PERCENTILES& stats);
+
+public:
+	// read the benchmark options, setting the entries of usedArguments
+	// they take up; returns false on a malformed option
+	bool ParseArguments(int argc, char* argv[], std::vector<bool>& usedArguments);
+
+	bool IsEnabled() const;
+	int GetSceneCopies() const;
+	float GetFixedTimeStep() const;
+	// total frames to render, warm-up included
+	int GetTotalFrames() const;
+
+	// write the report over the measured frames kept by the profiler
+	bool WriteReport(const FrameProfiler& profiler) const;
+};
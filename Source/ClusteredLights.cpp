@@ -0,0 +1,476 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlights.cpp
+// ============
+// assign the scene point lights to the clusters of the view frustum
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ClusteredLights.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// the C++ mirrors must match the std430 layout of the shader blocks
+static_assert(sizeof(ClusteredLights::POINT_LIGHT) == 64, "ClusteredPointLight layout mismatch");
+static_assert(sizeof(ClusteredLights::CLUSTER_HEADER) == 32, "LightClustersBlock layout mismatch");
+static_assert(sizeof(glm::uvec2) == 8, "cluster range layout mismatch");
+
+// declaration of global variables
+namespace
+{
+	const char* g_LightsBlockName = "ClusteredLightsBlock";
+	const char* g_ClustersBlockName = "LightClustersBlock";
+	const char* g_IndicesBlockName = "LightIndicesBlock";
+
+	// nearest view depth the slices start at, for projections whose
+	// near plane is at or behind the camera
+	const float g_MinSliceDepth = 0.001f;
+
+	// point of a line between two view-space points at a view depth
+	glm::vec3 GetPointAtDepth(const glm::vec3& pointNear, const glm::vec3& pointFar, float depth)
+	{
+		float t = (depth + pointNear.z) / (pointNear.z - pointFar.z);
+
+		return(glm::mix(pointNear, pointFar, t));
+	}
+
+	// view-space point of a normalized device coordinate
+	glm::vec3 Unproject(const glm::mat4& inverseProjection, const glm::vec3& ndc)
+	{
+		glm::vec4 point = inverseProjection * glm::vec4(ndc, 1.0f);
+
+		return(glm::vec3(point) / point.w);
+	}
+}
+
+/***********************************************************
+ *  ClusteredLights()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ClusteredLights::ClusteredLights()
+{
+	m_lightBuffer = 0;
+	m_clusterBuffer = 0;
+	m_indexBuffer = 0;
+	m_bLightsDirty = true;
+	m_cornerNear.resize((CLUSTERS_X + 1) * (CLUSTERS_Y + 1));
+	m_cornerFar.resize((CLUSTERS_X + 1) * (CLUSTERS_Y + 1));
+	for (int slice = 0; slice <= CLUSTERS_Z; slice++)
+	{
+		m_sliceDepths[slice] = 0.0f;
+	}
+	m_sliceIndices.resize(CLUSTERS_Z);
+	m_ranges.assign(CLUSTER_COUNT, glm::uvec2(0));
+	m_maxClusterLights = 0;
+}
+
+/***********************************************************
+ *  ~ClusteredLights()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ClusteredLights::~ClusteredLights()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking for OpenGL 4.3, which
+ *  has shader storage buffers.
+ ***********************************************************/
+bool ClusteredLights::IsSupported()
+{
+	return(GLEW_VERSION_4_3 != 0);
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the storage buffers,
+ *  with empty clusters, and attaching them to their binding
+ *  points.
+ ***********************************************************/
+bool ClusteredLights::Create()
+{
+	if (m_lightBuffer != 0)
+	{
+		return(true);
+	}
+
+	glGenBuffers(1, &m_lightBuffer);
+	glGenBuffers(1, &m_clusterBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+	if ((m_lightBuffer == 0) || (m_clusterBuffer == 0) || (m_indexBuffer == 0))
+	{
+		Destroy();
+		return(false);
+	}
+
+	// a storage buffer is never empty, so the blocks can be bound
+	// before the first light is added
+	POINT_LIGHT light;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(POINT_LIGHT), &light, GL_DYNAMIC_DRAW);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER,
+		sizeof(CLUSTER_HEADER) + m_ranges.size() * sizeof(glm::uvec2), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(CLUSTER_HEADER), &m_header);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+		sizeof(CLUSTER_HEADER), m_ranges.size() * sizeof(glm::uvec2), m_ranges.data());
+
+	uint32_t index = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_indexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), &index, GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHTS_BINDING, m_lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTERS_BINDING, m_clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDICES_BINDING, m_indexBuffer);
+	m_bLightsDirty = !m_lights.empty();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the storage buffers.
+ ***********************************************************/
+void ClusteredLights::Destroy()
+{
+	if (m_lightBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_lightBuffer);
+		m_lightBuffer = 0;
+	}
+	if (m_clusterBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_clusterBuffer);
+		m_clusterBuffer = 0;
+	}
+	if (m_indexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  BindBlock()
+ *
+ *  This method is used for attaching one named storage block
+ *  of a program to a binding point.  Programs that do not
+ *  use the block are silently skipped.
+ ***********************************************************/
+void ClusteredLights::BindBlock(GLuint programID, const char* blockName, GLuint binding)
+{
+	GLuint blockIndex = glGetProgramResourceIndex(programID, GL_SHADER_STORAGE_BLOCK, blockName);
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glShaderStorageBlockBinding(programID, blockIndex, binding);
+	}
+}
+
+/***********************************************************
+ *  BindShaderBlocks()
+ *
+ *  This method is used for attaching the light, cluster and
+ *  index storage blocks of a loaded program to the buffers.
+ *  GLSL 3.30 cannot name the binding points itself.
+ ***********************************************************/
+void ClusteredLights::BindShaderBlocks(ShaderManager* pShaderManager)
+{
+	if ((NULL == pShaderManager) || (pShaderManager->m_programID == 0) || !IsSupported())
+	{
+		return;
+	}
+
+	BindBlock(pShaderManager->m_programID, g_LightsBlockName, LIGHTS_BINDING);
+	BindBlock(pShaderManager->m_programID, g_ClustersBlockName, CLUSTERS_BINDING);
+	BindBlock(pShaderManager->m_programID, g_IndicesBlockName, INDICES_BINDING);
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a point light to the ones
+ *  sorted into the clusters.
+ ***********************************************************/
+int ClusteredLights::AddLight(const POINT_LIGHT& light)
+{
+	m_lights.push_back(light);
+	m_bLightsDirty = true;
+
+	return((int)m_lights.size() - 1);
+}
+
+/***********************************************************
+ *  GetLight()
+ *
+ *  This method is used for editing one light of the CPU
+ *  copy.
+ ***********************************************************/
+ClusteredLights::POINT_LIGHT& ClusteredLights::GetLight(int light)
+{
+	return(m_lights[light]);
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method is used for reading how many lights there
+ *  are.
+ ***********************************************************/
+int ClusteredLights::GetLightCount() const
+{
+	return((int)m_lights.size());
+}
+
+/***********************************************************
+ *  MarkLightsDirty()
+ *
+ *  This method is used for flagging the lights for upload
+ *  after one was edited through GetLight().
+ ***********************************************************/
+void ClusteredLights::MarkLightsDirty()
+{
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  ClearLights()
+ *
+ *  This method is used for removing every light.
+ ***********************************************************/
+void ClusteredLights::ClearLights()
+{
+	m_lights.clear();
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetClusterBox()
+ *
+ *  This method is used for bounding one cluster in view
+ *  space.  Its four tile corners are taken at the depths
+ *  where its slice starts and ends, which bounds it under
+ *  a perspective and an orthographic projection alike.
+ ***********************************************************/
+ClusteredLights::CLUSTER_BOX ClusteredLights::GetClusterBox(int slice, int tileX, int tileY) const
+{
+	CLUSTER_BOX box;
+	box.boxMin = glm::vec3(FLT_MAX);
+	box.boxMax = glm::vec3(-FLT_MAX);
+	for (int corner = 0; corner < 4; corner++)
+	{
+		int index = (tileY + corner / 2) * (CLUSTERS_X + 1) + tileX + corner % 2;
+		for (int end = 0; end < 2; end++)
+		{
+			glm::vec3 point = GetPointAtDepth(
+				m_cornerNear[index], m_cornerFar[index], m_sliceDepths[slice + end]);
+			box.boxMin = glm::min(box.boxMin, point);
+			box.boxMax = glm::max(box.boxMax, point);
+		}
+	}
+
+	return(box);
+}
+
+/***********************************************************
+ *  AssignSlice()
+ *
+ *  This method is used for filling the clusters of one
+ *  depth slice.  Only the lights whose range reaches the
+ *  depths of the slice are tested against its clusters, by
+ *  the distance from the light to the nearest point of the
+ *  cluster box.  The ranges are relative to the start of
+ *  the slice until the slices are joined.
+ ***********************************************************/
+void ClusteredLights::AssignSlice(int slice)
+{
+	std::vector<uint32_t>& indices = m_sliceIndices[slice];
+	indices.clear();
+
+	float sliceNear = m_sliceDepths[slice];
+	float sliceFar = m_sliceDepths[slice + 1];
+	for (int tileY = 0; tileY < CLUSTERS_Y; tileY++)
+	{
+		for (int tileX = 0; tileX < CLUSTERS_X; tileX++)
+		{
+			CLUSTER_BOX box = GetClusterBox(slice, tileX, tileY);
+			uint32_t first = (uint32_t)indices.size();
+			for (size_t light = 0; light < m_viewLights.size(); light++)
+			{
+				const glm::vec4& sphere = m_viewLights[light];
+				float depth = -sphere.z;
+				if ((depth + sphere.w < sliceNear) || (depth - sphere.w > sliceFar))
+					continue;
+
+				glm::vec3 center(sphere);
+				glm::vec3 offset = glm::clamp(center, box.boxMin, box.boxMax) - center;
+				if (glm::dot(offset, offset) <= sphere.w * sphere.w)
+				{
+					indices.push_back((uint32_t)light);
+				}
+			}
+
+			int cluster = (slice * CLUSTERS_Y + tileY) * CLUSTERS_X + tileX;
+			m_ranges[cluster] = glm::uvec2(first, (uint32_t)indices.size() - first);
+		}
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for sorting the lights into the
+ *  clusters of a camera.  The slices split the depth range
+ *  of the projection evenly in the log of the depth, so a
+ *  cluster is about as deep as it is wide at any distance.
+ *  Every slice is filled by a job of its own; the slices
+ *  are then joined in order into one index list, and the
+ *  ranges and indices are uploaded.
+ ***********************************************************/
+void ClusteredLights::Update(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	int viewportWidth,
+	int viewportHeight,
+	JobSystem& jobs)
+{
+	if ((m_lightBuffer == 0) || (viewportWidth <= 0) || (viewportHeight <= 0))
+	{
+		return;
+	}
+
+	if (m_bLightsDirty)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffer);
+		if (m_lights.empty())
+		{
+			POINT_LIGHT light;
+			glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(POINT_LIGHT), &light, GL_DYNAMIC_DRAW);
+		}
+		else
+		{
+			glBufferData(GL_SHADER_STORAGE_BUFFER,
+				m_lights.size() * sizeof(POINT_LIGHT), m_lights.data(), GL_DYNAMIC_DRAW);
+		}
+		m_bLightsDirty = false;
+	}
+
+	// depth range of the projection and the lines through the corners
+	// of the tiles, from the near plane to the far plane
+	glm::mat4 inverseProjection = glm::inverse(projection);
+	float nearDepth = -Unproject(inverseProjection, glm::vec3(0.0f, 0.0f, -1.0f)).z;
+	float farDepth = -Unproject(inverseProjection, glm::vec3(0.0f, 0.0f, 1.0f)).z;
+	nearDepth = std::max(nearDepth, g_MinSliceDepth);
+	farDepth = std::max(farDepth, nearDepth * 2.0f);
+	for (int y = 0; y <= CLUSTERS_Y; y++)
+	{
+		for (int x = 0; x <= CLUSTERS_X; x++)
+		{
+			glm::vec2 ndc(
+				-1.0f + 2.0f * (float)x / (float)CLUSTERS_X,
+				-1.0f + 2.0f * (float)y / (float)CLUSTERS_Y);
+			m_cornerNear[y * (CLUSTERS_X + 1) + x] = Unproject(inverseProjection, glm::vec3(ndc, -1.0f));
+			m_cornerFar[y * (CLUSTERS_X + 1) + x] = Unproject(inverseProjection, glm::vec3(ndc, 1.0f));
+		}
+	}
+	float logRange = std::log(farDepth / nearDepth);
+	for (int slice = 0; slice <= CLUSTERS_Z; slice++)
+	{
+		m_sliceDepths[slice] = nearDepth * std::exp(logRange * (float)slice / (float)CLUSTERS_Z);
+	}
+	m_header.clusterScale = glm::vec4(
+		(float)CLUSTERS_X / (float)viewportWidth,
+		(float)CLUSTERS_Y / (float)viewportHeight,
+		(float)CLUSTERS_Z / logRange,
+		-(float)CLUSTERS_Z * std::log(nearDepth) / logRange);
+
+	m_viewLights.resize(m_lights.size());
+	for (size_t light = 0; light < m_lights.size(); light++)
+	{
+		glm::vec4 center = view * glm::vec4(glm::vec3(m_lights[light].positionRange), 1.0f);
+		m_viewLights[light] = glm::vec4(glm::vec3(center), m_lights[light].positionRange.w);
+	}
+
+	jobs.ParallelFor(CLUSTERS_Z, 1,
+		[this](size_t, size_t begin, size_t end)
+	{
+		for (size_t slice = begin; slice < end; slice++)
+		{
+			AssignSlice((int)slice);
+		}
+	});
+
+	// the ranges of every slice move up by the indices before it
+	m_indices.clear();
+	m_maxClusterLights = 0;
+	for (int slice = 0; slice < CLUSTERS_Z; slice++)
+	{
+		uint32_t base = (uint32_t)m_indices.size();
+		for (int cluster = 0; cluster < CLUSTERS_X * CLUSTERS_Y; cluster++)
+		{
+			glm::uvec2& range = m_ranges[slice * CLUSTERS_X * CLUSTERS_Y + cluster];
+			range.x += base;
+			m_maxClusterLights = std::max(m_maxClusterLights, (int)range.y);
+		}
+		m_indices.insert(m_indices.end(), m_sliceIndices[slice].begin(), m_sliceIndices[slice].end());
+	}
+
+	// both are refilled every frame, so the old storage is orphaned
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER,
+		sizeof(CLUSTER_HEADER) + m_ranges.size() * sizeof(glm::uvec2), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(CLUSTER_HEADER), &m_header);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+		sizeof(CLUSTER_HEADER), m_ranges.size() * sizeof(glm::uvec2), m_ranges.data());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_indexBuffer);
+	if (m_indices.empty())
+	{
+		uint32_t index = 0;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), &index, GL_STREAM_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_SHADER_STORAGE_BUFFER,
+			m_indices.size() * sizeof(uint32_t), m_indices.data(), GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the points are attached again in case another pass used them
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHTS_BINDING, m_lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTERS_BINDING, m_clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDICES_BINDING, m_indexBuffer);
+}
+
+/***********************************************************
+ *  GetAssignedCount()
+ *
+ *  This method is used for reading how many light indices
+ *  all clusters held together in the last update.
+ ***********************************************************/
+int ClusteredLights::GetAssignedCount() const
+{
+	return((int)m_indices.size());
+}
+
+/***********************************************************
+ *  GetMaxClusterLights()
+ *
+ *  This method is used for reading the most lights any one
+ *  cluster held in the last update.
+ ***********************************************************/
+int ClusteredLights::GetMaxClusterLights() const
+{
+	return(m_maxClusterLights);
+}
@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlights.h
+// ============
+// assign the scene point lights to the clusters of the view frustum
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  ClusteredLights
+ *
+ *  This class keeps any number of point lights of limited
+ *  range in a shader storage buffer, and every frame sorts
+ *  them into the clusters of the view volume: a grid of
+ *  screen tiles, each cut into depth slices that grow with
+ *  the distance from the camera.  The lit fragment shader
+ *  finds the cluster of its pixel and depth and lights the
+ *  fragment with the lights of that cluster only, so its
+ *  cost follows the lights nearby and not the light count.
+ *
+ *  The clusters are filled on the CPU, one depth slice per
+ *  job, and uploaded as a range per cluster into one list
+ *  of light indices.  The lights of the lights block stay
+ *  as they are and are added on top.
+ ***********************************************************/
+class ClusteredLights
+{
+public:
+	// constructor
+	ClusteredLights();
+	// destructor
+	~ClusteredLights();
+
+	// clusters across, down and into the view volume
+	static const int CLUSTERS_X = 16;
+	static const int CLUSTERS_Y = 9;
+	static const int CLUSTERS_Z = 24;
+	static const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+	// storage buffer binding points; above those of GpuCulling
+	enum STORAGE_BINDING
+	{
+		LIGHTS_BINDING = 3,
+		CLUSTERS_BINDING = 4,
+		INDICES_BINDING = 5
+	};
+
+	// std430 mirror of ClusteredPointLight in fragmentShader.glsl
+	struct POINT_LIGHT
+	{
+		// xyz: world position, w: distance at which the light ends
+		glm::vec4 positionRange = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		// w: first of the six shadow atlas views of the light, in the
+		// order +X, -X, +Y, -Y, +Z, -Z, or -1 while it has none
+		glm::vec4 ambient = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+		glm::vec4 diffuse = glm::vec4(0.0f);
+		glm::vec4 specular = glm::vec4(0.0f);
+	};
+
+	// std430 mirror of the fixed start of LightClustersBlock
+	struct CLUSTER_HEADER
+	{
+		// clusters along each axis; w is unused
+		glm::uvec4 clusterCounts = glm::uvec4(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, 0);
+		// xy: clusters per pixel, z and w: scale and bias that map
+		// the log of the view depth to its slice
+		glm::vec4 clusterScale = glm::vec4(0.0f);
+	};
+
+private:
+	// view-space box of one cluster
+	struct CLUSTER_BOX
+	{
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+	};
+
+	// storage buffers of the lights, the cluster ranges and the
+	// light indices the ranges point into
+	GLuint m_lightBuffer;
+	GLuint m_clusterBuffer;
+	GLuint m_indexBuffer;
+	// CPU copy of the lights, and set when it differs from the GPU
+	std::vector<POINT_LIGHT> m_lights;
+	bool m_bLightsDirty;
+
+	// lights in view space as center and range, for the last view
+	std::vector<glm::vec4> m_viewLights;
+	// view-space ends of the lines through the tile corners at the
+	// near and the far plane
+	std::vector<glm::vec3> m_cornerNear;
+	std::vector<glm::vec3> m_cornerFar;
+	// depth at which every slice starts, and where the last one ends
+	float m_sliceDepths[CLUSTERS_Z + 1];
+	// per slice, filled by its own job: the light indices and the
+	// range of every cluster within them
+	std::vector<std::vector<uint32_t>> m_sliceIndices;
+	std::vector<glm::uvec2> m_ranges;
+	// header and ranges as uploaded, and the joined index list
+	CLUSTER_HEADER m_header;
+	std::vector<uint32_t> m_indices;
+	// most lights any one cluster held in the last frame
+	int m_maxClusterLights;
+
+	// fill the clusters of one depth slice
+	void AssignSlice(int slice);
+	// box of a cluster of a slice between two of its tile corners
+	CLUSTER_BOX GetClusterBox(int slice, int tileX, int tileY) const;
+	// attach one named storage block of a program to a binding point
+	static void BindBlock(GLuint programID, const char* blockName, GLuint binding);
+
+public:
+	// check for storage buffers; call with a current OpenGL context
+	static bool IsSupported();
+
+	// create the storage buffers
+	bool Create();
+	// free the storage buffers
+	void Destroy();
+
+	// attach the storage blocks of a lit program to the buffers
+	static void BindShaderBlocks(ShaderManager* pShaderManager);
+
+	// add a light and return its index; call MarkLightsDirty() after
+	// editing one through GetLight()
+	int AddLight(const POINT_LIGHT& light);
+	POINT_LIGHT& GetLight(int light);
+	int GetLightCount() const;
+	void MarkLightsDirty();
+	void ClearLights();
+
+	// sort the lights into the clusters of a camera and viewport
+	// size, on the jobs of a job system, and upload the result
+	void Update(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		int viewportWidth,
+		int viewportHeight,
+		JobSystem& jobs);
+
+	// light indices of all clusters together, and the most any one
+	// cluster held, in the last update
+	int GetAssignedCount() const;
+	int GetMaxClusterLights() const;
+};
@@ -0,0 +1,433 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// render the scene offscreen at a resolution that keeps to a frame budget
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+#include "ShaderCompiler.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texture unit the present pass samples the scene from
+	const int g_PresentTextureUnit = 0;
+
+	// share of the budget a new scale aims for, so a frame near the
+	// budget does not go over it with the next small spike, and the
+	// share below which the scale is raised again
+	const float g_BudgetTarget = 0.9f;
+	const float g_BudgetRaiseBelow = 0.75f;
+	// most steps the scale drops or rises in one change
+	const int g_MaxStepsDown = 3;
+	const int g_MaxStepsUp = 1;
+	// finished frames the scale is held at a limit before the tier
+	// moves, and the share of the budget at the highest scale below
+	// which a tier is raised again
+	const int g_TierHoldFrames = 120;
+	const float g_TierRaiseBelow = 0.5f;
+
+	// shadow atlas side of each quality tier
+	const int g_ShadowAtlasSizes[DynamicResolution::QUALITY_TIER_COUNT] = { 1024, 2048, 4096 };
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution()
+{
+	m_sceneFBO = 0;
+	m_colorTexture = 0;
+	m_depthTexture = 0;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	m_pPresentShader = NULL;
+	m_presentVAO = 0;
+	m_sourceScaleLocation = -1;
+	m_sourceMaxLocation = -1;
+	m_frameBudgetMs = 0.0f;
+	m_scaleSteps = SCALE_STEPS;
+	m_qualityTier = QUALITY_HIGH;
+	m_maxQualityTier = QUALITY_HIGH;
+	m_settledFrame = 0;
+	m_nextSampleFrame = 0;
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+}
+
+/***********************************************************
+ *  ~DynamicResolution()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DynamicResolution::~DynamicResolution()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for loading the present program and
+ *  the empty vertex array its triangle is drawn with.  The
+ *  target itself follows the window in Resize().
+ ***********************************************************/
+bool DynamicResolution::Create()
+{
+	if (m_pPresentShader != NULL)
+	{
+		return(true);
+	}
+
+	m_pPresentShader = ShaderCompiler::CreateShaderManager(NULL);
+	if (!ShaderCompiler::LoadProgram(
+		m_pPresentShader,
+		"shaders/presentVertex.glsl",
+		"shaders/presentFragment.glsl",
+		ShaderCompiler::DEFINES()))
+	{
+		std::cout << "Cannot render offscreen: present program is not loaded" << std::endl;
+		delete m_pPresentShader;
+		m_pPresentShader = NULL;
+		return(false);
+	}
+
+	GLuint programID = m_pPresentShader->m_programID;
+	m_pPresentShader->use();
+	glUniform1i(glGetUniformLocation(programID, "sceneColor"), g_PresentTextureUnit);
+	m_sourceScaleLocation = glGetUniformLocation(programID, "sourceScale");
+	m_sourceMaxLocation = glGetUniformLocation(programID, "sourceMax");
+
+	glGenVertexArrays(1, &m_presentVAO);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the target and the
+ *  present program.
+ ***********************************************************/
+void DynamicResolution::Destroy()
+{
+	DestroyTarget();
+	if (m_presentVAO != 0)
+	{
+		glDeleteVertexArrays(1, &m_presentVAO);
+		m_presentVAO = 0;
+	}
+	delete m_pPresentShader;
+	m_pPresentShader = NULL;
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method is used for creating the HDR color and the
+ *  depth texture of a window size and the framebuffer that
+ *  draws into both.  The depth has the format of the copy
+ *  the occlusion culling takes of it.
+ ***********************************************************/
+void DynamicResolution::CreateTarget(int width, int height)
+{
+	DestroyTarget();
+	m_targetWidth = width;
+	m_targetHeight = height;
+
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &m_sceneFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Cannot render offscreen: scene target is incomplete" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		DestroyTarget();
+		return;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method is used for freeing the target textures and
+ *  their framebuffer.
+ ***********************************************************/
+void DynamicResolution::DestroyTarget()
+{
+	if (m_sceneFBO != 0)
+	{
+		glDeleteFramebuffers(1, &m_sceneFBO);
+		m_sceneFBO = 0;
+	}
+	if (m_colorTexture != 0)
+	{
+		glDeleteTextures(1, &m_colorTexture);
+		m_colorTexture = 0;
+	}
+	if (m_depthTexture != 0)
+	{
+		glDeleteTextures(1, &m_depthTexture);
+		m_depthTexture = 0;
+	}
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+}
+
+/***********************************************************
+ *  SetFrameBudget()
+ *
+ *  This method is used for setting the frame time in
+ *  milliseconds the scale keeps to.  Without a budget the
+ *  scene is drawn at the window size and the tier stays.
+ ***********************************************************/
+void DynamicResolution::SetFrameBudget(float milliseconds)
+{
+	m_frameBudgetMs = std::max(milliseconds, 0.0f);
+	if (m_frameBudgetMs == 0.0f)
+	{
+		m_scaleSteps = SCALE_STEPS;
+		m_qualityTier = m_maxQualityTier;
+	}
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+}
+
+/***********************************************************
+ *  GetFrameBudget()
+ *
+ *  This method is used for reading the frame budget in
+ *  milliseconds, 0 when there is none.
+ ***********************************************************/
+float DynamicResolution::GetFrameBudget() const
+{
+	return(m_frameBudgetMs);
+}
+
+/***********************************************************
+ *  SetQualityTier()
+ *
+ *  This method is used for setting the highest tier, which
+ *  is also the tier until the frame budget moves it.
+ ***********************************************************/
+void DynamicResolution::SetQualityTier(QUALITY_TIER tier)
+{
+	m_maxQualityTier = tier;
+	m_qualityTier = tier;
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+}
+
+/***********************************************************
+ *  GetQualityTier()
+ *
+ *  This method is used for reading the current tier.
+ ***********************************************************/
+DynamicResolution::QUALITY_TIER DynamicResolution::GetQualityTier() const
+{
+	return(m_qualityTier);
+}
+
+/***********************************************************
+ *  GetShadowAtlasSize()
+ *
+ *  This method is used for reading the shadow atlas side of
+ *  a tier in texels.
+ ***********************************************************/
+int DynamicResolution::GetShadowAtlasSize(QUALITY_TIER tier)
+{
+	return(g_ShadowAtlasSizes[tier]);
+}
+
+/***********************************************************
+ *  GetScale()
+ *
+ *  This method is used for reading the share of the window
+ *  size the scene is drawn at.
+ ***********************************************************/
+float DynamicResolution::GetScale() const
+{
+	return((float)m_scaleSteps / (float)SCALE_STEPS);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for fitting the scale to the frame
+ *  budget once per finished frame.  Its GPU time of the
+ *  shadow and scene sections, or their CPU time without GPU
+ *  timers, is taken to grow with the square of the scale.
+ *  Frames begun before the last change are skipped, as the
+ *  profiler reads them back a few frames late.
+ ***********************************************************/
+void DynamicResolution::Update(const FrameProfiler& profiler)
+{
+	const FrameProfiler::FRAME_SAMPLE* pSample = profiler.GetLastFrame();
+	if ((m_frameBudgetMs <= 0.0f) || (NULL == pSample) ||
+		(pSample->frameIndex < m_settledFrame) ||
+		(pSample->frameIndex < m_nextSampleFrame))
+	{
+		return;
+	}
+	m_nextSampleFrame = pSample->frameIndex + 1;
+
+	float frameMs = 0.0f;
+	if (pSample->bGpuTimed[FrameProfiler::SECTION_SCENE])
+	{
+		frameMs = pSample->gpuMs[FrameProfiler::SECTION_SHADOW] + pSample->gpuMs[FrameProfiler::SECTION_SCENE];
+	}
+	else
+	{
+		frameMs = pSample->cpuMs[FrameProfiler::SECTION_SHADOW] + pSample->cpuMs[FrameProfiler::SECTION_SCENE];
+	}
+	if (frameMs <= 0.0f)
+	{
+		return;
+	}
+
+	int steps = m_scaleSteps;
+	if ((frameMs > m_frameBudgetMs) || (frameMs < m_frameBudgetMs * g_BudgetRaiseBelow))
+	{
+		float scale = GetScale() * std::sqrt(m_frameBudgetMs * g_BudgetTarget / frameMs);
+		steps = (int)std::floor(scale * (float)SCALE_STEPS + 0.5f);
+		steps = glm::clamp(steps, m_scaleSteps - g_MaxStepsDown, m_scaleSteps + g_MaxStepsUp);
+		steps = glm::clamp(steps, (int)MIN_SCALE_STEPS, (int)SCALE_STEPS);
+	}
+
+	// a scale stuck at a limit hands the rest of the change to the
+	// tier, which is held for a while so it does not flicker
+	m_overBudgetFrames = ((steps == MIN_SCALE_STEPS) && (frameMs > m_frameBudgetMs)) ? m_overBudgetFrames + 1 : 0;
+	m_underBudgetFrames = ((steps == SCALE_STEPS) && (frameMs < m_frameBudgetMs * g_TierRaiseBelow)) ? m_underBudgetFrames + 1 : 0;
+	bool bChanged = (steps != m_scaleSteps);
+	if ((m_overBudgetFrames >= g_TierHoldFrames) && (m_qualityTier > QUALITY_LOW))
+	{
+		m_qualityTier = (QUALITY_TIER)(m_qualityTier - 1);
+		m_overBudgetFrames = 0;
+		bChanged = true;
+	}
+	else if ((m_underBudgetFrames >= g_TierHoldFrames) && (m_qualityTier < m_maxQualityTier))
+	{
+		m_qualityTier = (QUALITY_TIER)(m_qualityTier + 1);
+		m_underBudgetFrames = 0;
+		bChanged = true;
+	}
+
+	if (bChanged)
+	{
+		m_scaleSteps = steps;
+		m_settledFrame = profiler.GetFrameCount();
+	}
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for reallocating the target when
+ *  the window size changed.  A minimized window keeps it.
+ ***********************************************************/
+void DynamicResolution::Resize(int windowWidth, int windowHeight)
+{
+	if ((m_pPresentShader == NULL) || (windowWidth <= 0) || (windowHeight <= 0))
+	{
+		return;
+	}
+	if ((m_sceneFBO != 0) && (windowWidth == m_targetWidth) && (windowHeight == m_targetHeight))
+	{
+		return;
+	}
+
+	CreateTarget(windowWidth, windowHeight);
+}
+
+/***********************************************************
+ *  BeginScene()
+ *
+ *  This method is used for binding the target with the
+ *  viewport of the frame scale and clearing that part.  The
+ *  passes of the scene read the size back from the viewport.
+ ***********************************************************/
+void DynamicResolution::BeginScene(RenderStateCache& glState)
+{
+	if (m_sceneFBO == 0)
+	{
+		return;
+	}
+
+	int width = std::max((m_targetWidth * m_scaleSteps) / SCALE_STEPS, 1);
+	int height = std::max((m_targetHeight * m_scaleSteps) / SCALE_STEPS, 1);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
+	glViewport(0, 0, width, height);
+
+	glState.SetDepthMask(true);
+	glState.SetColorMask(true);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+/***********************************************************
+ *  Present()
+ *
+ *  This method is used for drawing the scene part of the
+ *  target over the whole window with one triangle.  The
+ *  window viewport is left set.
+ ***********************************************************/
+void DynamicResolution::Present(RenderStateCache& glState)
+{
+	if (m_sceneFBO == 0)
+	{
+		return;
+	}
+
+	int width = std::max((m_targetWidth * m_scaleSteps) / SCALE_STEPS, 1);
+	int height = std::max((m_targetHeight * m_scaleSteps) / SCALE_STEPS, 1);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_targetWidth, m_targetHeight);
+
+	glState.SetDepthTest(false);
+	glState.SetBlend(false);
+	glState.UseProgram(m_pPresentShader);
+	glState.BindTexture2D(g_PresentTextureUnit, m_colorTexture);
+	glUniform2f(m_sourceScaleLocation,
+		(float)width / (float)m_targetWidth,
+		(float)height / (float)m_targetHeight);
+	glUniform2f(m_sourceMaxLocation,
+		((float)width - 0.5f) / (float)m_targetWidth,
+		((float)height - 0.5f) / (float)m_targetHeight);
+
+	glBindVertexArray(m_presentVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	// the next frame draws into the texture, so it must not stay
+	// bound to a unit the scene programs sample
+	glState.BindTexture2D(g_PresentTextureUnit, 0);
+	glState.SetDepthTest(true);
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// render the scene offscreen at a resolution that keeps to a frame budget
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameProfiler.h"
+#include "RenderStateCache.h"
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  This class owns the HDR target the scene is drawn into
+ *  and the pass that scales it up to the window and maps it
+ *  to the display range.  The target has the size of the
+ *  window; a frame draws into the lower left part of it at
+ *  the resolution scale of the frame, so changing the scale
+ *  never reallocates it.
+ *
+ *  With a frame budget set, the scale follows the GPU time
+ *  of the newest finished frame: the pixel cost grows with
+ *  the square of the scale, so the scale that fits the
+ *  budget is estimated from it, dropped quickly and raised
+ *  slowly.  A scale held at either limit for a while moves
+ *  the quality tier, which sizes the shadow atlas.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+	// constructor
+	DynamicResolution();
+	// destructor
+	~DynamicResolution();
+
+	// quality tiers, from the cheapest up
+	enum QUALITY_TIER
+	{
+		QUALITY_LOW = 0,
+		QUALITY_MEDIUM,
+		QUALITY_HIGH,
+		QUALITY_TIER_COUNT
+	};
+
+	// the scale moves in steps of 1 / SCALE_STEPS, from
+	// MIN_SCALE_STEPS of them up to all of them
+	static const int SCALE_STEPS = 20;
+	static const int MIN_SCALE_STEPS = 10;
+
+private:
+	// HDR color and depth of the scene, and the framebuffer of both
+	GLuint m_sceneFBO;
+	GLuint m_colorTexture;
+	GLuint m_depthTexture;
+	int m_targetWidth;
+	int m_targetHeight;
+	// program and empty vertex array of the present pass
+	ShaderManager* m_pPresentShader;
+	GLuint m_presentVAO;
+	GLint m_sourceScaleLocation;
+	GLint m_sourceMaxLocation;
+
+	// frame time to keep to in milliseconds, or 0 for a fixed scale
+	float m_frameBudgetMs;
+	// current scale in steps, and the tier with the highest allowed
+	int m_scaleSteps;
+	QUALITY_TIER m_qualityTier;
+	QUALITY_TIER m_maxQualityTier;
+	// frames before this one were drawn before the last change and
+	// say nothing about it; the first frame not looked at yet
+	unsigned long long m_settledFrame;
+	unsigned long long m_nextSampleFrame;
+	// finished frames in a row with the scale at its lowest and
+	// over budget, or at its highest and far below it
+	int m_overBudgetFrames;
+	int m_underBudgetFrames;
+
+	// create the target for a window size
+	void CreateTarget(int width, int height);
+	// free the target
+	void DestroyTarget();
+
+public:
+	// load the present program; false leaves the scene in the window
+	bool Create();
+	// free the target and the present program
+	void Destroy();
+
+	// frame time to keep to; 0 holds the scale at its highest
+	void SetFrameBudget(float milliseconds);
+	float GetFrameBudget() const;
+	// highest tier, which the frame budget may lower and raise back
+	void SetQualityTier(QUALITY_TIER tier);
+	QUALITY_TIER GetQualityTier() const;
+	// texels along each side of the shadow atlas of a tier
+	static int GetShadowAtlasSize(QUALITY_TIER tier);
+	// share of the window size the scene is drawn at
+	float GetScale() const;
+
+	// adjust the scale and the tier to the newest finished frame
+	// of a profiler
+	void Update(const FrameProfiler& profiler);
+	// make the target fit a window size
+	void Resize(int windowWidth, int windowHeight);
+	// bind the target at the scale of the frame and clear it
+	void BeginScene(RenderStateCache& glState);
+	// scale the scene up into the window
+	void Present(RenderStateCache& glState);
+};
@@ -0,0 +1,657 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// CPU and GPU frame timing, per-pass render counters and rolling statistics
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// section names used in the log columns
+	const char* g_SectionNames[FrameProfiler::SECTION_COUNT] =
+	{
+		"frame",
+		"shadow",
+		"scene",
+		"swap"
+	};
+
+	// pass names used in the log columns
+	const char* g_PassNames[FrameProfiler::PASS_COUNT] =
+	{
+		"shadow",
+		"lit"
+	};
+
+	// only the render passes are timed on the GPU; the frame spans
+	// them and the swap is dominated by presentation
+	bool IsGpuSection(FrameProfiler::PROFILE_SECTION section)
+	{
+		return((section == FrameProfiler::SECTION_SHADOW) ||
+			(section == FrameProfiler::SECTION_SCENE));
+	}
+}
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler()
+{
+	for (int slot = 0; slot < FRAME_LATENCY; slot++)
+	{
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			m_queries[slot][section] = 0;
+		}
+	}
+	for (int section = 0; section < SECTION_COUNT; section++)
+	{
+		m_cpuHistory[section].assign(HISTORY_LENGTH, 0.0f);
+		m_gpuHistory[section].assign(HISTORY_LENGTH, 0.0f);
+	}
+	m_currentSlot = 0;
+	m_frameIndex = 0;
+	m_bInFrame = false;
+	m_bGpuTiming = false;
+	m_activeGpuSection = -1;
+	m_historyNext = 0;
+	m_historyCount = 0;
+	m_bKeepFrames = false;
+	m_logFormat = LOG_NONE;
+	m_loggedFrames = 0;
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	Shutdown();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating one GL_TIME_ELAPSED
+ *  query per section and frame slot.  It needs a current
+ *  OpenGL context.
+ ***********************************************************/
+bool FrameProfiler::Initialize()
+{
+	if (m_bGpuTiming)
+	{
+		return(true);
+	}
+
+	for (int slot = 0; slot < FRAME_LATENCY; slot++)
+	{
+		glGenQueries(SECTION_COUNT, m_queries[slot]);
+	}
+	m_bGpuTiming = (m_queries[0][0] != 0);
+	if (!m_bGpuTiming)
+	{
+		std::cout << "GPU timer queries are unavailable; profiling CPU time only" << std::endl;
+	}
+
+	return(m_bGpuTiming);
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for reading back the frames still in
+ *  flight, so the log is complete, and then deleting the
+ *  queries and closing the log.
+ ***********************************************************/
+void FrameProfiler::Shutdown()
+{
+	// finish the pending frames oldest first
+	for (int i = 0; i < FRAME_LATENCY; i++)
+	{
+		int slot = (int)((m_frameIndex + i) % FRAME_LATENCY);
+		if (m_frames[slot].bPending)
+		{
+			ResolveFrame(slot, true);
+		}
+	}
+
+	if (m_bGpuTiming)
+	{
+		for (int slot = 0; slot < FRAME_LATENCY; slot++)
+		{
+			glDeleteQueries(SECTION_COUNT, m_queries[slot]);
+			for (int section = 0; section < SECTION_COUNT; section++)
+			{
+				m_queries[slot][section] = 0;
+			}
+		}
+		m_bGpuTiming = false;
+	}
+
+	if (m_log.is_open())
+	{
+		if (m_logFormat == LOG_JSON)
+		{
+			m_log << "\n]\n";
+		}
+		m_log.close();
+	}
+	m_logFormat = LOG_NONE;
+}
+
+/***********************************************************
+ *  OpenLog()
+ *
+ *  This method is used for opening a per-frame log.  A file
+ *  name ending in .json gets a JSON array of frame objects,
+ *  anything else gets CSV rows.
+ ***********************************************************/
+bool FrameProfiler::OpenLog(const std::string& filename)
+{
+	m_log.open(filename.c_str(), std::ios::out | std::ios::trunc);
+	if (!m_log.is_open())
+	{
+		std::cout << "Could not open profiling log:" << filename << std::endl;
+		return(false);
+	}
+
+	bool bJson = (filename.size() >= 5) &&
+		(filename.compare(filename.size() - 5, 5, ".json") == 0);
+	m_logFormat = bJson ? LOG_JSON : LOG_CSV;
+	m_loggedFrames = 0;
+
+	if (m_logFormat == LOG_JSON)
+	{
+		m_log << "[";
+	}
+	else
+	{
+		m_log << "frame";
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			m_log << ",cpu_" << g_SectionNames[section] << "_ms";
+		}
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			if (IsGpuSection((PROFILE_SECTION)section))
+				m_log << ",gpu_" << g_SectionNames[section] << "_ms";
+		}
+		for (int pass = 0; pass < PASS_COUNT; pass++)
+		{
+			const char* name = g_PassNames[pass];
+			m_log << "," << name << "_draws"
+				<< "," << name << "_triangles"
+				<< "," << name << "_uniform_uploads"
+				<< "," << name << "_texture_binds"
+				<< "," << name << "_objects_drawn"
+				<< "," << name << "_objects_culled"
+				<< "," << name << "_allocations";
+		}
+		m_log << "\n";
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetKeepFrames()
+ *
+ *  This method is used for keeping every finished frame, so
+ *  statistics can be computed over a whole run.
+ ***********************************************************/
+void FrameProfiler::SetKeepFrames(bool bKeep)
+{
+	m_bKeepFrames = bKeep;
+}
+
+/***********************************************************
+ *  GetKeptFrames()
+ *
+ *  This method is used for reading the frames kept since
+ *  SetKeepFrames() was turned on, oldest first.
+ ***********************************************************/
+const std::vector<FrameProfiler::FRAME_SAMPLE>& FrameProfiler::GetKeptFrames() const
+{
+	return(m_keptFrames);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame.  The slot it
+ *  reuses belongs to the frame FRAME_LATENCY frames back;
+ *  its results are read if ready and dropped otherwise, so
+ *  the CPU never waits on the GPU here.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	m_currentSlot = (int)(m_frameIndex % FRAME_LATENCY);
+
+	FRAME_RECORD& record = m_frames[m_currentSlot];
+	if (record.bPending && !ResolveFrame(m_currentSlot, false))
+	{
+		// the GPU is more than FRAME_LATENCY frames behind; keep the
+		// CPU times and lose the GPU times of that frame
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			record.bGpuTimed[section] = false;
+		}
+		FinishFrame(record);
+	}
+
+	record = FRAME_RECORD();
+	record.frameIndex = m_frameIndex;
+	m_activeGpuSection = -1;
+	m_bInFrame = true;
+
+	m_sectionStart[SECTION_FRAME] = CLOCK::now();
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing the CPU side of a frame.
+ *  Without GPU timing the frame is complete right away.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+	if (!m_bInFrame)
+	{
+		return;
+	}
+
+	FRAME_RECORD& record = m_frames[m_currentSlot];
+	std::chrono::duration<float, std::milli> elapsed = CLOCK::now() - m_sectionStart[SECTION_FRAME];
+	record.cpuMs[SECTION_FRAME] = elapsed.count();
+
+	record.bPending = true;
+	m_bInFrame = false;
+	m_frameIndex++;
+
+	if (!m_bGpuTiming)
+	{
+		ResolveFrame(m_currentSlot, false);
+	}
+}
+
+/***********************************************************
+ *  BeginSection()
+ *
+ *  This method is used for starting the timers of a section.
+ ***********************************************************/
+void FrameProfiler::BeginSection(PROFILE_SECTION section)
+{
+	if (!m_bInFrame || (section == SECTION_FRAME))
+	{
+		return;
+	}
+
+	m_sectionStart[section] = CLOCK::now();
+
+	// GL_TIME_ELAPSED queries cannot overlap
+	if (m_bGpuTiming && IsGpuSection(section) && (m_activeGpuSection < 0))
+	{
+		glBeginQuery(GL_TIME_ELAPSED, m_queries[m_currentSlot][section]);
+		m_activeGpuSection = section;
+	}
+}
+
+/***********************************************************
+ *  EndSection()
+ *
+ *  This method is used for stopping the timers of a section.
+ ***********************************************************/
+void FrameProfiler::EndSection(PROFILE_SECTION section)
+{
+	if (!m_bInFrame || (section == SECTION_FRAME))
+	{
+		return;
+	}
+
+	FRAME_RECORD& record = m_frames[m_currentSlot];
+	std::chrono::duration<float, std::milli> elapsed = CLOCK::now() - m_sectionStart[section];
+	record.cpuMs[section] += elapsed.count();
+
+	if (m_activeGpuSection == section)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		record.bGpuTimed[section] = true;
+		m_activeGpuSection = -1;
+	}
+}
+
+/***********************************************************
+ *  SetPassCounters()
+ *
+ *  This method is used for recording the counters of a pass
+ *  for the current frame.
+ ***********************************************************/
+void FrameProfiler::SetPassCounters(PROFILE_PASS pass, const PASS_COUNTERS& counters)
+{
+	if (m_bInFrame)
+	{
+		m_frames[m_currentSlot].counters[pass] = counters;
+	}
+}
+
+/***********************************************************
+ *  ResolveFrame()
+ *
+ *  This method is used for reading the GPU times of a pending
+ *  frame.  It returns false, leaving the frame pending, when
+ *  a result is not available yet and bWait is false.
+ ***********************************************************/
+bool FrameProfiler::ResolveFrame(int slot, bool bWait)
+{
+	FRAME_RECORD& record = m_frames[slot];
+
+	if (!bWait)
+	{
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			if (!record.bGpuTimed[section])
+				continue;
+
+			GLint available = 0;
+			glGetQueryObjectiv(m_queries[slot][section], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+			{
+				return(false);
+			}
+		}
+	}
+
+	for (int section = 0; section < SECTION_COUNT; section++)
+	{
+		if (!record.bGpuTimed[section])
+			continue;
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(m_queries[slot][section], GL_QUERY_RESULT, &nanoseconds);
+		record.gpuMs[section] = (float)((double)nanoseconds / 1.0e6);
+	}
+
+	FinishFrame(record);
+	record.bPending = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FinishFrame()
+ *
+ *  This method is used for adding a finished frame to the
+ *  rolling history and the log.
+ ***********************************************************/
+void FrameProfiler::FinishFrame(const FRAME_RECORD& record)
+{
+	for (int section = 0; section < SECTION_COUNT; section++)
+	{
+		m_cpuHistory[section][m_historyNext] = record.cpuMs[section];
+		m_gpuHistory[section][m_historyNext] = record.gpuMs[section];
+	}
+	m_historyNext = (m_historyNext + 1) % HISTORY_LENGTH;
+	m_historyCount = std::min(m_historyCount + 1, (int)HISTORY_LENGTH);
+
+	m_lastFrame = record;
+
+	if (m_bKeepFrames)
+	{
+		m_keptFrames.push_back(record);
+	}
+
+	WriteLogRecord(record);
+}
+
+/***********************************************************
+ *  WriteLogRecord()
+ *
+ *  This method is used for writing one finished frame to the
+ *  log in the format chosen by OpenLog().
+ ***********************************************************/
+void FrameProfiler::WriteLogRecord(const FRAME_RECORD& record)
+{
+	if (m_logFormat == LOG_CSV)
+	{
+		m_log << record.frameIndex;
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			m_log << "," << record.cpuMs[section];
+		}
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			if (!IsGpuSection((PROFILE_SECTION)section))
+				continue;
+			m_log << ",";
+			if (record.bGpuTimed[section])
+				m_log << record.gpuMs[section];
+		}
+		for (int pass = 0; pass < PASS_COUNT; pass++)
+		{
+			const PASS_COUNTERS& c = record.counters[pass];
+			m_log << "," << c.drawCalls << "," << c.triangles << "," << c.uniformUploads
+				<< "," << c.textureBinds << "," << c.objectsDrawn << "," << c.objectsCulled
+				<< "," << c.allocations;
+		}
+		m_log << "\n";
+	}
+	else if (m_logFormat == LOG_JSON)
+	{
+		m_log << ((m_loggedFrames == 0) ? "\n" : ",\n");
+		m_log << "{\"frame\":" << record.frameIndex << ",\"cpu_ms\":{";
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			m_log << ((section == 0) ? "" : ",") << "\"" << g_SectionNames[section] << "\":" << record.cpuMs[section];
+		}
+		m_log << "},\"gpu_ms\":{";
+		bool bFirst = true;
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			if (!IsGpuSection((PROFILE_SECTION)section) || !record.bGpuTimed[section])
+				continue;
+			m_log << (bFirst ? "" : ",") << "\"" << g_SectionNames[section] << "\":" << record.gpuMs[section];
+			bFirst = false;
+		}
+		m_log << "}";
+		for (int pass = 0; pass < PASS_COUNT; pass++)
+		{
+			const PASS_COUNTERS& c = record.counters[pass];
+			m_log << ",\"" << g_PassNames[pass] << "\":{"
+				<< "\"draws\":" << c.drawCalls
+				<< ",\"triangles\":" << c.triangles
+				<< ",\"uniform_uploads\":" << c.uniformUploads
+				<< ",\"texture_binds\":" << c.textureBinds
+				<< ",\"objects_drawn\":" << c.objectsDrawn
+				<< ",\"objects_culled\":" << c.objectsCulled
+				<< ",\"allocations\":" << c.allocations << "}";
+		}
+		m_log << "}";
+	}
+	m_loggedFrames++;
+}
+
+/***********************************************************
+ *  ComputeStats()
+ *
+ *  This method is used for computing min, average and 99th
+ *  percentile over the filled part of a history.
+ ***********************************************************/
+FrameProfiler::TIMING_STATS FrameProfiler::ComputeStats(const std::vector<float>& history) const
+{
+	TIMING_STATS stats;
+	if (m_historyCount == 0)
+	{
+		return(stats);
+	}
+
+	std::vector<float> values(history.begin(), history.begin() + m_historyCount);
+
+	float sum = 0.0f;
+	stats.minMs = values[0];
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		stats.minMs = std::min(stats.minMs, values[i]);
+		sum += values[i];
+	}
+	stats.avgMs = sum / (float)values.size();
+
+	size_t p99 = (size_t)((values.size() * 99 + 99) / 100) - 1;
+	std::nth_element(values.begin(), values.begin() + p99, values.end());
+	stats.p99Ms = values[p99];
+
+	return(stats);
+}
+
+/***********************************************************
+ *  GetCpuStats()
+ *
+ *  This method is used for reading the rolling CPU times of
+ *  a section.
+ ***********************************************************/
+FrameProfiler::TIMING_STATS FrameProfiler::GetCpuStats(PROFILE_SECTION section) const
+{
+	return(ComputeStats(m_cpuHistory[section]));
+}
+
+/***********************************************************
+ *  GetGpuStats()
+ *
+ *  This method is used for reading the rolling GPU times of
+ *  a section.
+ ***********************************************************/
+FrameProfiler::TIMING_STATS FrameProfiler::GetGpuStats(PROFILE_SECTION section) const
+{
+	return(ComputeStats(m_gpuHistory[section]));
+}
+
+/***********************************************************
+ *  GetLastCounters()
+ *
+ *  This method is used for reading the counters of a pass in
+ *  the newest finished frame.
+ ***********************************************************/
+const FrameProfiler::PASS_COUNTERS& FrameProfiler::GetLastCounters(PROFILE_PASS pass) const
+{
+	return(m_lastFrame.counters[pass]);
+}
+
+/***********************************************************
+ *  GetLastFrame()
+ *
+ *  This method is used for reading everything measured for
+ *  the newest finished frame, or NULL before there is one.
+ ***********************************************************/
+const FrameProfiler::FRAME_SAMPLE* FrameProfiler::GetLastFrame() const
+{
+	if (m_historyCount == 0)
+	{
+		return(NULL);
+	}
+	return(&m_lastFrame);
+}
+
+/***********************************************************
+ *  HasGpuTiming()
+ *
+ *  This method is used for checking whether GPU times are
+ *  being measured.
+ ***********************************************************/
+bool FrameProfiler::HasGpuTiming() const
+{
+	return(m_bGpuTiming);
+}
+
+/***********************************************************
+ *  GetFrameCount()
+ *
+ *  This method is used for reading the number of frames
+ *  started so far.
+ ***********************************************************/
+unsigned long long FrameProfiler::GetFrameCount() const
+{
+	return(m_frameIndex);
+}
+
+/***********************************************************
+ *  GetSummary()
+ *
+ *  This method is used for formatting the rolling statistics
+ *  and the newest counters into one line of text.
+ ***********************************************************/
+std::string FrameProfiler::GetSummary() const
+{
+	std::ostringstream text;
+	text << std::fixed << std::setprecision(2);
+
+	TIMING_STATS frame = GetCpuStats(SECTION_FRAME);
+	text << "frame " << frame.minMs << "/" << frame.avgMs << "/" << frame.p99Ms << " ms (min/avg/p99)";
+
+	const PROFILE_SECTION passes[2] = { SECTION_SHADOW, SECTION_SCENE };
+	for (int i = 0; i < 2; i++)
+	{
+		TIMING_STATS cpu = GetCpuStats(passes[i]);
+		text << " | " << g_SectionNames[passes[i]] << " cpu " << cpu.avgMs;
+		if (m_bGpuTiming)
+		{
+			TIMING_STATS gpu = GetGpuStats(passes[i]);
+			text << " gpu " << gpu.avgMs << "/" << gpu.p99Ms;
+		}
+	}
+	text << " | swap " << GetCpuStats(SECTION_SWAP).avgMs;
+
+	for (int pass = 0; pass < PASS_COUNT; pass++)
+	{
+		const PASS_COUNTERS& c = m_lastFrame.counters[pass];
+		text << " | " << g_PassNames[pass]
+			<< " draws " << c.drawCalls
+			<< " tris " << c.triangles
+			<< " uniforms " << c.uniformUploads
+			<< " binds " << c.textureBinds
+			<< " culled " << c.objectsCulled << "/" << (c.objectsDrawn + c.objectsCulled)
+			<< " allocs " << c.allocations;
+	}
+
+	return(text.str());
+}
+
+/***********************************************************
+ *  ProfileScope()
+ *
+ *  The constructor for the class; it starts the section.
+ ***********************************************************/
+ProfileScope::ProfileScope(FrameProfiler* pProfiler, FrameProfiler::PROFILE_SECTION section)
+{
+	m_pProfiler = pProfiler;
+	m_section = section;
+	if (NULL != m_pProfiler)
+	{
+		m_pProfiler->BeginSection(m_section);
+	}
+}
+
+/***********************************************************
+ *  ~ProfileScope()
+ *
+ *  The destructor for the class; it stops the section.
+ ***********************************************************/
+ProfileScope::~ProfileScope()
+{
+	if (NULL != m_pProfiler)
+	{
+		m_pProfiler->EndSection(m_section);
+	}
+}
@@ -0,0 +1,199 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// CPU and GPU frame timing, per-pass render counters and rolling statistics
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class times the sections of every frame on the CPU
+ *  with a steady clock and on the GPU with GL_TIME_ELAPSED
+ *  queries.  The queries of a frame are read back
+ *  FRAME_LATENCY frames later, and only once their results
+ *  are available, so reading them never stalls the
+ *  pipeline.
+ *
+ *  The counters of each render pass are handed in by the
+ *  scene after the pass.  Finished frames feed a rolling
+ *  history for min/avg/p99 and, when a log is open, one
+ *  CSV row or JSON line each.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler();
+	// destructor
+	~FrameProfiler();
+
+	// timed parts of a frame; sections must not nest, except that
+	// SECTION_FRAME, which is timed on the CPU only, spans them all
+	enum PROFILE_SECTION
+	{
+		SECTION_FRAME = 0,
+		SECTION_SHADOW,
+		SECTION_SCENE,
+		SECTION_SWAP,
+		SECTION_COUNT
+	};
+
+	// render passes that report counters
+	enum PROFILE_PASS
+	{
+		PASS_SHADOW = 0,
+		PASS_LIT,
+		PASS_COUNT
+	};
+
+	// work done by one render pass
+	struct PASS_COUNTERS
+	{
+		unsigned int drawCalls = 0;
+		unsigned int triangles = 0;
+		unsigned int uniformUploads = 0;
+		unsigned int textureBinds = 0;
+		unsigned int objectsDrawn = 0;
+		unsigned int objectsCulled = 0;
+		// heap allocations made while the pass was recorded
+		unsigned int allocations = 0;
+	};
+
+	// rolling statistics of one timed value, in milliseconds
+	struct TIMING_STATS
+	{
+		float minMs = 0.0f;
+		float avgMs = 0.0f;
+		float p99Ms = 0.0f;
+	};
+
+	// everything measured for one finished frame
+	struct FRAME_SAMPLE
+	{
+		unsigned long long frameIndex = 0;
+		float cpuMs[SECTION_COUNT] = {};
+		float gpuMs[SECTION_COUNT] = {};
+		bool bGpuTimed[SECTION_COUNT] = {};
+		PASS_COUNTERS counters[PASS_COUNT];
+	};
+
+	// number of frames between issuing and reading GPU queries
+	static const int FRAME_LATENCY = 3;
+	// number of finished frames in the rolling history
+	static const int HISTORY_LENGTH = 240;
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	// one frame in flight
+	struct FRAME_RECORD : public FRAME_SAMPLE
+	{
+		bool bPending = false;
+	};
+
+	enum LOG_FORMAT
+	{
+		LOG_NONE = 0,
+		LOG_CSV,
+		LOG_JSON
+	};
+
+	// queries and records, indexed by frame slot
+	GLuint m_queries[FRAME_LATENCY][SECTION_COUNT];
+	FRAME_RECORD m_frames[FRAME_LATENCY];
+	int m_currentSlot;
+	unsigned long long m_frameIndex;
+	bool m_bInFrame;
+	bool m_bGpuTiming;
+	// section start times of the current frame
+	CLOCK::time_point m_sectionStart[SECTION_COUNT];
+	// section whose GPU query is running, or -1
+	int m_activeGpuSection;
+
+	// rolling history of finished frames
+	std::vector<float> m_cpuHistory[SECTION_COUNT];
+	std::vector<float> m_gpuHistory[SECTION_COUNT];
+	int m_historyNext;
+	int m_historyCount;
+	// newest finished frame
+	FRAME_SAMPLE m_lastFrame;
+	// every finished frame, when kept for a benchmark report
+	bool m_bKeepFrames;
+	std::vector<FRAME_SAMPLE> m_keptFrames;
+
+	// optional per-frame log
+	std::ofstream m_log;
+	LOG_FORMAT m_logFormat;
+	unsigned long long m_loggedFrames;
+
+	// read back a pending frame if its results are ready; with
+	// bWait the call blocks until they are
+	bool ResolveFrame(int slot, bool bWait);
+	// add a finished frame to the history and the log
+	void FinishFrame(const FRAME_RECORD& record);
+	void WriteLogRecord(const FRAME_RECORD& record);
+	// compute rolling statistics from a history
+	TIMING_STATS ComputeStats(const std::vector<float>& history) const;
+
+public:
+	// create the GPU queries; without them only CPU times are kept
+	bool Initialize();
+	// delete the GPU queries and flush the log
+	void Shutdown();
+
+	// write every finished frame to a .csv or .json file
+	bool OpenLog(const std::string& filename);
+	// keep every finished frame in memory, beyond the rolling history
+	void SetKeepFrames(bool bKeep);
+	const std::vector<FRAME_SAMPLE>& GetKeptFrames() const;
+
+	// frame and section brackets
+	void BeginFrame();
+	void EndFrame();
+	void BeginSection(PROFILE_SECTION section);
+	void EndSection(PROFILE_SECTION section);
+
+	// record the counters of a pass for the current frame
+	void SetPassCounters(PROFILE_PASS pass, const PASS_COUNTERS& counters);
+
+	// rolling statistics of the finished frames
+	TIMING_STATS GetCpuStats(PROFILE_SECTION section) const;
+	TIMING_STATS GetGpuStats(PROFILE_SECTION section) const;
+	const PASS_COUNTERS& GetLastCounters(PROFILE_PASS pass) const;
+	// newest finished frame, or NULL before the first
+	const FRAME_SAMPLE* GetLastFrame() const;
+	bool HasGpuTiming() const;
+	unsigned long long GetFrameCount() const;
+
+	// one-line summary for the on-screen display
+	std::string GetSummary() const;
+};
+
+/***********************************************************
+ *  ProfileScope
+ *
+ *  Times one section of a FrameProfiler for as long as the
+ *  object lives.  A NULL profiler makes it a no-op.
+ ***********************************************************/
+class ProfileScope
+{
+public:
+	ProfileScope(FrameProfiler* pProfiler, FrameProfiler::PROFILE_SECTION section);
+	~ProfileScope();
+
+private:
+	FrameProfiler* m_pProfiler;
+	FrameProfiler::PROFILE_SECTION m_section;
+};
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.cpp
+// ============
+// bounding volumes and view frustum tests used to skip invisible objects
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Frustum.h"
+
+/***********************************************************
+ *  FromLocalBox()
+ *
+ *  This method is used for transforming a local box into
+ *  world space.  Each world axis extent is the sum of the
+ *  absolute matrix terms times the local half extents, so
+ *  rotated objects get a box that still encloses them.
+ ***********************************************************/
+BOUNDING_VOLUME BOUNDING_VOLUME::FromLocalBox(
+	const glm::vec3& localMin,
+	const glm::vec3& localMax,
+	const glm::mat4& model)
+{
+	glm::vec3 localCenter = (localMin + localMax) * 0.5f;
+	glm::vec3 localHalf = (localMax - localMin) * 0.5f;
+
+	glm::vec3 center = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+	glm::vec3 half(0.0f);
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 3; column++)
+		{
+			half[row] += glm::abs(model[column][row]) * localHalf[column];
+		}
+	}
+
+	BOUNDING_VOLUME bounds;
+	bounds.boxMin = center - half;
+	bounds.boxMax = center + half;
+	bounds.sphereCenter = center;
+	bounds.sphereRadius = glm::length(half);
+
+	return(bounds);
+}
+
+/***********************************************************
+ *  Frustum()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Frustum::Frustum()
+{
+	// until a matrix is set nothing is culled
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		m_planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+/***********************************************************
+ *  SetFromMatrix()
+ *
+ *  This method is used for taking the clip planes out of a
+ *  view-projection matrix.  A point is inside clip space
+ *  when -w <= x, y, z <= w, so each plane is the fourth row
+ *  plus or minus one of the first three.
+ ***********************************************************/
+void Frustum::SetFromMatrix(const glm::mat4& viewProjection)
+{
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; row++)
+	{
+		rows[row] = glm::vec4(
+			viewProjection[0][row],
+			viewProjection[1][row],
+			viewProjection[2][row],
+			viewProjection[3][row]);
+	}
+
+	m_planes[PLANE_LEFT] = rows[3] + rows[0];
+	m_planes[PLANE_RIGHT] = rows[3] - rows[0];
+	m_planes[PLANE_BOTTOM] = rows[3] + rows[1];
+	m_planes[PLANE_TOP] = rows[3] - rows[1];
+	m_planes[PLANE_NEAR] = rows[3] + rows[2];
+	m_planes[PLANE_FAR] = rows[3] - rows[2];
+
+	// unit normals make the plane distances comparable to radii
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		float length = glm::length(glm::vec3(m_planes[i]));
+		if (length > 0.0f)
+		{
+			m_planes[i] = m_planes[i] / length;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetPlanes()
+ *
+ *  This method is used for reading the planes, indexed by
+ *  FRUSTUM_PLANE.
+ ***********************************************************/
+const glm::vec4* Frustum::GetPlanes() const
+{
+	return(m_planes);
+}
+
+/***********************************************************
+ *  IntersectsSphere()
+ *
+ *  This method is used for checking whether a sphere is at
+ *  least partly on the inner side of every plane.
+ ***********************************************************/
+bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		float distance = glm::dot(glm::vec3(m_planes[i]), center) + m_planes[i].w;
+		if (distance < -radius)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  IntersectsBox()
+ *
+ *  This method is used for checking whether a box is at
+ *  least partly on the inner side of every plane, using the
+ *  box corner that lies furthest along each plane normal.
+ ***********************************************************/
+bool Frustum::IntersectsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		glm::vec3 normal = glm::vec3(m_planes[i]);
+		glm::vec3 corner(
+			(normal.x >= 0.0f) ? boxMax.x : boxMin.x,
+			(normal.y >= 0.0f) ? boxMax.y : boxMin.y,
+			(normal.z >= 0.0f) ? boxMax.z : boxMin.z);
+		if (glm::dot(normal, corner) + m_planes[i].w < 0.0f)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsVisible()
+ *
+ *  This method is used for testing a bounding volume, the
+ *  sphere first and then the box.
+ ***********************************************************/
+bool Frustum::IsVisible(const BOUNDING_VOLUME& bounds) const
+{
+	if (!IntersectsSphere(bounds.sphereCenter, bounds.sphereRadius))
+	{
+		return(false);
+	}
+
+	return(IntersectsBox(bounds.boxMin, bounds.boxMax));
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.h
+// ============
+// bounding volumes and view frustum tests used to skip invisible objects
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  BOUNDING_VOLUME
+ *
+ *  World space bounds of one object: an axis-aligned box and
+ *  the sphere around it.  The sphere gives a cheap first
+ *  test and the box a tighter second one.
+ ***********************************************************/
+struct BOUNDING_VOLUME
+{
+	glm::vec3 boxMin = glm::vec3(0.0f);
+	glm::vec3 boxMax = glm::vec3(0.0f);
+	glm::vec3 sphereCenter = glm::vec3(0.0f);
+	float sphereRadius = 0.0f;
+
+	// build the world bounds of a local box under a model matrix
+	static BOUNDING_VOLUME FromLocalBox(
+		const glm::vec3& localMin,
+		const glm::vec3& localMax,
+		const glm::mat4& model);
+};
+
+/***********************************************************
+ *  Frustum
+ *
+ *  This class holds the six planes of a view volume taken
+ *  from a view-projection matrix.  The planes are read
+ *  straight out of the matrix, so the same code covers
+ *  perspective and orthographic cameras as well as the
+ *  spotlight's shadow projection.
+ ***********************************************************/
+class Frustum
+{
+public:
+	// constructor
+	Frustum();
+
+	enum FRUSTUM_PLANE
+	{
+		PLANE_LEFT = 0,
+		PLANE_RIGHT,
+		PLANE_BOTTOM,
+		PLANE_TOP,
+		PLANE_NEAR,
+		PLANE_FAR,
+		PLANE_COUNT
+	};
+
+private:
+	// xyz: inward facing unit normal, w: distance term
+	glm::vec4 m_planes[PLANE_COUNT];
+
+public:
+	// take the planes from a projection * view matrix
+	void SetFromMatrix(const glm::mat4& viewProjection);
+	// the PLANE_COUNT planes, e.g. for testing on the GPU
+	const glm::vec4* GetPlanes() const;
+
+	// check whether any part of a volume may be inside
+	bool IsVisible(const BOUNDING_VOLUME& bounds) const;
+	bool IntersectsSphere(const glm::vec3& center, float radius) const;
+	bool IntersectsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+};
@@ -0,0 +1,568 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.cpp
+// ============
+// cull the scene objects in a compute shader and write the indirect commands
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCulling.h"
+#include "ShaderCompiler.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+// the C++ mirror must match the std430 layout of ObjectRecord
+static_assert(sizeof(GpuCulling::OBJECT_RECORD) == 208, "ObjectRecord layout mismatch");
+static_assert(sizeof(InstancedMeshes::DRAW_ELEMENTS_COMMAND) == 20, "DrawElementsCommand layout mismatch");
+
+// declaration of global variables
+namespace
+{
+	const char* g_CullShaderFile = "shaders/cullCompute.glsl";
+	const char* g_HiZShaderFile = "shaders/hiZCompute.glsl";
+
+	// work group sizes declared in the compute shaders
+	const int g_CullGroupSize = 64;
+	const int g_HiZGroupSize = 8;
+
+	// storage buffer binding points declared in cullCompute.glsl
+	const GLuint g_ObjectBinding = 0;
+	const GLuint g_CommandBinding = 1;
+	const GLuint g_InstanceBinding = 2;
+
+	// texture unit the depth pyramid is read through; above the
+	// units of the scene textures and the shadow map
+	const int g_HiZTextureUnit = 3;
+}
+
+/***********************************************************
+ *  GpuCulling()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCulling::GpuCulling()
+{
+	m_cullProgram = 0;
+	m_hiZProgram = 0;
+	m_objectCountLocation = -1;
+	m_passBitLocation = -1;
+	m_firstCommandLocation = -1;
+	m_frustumPlanesLocation = -1;
+	m_occlusionLocation = -1;
+	m_occlusionMatrixLocation = -1;
+	m_hiZLevelsLocation = -1;
+	m_hiZTextureLocation = -1;
+	m_lodViewPositionLocation = -1;
+	m_lodPixelsPerUnitLocation = -1;
+	m_lodPerspectiveLocation = -1;
+	m_lodMaxErrorLocation = -1;
+	m_sourceLevelLocation = -1;
+	m_sourceTextureLocation = -1;
+	m_copyLocation = -1;
+	m_objectBuffer = 0;
+	m_objectCount = 0;
+	m_commandBuffer = 0;
+	m_commandsPerPass = 0;
+	m_instancesPerPass = 0;
+	m_bCollectStats = false;
+	for (int i = 0; i < CULL_PASS_COUNT; i++)
+	{
+		m_candidates[i] = 0;
+		m_passFences[i] = 0;
+	}
+	m_depthTexture = 0;
+	m_hiZTexture = 0;
+	m_hiZWidth = 0;
+	m_hiZHeight = 0;
+	m_hiZLevels = 0;
+	m_hiZViewProjection = glm::mat4(1.0f);
+	m_bHiZValid = false;
+}
+
+/***********************************************************
+ *  ~GpuCulling()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCulling::~GpuCulling()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking for OpenGL 4.3, which
+ *  has compute shaders, storage buffers and multi-draw-
+ *  indirect.
+ ***********************************************************/
+bool GpuCulling::IsSupported()
+{
+	return(GLEW_VERSION_4_3 != 0);
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for loading both compute programs
+ *  and creating the object and command buffers.
+ ***********************************************************/
+bool GpuCulling::Create()
+{
+	if (m_cullProgram != 0)
+	{
+		return(true);
+	}
+
+	m_cullProgram = ShaderCompiler::LoadComputeProgram(g_CullShaderFile, ShaderCompiler::DEFINES());
+	m_hiZProgram = ShaderCompiler::LoadComputeProgram(g_HiZShaderFile, ShaderCompiler::DEFINES());
+	if ((m_cullProgram == 0) || (m_hiZProgram == 0))
+	{
+		Destroy();
+		return(false);
+	}
+
+	m_objectCountLocation = glGetUniformLocation(m_cullProgram, "objectCount");
+	m_passBitLocation = glGetUniformLocation(m_cullProgram, "passBit");
+	m_firstCommandLocation = glGetUniformLocation(m_cullProgram, "firstCommand");
+	m_frustumPlanesLocation = glGetUniformLocation(m_cullProgram, "frustumPlanes");
+	m_occlusionLocation = glGetUniformLocation(m_cullProgram, "bOcclusion");
+	m_occlusionMatrixLocation = glGetUniformLocation(m_cullProgram, "occlusionViewProjection");
+	m_hiZLevelsLocation = glGetUniformLocation(m_cullProgram, "hiZLevels");
+	m_hiZTextureLocation = glGetUniformLocation(m_cullProgram, "hiZ");
+	m_lodViewPositionLocation = glGetUniformLocation(m_cullProgram, "lodViewPosition");
+	m_lodPixelsPerUnitLocation = glGetUniformLocation(m_cullProgram, "lodPixelsPerUnit");
+	m_lodPerspectiveLocation = glGetUniformLocation(m_cullProgram, "bLodPerspective");
+	m_lodMaxErrorLocation = glGetUniformLocation(m_cullProgram, "lodMaxError");
+	m_sourceLevelLocation = glGetUniformLocation(m_hiZProgram, "sourceLevel");
+	m_sourceTextureLocation = glGetUniformLocation(m_hiZProgram, "sourceDepth");
+	m_copyLocation = glGetUniformLocation(m_hiZProgram, "bCopy");
+
+	// the samplers always read from the pyramid unit, and the
+	// errors of the levels of detail never change
+	glUseProgram(m_cullProgram);
+	glUniform1i(m_hiZTextureLocation, g_HiZTextureUnit);
+	float lodErrors[InstancedMeshes::LOD_COUNT];
+	for (int lod = 0; lod < InstancedMeshes::LOD_COUNT; lod++)
+	{
+		lodErrors[lod] = InstancedMeshes::GetLodError(InstancedMeshes::INSTANCED_CYLINDER, lod);
+	}
+	glUniform1fv(glGetUniformLocation(m_cullProgram, "lodErrors"), InstancedMeshes::LOD_COUNT, lodErrors);
+	glUseProgram(m_hiZProgram);
+	glUniform1i(m_sourceTextureLocation, g_HiZTextureUnit);
+	glUseProgram(0);
+
+	glGenBuffers(1, &m_objectBuffer);
+	glGenBuffers(1, &m_commandBuffer);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the programs, buffers,
+ *  fences and textures.
+ ***********************************************************/
+void GpuCulling::Destroy()
+{
+	if (m_cullProgram != 0)
+	{
+		glDeleteProgram(m_cullProgram);
+		m_cullProgram = 0;
+	}
+	if (m_hiZProgram != 0)
+	{
+		glDeleteProgram(m_hiZProgram);
+		m_hiZProgram = 0;
+	}
+	if (m_objectBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_objectBuffer);
+		m_objectBuffer = 0;
+	}
+	if (m_commandBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_commandBuffer);
+		m_commandBuffer = 0;
+	}
+	for (int i = 0; i < CULL_PASS_COUNT; i++)
+	{
+		if (m_passFences[i] != 0)
+		{
+			glDeleteSync(m_passFences[i]);
+			m_passFences[i] = 0;
+		}
+	}
+	m_objectCount = 0;
+	m_commandsPerPass = 0;
+	m_instancesPerPass = 0;
+	DestroyDepthPyramid();
+}
+
+/***********************************************************
+ *  SetObjects()
+ *
+ *  This method is used for uploading the object records and
+ *  laying out the commands of every pass.  The commands of a
+ *  pass are one copy of the mesh commands; each pass starts
+ *  its instances after those of the passes before it, so all
+ *  passes together need instancesPerPass x CULL_PASS_COUNT
+ *  instances.
+ ***********************************************************/
+void GpuCulling::SetObjects(
+	const std::vector<OBJECT_RECORD>& records,
+	const std::vector<InstancedMeshes::DRAW_ELEMENTS_COMMAND>& commands,
+	const std::vector<bool>& bFirstCommand,
+	int instancesPerPass)
+{
+	if (m_objectBuffer == 0)
+	{
+		return;
+	}
+
+	m_objectCount = (int)records.size();
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(OBJECT_RECORD) * records.size(), records.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	for (int pass = 0; pass < CULL_PASS_COUNT; pass++)
+	{
+		m_candidates[pass] = 0;
+	}
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		for (int pass = 0; pass < CULL_PASS_COUNT; pass++)
+		{
+			if (records[i].passMask & (1u << pass))
+				m_candidates[pass]++;
+		}
+	}
+
+	m_commandsPerPass = (int)commands.size();
+	m_instancesPerPass = instancesPerPass;
+	m_bFirstCommand = bFirstCommand;
+	m_commandTemplates.clear();
+	for (int pass = 0; pass < CULL_PASS_COUNT; pass++)
+	{
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			InstancedMeshes::DRAW_ELEMENTS_COMMAND command = commands[i];
+			command.instanceCount = 0;
+			command.baseInstance += (GLuint)(pass * m_instancesPerPass);
+			m_commandTemplates.push_back(command);
+		}
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER,
+		sizeof(InstancedMeshes::DRAW_ELEMENTS_COMMAND) * m_commandTemplates.size(),
+		m_commandTemplates.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/***********************************************************
+ *  GetRequiredInstances()
+ *
+ *  This method is used for getting the size the instance
+ *  buffer must have for every pass to write its instances.
+ ***********************************************************/
+int GpuCulling::GetRequiredInstances() const
+{
+	return(m_instancesPerPass * CULL_PASS_COUNT);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for resetting the commands of a pass
+ *  and running the cull shader over every object record.
+ *  The occlusion test is skipped until a depth pyramid from
+ *  an earlier frame exists.  The barrier makes the written
+ *  commands and instances visible to the following draws.
+ ***********************************************************/
+void GpuCulling::Cull(
+	CULL_PASS pass,
+	const Frustum& frustum,
+	const InstancedMeshes::LOD_VIEW& lodView,
+	bool bOcclusion,
+	GLuint instanceBuffer,
+	RenderStateCache& glState)
+{
+	if ((m_cullProgram == 0) || (m_commandsPerPass == 0))
+	{
+		return;
+	}
+
+	if (m_passFences[pass] != 0)
+	{
+		CollectPassStats(pass);
+	}
+
+	// restart every command of the pass at zero instances
+	const size_t commandSize = sizeof(InstancedMeshes::DRAW_ELEMENTS_COMMAND);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER,
+		commandSize * GetFirstCommand(pass),
+		commandSize * m_commandsPerPass,
+		&m_commandTemplates[GetFirstCommand(pass)]);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	if (m_candidates[pass] == 0)
+	{
+		return;
+	}
+
+	bool bTestOcclusion = bOcclusion && m_bHiZValid;
+
+	glUseProgram(m_cullProgram);
+	glState.InvalidateProgram();
+	glUniform1ui(m_objectCountLocation, (GLuint)m_objectCount);
+	glUniform1ui(m_passBitLocation, 1u << pass);
+	glUniform1ui(m_firstCommandLocation, (GLuint)GetFirstCommand(pass));
+	glUniform4fv(m_frustumPlanesLocation, Frustum::PLANE_COUNT, glm::value_ptr(frustum.GetPlanes()[0]));
+	glUniform3fv(m_lodViewPositionLocation, 1, glm::value_ptr(lodView.viewPosition));
+	glUniform1f(m_lodPixelsPerUnitLocation, lodView.pixelsPerUnit);
+	glUniform1i(m_lodPerspectiveLocation, lodView.bPerspective);
+	glUniform1f(m_lodMaxErrorLocation, lodView.maxErrorPixels);
+	glUniform1i(m_occlusionLocation, bTestOcclusion);
+	if (bTestOcclusion)
+	{
+		glUniformMatrix4fv(m_occlusionMatrixLocation, 1, GL_FALSE, glm::value_ptr(m_hiZViewProjection));
+		glUniform1i(m_hiZLevelsLocation, m_hiZLevels);
+		glState.BindTexture2D(g_HiZTextureUnit, m_hiZTexture);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ObjectBinding, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CommandBinding, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_InstanceBinding, instanceBuffer);
+
+	glDispatchCompute((GLuint)((m_objectCount + g_CullGroupSize - 1) / g_CullGroupSize), 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	if (m_bCollectStats)
+	{
+		m_passFences[pass] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+/***********************************************************
+ *  CollectPassStats()
+ *
+ *  This method is used for reading the instance counts that
+ *  the last cull of a pass wrote, once its fence has passed.
+ *  A pass whose cull has not finished keeps its previous
+ *  statistics rather than waiting for the GPU.
+ ***********************************************************/
+void GpuCulling::CollectPassStats(CULL_PASS pass)
+{
+	GLenum status = glClientWaitSync(m_passFences[pass], 0, 0);
+	glDeleteSync(m_passFences[pass]);
+	m_passFences[pass] = 0;
+	if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED))
+	{
+		return;
+	}
+
+	m_readback.resize(m_commandsPerPass);
+	glBindBuffer(GL_COPY_READ_BUFFER, m_commandBuffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER,
+		sizeof(InstancedMeshes::DRAW_ELEMENTS_COMMAND) * GetFirstCommand(pass),
+		sizeof(InstancedMeshes::DRAW_ELEMENTS_COMMAND) * m_commandsPerPass,
+		m_readback.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	PASS_STATS& stats = m_passStats[pass];
+	stats.candidates = m_candidates[pass];
+	stats.visible = 0;
+	stats.triangles = 0;
+	for (int i = 0; i < m_commandsPerPass; i++)
+	{
+		if (m_bFirstCommand[i])
+			stats.visible += (int)m_readback[i].instanceCount;
+		stats.triangles += (m_readback[i].count / 3) * m_readback[i].instanceCount;
+	}
+}
+
+/***********************************************************
+ *  GetCommandBuffer()
+ *
+ *  This method is used for getting the buffer that holds
+ *  the indirect commands of every pass.
+ ***********************************************************/
+GLuint GpuCulling::GetCommandBuffer() const
+{
+	return(m_commandBuffer);
+}
+
+/***********************************************************
+ *  GetFirstCommand()
+ *
+ *  This method is used for getting the index of the first
+ *  command of a pass in the command buffer.
+ ***********************************************************/
+int GpuCulling::GetFirstCommand(CULL_PASS pass) const
+{
+	return(pass * m_commandsPerPass);
+}
+
+/***********************************************************
+ *  GetCommandsPerPass()
+ *
+ *  This method is used for getting the number of commands
+ *  each pass draws.
+ ***********************************************************/
+int GpuCulling::GetCommandsPerPass() const
+{
+	return(m_commandsPerPass);
+}
+
+/***********************************************************
+ *  CreateDepthPyramid()
+ *
+ *  This method is used for creating the depth copy and the
+ *  single channel pyramid, with a full mip chain, for one
+ *  viewport size.
+ ***********************************************************/
+void GpuCulling::CreateDepthPyramid(int width, int height)
+{
+	DestroyDepthPyramid();
+
+	m_hiZWidth = width;
+	m_hiZHeight = height;
+	m_hiZLevels = 1;
+	while ((width >> m_hiZLevels) > 0 || (height >> m_hiZLevels) > 0)
+	{
+		m_hiZLevels++;
+	}
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenTextures(1, &m_hiZTexture);
+	glBindTexture(GL_TEXTURE_2D, m_hiZTexture);
+	glTexStorage2D(GL_TEXTURE_2D, m_hiZLevels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  DestroyDepthPyramid()
+ *
+ *  This method is used for freeing the depth copy and the
+ *  pyramid.
+ ***********************************************************/
+void GpuCulling::DestroyDepthPyramid()
+{
+	if (m_depthTexture != 0)
+	{
+		glDeleteTextures(1, &m_depthTexture);
+		m_depthTexture = 0;
+	}
+	if (m_hiZTexture != 0)
+	{
+		glDeleteTextures(1, &m_hiZTexture);
+		m_hiZTexture = 0;
+	}
+	m_hiZWidth = 0;
+	m_hiZHeight = 0;
+	m_hiZLevels = 0;
+	m_bHiZValid = false;
+}
+
+/***********************************************************
+ *  BuildDepthPyramid()
+ *
+ *  This method is used for copying the depth buffer of the
+ *  current viewport and reducing it into the pyramid, where
+ *  each texel holds the farthest depth of the texels below
+ *  it.  The next frame tests its objects against it with the
+ *  camera it was drawn with.
+ ***********************************************************/
+void GpuCulling::BuildDepthPyramid(const glm::mat4& viewProjection, RenderStateCache& glState)
+{
+	if (m_hiZProgram == 0)
+	{
+		return;
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if ((viewport[2] <= 0) || (viewport[3] <= 0))
+	{
+		return;
+	}
+	if ((viewport[2] != m_hiZWidth) || (viewport[3] != m_hiZHeight))
+	{
+		// the creation binds bypassed the state cache
+		CreateDepthPyramid(viewport[2], viewport[3]);
+		glState.InvalidateTextures();
+	}
+
+	glState.BindTexture2D(g_HiZTextureUnit, m_depthTexture);
+	glState.SetActiveTextureUnit(g_HiZTextureUnit);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	glUseProgram(m_hiZProgram);
+	glState.InvalidateProgram();
+
+	// level 0 is a straight copy of the depth texture, every
+	// further level reduces the one before it
+	for (int level = 0; level < m_hiZLevels; level++)
+	{
+		int width = glm::max(m_hiZWidth >> level, 1);
+		int height = glm::max(m_hiZHeight >> level, 1);
+
+		glUniform1i(m_copyLocation, level == 0);
+		glUniform1i(m_sourceLevelLocation, glm::max(level - 1, 0));
+		glState.BindTexture2D(g_HiZTextureUnit, (level == 0) ? m_depthTexture : m_hiZTexture);
+		glBindImageTexture(0, m_hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		glDispatchCompute(
+			(GLuint)((width + g_HiZGroupSize - 1) / g_HiZGroupSize),
+			(GLuint)((height + g_HiZGroupSize - 1) / g_HiZGroupSize),
+			1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+
+	m_hiZViewProjection = viewProjection;
+	m_bHiZValid = true;
+}
+
+/***********************************************************
+ *  InvalidateDepthPyramid()
+ *
+ *  This method is used for turning off the occlusion test
+ *  until the next pyramid has been built.
+ ***********************************************************/
+void GpuCulling::InvalidateDepthPyramid()
+{
+	m_bHiZValid = false;
+}
+
+/***********************************************************
+ *  SetCollectStats()
+ *
+ *  This method is used for turning the read back of the
+ *  visible counts on or off.
+ ***********************************************************/
+void GpuCulling::SetCollectStats(bool bCollect)
+{
+	m_bCollectStats = bCollect;
+}
+
+/***********************************************************
+ *  GetPassStats()
+ *
+ *  This method is used for reading the counts of the last
+ *  finished cull of a pass.
+ ***********************************************************/
+const GpuCulling::PASS_STATS& GpuCulling::GetPassStats(CULL_PASS pass) const
+{
+	return(m_passStats[pass]);
+}
@@ -0,0 +1,197 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.h
+// ============
+// cull the scene objects in a compute shader and write the indirect commands
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Frustum.h"
+#include "InstancedMeshes.h"
+#include "RenderStateCache.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  GpuCulling
+ *
+ *  This class keeps one record per scene object in a shader
+ *  storage buffer and tests them against a view volume in
+ *  cullCompute.glsl.  Every visible object appends its
+ *  instance to the command of its mesh, so the compute pass
+ *  leaves a ready indirect command buffer and instance
+ *  buffer behind and the CPU never walks the objects.
+ *
+ *  Each cull pass has its own range of commands and
+ *  instances, so e.g. the shadow layers and the lit pass do
+ *  not overwrite each other within a frame.
+ *
+ *  The lit pass can also test the objects against a depth
+ *  pyramid of the previous frame, built by hiZCompute.glsl,
+ *  to skip objects hidden behind nearer ones.
+ ***********************************************************/
+class GpuCulling
+{
+public:
+	// constructor
+	GpuCulling();
+	// destructor
+	~GpuCulling();
+
+	// independent cull passes of a frame
+	enum CULL_PASS
+	{
+		CULL_LIT = 0,
+		CULL_SHADOW_ALL,
+		CULL_SHADOW_STATIC,
+		CULL_SHADOW_DYNAMIC,
+		CULL_PASS_COUNT
+	};
+
+	// std430 mirror of ObjectRecord in cullCompute.glsl
+	struct OBJECT_RECORD
+	{
+		InstancedMeshes::INSTANCE_DATA instance;
+		// xyz: world sphere center, w: radius
+		glm::vec4 sphere = glm::vec4(0.0f);
+		glm::vec4 boxMin = glm::vec4(0.0f);
+		glm::vec4 boxMax = glm::vec4(0.0f);
+		// one bit per CULL_PASS the object takes part in
+		uint32_t passMask = 0;
+		// first command of the mesh of the object, from the list
+		// given to SetObjects(), and the number of its commands
+		// the commands of level of detail n follow n x commandCount
+		// after the first one
+		uint32_t firstCommand = 0;
+		uint32_t commandCount = 0;
+		// radius about the mesh axis that the level of detail is
+		// chosen for; 0 keeps the full detail
+		float lodRadius = 0.0f;
+	};
+
+	// objects of the last finished cull of one pass
+	struct PASS_STATS
+	{
+		int candidates = 0;
+		int visible = 0;
+		unsigned int triangles = 0;
+	};
+
+private:
+	// compute programs
+	GLuint m_cullProgram;
+	GLuint m_hiZProgram;
+	// uniform locations of the cull program
+	GLint m_objectCountLocation;
+	GLint m_passBitLocation;
+	GLint m_firstCommandLocation;
+	GLint m_frustumPlanesLocation;
+	GLint m_occlusionLocation;
+	GLint m_occlusionMatrixLocation;
+	GLint m_hiZLevelsLocation;
+	GLint m_hiZTextureLocation;
+	GLint m_lodViewPositionLocation;
+	GLint m_lodPixelsPerUnitLocation;
+	GLint m_lodPerspectiveLocation;
+	GLint m_lodMaxErrorLocation;
+	// uniform locations of the pyramid program
+	GLint m_sourceLevelLocation;
+	GLint m_sourceTextureLocation;
+	GLint m_copyLocation;
+
+	// object records on the GPU and the number of them
+	GLuint m_objectBuffer;
+	int m_objectCount;
+	// commands of every pass, one copy of the mesh commands each
+	GLuint m_commandBuffer;
+	// mesh commands with the instance counts at zero, per pass
+	std::vector<InstancedMeshes::DRAW_ELEMENTS_COMMAND> m_commandTemplates;
+	int m_commandsPerPass;
+	// instances one pass can write, given by SetObjects()
+	int m_instancesPerPass;
+	// set on the first command of each mesh and level, so the visible
+	// objects are counted once per object
+	std::vector<bool> m_bFirstCommand;
+	// objects taking part in each pass
+	int m_candidates[CULL_PASS_COUNT];
+
+	// counts are read back only when collected, and only once the
+	// fence of the pass has passed, so reading never stalls
+	bool m_bCollectStats;
+	GLsync m_passFences[CULL_PASS_COUNT];
+	PASS_STATS m_passStats[CULL_PASS_COUNT];
+	std::vector<InstancedMeshes::DRAW_ELEMENTS_COMMAND> m_readback;
+
+	// depth copy of the last lit pass and its max-depth pyramid
+	GLuint m_depthTexture;
+	GLuint m_hiZTexture;
+	int m_hiZWidth;
+	int m_hiZHeight;
+	int m_hiZLevels;
+	// camera the pyramid was rendered with; false until one exists
+	glm::mat4 m_hiZViewProjection;
+	bool m_bHiZValid;
+
+	// read a finished pass back into its statistics
+	void CollectPassStats(CULL_PASS pass);
+	// create the depth copy and pyramid for a viewport size
+	void CreateDepthPyramid(int width, int height);
+	// free the depth copy and pyramid
+	void DestroyDepthPyramid();
+
+public:
+	// check for compute shaders and multi-draw-indirect; call with
+	// a current OpenGL context
+	static bool IsSupported();
+
+	// load the compute programs and create the buffers
+	bool Create();
+	// free the programs, buffers and textures
+	void Destroy();
+
+	// replace the object records and the commands of every mesh
+	// they point at; the instances of each command start after
+	// those of the commands before it, and one pass writes at most
+	// a number of instances
+	void SetObjects(
+		const std::vector<OBJECT_RECORD>& records,
+		const std::vector<InstancedMeshes::DRAW_ELEMENTS_COMMAND>& commands,
+		const std::vector<bool>& bFirstCommand,
+		int instancesPerPass);
+	// instances written by all passes together
+	int GetRequiredInstances() const;
+
+	// test the objects of a pass against a view volume, optionally
+	// also against the depth pyramid, and write the visible ones
+	// into the instance buffer and the commands of the level of
+	// detail the view picks for them
+	void Cull(
+		CULL_PASS pass,
+		const Frustum& frustum,
+		const InstancedMeshes::LOD_VIEW& lodView,
+		bool bOcclusion,
+		GLuint instanceBuffer,
+		RenderStateCache& glState);
+
+	// command buffer and the range of commands of a pass
+	GLuint GetCommandBuffer() const;
+	int GetFirstCommand(CULL_PASS pass) const;
+	int GetCommandsPerPass() const;
+
+	// copy the depth buffer of the finished lit pass, drawn with a
+	// view-projection matrix, and build the pyramid for next frame
+	void BuildDepthPyramid(const glm::mat4& viewProjection, RenderStateCache& glState);
+	// forget the pyramid, e.g. when the scene changed completely
+	void InvalidateDepthPyramid();
+
+	// read back the visible counts of each pass as they finish
+	void SetCollectStats(bool bCollect);
+	const PASS_STATS& GetPassStats(CULL_PASS pass) const;
+};
@@ -0,0 +1,1021 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.cpp
+// ============
+// generate the basic shape meshes and draw many copies with one draw call
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InstancedMeshes.h"
+#include "MeshOptimizer.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstddef>
+#include <cstring>
+
+// the instance attributes read the struct with a fixed stride
+static_assert(sizeof(InstancedMeshes::INSTANCE_DATA) == 144, "INSTANCE_DATA layout mismatch");
+// the optimizer renumbers the index buffer in place
+static_assert(sizeof(GLuint) == sizeof(uint32_t), "GLuint must be 32 bits");
+
+// declaration of global variables
+namespace
+{
+	// number of slices around the cylinders at each level of
+	// detail; level 0 matches ShapeMeshes
+	const int g_CylinderSlices[InstancedMeshes::LOD_COUNT] = { 36, 18, 9 };
+	// floats per vertex while a mesh is built: position, normal,
+	// texture coordinate
+	const int g_FloatsPerVertex = 8;
+
+	// normal and texture coordinate of one uploaded vertex
+	struct PACKED_ATTRIBUTES
+	{
+		// signed normalized 10:10:10:2, x in the low bits
+		uint32_t normal;
+		// two half floats, u in the low bits
+		uint32_t uv;
+	};
+
+	// attribute locations in instancedVertexShader.glsl
+	const GLuint g_PositionAttribute = 0;
+	const GLuint g_NormalAttribute = 1;
+	const GLuint g_TextureAttribute = 2;
+	const GLuint g_InstanceModelAttribute = 3;
+	const GLuint g_InstanceNormalAttribute = 7;
+	const GLuint g_InstanceColorAttribute = 10;
+	const GLuint g_InstanceUVScaleAttribute = 11;
+	const GLuint g_InstanceMaterialAttribute = 12;
+
+	// starting room of the rings per frame; they grow to fit
+	const int g_RingInstances = 1024;
+	const int g_RingCommands = 256;
+	// alignment of streamed data; indirect commands need 4 bytes,
+	// and 16 keeps every vec4 of the instances aligned
+	const size_t g_RingAlignment = 16;
+}
+
+/***********************************************************
+ *  InstancedMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InstancedMeshes::InstancedMeshes()
+{
+	m_positionVBO = 0;
+	m_attributeVBO = 0;
+	m_ibo = 0;
+	for (int i = 0; i < STREAMS_COUNT; i++)
+	{
+		m_vaos[i] = 0;
+		m_instanceSources[i] = 0;
+		m_instanceSourceOffsets[i] = 0;
+	}
+	m_streams = STREAMS_ALL;
+	m_instanceVBO = 0;
+	m_instanceCapacity = 0;
+	m_indirectBuffer = 0;
+	m_indirectCapacity = 0;
+	m_drawCallCount = 0;
+	m_triangleCount = 0;
+}
+
+/***********************************************************
+ *  ~InstancedMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InstancedMeshes::~InstancedMeshes()
+{
+	DestroyMeshes();
+}
+
+/***********************************************************
+ *  AddVertex()
+ *
+ *  This method is used for appending one vertex to the mesh
+ *  being built and returning its index.
+ ***********************************************************/
+GLuint InstancedMeshes::AddVertex(glm::vec3 position, glm::vec3 normal, glm::vec2 uv)
+{
+	GLuint index = (GLuint)(m_vertices.size() / g_FloatsPerVertex);
+
+	m_vertices.push_back(position.x);
+	m_vertices.push_back(position.y);
+	m_vertices.push_back(position.z);
+	m_vertices.push_back(normal.x);
+	m_vertices.push_back(normal.y);
+	m_vertices.push_back(normal.z);
+	m_vertices.push_back(uv.x);
+	m_vertices.push_back(uv.y);
+
+	return(index);
+}
+
+/***********************************************************
+ *  BuildPlane()
+ *
+ *  This method is used for building the plane: 2 x 2 units
+ *  in the XZ plane facing +Y, mapped once with the texture.
+ ***********************************************************/
+void InstancedMeshes::BuildPlane(MESH_RANGES& mesh)
+{
+	glm::vec3 up(0.0f, 1.0f, 0.0f);
+
+	GLuint v0 = AddVertex(glm::vec3(-1.0f, 0.0f, 1.0f), up, glm::vec2(0.0f, 0.0f));
+	GLuint v1 = AddVertex(glm::vec3(1.0f, 0.0f, 1.0f), up, glm::vec2(1.0f, 0.0f));
+	GLuint v2 = AddVertex(glm::vec3(1.0f, 0.0f, -1.0f), up, glm::vec2(1.0f, 1.0f));
+	GLuint v3 = AddVertex(glm::vec3(-1.0f, 0.0f, -1.0f), up, glm::vec2(0.0f, 1.0f));
+
+	mesh.sides.first = (GLuint)m_indices.size();
+	m_indices.push_back(v0);
+	m_indices.push_back(v1);
+	m_indices.push_back(v2);
+	m_indices.push_back(v0);
+	m_indices.push_back(v2);
+	m_indices.push_back(v3);
+	mesh.sides.count = (GLuint)m_indices.size() - mesh.sides.first;
+}
+
+/***********************************************************
+ *  BuildCylinder()
+ *
+ *  This method is used for building a capped cylinder of
+ *  height 1 standing on the XZ plane, with a number of
+ *  slices around it.  A top radius smaller than the bottom
+ *  radius gives the tapered cylinder.
+ ***********************************************************/
+void InstancedMeshes::BuildCylinder(MESH_RANGES& mesh, float bottomRadius, float topRadius, int slices)
+{
+	const float twoPi = glm::two_pi<float>();
+
+	// bottom cap, facing -Y
+	mesh.bottom.first = (GLuint)m_indices.size();
+	GLuint center = AddVertex(glm::vec3(0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(0.5f));
+	GLuint ring = 0;
+	for (int i = 0; i <= slices; i++)
+	{
+		float angle = twoPi * (float)i / (float)slices;
+		float c = glm::cos(angle);
+		float s = glm::sin(angle);
+		GLuint index = AddVertex(
+			glm::vec3(c * bottomRadius, 0.0f, s * bottomRadius),
+			glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec2(0.5f + 0.5f * c, 0.5f + 0.5f * s));
+		if (i == 0)
+			ring = index;
+	}
+	for (int i = 0; i < slices; i++)
+	{
+		m_indices.push_back(center);
+		m_indices.push_back(ring + i);
+		m_indices.push_back(ring + i + 1);
+	}
+	mesh.bottom.count = (GLuint)m_indices.size() - mesh.bottom.first;
+
+	// sides; the normal leans up as the radius shrinks with height
+	mesh.sides.first = (GLuint)m_indices.size();
+	float slope = bottomRadius - topRadius;
+	GLuint side = 0;
+	for (int i = 0; i <= slices; i++)
+	{
+		float angle = twoPi * (float)i / (float)slices;
+		float c = glm::cos(angle);
+		float s = glm::sin(angle);
+		float u = (float)i / (float)slices;
+		glm::vec3 normal = glm::normalize(glm::vec3(c, slope, s));
+		GLuint index = AddVertex(
+			glm::vec3(c * bottomRadius, 0.0f, s * bottomRadius), normal, glm::vec2(u, 0.0f));
+		AddVertex(
+			glm::vec3(c * topRadius, 1.0f, s * topRadius), normal, glm::vec2(u, 1.0f));
+		if (i == 0)
+			side = index;
+	}
+	for (int i = 0; i < slices; i++)
+	{
+		GLuint bottom0 = side + 2 * i;
+		GLuint top0 = bottom0 + 1;
+		GLuint bottom1 = bottom0 + 2;
+		GLuint top1 = bottom0 + 3;
+		m_indices.push_back(bottom0);
+		m_indices.push_back(top0);
+		m_indices.push_back(top1);
+		m_indices.push_back(bottom0);
+		m_indices.push_back(top1);
+		m_indices.push_back(bottom1);
+	}
+	mesh.sides.count = (GLuint)m_indices.size() - mesh.sides.first;
+
+	// top cap, facing +Y
+	mesh.top.first = (GLuint)m_indices.size();
+	center = AddVertex(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.5f));
+	for (int i = 0; i <= slices; i++)
+	{
+		float angle = twoPi * (float)i / (float)slices;
+		float c = glm::cos(angle);
+		float s = glm::sin(angle);
+		GLuint index = AddVertex(
+			glm::vec3(c * topRadius, 1.0f, s * topRadius),
+			glm::vec3(0.0f, 1.0f, 0.0f),
+			glm::vec2(0.5f + 0.5f * c, 0.5f + 0.5f * s));
+		if (i == 0)
+			ring = index;
+	}
+	for (int i = 0; i < slices; i++)
+	{
+		m_indices.push_back(center);
+		m_indices.push_back(ring + i + 1);
+		m_indices.push_back(ring + i);
+	}
+	mesh.top.count = (GLuint)m_indices.size() - mesh.top.first;
+}
+
+/***********************************************************
+ *  BindInstanceSource()
+ *
+ *  This method is used for pointing the instance attributes
+ *  of the bound vertex array at a buffer and offset.  The
+ *  pointers are only respecified when the source changed,
+ *  which for the rings is once per streamed draw.  The
+ *  position-only array only reads the model matrix.
+ ***********************************************************/
+void InstancedMeshes::BindInstanceSource(GLuint buffer, GLintptr offset)
+{
+	if ((buffer == m_instanceSources[m_streams]) && (offset == m_instanceSourceOffsets[m_streams]))
+	{
+		return;
+	}
+
+	const GLsizei instanceStride = sizeof(INSTANCE_DATA);
+	const GLintptr base = offset;
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(g_InstanceModelAttribute + column, 4, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(base + offsetof(INSTANCE_DATA, model) + sizeof(glm::vec4) * column));
+	}
+	if (m_streams == STREAMS_ALL)
+	{
+		for (GLuint column = 0; column < 3; column++)
+		{
+			glVertexAttribPointer(g_InstanceNormalAttribute + column, 3, GL_FLOAT, GL_FALSE, instanceStride,
+				(void*)(base + offsetof(INSTANCE_DATA, normalMatrix) + sizeof(glm::vec4) * column));
+		}
+		glVertexAttribPointer(g_InstanceColorAttribute, 4, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(base + offsetof(INSTANCE_DATA, color)));
+		glVertexAttribPointer(g_InstanceUVScaleAttribute, 2, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(base + offsetof(INSTANCE_DATA, uvScale)));
+		// the material slot and flags stay integers
+		glVertexAttribIPointer(g_InstanceMaterialAttribute, 2, GL_INT, instanceStride,
+			(void*)(base + offsetof(INSTANCE_DATA, materialSlot)));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_instanceSources[m_streams] = buffer;
+	m_instanceSourceOffsets[m_streams] = offset;
+}
+
+/***********************************************************
+ *  OptimizeMeshes()
+ *
+ *  This method is used for ordering the triangles of every
+ *  part for the post-transform cache and then for overdraw,
+ *  and the vertices for the order the indices reach them.
+ *  Each part keeps its index range, so the part ranges and
+ *  their merging stay as they were built.
+ ***********************************************************/
+void InstancedMeshes::OptimizeMeshes()
+{
+	std::vector<size_t> clusterStarts;
+	for (int mesh = 0; mesh < INSTANCED_MESH_COUNT; mesh++)
+	{
+		// the levels of the plane share one range
+		int lodCount = (mesh == INSTANCED_PLANE) ? 1 : LOD_COUNT;
+		for (int lod = 0; lod < lodCount; lod++)
+		{
+			const MESH_RANGES& parts = m_meshes[mesh][lod];
+			const INDEX_RANGE* partList[3] = { &parts.bottom, &parts.sides, &parts.top };
+			for (int i = 0; i < 3; i++)
+			{
+				if (partList[i]->count == 0)
+					continue;
+
+				GLuint* pIndices = m_indices.data() + partList[i]->first;
+				clusterStarts.clear();
+				MeshOptimizer::OptimizeVertexCache(
+					pIndices, partList[i]->count, MeshOptimizer::DEFAULT_CACHE_SIZE, clusterStarts);
+				MeshOptimizer::OptimizeOverdraw(
+					pIndices, partList[i]->count, m_vertices.data(), g_FloatsPerVertex, clusterStarts);
+			}
+		}
+	}
+
+	MeshOptimizer::OptimizeVertexFetch(m_vertices, g_FloatsPerVertex, m_indices);
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for packing the geometry of every
+ *  mesh into one position buffer, one attribute buffer and
+ *  one index buffer, and recording the vertex and instance
+ *  attribute layout in the vertex arrays.  A vertex costs 12
+ *  bytes in the depth passes and 20 in the lit ones, down
+ *  from 32 of full floats.  The indices are absolute, so
+ *  every mesh is drawn without a base vertex.
+ ***********************************************************/
+void InstancedMeshes::CreateBuffers()
+{
+	size_t vertexCount = m_vertices.size() / g_FloatsPerVertex;
+	std::vector<GLfloat> positions;
+	std::vector<PACKED_ATTRIBUTES> attributes(vertexCount);
+	positions.reserve(vertexCount * 3);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const GLfloat* pVertex = m_vertices.data() + i * g_FloatsPerVertex;
+		positions.insert(positions.end(), pVertex, pVertex + 3);
+		attributes[i].normal = glm::packSnorm3x10_1x2(glm::vec4(pVertex[3], pVertex[4], pVertex[5], 0.0f));
+		attributes[i].uv = glm::packHalf2x16(glm::vec2(pVertex[6], pVertex[7]));
+	}
+
+	glGenBuffers(1, &m_positionVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_positionVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * positions.size(), positions.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_attributeVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_attributeVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(PACKED_ATTRIBUTES) * attributes.size(), attributes.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_ibo);
+
+	glGenVertexArrays(STREAMS_COUNT, m_vaos);
+	for (int streams = 0; streams < STREAMS_COUNT; streams++)
+	{
+		m_streams = (VERTEX_STREAMS)streams;
+		glBindVertexArray(m_vaos[streams]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+		if (streams == 0)
+		{
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m_indices.size(), m_indices.data(), GL_STATIC_DRAW);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_positionVBO);
+		glEnableVertexAttribArray(g_PositionAttribute);
+		glVertexAttribPointer(g_PositionAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, (void*)0);
+
+		// the shaders read the packed values as vec3 and vec2
+		GLuint lastInstanceAttribute = g_InstanceModelAttribute + 3;
+		if (streams == STREAMS_ALL)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_attributeVBO);
+			glEnableVertexAttribArray(g_NormalAttribute);
+			glVertexAttribPointer(g_NormalAttribute, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PACKED_ATTRIBUTES),
+				(void*)offsetof(PACKED_ATTRIBUTES, normal));
+			glEnableVertexAttribArray(g_TextureAttribute);
+			glVertexAttribPointer(g_TextureAttribute, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PACKED_ATTRIBUTES),
+				(void*)offsetof(PACKED_ATTRIBUTES, uv));
+			lastInstanceAttribute = g_InstanceMaterialAttribute;
+		}
+
+		// per-instance attributes advance once per instance
+		for (GLuint attribute = g_InstanceModelAttribute; attribute <= lastInstanceAttribute; attribute++)
+		{
+			glEnableVertexAttribArray(attribute);
+			glVertexAttribDivisor(attribute, 1);
+		}
+		BindInstanceSource(m_instanceVBO, 0);
+	}
+	m_streams = STREAMS_ALL;
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_vertices.clear();
+	m_indices.clear();
+}
+
+/***********************************************************
+ *  LoadMeshes()
+ *
+ *  This method is used for building every mesh into the
+ *  shared buffers and creating the instance buffer, plus the
+ *  indirect command buffer when the driver supports it.
+ ***********************************************************/
+void InstancedMeshes::LoadMeshes()
+{
+	if (m_instanceVBO != 0)
+	{
+		return;
+	}
+
+	glGenBuffers(1, &m_instanceVBO);
+
+	// the plane is exact, so every level shares its two triangles
+	BuildPlane(m_meshes[INSTANCED_PLANE][0]);
+	for (int lod = 1; lod < LOD_COUNT; lod++)
+	{
+		m_meshes[INSTANCED_PLANE][lod] = m_meshes[INSTANCED_PLANE][0];
+	}
+	for (int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		BuildCylinder(m_meshes[INSTANCED_CYLINDER][lod], 1.0f, 1.0f, g_CylinderSlices[lod]);
+		BuildCylinder(m_meshes[INSTANCED_TAPERED_CYLINDER][lod], 1.0f, 0.5f, g_CylinderSlices[lod]);
+	}
+	OptimizeMeshes();
+	CreateBuffers();
+
+	if (IsIndirectSupported())
+	{
+		glGenBuffers(1, &m_indirectBuffer);
+	}
+
+	if (StreamRing::IsSupported())
+	{
+		m_instanceRing.Create(sizeof(INSTANCE_DATA) * g_RingInstances);
+		if (m_indirectBuffer != 0)
+		{
+			m_commandRing.Create(sizeof(DRAW_ELEMENTS_COMMAND) * g_RingCommands);
+		}
+	}
+}
+
+/***********************************************************
+ *  DestroyMeshes()
+ *
+ *  This method is used for freeing the OpenGL objects.
+ ***********************************************************/
+void InstancedMeshes::DestroyMeshes()
+{
+	if (m_vaos[STREAMS_ALL] != 0)
+	{
+		glDeleteVertexArrays(STREAMS_COUNT, m_vaos);
+		glDeleteBuffers(1, &m_positionVBO);
+		glDeleteBuffers(1, &m_attributeVBO);
+		glDeleteBuffers(1, &m_ibo);
+		m_positionVBO = 0;
+		m_attributeVBO = 0;
+		m_ibo = 0;
+	}
+	for (int i = 0; i < INSTANCED_MESH_COUNT; i++)
+	{
+		for (int lod = 0; lod < LOD_COUNT; lod++)
+		{
+			m_meshes[i][lod] = MESH_RANGES();
+		}
+	}
+	if (m_instanceVBO != 0)
+	{
+		glDeleteBuffers(1, &m_instanceVBO);
+		m_instanceVBO = 0;
+	}
+	m_instanceCapacity = 0;
+	if (m_indirectBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indirectBuffer);
+		m_indirectBuffer = 0;
+	}
+	m_indirectCapacity = 0;
+	m_instanceRing.Destroy();
+	m_commandRing.Destroy();
+	for (int i = 0; i < STREAMS_COUNT; i++)
+	{
+		m_vaos[i] = 0;
+		m_instanceSources[i] = 0;
+		m_instanceSourceOffsets[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  SetVertexStreams()
+ *
+ *  This method is used for choosing the vertex array the
+ *  following draws bind.  The position-only array leaves the
+ *  normals, texture coordinates and shading instance values
+ *  unread, which a depth-only program has no use for.
+ ***********************************************************/
+void InstancedMeshes::SetVertexStreams(VERTEX_STREAMS streams)
+{
+	if ((streams >= 0) && (streams < STREAMS_COUNT))
+	{
+		m_streams = streams;
+	}
+}
+
+/***********************************************************
+ *  DrawRange()
+ *
+ *  This method is used for issuing one instanced draw of an
+ *  index range of the bound vertex array.
+ ***********************************************************/
+void InstancedMeshes::DrawRange(GLuint first, GLuint count, int instanceCount)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	glDrawElementsInstanced(
+		GL_TRIANGLES,
+		count,
+		GL_UNSIGNED_INT,
+		(void*)(sizeof(GLuint) * first),
+		instanceCount);
+	m_drawCallCount++;
+	m_triangleCount += (count / 3) * instanceCount;
+}
+
+/***********************************************************
+ *  UploadInstances()
+ *
+ *  This method is used for streaming per-instance values
+ *  into the instance buffer.  The previous contents are
+ *  orphaned so the driver does not wait for draws that still
+ *  read them.
+ ***********************************************************/
+void InstancedMeshes::UploadInstances(const INSTANCE_DATA* pInstances, int instanceCount)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	if (instanceCount > m_instanceCapacity)
+	{
+		m_instanceCapacity = instanceCount;
+	}
+	glBufferData(GL_ARRAY_BUFFER, sizeof(INSTANCE_DATA) * m_instanceCapacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(INSTANCE_DATA) * instanceCount, pInstances);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  StreamInstances()
+ *
+ *  This method is used for handing the instances of a draw
+ *  to the bound vertex array.  They are copied into the
+ *  ring of the frame when it has room, and uploaded into
+ *  the orphaned instance buffer otherwise.
+ ***********************************************************/
+void InstancedMeshes::StreamInstances(const INSTANCE_DATA* pInstances, int instanceCount)
+{
+	size_t size = sizeof(INSTANCE_DATA) * instanceCount;
+	GLintptr offset = 0;
+	void* pDestination = m_instanceRing.Allocate(size, g_RingAlignment, offset);
+	if (pDestination != NULL)
+	{
+		memcpy(pDestination, pInstances, size);
+		BindInstanceSource(m_instanceRing.GetBuffer(), offset);
+		return;
+	}
+
+	UploadInstances(pInstances, instanceCount);
+	BindInstanceSource(m_instanceVBO, 0);
+}
+
+/***********************************************************
+ *  ReserveInstanceCapacity()
+ *
+ *  This method is used for growing the instance buffer.  The
+ *  capacity never shrinks, so every later orphaning upload
+ *  keeps room for the instances written on the GPU.
+ ***********************************************************/
+void InstancedMeshes::ReserveInstanceCapacity(int instanceCount)
+{
+	if (instanceCount <= m_instanceCapacity)
+	{
+		return;
+	}
+
+	m_instanceCapacity = instanceCount;
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(INSTANCE_DATA) * m_instanceCapacity, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  GetPartRanges()
+ *
+ *  This method is used for merging the selected parts of a
+ *  mesh into index ranges.  The parts are walked in storage
+ *  order, extending the current range while the selected
+ *  parts stay adjacent, so any contiguous selection of
+ *  bottom, sides and top is a single range.
+ ***********************************************************/
+int InstancedMeshes::GetPartRanges(
+	INSTANCED_MESH mesh,
+	int lod,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides,
+	INDEX_RANGE ranges[2]) const
+{
+	const MESH_RANGES& parts = m_meshes[mesh][glm::clamp(lod, 0, LOD_COUNT - 1)];
+	if (mesh == INSTANCED_PLANE)
+	{
+		ranges[0] = parts.sides;
+		return(1);
+	}
+
+	const INDEX_RANGE* partList[3] = { &parts.bottom, &parts.sides, &parts.top };
+	bool bSelected[3] = { bDrawBottom, bDrawSides, bDrawTop };
+	int rangeCount = 0;
+	INDEX_RANGE current;
+	for (int i = 0; i < 3; i++)
+	{
+		if (bSelected[i])
+		{
+			if (current.count == 0)
+				current.first = partList[i]->first;
+			current.count += partList[i]->count;
+		}
+		else if (current.count > 0)
+		{
+			ranges[rangeCount++] = current;
+			current = INDEX_RANGE();
+		}
+	}
+	if (current.count > 0)
+	{
+		ranges[rangeCount++] = current;
+	}
+
+	return(rangeCount);
+}
+
+/***********************************************************
+ *  DrawInstanced()
+ *
+ *  This method is used for streaming the per-instance values
+ *  into the instance buffer and drawing one copy of the mesh
+ *  per instance, with one draw call per merged part range.
+ ***********************************************************/
+void InstancedMeshes::DrawInstanced(
+	INSTANCED_MESH mesh,
+	int lod,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides,
+	const INSTANCE_DATA* pInstances,
+	int instanceCount)
+{
+	if ((mesh < 0) || (mesh >= INSTANCED_MESH_COUNT) ||
+		(m_vaos[m_streams] == 0) || (pInstances == NULL) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vaos[m_streams]);
+	StreamInstances(pInstances, instanceCount);
+
+	INDEX_RANGE ranges[2];
+	int rangeCount = GetPartRanges(mesh, lod, bDrawTop, bDrawBottom, bDrawSides, ranges);
+	for (int i = 0; i < rangeCount; i++)
+	{
+		DrawRange(ranges[i].first, ranges[i].count, instanceCount);
+	}
+
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing one copy of the selected
+ *  parts of a mesh with the bound program, for the draws
+ *  that are not instanced.  The instance attributes stay
+ *  enabled but are read by that program only if it asks for
+ *  them.  The caller counts the draw with the others it
+ *  issues itself.
+ ***********************************************************/
+void InstancedMeshes::DrawMesh(
+	INSTANCED_MESH mesh,
+	int lod,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides) const
+{
+	if ((mesh < 0) || (mesh >= INSTANCED_MESH_COUNT) || (m_vaos[m_streams] == 0))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vaos[m_streams]);
+
+	INDEX_RANGE ranges[2];
+	int rangeCount = GetPartRanges(mesh, lod, bDrawTop, bDrawBottom, bDrawSides, ranges);
+	for (int i = 0; i < rangeCount; i++)
+	{
+		glDrawElements(GL_TRIANGLES, ranges[i].count, GL_UNSIGNED_INT, (void*)(sizeof(GLuint) * ranges[i].first));
+	}
+
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  IsIndirectSupported()
+ *
+ *  This method is used for checking for OpenGL 4.3, which
+ *  has multi-draw-indirect and honours the base instance of
+ *  every indirect command.
+ ***********************************************************/
+bool InstancedMeshes::IsIndirectSupported()
+{
+	return(GLEW_VERSION_4_3 != 0);
+}
+
+/***********************************************************
+ *  DrawIndirect()
+ *
+ *  This method is used for drawing a whole list of meshes
+ *  with one call.  All the instances go up in one upload,
+ *  and each listed draw becomes one indirect command per
+ *  part range whose base instance points at its instances.
+ *  The base instances stay relative to the streamed block,
+ *  since the attributes point at its start.
+ ***********************************************************/
+void InstancedMeshes::DrawIndirect(
+	const INDIRECT_DRAW* pDraws,
+	int drawCount,
+	const INSTANCE_DATA* pInstances,
+	int instanceCount)
+{
+	if ((m_vaos[m_streams] == 0) || (m_indirectBuffer == 0) || (drawCount <= 0) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	m_commands.clear();
+	for (int i = 0; i < drawCount; i++)
+	{
+		const INDIRECT_DRAW& draw = pDraws[i];
+		if ((draw.mesh < 0) || (draw.mesh >= INSTANCED_MESH_COUNT) || (draw.instanceCount <= 0))
+			continue;
+
+		DRAW_ELEMENTS_COMMAND commands[2];
+		int commandCount = GetDrawCommands(draw.mesh, draw.lod, draw.bDrawTop, draw.bDrawBottom, draw.bDrawSides, commands);
+		for (int c = 0; c < commandCount; c++)
+		{
+			commands[c].instanceCount = (GLuint)draw.instanceCount;
+			commands[c].baseInstance = (GLuint)draw.firstInstance;
+			m_commands.push_back(commands[c]);
+			m_triangleCount += (commands[c].count / 3) * draw.instanceCount;
+		}
+	}
+	if (m_commands.empty())
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vaos[m_streams]);
+	StreamInstances(pInstances, instanceCount);
+
+	size_t commandSize = sizeof(DRAW_ELEMENTS_COMMAND) * m_commands.size();
+	GLintptr commandOffset = 0;
+	void* pCommands = m_commandRing.Allocate(commandSize, g_RingAlignment, commandOffset);
+	if (pCommands != NULL)
+	{
+		memcpy(pCommands, m_commands.data(), commandSize);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandRing.GetBuffer());
+	}
+	else
+	{
+		// orphan the command buffer the same way as the instances
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+		if ((int)m_commands.size() > m_indirectCapacity)
+		{
+			m_indirectCapacity = (int)m_commands.size();
+		}
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DRAW_ELEMENTS_COMMAND) * m_indirectCapacity, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandSize, m_commands.data());
+	}
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commandOffset, (GLsizei)m_commands.size(), 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	m_drawCallCount++;
+}
+
+/***********************************************************
+ *  GetDrawCommands()
+ *
+ *  This method is used for getting the indirect commands
+ *  that draw the selected parts of a mesh.  The instance
+ *  count and base instance are left at zero for the caller,
+ *  or a compute shader, to fill in.
+ ***********************************************************/
+int InstancedMeshes::GetDrawCommands(
+	INSTANCED_MESH mesh,
+	int lod,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides,
+	DRAW_ELEMENTS_COMMAND commands[2]) const
+{
+	if ((mesh < 0) || (mesh >= INSTANCED_MESH_COUNT))
+	{
+		return(0);
+	}
+
+	INDEX_RANGE ranges[2];
+	int rangeCount = GetPartRanges(mesh, lod, bDrawTop, bDrawBottom, bDrawSides, ranges);
+	for (int i = 0; i < rangeCount; i++)
+	{
+		commands[i].count = ranges[i].count;
+		commands[i].instanceCount = 0;
+		commands[i].firstIndex = ranges[i].first;
+		commands[i].baseVertex = 0;
+		commands[i].baseInstance = 0;
+	}
+
+	return(rangeCount);
+}
+
+/***********************************************************
+ *  ReserveInstances()
+ *
+ *  This method is used for handing out the instance buffer
+ *  for a compute shader to write instances into.
+ ***********************************************************/
+GLuint InstancedMeshes::ReserveInstances(int instanceCount)
+{
+	ReserveInstanceCapacity(instanceCount);
+
+	return(m_instanceVBO);
+}
+
+/***********************************************************
+ *  DrawGpuCommands()
+ *
+ *  This method is used for drawing a range of indirect
+ *  commands that a compute shader wrote, together with the
+ *  instances they point at, with one multi-draw-indirect
+ *  call.  Commands that were left without instances draw
+ *  nothing.
+ ***********************************************************/
+void InstancedMeshes::DrawGpuCommands(GLuint commandBuffer, int firstCommand, int commandCount)
+{
+	if ((m_vaos[m_streams] == 0) || (commandBuffer == 0) || (commandCount <= 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBindVertexArray(m_vaos[m_streams]);
+	// the compute shader wrote the instances into the instance buffer
+	BindInstanceSource(m_instanceVBO, 0);
+	glMultiDrawElementsIndirect(
+		GL_TRIANGLES,
+		GL_UNSIGNED_INT,
+		(void*)(sizeof(DRAW_ELEMENTS_COMMAND) * firstCommand),
+		(GLsizei)commandCount,
+		0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	m_drawCallCount++;
+}
+
+/***********************************************************
+ *  FinishFrame()
+ *
+ *  This method is used for fencing the ring regions the
+ *  frame streamed into and moving on to the next ones.
+ ***********************************************************/
+void InstancedMeshes::FinishFrame()
+{
+	m_instanceRing.FinishFrame();
+	m_commandRing.FinishFrame();
+}
+
+/***********************************************************
+ *  GetMeshTriangleCount()
+ *
+ *  This method is used for counting the triangles of one
+ *  copy of the selected parts of a mesh.  The part flags are
+ *  ignored for the plane.
+ ***********************************************************/
+unsigned int InstancedMeshes::GetMeshTriangleCount(
+	INSTANCED_MESH mesh,
+	int lod,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides) const
+{
+	if ((mesh < 0) || (mesh >= INSTANCED_MESH_COUNT))
+	{
+		return(0);
+	}
+
+	const MESH_RANGES& buffers = m_meshes[mesh][glm::clamp(lod, 0, LOD_COUNT - 1)];
+	if (mesh == INSTANCED_PLANE)
+	{
+		return(buffers.sides.count / 3);
+	}
+
+	GLuint count = 0;
+	if (bDrawTop)
+		count += buffers.top.count;
+	if (bDrawBottom)
+		count += buffers.bottom.count;
+	if (bDrawSides)
+		count += buffers.sides.count;
+
+	return(count / 3);
+}
+
+/***********************************************************
+ *  GetLodError()
+ *
+ *  This method is used for getting how far a level of detail
+ *  falls short of the true round surface.  The slices are
+ *  chords of the circle, which sit 1 - cos(pi / slices) of
+ *  the radius inside it at their middle.
+ ***********************************************************/
+float InstancedMeshes::GetLodError(INSTANCED_MESH mesh, int lod)
+{
+	if ((mesh == INSTANCED_PLANE) || (lod <= 0))
+	{
+		// level 0 is the reference the others are measured against
+		return(0.0f);
+	}
+
+	lod = glm::min(lod, LOD_COUNT - 1);
+
+	return(1.0f - glm::cos(glm::pi<float>() / (float)g_CylinderSlices[lod]));
+}
+
+/***********************************************************
+ *  SelectLod()
+ *
+ *  This method is used for picking the level of detail of
+ *  one object.  The chord error of each level is projected
+ *  at the distance of the object's center, and the coarsest
+ *  level that stays within the allowed pixels is used.  An
+ *  object the view is inside of keeps the full detail.
+ ***********************************************************/
+int InstancedMeshes::SelectLod(
+	INSTANCED_MESH mesh,
+	float radius,
+	const glm::vec3& center,
+	const LOD_VIEW& view)
+{
+	if ((mesh == INSTANCED_PLANE) || (radius <= 0.0f) || (view.pixelsPerUnit <= 0.0f))
+	{
+		return(0);
+	}
+
+	float pixelsPerUnit = view.pixelsPerUnit;
+	if (view.bPerspective)
+	{
+		float distance = glm::length(center - view.viewPosition);
+		if (distance <= radius)
+		{
+			return(0);
+		}
+		pixelsPerUnit /= distance;
+	}
+
+	int lod = 0;
+	while ((lod + 1 < LOD_COUNT) &&
+		(GetLodError(mesh, lod + 1) * radius * pixelsPerUnit <= view.maxErrorPixels))
+	{
+		lod++;
+	}
+
+	return(lod);
+}
+
+/***********************************************************
+ *  GetDrawCallCount()
+ *
+ *  This method is used for reading the number of instanced
+ *  draw calls issued.
+ ***********************************************************/
+unsigned int InstancedMeshes::GetDrawCallCount() const
+{
+	return(m_drawCallCount);
+}
+
+/***********************************************************
+ *  GetTriangleCount()
+ *
+ *  This method is used for reading the number of triangles
+ *  drawn by the instanced draw calls, over all instances.
+ ***********************************************************/
+unsigned int InstancedMeshes::GetTriangleCount() const
+{
+	return(m_triangleCount);
+}
+
+/***********************************************************
+ *  ResetDrawCallCount()
+ *
+ *  This method is used for restarting the draw call and
+ *  triangle counters.
+ ***********************************************************/
+void InstancedMeshes::ResetDrawCallCount()
+{
+	m_drawCallCount = 0;
+	m_triangleCount = 0;
+}
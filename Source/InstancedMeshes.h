@@ -0,0 +1,316 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.h
+// ============
+// generate the basic shape meshes and draw many copies with one draw call
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "StreamRing.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  InstancedMeshes
+ *
+ *  This class builds its own copies of the plane, cylinder
+ *  and tapered cylinder that ShapeMeshes draws, with the
+ *  same dimensions and texture mapping, into one shared
+ *  vertex and index buffer.  It draws N copies of one of
+ *  them with a single instanced draw call, or a whole list
+ *  of meshes with one multi-draw-indirect call.
+ *
+ *  The per-instance model matrix, normal matrix, color, UV
+ *  scale, material and flags are streamed into one shared
+ *  instance buffer that feeds attributes 3 to 12 of
+ *  instancedVertexShader.glsl.  Each indirect command starts
+ *  at its own base instance, so every draw of a multi-draw
+ *  reads its own instances.
+ *
+ *  The vertices are packed into two streams: the positions
+ *  as floats, and the normals as 10:10:10:2 integers with
+ *  the texture coordinates as half floats.  Depth passes
+ *  bind a vertex array that reads the positions alone.  The
+ *  triangles of every part are ordered for the vertex cache
+ *  and for overdraw.
+ *
+ *  The cylinders are built at LOD_COUNT levels of detail,
+ *  halving the slices at each level.  SelectLod() picks the
+ *  coarsest level whose silhouette stays within an error in
+ *  pixels for a view, so distant copies cost fewer vertices.
+ *
+ *  Where buffers can stay mapped, the instances and commands
+ *  of each frame are written straight into fenced rings and
+ *  the instance attributes are pointed at the frame's part
+ *  of the ring; FinishFrame() must then close every frame.
+ ***********************************************************/
+class InstancedMeshes
+{
+public:
+	// constructor
+	InstancedMeshes();
+	// destructor
+	~InstancedMeshes();
+
+	// meshes that can be drawn instanced
+	enum INSTANCED_MESH
+	{
+		INSTANCED_PLANE = 0,
+		INSTANCED_CYLINDER,
+		INSTANCED_TAPERED_CYLINDER,
+		INSTANCED_MESH_COUNT
+	};
+
+	// levels of detail of each mesh, from the full tessellation at 0
+	static const int LOD_COUNT = 3;
+
+	// vertex streams the draws read
+	enum VERTEX_STREAMS
+	{
+		// positions, normals and texture coordinates
+		STREAMS_ALL = 0,
+		// positions and instance transforms only, for depth passes
+		STREAMS_POSITION,
+		STREAMS_COUNT
+	};
+
+	// what a level of detail is chosen for: the projection of one
+	// view and the largest silhouette error it accepts
+	struct LOD_VIEW
+	{
+		glm::vec3 viewPosition = glm::vec3(0.0f);
+		// pixels per world unit at distance 1 for a perspective
+		// projection, or at any distance for an orthographic one
+		float pixelsPerUnit = 0.0f;
+		bool bPerspective = true;
+		float maxErrorPixels = 1.0f;
+	};
+
+	// per-instance values; the layout matches the instance
+	// attributes of instancedVertexShader.glsl
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model = glm::mat4(1.0f);
+		// inverse-transpose of the model matrix, one column per
+		// vec4 with the w components unused
+		glm::vec4 normalMatrix[3] = {
+			glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
+			glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
+			glm::vec4(0.0f, 0.0f, 1.0f, 0.0f) };
+		glm::vec4 color = glm::vec4(1.0f);
+		glm::vec2 uvScale = glm::vec2(1.0f);
+		// material table entry, or -1 to use the material uniforms
+		int32_t materialSlot = -1;
+		// INSTANCE_FLAGS that switch on shading beyond the uniforms
+		uint32_t drawFlags = 0;
+	};
+
+	// per-instance shading flags; must match the INSTANCE_*
+	// defines in fragmentShader.glsl
+	enum INSTANCE_FLAGS : uint32_t
+	{
+		INSTANCE_TEXTURED = 1u << 0,
+		INSTANCE_LIT = 1u << 1,
+		INSTANCE_LIQUID = 1u << 2
+	};
+
+	// one draw of a multi-draw: the selected parts of a mesh for
+	// a range of the instances passed along with it
+	struct INDIRECT_DRAW
+	{
+		INSTANCED_MESH mesh = INSTANCED_PLANE;
+		int lod = 0;
+		bool bDrawTop = true;
+		bool bDrawBottom = true;
+		bool bDrawSides = true;
+		int firstInstance = 0;
+		int instanceCount = 0;
+	};
+
+	// command layout read by glMultiDrawElementsIndirect
+	struct DRAW_ELEMENTS_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+private:
+	// index range of one mesh part
+	struct INDEX_RANGE
+	{
+		GLuint first = 0;
+		GLuint count = 0;
+	};
+
+	// part ranges of one generated mesh in the shared index
+	// buffer; the parts are stored bottom, sides, top so that
+	// neighbouring parts can be drawn as one range
+	struct MESH_RANGES
+	{
+		INDEX_RANGE bottom;
+		INDEX_RANGE sides;
+		INDEX_RANGE top;
+	};
+
+	MESH_RANGES m_meshes[INSTANCED_MESH_COUNT][LOD_COUNT];
+	// shared geometry of every mesh: float positions, packed normals
+	// and texture coordinates, and the indices
+	GLuint m_positionVBO;
+	GLuint m_attributeVBO;
+	GLuint m_ibo;
+	// one vertex array per set of streams, and the set draws use
+	GLuint m_vaos[STREAMS_COUNT];
+	VERTEX_STREAMS m_streams;
+	// shared per-instance attribute buffer and its size in instances
+	GLuint m_instanceVBO;
+	int m_instanceCapacity;
+	// indirect command buffer and its CPU copy; the buffer is only
+	// created when multi-draw-indirect is supported
+	GLuint m_indirectBuffer;
+	int m_indirectCapacity;
+	std::vector<DRAW_ELEMENTS_COMMAND> m_commands;
+	// persistently mapped rings the instances and commands of a frame
+	// are streamed through; unused when buffer storage is missing
+	StreamRing m_instanceRing;
+	StreamRing m_commandRing;
+	// buffer and offset the instance attributes of each vertex
+	// array read from now
+	GLuint m_instanceSources[STREAMS_COUNT];
+	GLintptr m_instanceSourceOffsets[STREAMS_COUNT];
+	// number of instanced draw calls and triangles issued
+	unsigned int m_drawCallCount;
+	unsigned int m_triangleCount;
+
+	// CPU side geometry while a mesh is being built
+	std::vector<GLfloat> m_vertices;
+	std::vector<GLuint> m_indices;
+
+	// append one vertex of position, normal and texture coordinate
+	GLuint AddVertex(glm::vec3 position, glm::vec3 normal, glm::vec2 uv);
+	// append a capped cone section with a number of slices; equal
+	// radii give a cylinder
+	void BuildCylinder(MESH_RANGES& mesh, float bottomRadius, float topRadius, int slices);
+	// append the plane
+	void BuildPlane(MESH_RANGES& mesh);
+	// order the triangles and vertices of the built geometry
+	void OptimizeMeshes();
+	// pack and upload the built geometry and set up the vertex arrays
+	void CreateBuffers();
+	// stream instances into the instance buffer
+	void UploadInstances(const INSTANCE_DATA* pInstances, int instanceCount);
+	// grow the instance buffer to hold a number of instances
+	void ReserveInstanceCapacity(int instanceCount);
+	// point the instance attributes of the vertex array of the
+	// current streams, which must be bound, at a buffer, when they
+	// read from somewhere else
+	void BindInstanceSource(GLuint buffer, GLintptr offset);
+	// put instances where the bound vertex array reads them: the
+	// ring of the frame, or the instance buffer when it is full
+	void StreamInstances(const INSTANCE_DATA* pInstances, int instanceCount);
+	// merge the selected parts of a mesh into as few index ranges
+	// as possible; returns the number of ranges, at most two
+	int GetPartRanges(
+		INSTANCED_MESH mesh,
+		int lod,
+		bool bDrawTop,
+		bool bDrawBottom,
+		bool bDrawSides,
+		INDEX_RANGE ranges[2]) const;
+	// draw one index range for every uploaded instance
+	void DrawRange(GLuint first, GLuint count, int instanceCount);
+
+public:
+	// build and upload every mesh and the instance buffer
+	void LoadMeshes();
+	// free the OpenGL objects
+	void DestroyMeshes();
+	// choose the streams the following draws read; depth passes
+	// read the positions alone
+	void SetVertexStreams(VERTEX_STREAMS streams);
+
+	// draw one copy of a mesh per instance; the part flags are
+	// ignored for the plane
+	void DrawInstanced(
+		INSTANCED_MESH mesh,
+		int lod,
+		bool bDrawTop,
+		bool bDrawBottom,
+		bool bDrawSides,
+		const INSTANCE_DATA* pInstances,
+		int instanceCount);
+
+	// draw a single copy of a mesh with the bound program, which
+	// reads only the vertex attributes; nothing is counted here
+	void DrawMesh(
+		INSTANCED_MESH mesh,
+		int lod,
+		bool bDrawTop,
+		bool bDrawBottom,
+		bool bDrawSides) const;
+
+	// check whether the driver runs multi-draw-indirect with base
+	// instances; call with a current OpenGL context
+	static bool IsIndirectSupported();
+	// draw every listed mesh with one multi-draw-indirect call;
+	// each draw reads its range of the passed instances
+	void DrawIndirect(
+		const INDIRECT_DRAW* pDraws,
+		int drawCount,
+		const INSTANCE_DATA* pInstances,
+		int instanceCount);
+
+	// indirect commands of the selected parts of a mesh, with no
+	// instances; returns the number of commands, at most two
+	int GetDrawCommands(
+		INSTANCED_MESH mesh,
+		int lod,
+		bool bDrawTop,
+		bool bDrawBottom,
+		bool bDrawSides,
+		DRAW_ELEMENTS_COMMAND commands[2]) const;
+	// instance buffer sized for at least a number of instances, for
+	// filling on the GPU; the contents are undefined until written
+	GLuint ReserveInstances(int instanceCount);
+	// draw commands and instances that were written on the GPU; the
+	// triangles are not known here and are not counted
+	void DrawGpuCommands(GLuint commandBuffer, int firstCommand, int commandCount);
+
+	// close the streamed data of a frame once its last draw is issued
+	void FinishFrame();
+
+	// triangles in one copy of the selected parts of a mesh; the
+	// matching ShapeMeshes draws use the tessellation of level 0
+	unsigned int GetMeshTriangleCount(
+		INSTANCED_MESH mesh,
+		int lod,
+		bool bDrawTop,
+		bool bDrawBottom,
+		bool bDrawSides) const;
+
+	// deepest a level of detail cuts inside the true surface, as a
+	// fraction of the radius; 0 for the plane, which is exact
+	static float GetLodError(INSTANCED_MESH mesh, int lod);
+	// coarsest level of detail of a mesh with a radius about its
+	// axis, centered at a world position, that keeps its silhouette
+	// within the error of a view
+	static int SelectLod(
+		INSTANCED_MESH mesh,
+		float radius,
+		const glm::vec3& center,
+		const LOD_VIEW& view);
+
+	// instanced draw calls and triangles since the counters were last reset
+	unsigned int GetDrawCallCount() const;
+	unsigned int GetTriangleCount() const;
+	void ResetDrawCallCount();
+};
@@ -0,0 +1,251 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// split CPU frame work into jobs run by a pool of work-stealing threads
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem()
+	: m_queuedTasks(0)
+{
+	m_bStopping = false;
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the worker threads, one
+ *  queue each.
+ ***********************************************************/
+void JobSystem::Start(int workerCount)
+{
+	if (!m_workers.empty() || (workerCount < 1))
+	{
+		return;
+	}
+
+	m_bStopping = false;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_queues.push_back(std::unique_ptr<TASK_QUEUE>(new TASK_QUEUE()));
+	}
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerMain, this, (size_t)i));
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for joining the worker threads.  No
+ *  range is running then, so every queue is empty.
+ ***********************************************************/
+void JobSystem::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bStopping = true;
+	}
+	m_wake.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+	m_queues.clear();
+}
+
+/***********************************************************
+ *  GetWorkerCount()
+ *
+ *  This method is used for getting the number of worker
+ *  threads, not counting the caller.
+ ***********************************************************/
+int JobSystem::GetWorkerCount() const
+{
+	return((int)m_workers.size());
+}
+
+/***********************************************************
+ *  TakeTask()
+ *
+ *  This method is used for taking the newest task of one
+ *  queue, or else the oldest task of any other queue.
+ *  Passing an index past the last queue, as the caller
+ *  does, only steals.
+ ***********************************************************/
+bool JobSystem::TakeTask(size_t queueIndex, TASK& task)
+{
+	if (queueIndex < m_queues.size())
+	{
+		TASK_QUEUE& own = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (own.count > 0)
+		{
+			own.count--;
+			task = own.tasks[(own.first + own.count) % QUEUE_CAPACITY];
+			m_queuedTasks--;
+			return(true);
+		}
+	}
+
+	for (size_t i = 1; i <= m_queues.size(); i++)
+	{
+		TASK_QUEUE& victim = *m_queues[(queueIndex + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.count > 0)
+		{
+			task = victim.tasks[victim.first];
+			victim.first = (victim.first + 1) % QUEUE_CAPACITY;
+			victim.count--;
+			m_queuedTasks--;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  RunTask()
+ *
+ *  This method is used for running the chunk of a task and
+ *  counting it off its range.
+ ***********************************************************/
+void JobSystem::RunTask(const TASK& task)
+{
+	task.pThunk(task.pJob, task.chunk, task.begin, task.end);
+	task.pRemaining->fetch_sub(1, std::memory_order_acq_rel);
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method is used by each worker thread for running
+ *  tasks, sleeping while none are queued, until the job
+ *  system stops.
+ ***********************************************************/
+void JobSystem::WorkerMain(size_t queueIndex)
+{
+	while (true)
+	{
+		TASK task;
+		if (TakeTask(queueIndex, task))
+		{
+			RunTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wake.wait(lock, [this]() { return(m_bStopping || (m_queuedTasks.load() > 0)); });
+		if (m_bStopping)
+		{
+			return;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetChunkCount()
+ *
+ *  This method is used for getting the number of chunks a
+ *  range is cut into: enough for every thread to steal
+ *  from, but none smaller than the given size.
+ ***********************************************************/
+size_t JobSystem::GetChunkCount(size_t count, size_t minChunkSize) const
+{
+	if (count == 0)
+	{
+		return(0);
+	}
+
+	minChunkSize = std::max<size_t>(minChunkSize, 1);
+	size_t threadCount = m_workers.size() + 1;
+	size_t chunkCount = (count + minChunkSize - 1) / minChunkSize;
+
+	return(std::min(chunkCount, threadCount * CHUNKS_PER_THREAD));
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for running a job over a range.  A
+ *  range of one chunk, or a system without workers, runs on
+ *  the calling thread.  Otherwise the chunks are dealt out
+ *  round robin, and the caller steals them until the last
+ *  one is done.
+ ***********************************************************/
+void JobSystem::Run(size_t count, size_t minChunkSize, JOB_THUNK pThunk, const void* pJob)
+{
+	size_t chunkCount = GetChunkCount(count, minChunkSize);
+	if (chunkCount == 0)
+	{
+		return;
+	}
+	if ((chunkCount == 1) || m_workers.empty())
+	{
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			pThunk(pJob, chunk, chunk * count / chunkCount, (chunk + 1) * count / chunkCount);
+		}
+		return;
+	}
+
+	std::atomic<size_t> remaining(chunkCount);
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		TASK task;
+		task.pThunk = pThunk;
+		task.pJob = pJob;
+		task.chunk = chunk;
+		task.begin = chunk * count / chunkCount;
+		task.end = (chunk + 1) * count / chunkCount;
+		task.pRemaining = &remaining;
+
+		TASK_QUEUE& queue = *m_queues[chunk % m_queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks[(queue.first + queue.count) % QUEUE_CAPACITY] = task;
+		queue.count++;
+		m_queuedTasks++;
+	}
+	{
+		// taking the lock orders the wake-up after the waiters' check
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+	}
+	m_wake.notify_all();
+
+	while (remaining.load(std::memory_order_acquire) > 0)
+	{
+		TASK task;
+		if (TakeTask(m_queues.size(), task))
+		{
+			RunTask(task);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// split CPU frame work into jobs run by a pool of work-stealing threads
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs a loop over a range on a pool of worker
+ *  threads.  ParallelFor() cuts the range into chunks and
+ *  deals them out to the queues of the workers; a worker
+ *  takes from the back of its own queue and, when that runs
+ *  dry, steals from the front of another one, so uneven
+ *  chunks still keep every core busy.  The calling thread
+ *  steals chunks too while it waits.
+ *
+ *  The chunks of a range are the same for every call with
+ *  the same count, so a job can write its results into a
+ *  slot per chunk and the caller can combine them in order.
+ *  Jobs must not make OpenGL calls.
+ *
+ *  Running a range allocates nothing: the job is called
+ *  through a plain function pointer and every queue holds a
+ *  fixed number of tasks, which the chunk limit never
+ *  exceeds.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor
+	JobSystem();
+	// destructor
+	~JobSystem();
+
+private:
+	// most chunks per thread a range is cut into, so a thread that
+	// finishes early has chunks left to steal
+	static const size_t CHUNKS_PER_THREAD = 4;
+	// tasks one queue holds; the chunks of a range dealt round robin
+	// to at least one worker never fill more
+	static const size_t QUEUE_CAPACITY = CHUNKS_PER_THREAD * 2;
+
+	// calls the job of a range on one chunk
+	typedef void (*JOB_THUNK)(const void* pJob, size_t chunk, size_t begin, size_t end);
+
+	// one chunk waiting to run
+	struct TASK
+	{
+		JOB_THUNK pThunk = NULL;
+		const void* pJob = NULL;
+		size_t chunk = 0;
+		size_t begin = 0;
+		size_t end = 0;
+		std::atomic<size_t>* pRemaining = NULL;
+	};
+
+	// tasks dealt to one worker, as a ring of fixed size
+	struct TASK_QUEUE
+	{
+		std::mutex mutex;
+		TASK tasks[QUEUE_CAPACITY];
+		size_t first = 0;
+		size_t count = 0;
+	};
+
+	std::vector<std::thread> m_workers;
+	std::vector<std::unique_ptr<TASK_QUEUE>> m_queues;
+	// tasks queued and not yet taken, so idle workers can sleep
+	std::atomic<size_t> m_queuedTasks;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	bool m_bStopping;
+
+	// take a task, from the back of one queue or the front of any other
+	bool TakeTask(size_t queueIndex, TASK& task);
+	// run a task and count it as done
+	static void RunTask(const TASK& task);
+	// body of each worker thread
+	void WorkerMain(size_t queueIndex);
+	// run a job, called through its thunk, over every chunk of a range
+	void Run(size_t count, size_t minChunkSize, JOB_THUNK pThunk, const void* pJob);
+
+	template<typename JOB>
+	static void InvokeJob(const void* pJob, size_t chunk, size_t begin, size_t end)
+	{
+		(*static_cast<const JOB*>(pJob))(chunk, begin, end);
+	}
+
+public:
+	// start the worker threads; none runs every job on the caller
+	void Start(int workerCount);
+	// finish and join the worker threads
+	void Stop();
+	int GetWorkerCount() const;
+
+	// number of chunks ParallelFor() cuts a range of a count into,
+	// with at least minChunkSize entries per chunk
+	size_t GetChunkCount(size_t count, size_t minChunkSize) const;
+	// run a job over every chunk of a range and return when all of
+	// them are done; the job is called as job(chunk, begin, end);
+	// call from one thread at a time
+	template<typename JOB>
+	void ParallelFor(size_t count, size_t minChunkSize, const JOB& job)
+	{
+		Run(count, minChunkSize, &InvokeJob<JOB>, &job);
+	}
+};
@@ -0,0 +1,195 @@
+///////////////////////////////////////////////////////////////////////////////
+// lineararena.cpp
+// ============
+// hand out memory from large blocks and release all of it at once
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LinearArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// alignment of the memory right after a block header
+	const size_t g_BlockAlignment = 16;
+	// offset of the memory of a block from its header
+	const size_t g_HeaderSize = (sizeof(void*) * 3 + g_BlockAlignment - 1) & ~(g_BlockAlignment - 1);
+
+	// first offset at or after another one whose address is aligned
+	size_t AlignOffset(const unsigned char* pMemory, size_t offset, size_t alignment)
+	{
+		uintptr_t address = reinterpret_cast<uintptr_t>(pMemory + offset);
+		uintptr_t aligned = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+		return(offset + (size_t)(aligned - address));
+	}
+}
+
+/***********************************************************
+ *  LinearArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LinearArena::LinearArena(size_t blockSize)
+{
+	m_pBlocks = NULL;
+	m_blockSize = std::max<size_t>(blockSize, g_BlockAlignment);
+	m_usedBytes = 0;
+	m_pDestructors = NULL;
+}
+
+/***********************************************************
+ *  ~LinearArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LinearArena::~LinearArena()
+{
+	Reset();
+	FreeBlocks();
+}
+
+/***********************************************************
+ *  AddBlock()
+ *
+ *  This method is used for opening a block that takes the
+ *  requests from now on.
+ ***********************************************************/
+void LinearArena::AddBlock(size_t size)
+{
+	static_assert(sizeof(BLOCK) <= g_HeaderSize, "block header does not fit");
+
+	BLOCK* pBlock = static_cast<BLOCK*>(::operator new(g_HeaderSize + size));
+	pBlock->pNext = m_pBlocks;
+	pBlock->size = size;
+	pBlock->used = 0;
+	m_pBlocks = pBlock;
+}
+
+/***********************************************************
+ *  FreeBlocks()
+ *
+ *  This method is used for giving every block back to the
+ *  heap.
+ ***********************************************************/
+void LinearArena::FreeBlocks()
+{
+	while (m_pBlocks != NULL)
+	{
+		BLOCK* pNext = m_pBlocks->pNext;
+		::operator delete(m_pBlocks);
+		m_pBlocks = pNext;
+	}
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for handing out memory from the
+ *  newest block, or from a new one when it is full.
+ ***********************************************************/
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	alignment = std::max<size_t>(alignment, 1);
+
+	unsigned char* pMemory = NULL;
+	size_t start = 0;
+	if (m_pBlocks != NULL)
+	{
+		pMemory = reinterpret_cast<unsigned char*>(m_pBlocks) + g_HeaderSize;
+		start = AlignOffset(pMemory, m_pBlocks->used, alignment);
+	}
+	if ((m_pBlocks == NULL) || (start + size > m_pBlocks->size))
+	{
+		// the block memory is aligned to g_BlockAlignment, so larger
+		// alignments need room to move the start along
+		size_t padding = (alignment > g_BlockAlignment) ? alignment : 0;
+		AddBlock(std::max(m_blockSize, size + padding));
+		pMemory = reinterpret_cast<unsigned char*>(m_pBlocks) + g_HeaderSize;
+		start = AlignOffset(pMemory, 0, alignment);
+	}
+
+	m_usedBytes += start + size - m_pBlocks->used;
+	m_pBlocks->used = start + size;
+
+	return(pMemory + start);
+}
+
+/***********************************************************
+ *  CopyString()
+ *
+ *  This method is used for keeping a copy of a string for
+ *  the lifetime of the arena contents.
+ ***********************************************************/
+const char* LinearArena::CopyString(const char* text)
+{
+	size_t length = strlen(text);
+	char* pCopy = static_cast<char*>(Allocate(length + 1, 1));
+	memcpy(pCopy, text, length + 1);
+
+	return(pCopy);
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for destroying the created objects,
+ *  newest first, and taking back every byte.  Requests that
+ *  spilled into extra blocks grow the arena to one block of
+ *  their total size, with room to spare.
+ ***********************************************************/
+void LinearArena::Reset()
+{
+	while (m_pDestructors != NULL)
+	{
+		DESTRUCTOR* pDestructor = m_pDestructors;
+		m_pDestructors = pDestructor->pNext;
+		pDestructor->pDestroy(pDestructor->pObject);
+	}
+
+	if ((m_pBlocks != NULL) && (m_pBlocks->pNext != NULL))
+	{
+		m_blockSize = std::max(m_blockSize, m_usedBytes + m_usedBytes / 2);
+		FreeBlocks();
+		AddBlock(m_blockSize);
+	}
+	if (m_pBlocks != NULL)
+	{
+		m_pBlocks->used = 0;
+	}
+	m_usedBytes = 0;
+}
+
+/***********************************************************
+ *  GetUsedBytes()
+ *
+ *  This method is used for reading the bytes handed out
+ *  since the last Reset().
+ ***********************************************************/
+size_t LinearArena::GetUsedBytes() const
+{
+	return(m_usedBytes);
+}
+
+/***********************************************************
+ *  GetCapacity()
+ *
+ *  This method is used for reading the bytes held in all
+ *  blocks.
+ ***********************************************************/
+size_t LinearArena::GetCapacity() const
+{
+	size_t capacity = 0;
+	for (BLOCK* pBlock = m_pBlocks; pBlock != NULL; pBlock = pBlock->pNext)
+	{
+		capacity += pBlock->size;
+	}
+
+	return(capacity);
+}
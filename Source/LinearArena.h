@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+// lineararena.h
+// ============
+// hand out memory from large blocks and release all of it at once
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/***********************************************************
+ *  LinearArena
+ *
+ *  This class hands out memory by moving a pointer through
+ *  a block, and takes all of it back with one Reset().  A
+ *  frame arena is reset at the end of every frame, so the
+ *  lists a frame builds cost no heap allocation; a scene
+ *  arena lives as long as the scene.
+ *
+ *  A request that does not fit opens another block.  Reset()
+ *  then replaces the blocks with a single one large enough
+ *  for all of them, so an arena reset every frame settles
+ *  on one block after the first frames.
+ *
+ *  Objects made with Create() are destroyed by Reset() in
+ *  the reverse order of their creation.  Arrays are only for
+ *  types without a destructor.  An arena is used by one
+ *  thread at a time; jobs write into arrays handed out
+ *  before they start.
+ ***********************************************************/
+class LinearArena
+{
+public:
+	// constructor; the first block is made on the first request
+	explicit LinearArena(size_t blockSize);
+	// destructor
+	~LinearArena();
+
+private:
+	// header in front of the memory of every block
+	struct BLOCK
+	{
+		BLOCK* pNext;
+		size_t size;
+		size_t used;
+	};
+
+	// object to destroy on Reset(), kept in the arena itself
+	struct DESTRUCTOR
+	{
+		void (*pDestroy)(void* pObject);
+		void* pObject;
+		DESTRUCTOR* pNext;
+	};
+
+	// newest block first; only the newest one takes requests
+	BLOCK* m_pBlocks;
+	size_t m_blockSize;
+	// bytes handed out since the last Reset(), padding included
+	size_t m_usedBytes;
+	// newest object first
+	DESTRUCTOR* m_pDestructors;
+
+	LinearArena(const LinearArena&);
+	LinearArena& operator=(const LinearArena&);
+
+	// open a block of at least a number of bytes
+	void AddBlock(size_t size);
+	// free every block
+	void FreeBlocks();
+
+	template<typename T>
+	static void DestroyObject(void* pObject)
+	{
+		static_cast<T*>(pObject)->~T();
+	}
+
+public:
+	// uninitialized memory aligned to a power of two
+	void* Allocate(size_t size, size_t alignment);
+
+	// array of value-initialized elements; NULL for none
+	template<typename T>
+	T* AllocateArray(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "arena arrays are never destroyed");
+		if (count == 0)
+		{
+			return(NULL);
+		}
+
+		T* pArray = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		for (size_t i = 0; i < count; i++)
+		{
+			new (pArray + i) T();
+		}
+
+		return(pArray);
+	}
+
+	// object destroyed by the next Reset()
+	template<typename T, typename... ARGS>
+	T* Create(ARGS&&... args)
+	{
+		DESTRUCTOR* pDestructor = static_cast<DESTRUCTOR*>(Allocate(sizeof(DESTRUCTOR), alignof(DESTRUCTOR)));
+		T* pObject = new (Allocate(sizeof(T), alignof(T))) T(std::forward<ARGS>(args)...);
+		pDestructor->pDestroy = &DestroyObject<T>;
+		pDestructor->pObject = pObject;
+		pDestructor->pNext = m_pDestructors;
+		m_pDestructors = pDestructor;
+
+		return(pObject);
+	}
+
+	// copy of a zero-terminated string
+	const char* CopyString(const char* text);
+
+	// destroy the created objects and take back every byte
+	void Reset();
+
+	// bytes handed out since the last Reset() and bytes held
+	size_t GetUsedBytes() const;
+	size_t GetCapacity() const;
+};
+
+/***********************************************************
+ *  ArenaArray
+ *
+ *  This class is a list of elements without a destructor
+ *  whose storage comes from an arena, e.g. a table of the
+ *  loaded scene.  Reserve() sets its capacity once and
+ *  empties it; the storage goes with the next Reset() of
+ *  that arena, so the list is reserved again after it.
+ ***********************************************************/
+template<typename T>
+class ArenaArray
+{
+public:
+	// constructor; holds no storage until Reserve()
+	ArenaArray()
+	{
+		m_pItems = NULL;
+		m_size = 0;
+		m_capacity = 0;
+	}
+
+private:
+	T* m_pItems;
+	size_t m_size;
+	size_t m_capacity;
+
+	ArenaArray(const ArenaArray&);
+	ArenaArray& operator=(const ArenaArray&);
+
+public:
+	// take room for a number of elements from an arena
+	void Reserve(LinearArena& arena, size_t capacity)
+	{
+		m_pItems = arena.AllocateArray<T>(capacity);
+		m_size = 0;
+		m_capacity = capacity;
+	}
+
+	// append an element; returns false once the list is full
+	bool push_back(const T& item)
+	{
+		if (m_size >= m_capacity)
+		{
+			return(false);
+		}
+		m_pItems[m_size++] = item;
+		return(true);
+	}
+
+	// fill the list with a number of copies of one element,
+	// up to its capacity
+	void assign(size_t count, const T& item)
+	{
+		m_size = (count < m_capacity) ? count : m_capacity;
+		for (size_t i = 0; i < m_size; i++)
+		{
+			m_pItems[i] = item;
+		}
+	}
+
+	void clear()
+	{
+		m_size = 0;
+	}
+
+	size_t size() const
+	{
+		return(m_size);
+	}
+
+	size_t capacity() const
+	{
+		return(m_capacity);
+	}
+
+	bool empty() const
+	{
+		return(m_size == 0);
+	}
+
+	T& back()
+	{
+		return(m_pItems[m_size - 1]);
+	}
+
+	T& operator[](size_t index)
+	{
+		return(m_pItems[index]);
+	}
+
+	const T& operator[](size_t index) const
+	{
+		return(m_pItems[index]);
+	}
+};
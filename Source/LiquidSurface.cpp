@@ -0,0 +1,257 @@
+///////////////////////////////////////////////////////////////////////////////
+// liquidsurface.cpp
+// ============
+// generate the radial grid of the liquid surface with levels of detail
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LiquidSurface.h"
+
+#include <glm/gtc/constants.hpp>
+
+// declaration of global variables
+namespace
+{
+	// rings and slices of each grid, the finest first; the finest
+	// keeps about 18 vertices per ripple wavelength
+	const int g_LodRings[LiquidSurface::LOD_COUNT] = { 32, 16, 8 };
+	const int g_LodSlices[LiquidSurface::LOD_COUNT] = { 96, 48, 24 };
+	// smallest ratio of world radius to view distance that still
+	// takes each grid; below the last one the coarsest is drawn
+	const float g_LodSizeRatio[LiquidSurface::LOD_COUNT - 1] = { 0.25f, 0.08f };
+	// floats per vertex: position, normal, texture coordinate
+	const int g_FloatsPerVertex = 8;
+
+	// attribute locations shared with the basic meshes
+	const GLuint g_PositionAttribute = 0;
+	const GLuint g_NormalAttribute = 1;
+	const GLuint g_TextureAttribute = 2;
+}
+
+/***********************************************************
+ *  LiquidSurface()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LiquidSurface::LiquidSurface()
+{
+	m_vao = 0;
+	m_vbo = 0;
+	m_ibo = 0;
+}
+
+/***********************************************************
+ *  ~LiquidSurface()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LiquidSurface::~LiquidSurface()
+{
+	DestroyMesh();
+}
+
+/***********************************************************
+ *  AddVertex()
+ *
+ *  This method is used for appending one vertex of the disk
+ *  and returning its index.  The normal faces +Y and the
+ *  texture is mapped like the cylinder top cap, so the
+ *  fragment shader finds the center at (0.5, 0.5).
+ ***********************************************************/
+GLuint LiquidSurface::AddVertex(float x, float z)
+{
+	GLuint index = (GLuint)(m_vertices.size() / g_FloatsPerVertex);
+
+	m_vertices.push_back(x);
+	m_vertices.push_back(1.0f);
+	m_vertices.push_back(z);
+	m_vertices.push_back(0.0f);
+	m_vertices.push_back(1.0f);
+	m_vertices.push_back(0.0f);
+	m_vertices.push_back(0.5f + 0.5f * x);
+	m_vertices.push_back(0.5f + 0.5f * z);
+
+	return(index);
+}
+
+/***********************************************************
+ *  BuildGrid()
+ *
+ *  This method is used for building one grid: a center
+ *  vertex and evenly spaced rings out to radius 1, with a
+ *  fan around the center and a band of quads between each
+ *  pair of rings.  The winding matches the top cap of the
+ *  cylinder.
+ ***********************************************************/
+void LiquidSurface::BuildGrid(LOD_RANGE& lod, int rings, int slices)
+{
+	const float twoPi = glm::two_pi<float>();
+
+	lod.first = (GLuint)m_indices.size();
+	GLuint center = AddVertex(0.0f, 0.0f);
+	GLuint firstRing = (GLuint)(m_vertices.size() / g_FloatsPerVertex);
+	for (int ring = 1; ring <= rings; ring++)
+	{
+		float radius = (float)ring / (float)rings;
+		for (int i = 0; i < slices; i++)
+		{
+			float angle = twoPi * (float)i / (float)slices;
+			AddVertex(glm::cos(angle) * radius, glm::sin(angle) * radius);
+		}
+	}
+
+	for (int i = 0; i < slices; i++)
+	{
+		GLuint next = (GLuint)((i + 1) % slices);
+		m_indices.push_back(center);
+		m_indices.push_back(firstRing + next);
+		m_indices.push_back(firstRing + i);
+	}
+	for (int ring = 0; ring < rings - 1; ring++)
+	{
+		GLuint inner = firstRing + (GLuint)(ring * slices);
+		GLuint outer = inner + (GLuint)slices;
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint next = (GLuint)((i + 1) % slices);
+			m_indices.push_back(inner + i);
+			m_indices.push_back(outer + next);
+			m_indices.push_back(outer + i);
+			m_indices.push_back(inner + i);
+			m_indices.push_back(inner + next);
+			m_indices.push_back(outer + next);
+		}
+	}
+	lod.count = (GLuint)m_indices.size() - lod.first;
+}
+
+/***********************************************************
+ *  LoadMesh()
+ *
+ *  This method is used for building every grid into one
+ *  vertex and index buffer and recording the vertex layout
+ *  of the basic meshes in its own vertex array.
+ ***********************************************************/
+void LiquidSurface::LoadMesh()
+{
+	if (m_vao != 0)
+	{
+		return;
+	}
+
+	for (int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		BuildGrid(m_lods[lod], g_LodRings[lod], g_LodSlices[lod]);
+	}
+
+	const GLsizei vertexStride = sizeof(GLfloat) * g_FloatsPerVertex;
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	glGenBuffers(1, &m_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m_indices.size(), m_indices.data(), GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(g_PositionAttribute);
+	glVertexAttribPointer(g_PositionAttribute, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)0);
+	glEnableVertexAttribArray(g_NormalAttribute);
+	glVertexAttribPointer(g_NormalAttribute, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(GLfloat) * 3));
+	glEnableVertexAttribArray(g_TextureAttribute);
+	glVertexAttribPointer(g_TextureAttribute, 2, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(GLfloat) * 6));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_vertices.clear();
+	m_indices.clear();
+}
+
+/***********************************************************
+ *  DestroyMesh()
+ *
+ *  This method is used for freeing the buffers and the
+ *  vertex array.
+ ***********************************************************/
+void LiquidSurface::DestroyMesh()
+{
+	if (m_vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+	}
+	if (m_vbo != 0)
+	{
+		glDeleteBuffers(1, &m_vbo);
+		m_vbo = 0;
+	}
+	if (m_ibo != 0)
+	{
+		glDeleteBuffers(1, &m_ibo);
+		m_ibo = 0;
+	}
+}
+
+/***********************************************************
+ *  SelectLod()
+ *
+ *  This method is used for picking the grid of a surface
+ *  by roughly how large it appears: its world radius over
+ *  its distance from the viewer.
+ ***********************************************************/
+int LiquidSurface::SelectLod(float worldRadius, float viewDistance)
+{
+	float sizeRatio = worldRadius / glm::max(viewDistance, 0.001f);
+	for (int lod = 0; lod < LOD_COUNT - 1; lod++)
+	{
+		if (sizeRatio >= g_LodSizeRatio[lod])
+		{
+			return(lod);
+		}
+	}
+
+	return(LOD_COUNT - 1);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing one grid.
+ ***********************************************************/
+void LiquidSurface::Draw(int lod) const
+{
+	if ((m_vao == 0) || (lod < 0) || (lod >= LOD_COUNT))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vao);
+	glDrawElements(
+		GL_TRIANGLES,
+		(GLsizei)m_lods[lod].count,
+		GL_UNSIGNED_INT,
+		(void*)(sizeof(GLuint) * m_lods[lod].first));
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  GetTriangleCount()
+ *
+ *  This method is used for getting the number of triangles
+ *  in one grid.
+ ***********************************************************/
+unsigned int LiquidSurface::GetTriangleCount(int lod) const
+{
+	if ((lod < 0) || (lod >= LOD_COUNT))
+	{
+		return(0);
+	}
+
+	return(m_lods[lod].count / 3);
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// liquidsurface.h
+// ============
+// generate the radial grid of the liquid surface with levels of detail
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LiquidSurface
+ *
+ *  This class builds a disk of radius 1 at height 1, in the
+ *  place of the cylinder top cap, as rings of vertices around
+ *  the center.  The vertex shaders displace every vertex by
+ *  the ripple of the liquid and tilt its normal, so the
+ *  ripple is computed once per vertex rather than for every
+ *  fragment of the surface.
+ *
+ *  Each level of detail is a coarser grid in the same
+ *  buffers; distant or small surfaces take fewer rings, so
+ *  the ripple work stays bounded by the screen size.
+ ***********************************************************/
+class LiquidSurface
+{
+public:
+	// constructor
+	LiquidSurface();
+	// destructor
+	~LiquidSurface();
+
+	// number of grids, the finest first
+	static const int LOD_COUNT = 3;
+
+private:
+	// index range of one grid in the shared index buffer
+	struct LOD_RANGE
+	{
+		GLuint first = 0;
+		GLuint count = 0;
+	};
+
+	LOD_RANGE m_lods[LOD_COUNT];
+	// shared geometry of every grid
+	GLuint m_vao;
+	GLuint m_vbo;
+	GLuint m_ibo;
+
+	// CPU side geometry while the grids are being built
+	std::vector<GLfloat> m_vertices;
+	std::vector<GLuint> m_indices;
+
+	// append one vertex of the disk at a position in the XZ plane
+	GLuint AddVertex(float x, float z);
+	// append a grid of rings around the center
+	void BuildGrid(LOD_RANGE& lod, int rings, int slices);
+
+public:
+	// build and upload every grid
+	void LoadMesh();
+	// free the OpenGL objects
+	void DestroyMesh();
+
+	// grid for a surface of a world radius seen from a distance
+	static int SelectLod(float worldRadius, float viewDistance);
+	// draw one grid with the current program
+	void Draw(int lod) const;
+	// triangles in one grid
+	unsigned int GetTriangleCount(int lod) const;
+};
@@ -9,6 +9,8 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <string>
+#include <vector>
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -22,6 +24,11 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "ShaderCompiler.h"
+#include "UniformBufferManager.h"
+#include "FrameProfiler.h"
+#include "Benchmark.h"
+#include "RenderOptions.h"
 
 // Namespace for declaring global variables
 namespace
@@ -38,12 +45,22 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// uniform buffer objects shared by every shader program
+	UniformBufferManager* g_UniformBuffers = nullptr;
+	// frame timing and per-pass counters shown in the window title
+	FrameProfiler* g_Profiler = nullptr;
+
+	// scene file shown, and a scene file dropped onto the window
+	// that replaces it before the next frame
+	std::string g_SceneFile;
+	std::string g_DroppedSceneFile;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void DropCallback(GLFWwindow* window, int count, const char** paths);
 
 
 /***********************************************************
@@ -54,20 +71,52 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// read the benchmark and rendering options from the command line
+	std::vector<bool> usedArguments(argc, false);
+	Benchmark benchmark;
+	if (benchmark.ParseArguments(argc, argv, usedArguments) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+	RenderOptions options;
+	if (options.ParseArguments(argc, argv, usedArguments) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+	// anything neither of them read is a mistake, e.g. a misspelled
+	// option, and would otherwise run with the defaults
+	if (RenderOptions::CheckUnusedArguments(argc, argv, usedArguments) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
+	// a benchmark renders into a window that is never shown
+	if (benchmark.IsEnabled())
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	// try to create a new shader manager object
-	g_ShaderManager = new ShaderManager();
+	g_ShaderManager = ShaderCompiler::CreateShaderManager(NULL);
+	// try to create a new uniform buffer manager object
+	g_UniformBuffers = new UniformBufferManager();
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
-		g_ShaderManager);
+		g_ShaderManager,
+		g_UniformBuffers);
 
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	if (g_Window == NULL)
+	{
+		return(EXIT_FAILURE);
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -75,20 +124,102 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
+	// create the GPU timer queries and open the optional log,
+	// given as --profile-log <file.csv|file.json>
+	g_Profiler = new FrameProfiler();
+	g_Profiler->Initialize();
+	if (!options.GetProfileLogFile().empty())
+	{
+		g_Profiler->OpenLog(options.GetProfileLogFile().c_str());
+	}
+	g_ViewManager->SetProfiler(g_Profiler);
+
+	// frames are not paced by the display during a benchmark, and
+	// every measured frame is kept for the report
+	if (benchmark.IsEnabled())
+	{
+		glfwSwapInterval(0);
+		g_Profiler->SetKeepFrames(true);
+	}
+
+	// load the shader code from the external GLSL files, or the
+	// cached program binaries of an earlier run
+	ShaderCompiler::EnableParallelCompile();
+	ShaderCompiler::LoadProgram(
+		g_ShaderManager,
 		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
+		"shaders/fragmentShader.glsl",
+		ShaderCompiler::DEFINES());
 	g_ShaderManager->use();
 
+	// create the shared camera and lights uniform buffers
+	g_UniformBuffers->CreateBuffers();
+
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager = new SceneManager(g_ShaderManager, g_UniformBuffers);
+	g_SceneManager->SetSceneCopies(benchmark.GetSceneCopies());
+	// the mug table is shown unless given as --scene <file.scene>
+	if (!options.GetSceneFile().empty())
+	{
+		g_SceneManager->SetSceneFile(options.GetSceneFile().c_str());
+	}
+	g_SceneFile = g_SceneManager->GetSceneFile();
+	g_SceneManager->SetTextureAnisotropy(options.GetAnisotropy());
+	g_SceneManager->SetShadowFilter(options.GetShadowFilter());
+	g_SceneManager->SetLodError(options.GetLodError());
+	g_SceneManager->SetShadowLodBias(options.GetShadowLodBias());
+	g_SceneManager->SetOcclusionCulling(options.IsOcclusionCulling());
+	g_SceneManager->SetDepthPrepass(options.IsDepthPrepass());
+	g_SceneManager->SetFrameBudget(options.GetFrameBudget());
+	g_SceneManager->SetQualityTier(options.GetQualityTier());
 	g_SceneManager->PrepareScene();
+	g_SceneManager->SetProfiler(g_Profiler);
+	// spread the optional point lights over the scene, and write it
+	// with all of its copies, so a large scene loads from one file
+	// next time
+	g_SceneManager->ScatterPointLights(
+		options.GetPointLightCount(),
+		options.GetPointLightShadows());
+	if (!options.GetSaveSceneFile().empty())
+	{
+		g_SceneManager->SaveSceneFile(options.GetSaveSceneFile().c_str());
+	}
+	glfwSetDropCallback(g_Window, DropCallback);
+	// F5 reloads the scene file, e.g. after it was written again
+	bool bReloadHeld = false;
+
+	// the benchmark camera orbits just outside the outermost scene copy,
+	// and measuring starts with every texture in place
+	if (benchmark.IsEnabled())
+	{
+		g_SceneManager->WaitForTextures();
+		g_ViewManager->SetBenchmarkMode(
+			benchmark.GetFixedTimeStep(),
+			g_SceneManager->GetSceneRadius() + 12.0f);
+	}
+	else
+	{
+		// the camera and ripple tick on their own thread, so a slow
+		// frame neither delays nor speeds up the input
+		g_ViewManager->StartUpdateThread();
+	}
+
+	// number of frames rendered so far
+	int renderedFrames = 0;
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		g_Profiler->BeginFrame();
+
+		// fit the resolution scale to the last finished frame and the
+		// offscreen target to the window
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		glfwGetFramebufferSize(g_Window, &framebufferWidth, &framebufferHeight);
+		g_SceneManager->BeginFrame(framebufferWidth, framebufferHeight);
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -101,6 +232,7 @@ int main(int argc, char* argv[])
 
 		// render camera-spotlight shadow map before the lit pass
 		{
+			ProfileScope shadowScope(g_Profiler, FrameProfiler::SECTION_SHADOW);
 			// retrieve camera for spotlight position/direction
 			glm::vec3 camPos = g_ViewManager->GetCameraPosition();
 			glm::vec3 camDir = g_ViewManager->GetCameraFront();
@@ -110,14 +242,58 @@ int main(int argc, char* argv[])
 		}
 
 		// refresh the 3D scene
-		g_SceneManager->RenderScene();
-
+		{
+			ProfileScope sceneScope(g_Profiler, FrameProfiler::SECTION_SCENE);
+			g_SceneManager->RenderScene();
+			g_SceneManager->PresentFrame();
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		{
+			ProfileScope swapScope(g_Profiler, FrameProfiler::SECTION_SWAP);
+			glfwSwapBuffers(g_Window);
+		}
+		g_Profiler->EndFrame();
 
 		// query the latest GLFW events
 		glfwPollEvents();
+
+		// swap scenes between frames, never during a benchmark
+		if (!benchmark.IsEnabled())
+		{
+			bool bReloadKey = (glfwGetKey(g_Window, GLFW_KEY_F5) == GLFW_PRESS);
+			if (bReloadKey && !bReloadHeld)
+			{
+				g_SceneManager->LoadSceneFile(g_SceneFile.c_str());
+			}
+			bReloadHeld = bReloadKey;
+
+			if (!g_DroppedSceneFile.empty())
+			{
+				if (g_SceneManager->LoadSceneFile(g_DroppedSceneFile.c_str()))
+				{
+					g_SceneFile = g_DroppedSceneFile;
+				}
+				g_DroppedSceneFile.clear();
+			}
+		}
+
+		// a benchmark run ends after its fixed number of frames
+		renderedFrames++;
+		if (benchmark.IsEnabled() && (renderedFrames >= benchmark.GetTotalFrames()))
+		{
+			glfwSetWindowShouldClose(g_Window, true);
+		}
+	}
+
+	// read back the frames still in flight while the context is alive
+	if (NULL != g_Profiler)
+	{
+		g_Profiler->Shutdown();
+		if (benchmark.IsEnabled())
+		{
+			benchmark.WriteReport(*g_Profiler);
+		}
 	}
 
 	// clear the allocated manager objects from memory
@@ -131,11 +307,21 @@ int main(int argc, char* argv[])
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
+	if (NULL != g_UniformBuffers)
+	{
+		delete g_UniformBuffers;
+		g_UniformBuffers = NULL;
+	}
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_Profiler)
+	{
+		delete g_Profiler;
+		g_Profiler = NULL;
+	}
 
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
@@ -195,4 +381,18 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+/***********************************************************
+ *	DropCallback()
+ *
+ *  This function is called by GLFW when files are dropped
+ *  onto the window.  The last one is loaded as the scene
+ *  before the next frame.
+ ***********************************************************/
+void DropCallback(GLFWwindow* /*window*/, int count, const char** paths)
+{
+	if (count > 0)
+	{
+		g_DroppedSceneFile = paths[count - 1];
+	}
+}
@@ -0,0 +1,279 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.cpp
+// ============
+// reorder the triangles and vertices of a mesh for the GPU vertex caches
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// marks a vertex that has no new number yet
+	const uint32_t g_Unassigned = 0xFFFFFFFFu;
+
+	// position of a vertex; the first three floats of it
+	glm::vec3 GetPosition(const float* pVertices, int floatsPerVertex, uint32_t vertex)
+	{
+		const float* pPosition = pVertices + (size_t)vertex * floatsPerVertex;
+
+		return(glm::vec3(pPosition[0], pPosition[1], pPosition[2]));
+	}
+
+	// cluster of triangles with its place in the overdraw order
+	struct CLUSTER
+	{
+		size_t firstTriangle;
+		size_t triangleCount;
+		float sortKey;
+	};
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This method is used for ordering the triangles of an
+ *  index range with Tipsify.  The triangles around one
+ *  vertex are emitted as a fan, and the next fan is the
+ *  emitted vertex that still has triangles left and will
+ *  still be in the cache once they are drawn.  When none
+ *  is, the most recent dead end with triangles left is
+ *  taken, and only when those run out the order jumps to
+ *  the next unconnected vertex, which starts a cluster.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexCache(
+	uint32_t* pIndices,
+	size_t indexCount,
+	int cacheSize,
+	std::vector<size_t>& clusterStarts)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// the range is renumbered from its lowest vertex
+	uint32_t firstVertex = *std::min_element(pIndices, pIndices + indexCount);
+	uint32_t lastVertex = *std::max_element(pIndices, pIndices + indexCount);
+	size_t vertexCount = (size_t)(lastVertex - firstVertex) + 1;
+
+	// the triangles of every vertex, and how many are not emitted
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		liveTriangles[pIndices[i] - firstVertex]++;
+	}
+	std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyStart[v + 1] = adjacencyStart[v] + liveTriangles[v];
+	}
+	std::vector<uint32_t> adjacency(adjacencyStart[vertexCount]);
+	std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[pIndices[i] - firstVertex]++] = (uint32_t)(i / 3);
+	}
+
+	// time each vertex entered the cache; it is still there while
+	// fewer than cacheSize vertices entered after it
+	std::vector<int> cacheTime(vertexCount, 0);
+	int time = cacheSize + 1;
+	std::vector<bool> bEmitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	size_t scan = 0;
+	int fanning = (int)(pIndices[0] - firstVertex);
+	clusterStarts.push_back(0);
+	while (fanning >= 0)
+	{
+		candidates.clear();
+		for (size_t a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++)
+		{
+			uint32_t triangle = adjacency[a];
+			if (bEmitted[triangle])
+				continue;
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t vertex = pIndices[triangle * 3 + corner] - firstVertex;
+				output.push_back(vertex + firstVertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (time - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = time;
+					time++;
+				}
+			}
+			bEmitted[triangle] = true;
+		}
+
+		// the oldest candidate that survives its own fan goes next
+		int next = -1;
+		int bestPriority = -1;
+		for (size_t c = 0; c < candidates.size(); c++)
+		{
+			uint32_t vertex = candidates[c];
+			if (liveTriangles[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			if (time - cacheTime[vertex] + 2 * (int)liveTriangles[vertex] <= cacheSize)
+				priority = time - cacheTime[vertex];
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = (int)vertex;
+			}
+		}
+
+		while ((next < 0) && !deadEnds.empty())
+		{
+			uint32_t vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[vertex] > 0)
+				next = (int)vertex;
+		}
+		if (next < 0)
+		{
+			while ((scan < vertexCount) && (liveTriangles[scan] == 0))
+			{
+				scan++;
+			}
+			if (scan < vertexCount)
+			{
+				next = (int)scan;
+				clusterStarts.push_back(output.size() / 3);
+			}
+		}
+		fanning = next;
+	}
+
+	std::copy(output.begin(), output.end(), pIndices);
+}
+
+/***********************************************************
+ *  OptimizeOverdraw()
+ *
+ *  This method is used for ordering the clusters of a range
+ *  so the ones facing out from its center draw first.  They
+ *  are the ones most likely to hide the others, so more of
+ *  the later fragments fail the depth test before they are
+ *  shaded.  Within a cluster the cache order stays as it is.
+ ***********************************************************/
+void MeshOptimizer::OptimizeOverdraw(
+	uint32_t* pIndices,
+	size_t indexCount,
+	const float* pVertices,
+	int floatsPerVertex,
+	const std::vector<size_t>& clusterStarts)
+{
+	size_t triangleCount = indexCount / 3;
+	if ((clusterStarts.size() < 2) || (triangleCount == 0))
+	{
+		return;
+	}
+
+	// area weighted center and normal of every cluster, and of the
+	// whole range
+	std::vector<CLUSTER> clusters(clusterStarts.size());
+	std::vector<glm::vec3> centers(clusters.size(), glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(clusters.size(), glm::vec3(0.0f));
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		size_t end = (c + 1 < clusters.size()) ? clusterStarts[c + 1] : triangleCount;
+		clusters[c].firstTriangle = clusterStarts[c];
+		clusters[c].triangleCount = end - clusterStarts[c];
+
+		float clusterArea = 0.0f;
+		for (size_t t = clusterStarts[c]; t < end; t++)
+		{
+			glm::vec3 p0 = GetPosition(pVertices, floatsPerVertex, pIndices[t * 3 + 0]);
+			glm::vec3 p1 = GetPosition(pVertices, floatsPerVertex, pIndices[t * 3 + 1]);
+			glm::vec3 p2 = GetPosition(pVertices, floatsPerVertex, pIndices[t * 3 + 2]);
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+
+			centers[c] += (p0 + p1 + p2) * (area / 3.0f);
+			normals[c] += normal;
+			clusterArea += area;
+		}
+		meshCenter += centers[c];
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f)
+		{
+			centers[c] /= clusterArea;
+		}
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCenter /= meshArea;
+	}
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		float normalLength = glm::length(normals[c]);
+		glm::vec3 normal = (normalLength > 0.0f) ? normals[c] / normalLength : glm::vec3(0.0f);
+		clusters[c].sortKey = glm::dot(centers[c] - meshCenter, normal);
+	}
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const CLUSTER& a, const CLUSTER& b) { return(a.sortKey > b.sortKey); });
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const uint32_t* pFirst = pIndices + clusters[c].firstTriangle * 3;
+		output.insert(output.end(), pFirst, pFirst + clusters[c].triangleCount * 3);
+	}
+
+	std::copy(output.begin(), output.end(), pIndices);
+}
+
+/***********************************************************
+ *  OptimizeVertexFetch()
+ *
+ *  This method is used for storing the vertices of a buffer
+ *  in the order the indices first reach them, so the draws
+ *  walk the vertex buffer forward instead of jumping in it.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexFetch(
+	std::vector<float>& vertices,
+	int floatsPerVertex,
+	std::vector<uint32_t>& indices)
+{
+	size_t vertexCount = vertices.size() / floatsPerVertex;
+	std::vector<uint32_t> newIndex(vertexCount, g_Unassigned);
+	std::vector<float> reordered;
+	reordered.reserve(vertices.size());
+
+	uint32_t nextIndex = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		uint32_t vertex = indices[i];
+		if (newIndex[vertex] == g_Unassigned)
+		{
+			newIndex[vertex] = nextIndex++;
+			const float* pVertex = vertices.data() + (size_t)vertex * floatsPerVertex;
+			reordered.insert(reordered.end(), pVertex, pVertex + floatsPerVertex);
+		}
+		indices[i] = newIndex[vertex];
+	}
+
+	vertices.swap(reordered);
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.h
+// ============
+// reorder the triangles and vertices of a mesh for the GPU vertex caches
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  MeshOptimizer
+ *
+ *  This class reorders an indexed triangle list so that the
+ *  GPU transforms fewer vertices and shades fewer hidden
+ *  fragments, without changing what is drawn:
+ *
+ *    OptimizeVertexCache()  Tipsify (Sander et al. 2007):
+ *                           fan around the vertex that stays
+ *                           in the post-transform cache
+ *    OptimizeOverdraw()     move the clusters Tipsify had to
+ *                           jump between so the outward
+ *                           facing ones draw first
+ *    OptimizeVertexFetch()  store the vertices in the order
+ *                           the indices first use them
+ *
+ *  The first two work on one index range at a time, so the
+ *  parts of a mesh keep their place in a shared buffer.
+ ***********************************************************/
+class MeshOptimizer
+{
+public:
+	// vertices the post-transform cache is assumed to hold
+	static const int DEFAULT_CACHE_SIZE = 16;
+
+	// reorder the triangles of an index range for a vertex cache
+	// of a size; the triangles where the order had to jump to an
+	// unconnected part of the range are added to clusterStarts
+	static void OptimizeVertexCache(
+		uint32_t* pIndices,
+		size_t indexCount,
+		int cacheSize,
+		std::vector<size_t>& clusterStarts);
+	// reorder the clusters of a range optimized above, outward
+	// facing clusters first; positions are the first three floats
+	// of every vertex
+	static void OptimizeOverdraw(
+		uint32_t* pIndices,
+		size_t indexCount,
+		const float* pVertices,
+		int floatsPerVertex,
+		const std::vector<size_t>& clusterStarts);
+	// store the vertices of a buffer in the order of their first
+	// use and renumber the indices; unused vertices are dropped
+	static void OptimizeVertexFetch(
+		std::vector<float>& vertices,
+		int floatsPerVertex,
+		std::vector<uint32_t>& indices);
+};
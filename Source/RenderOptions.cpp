@@ -0,0 +1,386 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderoptions.cpp
+// ============
+// command line settings of the scene, its rendering and its files
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderOptions.h"
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// names of the shadow filters and quality tiers on the command line
+	struct OPTION_NAME
+	{
+		const char* name;
+		int value;
+	};
+	const OPTION_NAME g_ShadowFilterNames[] =
+	{
+		{ "hardware", SceneManager::SHADOW_FILTER_HARDWARE },
+		{ "pcf4", SceneManager::SHADOW_FILTER_PCF4 },
+		{ "poisson16", SceneManager::SHADOW_FILTER_POISSON16 }
+	};
+	const OPTION_NAME g_QualityTierNames[] =
+	{
+		{ "low", DynamicResolution::QUALITY_LOW },
+		{ "medium", DynamicResolution::QUALITY_MEDIUM },
+		{ "high", DynamicResolution::QUALITY_HIGH }
+	};
+
+	// read the text value that follows an option
+	bool ReadTextOption(int argc, char* argv[], int& i, std::string& value)
+	{
+		if (i + 1 >= argc)
+		{
+			std::cout << "Missing value for " << argv[i] << std::endl;
+			return(false);
+		}
+		value = argv[++i];
+		return(true);
+	}
+
+	// read the integer value that follows an option
+	bool ReadIntOption(int argc, char* argv[], int& i, int minimum, int& value)
+	{
+		if (i + 1 >= argc)
+		{
+			std::cout << "Missing value for " << argv[i] << std::endl;
+			return(false);
+		}
+		char* end = NULL;
+		long number = strtol(argv[++i], &end, 10);
+		if ((end == argv[i]) || (*end != '\0') || (number < minimum) || (number > INT_MAX))
+		{
+			std::cout << "Invalid value for " << argv[i - 1] << ": " << argv[i] << std::endl;
+			return(false);
+		}
+		value = (int)number;
+		return(true);
+	}
+
+	// read the decimal value that follows an option
+	bool ReadFloatOption(int argc, char* argv[], int& i, float minimum, float& value)
+	{
+		if (i + 1 >= argc)
+		{
+			std::cout << "Missing value for " << argv[i] << std::endl;
+			return(false);
+		}
+		char* end = NULL;
+		double number = strtod(argv[++i], &end);
+		if ((end == argv[i]) || (*end != '\0') || !(number >= minimum) || (number > 1.0e6))
+		{
+			std::cout << "Invalid value for " << argv[i - 1] << ": " << argv[i] << std::endl;
+			return(false);
+		}
+		value = (float)number;
+		return(true);
+	}
+
+	// read the named value that follows an option
+	template <size_t N>
+	bool ReadNamedOption(int argc, char* argv[], int& i, const OPTION_NAME (&names)[N], int& value)
+	{
+		if (i + 1 >= argc)
+		{
+			std::cout << "Missing value for " << argv[i] << std::endl;
+			return(false);
+		}
+		i++;
+		for (size_t n = 0; n < N; n++)
+		{
+			if (strcmp(argv[i], names[n].name) == 0)
+			{
+				value = names[n].value;
+				return(true);
+			}
+		}
+		std::cout << "Invalid value for " << argv[i - 1] << ": " << argv[i] << std::endl;
+		return(false);
+	}
+}
+
+/***********************************************************
+ *  RenderOptions()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderOptions::RenderOptions()
+{
+	m_anisotropy = 8.0f;
+	m_shadowFilter = SceneManager::SHADOW_FILTER_POISSON16;
+	m_lodError = 1.0f;
+	m_shadowLodBias = 4.0f;
+	m_bOcclusionCulling = false;
+	m_bDepthPrepass = false;
+	m_frameBudgetMs = 0.0f;
+	m_qualityTier = DynamicResolution::QUALITY_HIGH;
+	m_pointLightCount = 0;
+	m_pointLightShadows = 0;
+}
+
+/***********************************************************
+ *  ParseArguments()
+ *
+ *  This method is used for reading the rendering options
+ *  from the command line in one pass.  Options it does not
+ *  know are left for other parts of the program; the ones
+ *  it reads are marked in usedArguments, with their values.
+ ***********************************************************/
+bool RenderOptions::ParseArguments(int argc, char* argv[], std::vector<bool>& usedArguments)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		int option = i;
+		if (strcmp(argv[i], "--scene") == 0)
+		{
+			if (!ReadTextOption(argc, argv, i, m_sceneFile))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--save-scene") == 0)
+		{
+			if (!ReadTextOption(argc, argv, i, m_saveSceneFile))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--profile-log") == 0)
+		{
+			if (!ReadTextOption(argc, argv, i, m_profileLogFile))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--anisotropy") == 0)
+		{
+			if (!ReadFloatOption(argc, argv, i, 1.0f, m_anisotropy))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--shadow-filter") == 0)
+		{
+			int filter = 0;
+			if (!ReadNamedOption(argc, argv, i, g_ShadowFilterNames, filter))
+				return(false);
+			m_shadowFilter = (SceneManager::SHADOW_FILTER)filter;
+		}
+		else if (strcmp(argv[i], "--lod-error") == 0)
+		{
+			if (!ReadFloatOption(argc, argv, i, 0.0f, m_lodError))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--shadow-lod-bias") == 0)
+		{
+			if (!ReadFloatOption(argc, argv, i, 1.0f, m_shadowLodBias))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--occlusion-culling") == 0)
+		{
+			m_bOcclusionCulling = true;
+		}
+		else if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			m_bDepthPrepass = true;
+		}
+		else if (strcmp(argv[i], "--frame-budget") == 0)
+		{
+			if (!ReadFloatOption(argc, argv, i, 0.0f, m_frameBudgetMs))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--shadow-quality") == 0)
+		{
+			int tier = 0;
+			if (!ReadNamedOption(argc, argv, i, g_QualityTierNames, tier))
+				return(false);
+			m_qualityTier = (DynamicResolution::QUALITY_TIER)tier;
+		}
+		else if (strcmp(argv[i], "--point-lights") == 0)
+		{
+			if (!ReadIntOption(argc, argv, i, 0, m_pointLightCount))
+				return(false);
+		}
+		else if (strcmp(argv[i], "--point-light-shadows") == 0)
+		{
+			if (!ReadIntOption(argc, argv, i, 0, m_pointLightShadows))
+				return(false);
+		}
+		else
+		{
+			continue;
+		}
+
+		for (int used = option; used <= i; used++)
+		{
+			usedArguments[used] = true;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CheckUnusedArguments()
+ *
+ *  This method is used for reporting an argument that none
+ *  of the command line parsers took up, e.g. a misspelled
+ *  option, once all of them have read the command line.
+ ***********************************************************/
+bool RenderOptions::CheckUnusedArguments(int argc, char* argv[], const std::vector<bool>& usedArguments)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (!usedArguments[i])
+		{
+			std::cout << "Unknown option: " << argv[i] << std::endl;
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetSceneFile()
+ *
+ *  This method is used for reading the scene file shown,
+ *  empty when the scene manager shows its default one.
+ ***********************************************************/
+const std::string& RenderOptions::GetSceneFile() const
+{
+	return(m_sceneFile);
+}
+
+/***********************************************************
+ *  GetSaveSceneFile()
+ *
+ *  This method is used for reading the file the loaded
+ *  scene is written to, empty if it is not written.
+ ***********************************************************/
+const std::string& RenderOptions::GetSaveSceneFile() const
+{
+	return(m_saveSceneFile);
+}
+
+/***********************************************************
+ *  GetProfileLogFile()
+ *
+ *  This method is used for reading the file the frame
+ *  timings are logged to, empty if they are not logged.
+ ***********************************************************/
+const std::string& RenderOptions::GetProfileLogFile() const
+{
+	return(m_profileLogFile);
+}
+
+/***********************************************************
+ *  GetAnisotropy()
+ *
+ *  This method is used for reading the texture anisotropy.
+ ***********************************************************/
+float RenderOptions::GetAnisotropy() const
+{
+	return(m_anisotropy);
+}
+
+/***********************************************************
+ *  GetShadowFilter()
+ *
+ *  This method is used for reading the filter of the
+ *  light shadows.
+ ***********************************************************/
+SceneManager::SHADOW_FILTER RenderOptions::GetShadowFilter() const
+{
+	return(m_shadowFilter);
+}
+
+/***********************************************************
+ *  GetLodError()
+ *
+ *  This method is used for reading the silhouette error in
+ *  pixels a coarser level of detail may make.
+ ***********************************************************/
+float RenderOptions::GetLodError() const
+{
+	return(m_lodError);
+}
+
+/***********************************************************
+ *  GetShadowLodBias()
+ *
+ *  This method is used for reading the factor the shadow
+ *  map accepts beyond the level of detail error.
+ ***********************************************************/
+float RenderOptions::GetShadowLodBias() const
+{
+	return(m_shadowLodBias);
+}
+
+/***********************************************************
+ *  IsOcclusionCulling()
+ *
+ *  This method is used for checking whether
+ *  --occlusion-culling was given.
+ ***********************************************************/
+bool RenderOptions::IsOcclusionCulling() const
+{
+	return(m_bOcclusionCulling);
+}
+
+/***********************************************************
+ *  IsDepthPrepass()
+ *
+ *  This method is used for checking whether
+ *  --depth-prepass was given.
+ ***********************************************************/
+bool RenderOptions::IsDepthPrepass() const
+{
+	return(m_bDepthPrepass);
+}
+
+/***********************************************************
+ *  GetFrameBudget()
+ *
+ *  This method is used for reading the milliseconds the
+ *  shadow and lit passes keep to, 0 for no budget.
+ ***********************************************************/
+float RenderOptions::GetFrameBudget() const
+{
+	return(m_frameBudgetMs);
+}
+
+/***********************************************************
+ *  GetQualityTier()
+ *
+ *  This method is used for reading the highest shadow
+ *  quality.
+ ***********************************************************/
+DynamicResolution::QUALITY_TIER RenderOptions::GetQualityTier() const
+{
+	return(m_qualityTier);
+}
+
+/***********************************************************
+ *  GetPointLightCount()
+ *
+ *  This method is used for reading how many point lights
+ *  are spread over the scene.
+ ***********************************************************/
+int RenderOptions::GetPointLightCount() const
+{
+	return(m_pointLightCount);
+}
+
+/***********************************************************
+ *  GetPointLightShadows()
+ *
+ *  This method is used for reading how many of the spread
+ *  point lights cast shadows.
+ ***********************************************************/
+int RenderOptions::GetPointLightShadows() const
+{
+	return(m_pointLightShadows);
+}
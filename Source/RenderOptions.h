@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderoptions.h
+// ============
+// command line settings of the scene, its rendering and its files
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "DynamicResolution.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  RenderOptions
+ *
+ *  This class holds the rendering settings read from the
+ *  command line, next to the benchmark options:
+ *
+ *    --scene FILE          scene file shown, instead of the
+ *                          default of the scene manager
+ *    --save-scene FILE     write the loaded scene, copies
+ *                          included, as a scene file
+ *    --profile-log FILE    per-frame timings as .csv or .json
+ *    --anisotropy N        texture anisotropy, 1 turns it off
+ *                          (default 8)
+ *    --shadow-filter F     hardware, pcf4 or poisson16
+ *                          (default poisson16)
+ *    --lod-error N         silhouette error in pixels a coarser
+ *                          level of detail may make (default 1)
+ *    --shadow-lod-bias N   factor the shadow map accepts beyond
+ *                          that error (default 4)
+ *    --occlusion-culling   skip objects hidden in the depth of
+ *                          the previous frame
+ *    --depth-prepass       lay down the opaque depth first
+ *    --frame-budget N      milliseconds the shadow and lit
+ *                          passes keep to (default 0, none)
+ *    --shadow-quality Q    low, medium or high (default high)
+ *    --point-lights N      colored lights spread over the scene
+ *                          (default 0)
+ *    --point-light-shadows N
+ *                          how many of them cast shadows
+ *                          (default 0)
+ ***********************************************************/
+class RenderOptions
+{
+public:
+	// constructor
+	RenderOptions();
+
+private:
+	std::string m_sceneFile;
+	std::string m_saveSceneFile;
+	std::string m_profileLogFile;
+	float m_anisotropy;
+	SceneManager::SHADOW_FILTER m_shadowFilter;
+	float m_lodError;
+	float m_shadowLodBias;
+	bool m_bOcclusionCulling;
+	bool m_bDepthPrepass;
+	float m_frameBudgetMs;
+	DynamicResolution::QUALITY_TIER m_qualityTier;
+	int m_pointLightCount;
+	int m_pointLightShadows;
+
+public:
+	// read the rendering options, setting the entries of usedArguments
+	// they take up; returns false on a malformed option
+	bool ParseArguments(int argc, char* argv[], std::vector<bool>& usedArguments);
+	// report the first argument no parser took up; returns false
+	// when there is one
+	static bool CheckUnusedArguments(int argc, char* argv[], const std::vector<bool>& usedArguments);
+
+	// empty unless another scene file should be shown
+	const std::string& GetSceneFile() const;
+	// empty unless the loaded scene should be written
+	const std::string& GetSaveSceneFile() const;
+	// empty unless the frame timings should be logged
+	const std::string& GetProfileLogFile() const;
+	float GetAnisotropy() const;
+	SceneManager::SHADOW_FILTER GetShadowFilter() const;
+	float GetLodError() const;
+	float GetShadowLodBias() const;
+	bool IsOcclusionCulling() const;
+	bool IsDepthPrepass() const;
+	float GetFrameBudget() const;
+	DynamicResolution::QUALITY_TIER GetQualityTier() const;
+	int GetPointLightCount() const;
+	int GetPointLightShadows() const;
+};
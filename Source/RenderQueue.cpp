@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// collect draw commands and sort them by a 64-bit state key
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// field widths of the sort key, 64 bits in total
+	const int g_PassBits = 2;
+	const int g_ProgramBits = 6;
+	const int g_TextureBits = 12;
+	const int g_MaterialBits = 10;
+	const int g_MeshBits = 10;
+	const int g_DepthBits = 24;
+
+	// shift of the most significant field
+	const int g_PassShift = 64 - g_PassBits;
+	const int g_ProgramShift = g_PassShift - g_ProgramBits;
+
+	// pack a handle into a field; -1 ("none") packs as zero so it
+	// sorts ahead of every real handle
+	uint64_t PackField(int handle, int bits)
+	{
+		uint64_t mask = (1ull << bits) - 1ull;
+		return((uint64_t)(handle + 1) & mask);
+	}
+
+	// order commands by key, and equal keys by item index
+	bool CompareCommands(
+		const RenderQueue::RENDER_COMMAND& a,
+		const RenderQueue::RENDER_COMMAND& b)
+	{
+		if (a.sortKey != b.sortKey)
+		{
+			return(a.sortKey < b.sortKey);
+		}
+
+		return(a.itemIndex < b.itemIndex);
+	}
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+	m_maxDepth = 100.0f;
+}
+
+/***********************************************************
+ *  SetDepthRange()
+ *
+ *  This method is used for setting the view depth that maps
+ *  to the far end of the depth field, normally the far plane
+ *  of the projection.  Deeper commands share the last value.
+ ***********************************************************/
+void RenderQueue::SetDepthRange(float maxDepth)
+{
+	if (maxDepth > 0.0f)
+	{
+		m_maxDepth = maxDepth;
+	}
+}
+
+/***********************************************************
+ *  QuantizeDepth()
+ *
+ *  This method is used for mapping a view depth onto the
+ *  unsigned depth field of the key.
+ ***********************************************************/
+uint64_t RenderQueue::QuantizeDepth(float viewDepth) const
+{
+	const uint64_t maxValue = (1ull << g_DepthBits) - 1ull;
+
+	float normalized = viewDepth / m_maxDepth;
+	normalized = std::min(std::max(normalized, 0.0f), 1.0f);
+
+	return((uint64_t)(normalized * (float)maxValue));
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every queued command.
+ *  The storage is kept for the next frame.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_commands.clear();
+}
+
+/***********************************************************
+ *  MakeKey()
+ *
+ *  This method is used for packing the state of one draw
+ *  item into a sort key.
+ ***********************************************************/
+uint64_t RenderQueue::MakeKey(
+	RENDER_PASS pass,
+	int programHandle,
+	int textureHandle,
+	int materialHandle,
+	int meshHandle,
+	float viewDepth) const
+{
+	uint64_t key = 0;
+	uint64_t depth = QuantizeDepth(viewDepth);
+
+	key |= ((uint64_t)pass & ((1ull << g_PassBits) - 1ull)) << g_PassShift;
+	key |= PackField(programHandle, g_ProgramBits) << g_ProgramShift;
+
+	if (pass == PASS_TRANSLUCENT)
+	{
+		// far-to-near ranks ahead of state so blending stays correct
+		uint64_t farToNear = ((1ull << g_DepthBits) - 1ull) - depth;
+		int depthShift = g_ProgramShift - g_DepthBits;
+		int textureShift = depthShift - g_TextureBits;
+		int materialShift = textureShift - g_MaterialBits;
+
+		key |= farToNear << depthShift;
+		key |= PackField(textureHandle, g_TextureBits) << textureShift;
+		key |= PackField(materialHandle, g_MaterialBits) << materialShift;
+		key |= PackField(meshHandle, g_MeshBits);
+	}
+	else
+	{
+		// state changes rank ahead of depth, near-to-far breaks ties
+		int textureShift = g_ProgramShift - g_TextureBits;
+		int materialShift = textureShift - g_MaterialBits;
+		int meshShift = materialShift - g_MeshBits;
+
+		key |= PackField(textureHandle, g_TextureBits) << textureShift;
+		key |= PackField(materialHandle, g_MaterialBits) << materialShift;
+		key |= PackField(meshHandle, g_MeshBits) << meshShift;
+		key |= depth;
+	}
+
+	return(key);
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for packing the state of one draw
+ *  item into a sort key and queueing it.
+ ***********************************************************/
+void RenderQueue::Submit(
+	int itemIndex,
+	RENDER_PASS pass,
+	int programHandle,
+	int textureHandle,
+	int materialHandle,
+	int meshHandle,
+	float viewDepth)
+{
+	RENDER_COMMAND command;
+	command.sortKey = MakeKey(pass, programHandle, textureHandle, materialHandle, meshHandle, viewDepth);
+	command.itemIndex = itemIndex;
+	command.lod = 0;
+	m_commands.push_back(command);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for ordering the queued commands by
+ *  their keys.  Equal keys keep the order of their items.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	SortCommands(m_commands.data(), m_commands.size());
+}
+
+/***********************************************************
+ *  SortCommands()
+ *
+ *  This method is used for ordering a list of commands by
+ *  their keys, and equal keys by item.  The order is total,
+ *  so an in-place sort gives the result of a stable one.
+ ***********************************************************/
+void RenderQueue::SortCommands(RENDER_COMMAND* pCommands, size_t count)
+{
+	std::sort(pCommands, pCommands + count, CompareCommands);
+}
+
+/***********************************************************
+ *  MergeSorted()
+ *
+ *  This method is used for replacing the queued commands
+ *  with sorted runs.  The runs are laid end to end and
+ *  neighbouring runs are merged pairwise, back and forth
+ *  between the queue and its scratch list, until one is
+ *  left; the result matches one sort of every command.
+ ***********************************************************/
+void RenderQueue::MergeSorted(const COMMAND_RUN* pRuns, size_t runCount)
+{
+	m_commands.clear();
+	m_runStarts.clear();
+	for (size_t i = 0; i < runCount; i++)
+	{
+		m_runStarts.push_back(m_commands.size());
+		m_commands.insert(m_commands.end(), pRuns[i].pCommands, pRuns[i].pCommands + pRuns[i].count);
+	}
+	m_runStarts.push_back(m_commands.size());
+	m_mergeScratch.resize(m_commands.size());
+
+	for (size_t width = 1; width < runCount; width *= 2)
+	{
+		for (size_t first = 0; first < runCount; first += width * 2)
+		{
+			size_t middle = std::min(first + width, runCount);
+			size_t last = std::min(first + width * 2, runCount);
+			std::merge(
+				m_commands.begin() + m_runStarts[first],
+				m_commands.begin() + m_runStarts[middle],
+				m_commands.begin() + m_runStarts[middle],
+				m_commands.begin() + m_runStarts[last],
+				m_mergeScratch.begin() + m_runStarts[first],
+				CompareCommands);
+		}
+		m_commands.swap(m_mergeScratch);
+	}
+}
+
+/***********************************************************
+ *  GetCommands()
+ *
+ *  This method is used for reading the queued commands.
+ ***********************************************************/
+const std::vector<RenderQueue::RENDER_COMMAND>& RenderQueue::GetCommands() const
+{
+	return(m_commands);
+}
+
+/***********************************************************
+ *  GetPass()
+ *
+ *  This method is used for decoding the pass of a key.
+ ***********************************************************/
+RenderQueue::RENDER_PASS RenderQueue::GetPass(uint64_t sortKey)
+{
+	return((RENDER_PASS)(sortKey >> g_PassShift));
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// collect draw commands and sort them by a 64-bit state key
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class collects one command per draw item and sorts
+ *  them by a packed 64-bit key, most significant field
+ *  first:
+ *
+ *    opaque       pass | program | texture | material | mesh | depth
+ *    translucent  pass | program | far-to-near depth | texture | material | mesh
+ *
+ *  Opaque commands are grouped by state and go front-to-back
+ *  within a group for early depth rejection.  Translucent
+ *  commands sort after every opaque one and go back-to-front
+ *  so that blending composes correctly.
+ *
+ *  Commands with equal keys are ordered by item index, which
+ *  every list is submitted in, so sorting needs no stable
+ *  sort and its scratch allocation.
+ *
+ *  Commands can also be built and sorted in separate runs,
+ *  e.g. one per worker thread, and merged; the result is
+ *  the same as submitting them all here.  The storage of the
+ *  queue is kept between frames, so a steady frame sorts
+ *  and merges without touching the heap.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+
+	// passes in submission order; lower values draw first
+	enum RENDER_PASS
+	{
+		PASS_OPAQUE = 0,
+		PASS_TRANSLUCENT = 1
+	};
+
+	// one queued draw
+	struct RENDER_COMMAND
+	{
+		uint64_t sortKey;
+		int itemIndex;
+		// level of detail of the mesh; the caller folds it into the
+		// mesh field of the key so equal levels sort together
+		int lod;
+	};
+
+	// sorted commands built outside the queue
+	struct COMMAND_RUN
+	{
+		const RENDER_COMMAND* pCommands;
+		size_t count;
+	};
+
+private:
+	// queued commands, sorted by Sort()
+	std::vector<RENDER_COMMAND> m_commands;
+	// the other half of each merge, and where each run starts
+	std::vector<RENDER_COMMAND> m_mergeScratch;
+	std::vector<size_t> m_runStarts;
+	// view depth mapped to the far end of the depth field
+	float m_maxDepth;
+
+	// map a view depth onto the unsigned depth field
+	uint64_t QuantizeDepth(float viewDepth) const;
+
+public:
+	// set the view depth that maps to the far end of the depth field
+	void SetDepthRange(float maxDepth);
+
+	// remove every command, keeping the storage
+	void Clear();
+	// queue one command; handles of -1 mean "none"
+	void Submit(
+		int itemIndex,
+		RENDER_PASS pass,
+		int programHandle,
+		int textureHandle,
+		int materialHandle,
+		int meshHandle,
+		float viewDepth);
+	// order the queued commands by their keys
+	void Sort();
+	// key of one draw, as Submit() packs it; safe to call from
+	// several threads at once
+	uint64_t MakeKey(
+		RENDER_PASS pass,
+		int programHandle,
+		int textureHandle,
+		int materialHandle,
+		int meshHandle,
+		float viewDepth) const;
+	// replace the queued commands with the merge of runs that are
+	// each sorted
+	void MergeSorted(const COMMAND_RUN* pRuns, size_t runCount);
+	// order commands the way Sort() does
+	static void SortCommands(RENDER_COMMAND* pCommands, size_t count);
+
+	// queued commands
+	const std::vector<RENDER_COMMAND>& GetCommands() const;
+	// decode the pass field of a key
+	static RENDER_PASS GetPass(uint64_t sortKey);
+};
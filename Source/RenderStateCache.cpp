@@ -0,0 +1,296 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderstatecache.cpp
+// ============
+// track the current OpenGL state so that unchanged binds are skipped
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderStateCache.h"
+
+/***********************************************************
+ *  RenderStateCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderStateCache::RenderStateCache()
+{
+	m_changeCount = 0;
+	m_textureBindCount = 0;
+	Invalidate();
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting all of the tracked
+ *  state, so the next request of each state is issued.
+ ***********************************************************/
+void RenderStateCache::Invalidate()
+{
+	m_pCurrentProgram = NULL;
+	m_depthMask = TOGGLE_UNKNOWN;
+	m_blend = TOGGLE_UNKNOWN;
+	m_depthTest = TOGGLE_UNKNOWN;
+	m_colorMask = TOGGLE_UNKNOWN;
+	m_depthFunc = 0;
+	InvalidateTextures();
+}
+
+/***********************************************************
+ *  InvalidateTextures()
+ *
+ *  This method is used for forgetting the tracked texture
+ *  bindings, e.g. after textures were created or deleted.
+ ***********************************************************/
+void RenderStateCache::InvalidateTextures()
+{
+	m_activeTextureUnit = -1;
+	for (int i = 0; i < TRACKED_TEXTURE_UNITS; i++)
+	{
+		m_boundTextures[i] = 0;
+		m_bTextureKnown[i] = false;
+		m_boundArrayTextures[i] = 0;
+		m_bArrayTextureKnown[i] = false;
+	}
+}
+
+/***********************************************************
+ *  InvalidateProgram()
+ *
+ *  This method is used for forgetting the current program
+ *  after one was made current outside of the cache.
+ ***********************************************************/
+void RenderStateCache::InvalidateProgram()
+{
+	m_pCurrentProgram = NULL;
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for making the program of a shader
+ *  manager current when it is not already.
+ ***********************************************************/
+void RenderStateCache::UseProgram(ShaderManager* pShaderManager)
+{
+	if ((NULL == pShaderManager) || (pShaderManager == m_pCurrentProgram))
+	{
+		return;
+	}
+
+	pShaderManager->use();
+	m_pCurrentProgram = pShaderManager;
+	m_changeCount++;
+}
+
+/***********************************************************
+ *  SetActiveTextureUnit()
+ *
+ *  This method is used for selecting the texture unit that
+ *  the next texture bind applies to.
+ ***********************************************************/
+void RenderStateCache::SetActiveTextureUnit(int unit)
+{
+	if (unit == m_activeTextureUnit)
+	{
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	m_activeTextureUnit = unit;
+	m_changeCount++;
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding a texture to one target
+ *  of a texture unit when a different texture is bound
+ *  there.  Units past the tracked range are always bound.
+ ***********************************************************/
+void RenderStateCache::BindTexture(
+	GLenum target,
+	int unit,
+	GLuint textureID,
+	GLuint boundTextures[],
+	bool bTextureKnown[])
+{
+	if ((unit < 0) || (unit >= TRACKED_TEXTURE_UNITS))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, textureID);
+		m_activeTextureUnit = -1;
+		m_changeCount++;
+		m_textureBindCount++;
+		return;
+	}
+
+	if (bTextureKnown[unit] && (boundTextures[unit] == textureID))
+	{
+		return;
+	}
+
+	SetActiveTextureUnit(unit);
+	glBindTexture(target, textureID);
+	boundTextures[unit] = textureID;
+	bTextureKnown[unit] = true;
+	m_changeCount++;
+	m_textureBindCount++;
+}
+
+/***********************************************************
+ *  BindTexture2D()
+ *
+ *  This method is used for binding a 2D texture to a texture
+ *  unit when a different texture is bound there.
+ ***********************************************************/
+void RenderStateCache::BindTexture2D(int unit, GLuint textureID)
+{
+	BindTexture(GL_TEXTURE_2D, unit, textureID, m_boundTextures, m_bTextureKnown);
+}
+
+/***********************************************************
+ *  BindTextureArray()
+ *
+ *  This method is used for binding a 2D array texture to a
+ *  texture unit when a different one is bound there.
+ ***********************************************************/
+void RenderStateCache::BindTextureArray(int unit, GLuint textureID)
+{
+	BindTexture(GL_TEXTURE_2D_ARRAY, unit, textureID, m_boundArrayTextures, m_bArrayTextureKnown);
+}
+
+/***********************************************************
+ *  SetDepthMask()
+ *
+ *  This method is used for enabling or disabling writes to
+ *  the depth buffer.
+ ***********************************************************/
+void RenderStateCache::SetDepthMask(bool bEnable)
+{
+	TOGGLE_STATE state = bEnable ? TOGGLE_ON : TOGGLE_OFF;
+	if (state == m_depthMask)
+	{
+		return;
+	}
+
+	glDepthMask(bEnable ? GL_TRUE : GL_FALSE);
+	m_depthMask = state;
+	m_changeCount++;
+}
+
+/***********************************************************
+ *  SetBlend()
+ *
+ *  This method is used for enabling or disabling blending.
+ ***********************************************************/
+void RenderStateCache::SetBlend(bool bEnable)
+{
+	TOGGLE_STATE state = bEnable ? TOGGLE_ON : TOGGLE_OFF;
+	if (state == m_blend)
+	{
+		return;
+	}
+
+	if (bEnable)
+		glEnable(GL_BLEND);
+	else
+		glDisable(GL_BLEND);
+	m_blend = state;
+	m_changeCount++;
+}
+
+/***********************************************************
+ *  SetDepthTest()
+ *
+ *  This method is used for enabling or disabling the depth
+ *  test.
+ ***********************************************************/
+void RenderStateCache::SetDepthTest(bool bEnable)
+{
+	TOGGLE_STATE state = bEnable ? TOGGLE_ON : TOGGLE_OFF;
+	if (state == m_depthTest)
+	{
+		return;
+	}
+
+	if (bEnable)
+		glEnable(GL_DEPTH_TEST);
+	else
+		glDisable(GL_DEPTH_TEST);
+	m_depthTest = state;
+	m_changeCount++;
+}
+
+/***********************************************************
+ *  SetColorMask()
+ *
+ *  This method is used for enabling or disabling writes to
+ *  every channel of the color buffer.
+ ***********************************************************/
+void RenderStateCache::SetColorMask(bool bEnable)
+{
+	TOGGLE_STATE state = bEnable ? TOGGLE_ON : TOGGLE_OFF;
+	if (state == m_colorMask)
+	{
+		return;
+	}
+
+	GLboolean mask = bEnable ? GL_TRUE : GL_FALSE;
+	glColorMask(mask, mask, mask, mask);
+	m_colorMask = state;
+	m_changeCount++;
+}
+
+/***********************************************************
+ *  SetDepthFunc()
+ *
+ *  This method is used for setting the comparison of the
+ *  depth test.
+ ***********************************************************/
+void RenderStateCache::SetDepthFunc(GLenum depthFunc)
+{
+	if (depthFunc == m_depthFunc)
+	{
+		return;
+	}
+
+	glDepthFunc(depthFunc);
+	m_depthFunc = depthFunc;
+	m_changeCount++;
+}
+
+/***********************************************************
+ *  GetChangeCount()
+ *
+ *  This method is used for reading the number of state
+ *  changes that were not skipped as redundant.
+ ***********************************************************/
+unsigned int RenderStateCache::GetChangeCount() const
+{
+	return(m_changeCount);
+}
+
+/***********************************************************
+ *  GetTextureBindCount()
+ *
+ *  This method is used for reading how many of the issued
+ *  state changes were texture binds.
+ ***********************************************************/
+unsigned int RenderStateCache::GetTextureBindCount() const
+{
+	return(m_textureBindCount);
+}
+
+/***********************************************************
+ *  ResetChangeCount()
+ *
+ *  This method is used for restarting the change counters.
+ ***********************************************************/
+void RenderStateCache::ResetChangeCount()
+{
+	m_changeCount = 0;
+	m_textureBindCount = 0;
+}
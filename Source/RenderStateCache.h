@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderstatecache.h
+// ============
+// track the current OpenGL state so that unchanged binds are skipped
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+
+// number of texture units whose bindings are tracked
+const int TRACKED_TEXTURE_UNITS = 16;
+
+/***********************************************************
+ *  RenderStateCache
+ *
+ *  This class remembers the program, texture bindings and
+ *  fixed-function toggles last set through it, and only
+ *  calls into OpenGL when a requested value differs.
+ *
+ *  Every state starts out unknown, so the first request is
+ *  always issued.  Call Invalidate() after OpenGL state was
+ *  changed behind the cache's back.
+ ***********************************************************/
+class RenderStateCache
+{
+public:
+	// constructor
+	RenderStateCache();
+
+private:
+	// tri-state for toggles whose current value may be unknown
+	enum TOGGLE_STATE
+	{
+		TOGGLE_UNKNOWN = -1,
+		TOGGLE_OFF = 0,
+		TOGGLE_ON = 1
+	};
+
+	// program made current through UseProgram()
+	ShaderManager* m_pCurrentProgram;
+	// currently active texture unit, -1 when unknown
+	int m_activeTextureUnit;
+	// texture bound to GL_TEXTURE_2D on each tracked unit
+	GLuint m_boundTextures[TRACKED_TEXTURE_UNITS];
+	bool m_bTextureKnown[TRACKED_TEXTURE_UNITS];
+	// texture bound to GL_TEXTURE_2D_ARRAY on each tracked unit
+	GLuint m_boundArrayTextures[TRACKED_TEXTURE_UNITS];
+	bool m_bArrayTextureKnown[TRACKED_TEXTURE_UNITS];
+	// fixed-function toggles
+	TOGGLE_STATE m_depthMask;
+	TOGGLE_STATE m_blend;
+	TOGGLE_STATE m_depthTest;
+	TOGGLE_STATE m_colorMask;
+	// depth comparison, 0 when unknown
+	GLenum m_depthFunc;
+	// number of state changes that were actually issued
+	unsigned int m_changeCount;
+	// number of texture binds among them
+	unsigned int m_textureBindCount;
+
+	// bind a texture to one target of a unit, tracked in the given tables
+	void BindTexture(
+		GLenum target,
+		int unit,
+		GLuint textureID,
+		GLuint boundTextures[],
+		bool bTextureKnown[]);
+
+public:
+	// forget everything so the next request of every state is issued
+	void Invalidate();
+	// forget only the texture bindings
+	void InvalidateTextures();
+	// forget the current program, e.g. after a compute dispatch
+	void InvalidateProgram();
+
+	// make a program current
+	void UseProgram(ShaderManager* pShaderManager);
+	// bind a 2D texture to a texture unit
+	void BindTexture2D(int unit, GLuint textureID);
+	// bind a 2D array texture to a texture unit
+	void BindTextureArray(int unit, GLuint textureID);
+	// select a texture unit, e.g. to copy into the texture bound there
+	void SetActiveTextureUnit(int unit);
+	// fixed-function toggles
+	void SetDepthMask(bool bEnable);
+	void SetBlend(bool bEnable);
+	void SetDepthTest(bool bEnable);
+	void SetColorMask(bool bEnable);
+	// depth comparison, e.g. GL_EQUAL after a depth pre-pass
+	void SetDepthFunc(GLenum depthFunc);
+
+	// number of state changes issued since the counter was last reset
+	unsigned int GetChangeCount() const;
+	unsigned int GetTextureBindCount() const;
+	void ResetChangeCount();
+};
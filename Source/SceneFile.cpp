@@ -0,0 +1,675 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// read and write the binary scene files that describe the objects of a scene
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "AtomicFile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// the vector tables are read in place as packed floats
+static_assert(sizeof(glm::vec2) == 2 * sizeof(float), "glm::vec2 must be packed");
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 must be packed");
+static_assert(sizeof(glm::vec4) == 4 * sizeof(float), "glm::vec4 must be packed");
+
+// declaration of global variables
+namespace
+{
+	// every section starts on this many bytes
+	const size_t g_SectionAlignment = 16;
+	// most entries of one table, so every count fits an int
+	const uint32_t g_MaxEntries = 0x7FFFFFFFu;
+
+	/***********************************************************
+	 *  AlignSize()
+	 *
+	 *  This function is used for rounding a size up to the
+	 *  section alignment.
+	 ***********************************************************/
+	size_t AlignSize(size_t size)
+	{
+		return((size + g_SectionAlignment - 1) & ~(g_SectionAlignment - 1));
+	}
+
+	/***********************************************************
+	 *  AddString()
+	 *
+	 *  This function is used for appending a name to the string
+	 *  section and returning its offset.
+	 ***********************************************************/
+	uint32_t AddString(std::string& strings, const std::string& name)
+	{
+		uint32_t offset = (uint32_t)strings.size();
+		strings += name;
+		strings += '\0';
+
+		return(offset);
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_pData = NULL;
+	m_size = 0;
+	m_mapping = NULL;
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  GetEntrySize()
+ *
+ *  This method is used for getting the bytes of one entry
+ *  of a section.
+ ***********************************************************/
+size_t SceneFile::GetEntrySize(SECTION section)
+{
+	switch (section)
+	{
+	case SECTION_STRINGS:
+		return(1);
+	case SECTION_MATERIAL_DIFFUSE:
+	case SECTION_MATERIAL_SPECULAR:
+	case SECTION_OBJECT_SCALES:
+	case SECTION_OBJECT_ROTATIONS:
+	case SECTION_OBJECT_POSITIONS:
+		return(sizeof(glm::vec3));
+	case SECTION_OBJECT_COLORS:
+		return(sizeof(glm::vec4));
+	case SECTION_OBJECT_UV_SCALES:
+		return(sizeof(glm::vec2));
+	default:
+		// string offsets, indices, flags and single floats
+		return(sizeof(uint32_t));
+	}
+}
+
+/***********************************************************
+ *  GetEntryCount()
+ *
+ *  This method is used for getting the number of entries of
+ *  a section from the counts of a header.
+ ***********************************************************/
+size_t SceneFile::GetEntryCount(const HEADER& header, SECTION section)
+{
+	if (section == SECTION_STRINGS)
+	{
+		return(header.stringBytes);
+	}
+	if (section <= SECTION_TEXTURE_TAGS)
+	{
+		return(header.textureCount);
+	}
+	if (section <= SECTION_MATERIAL_SHININESS)
+	{
+		return(header.materialCount);
+	}
+
+	return(header.objectCount);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a scene file read-only
+ *  and checking it.  The pages are read by the first access
+ *  to the arrays, straight from the file cache.
+ ***********************************************************/
+bool SceneFile::Open(const char* filename)
+{
+	Close();
+
+	const void* pView = NULL;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		filename,
+		GENERIC_READ,
+		// a newer scene may replace the file while it is mapped
+		FILE_SHARE_READ | FILE_SHARE_DELETE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart <= 0))
+	{
+		CloseHandle(file);
+		return(false);
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	// the mapping keeps the file open on its own
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+	{
+		return(false);
+	}
+	pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (pView == NULL)
+	{
+		CloseHandle(mapping);
+		return(false);
+	}
+	m_mapping = mapping;
+#else
+	int file = ::open(filename, O_RDONLY);
+	if (file < 0)
+	{
+		return(false);
+	}
+	struct stat info;
+	if ((fstat(file, &info) != 0) || (info.st_size <= 0))
+	{
+		::close(file);
+		return(false);
+	}
+	size = (size_t)info.st_size;
+
+	// the mapping keeps the file open on its own
+	void* pMapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (pMapped == MAP_FAILED)
+	{
+		return(false);
+	}
+	pView = pMapped;
+#endif
+
+	m_pData = (const unsigned char*)pView;
+	m_size = size;
+	if (!Validate())
+	{
+		Close();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the open file.
+ ***********************************************************/
+void SceneFile::Close()
+{
+	if (m_pData == NULL)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_pData);
+	CloseHandle((HANDLE)m_mapping);
+#else
+	munmap((void*)m_pData, m_size);
+#endif
+	m_pData = NULL;
+	m_size = 0;
+	m_mapping = NULL;
+}
+
+/***********************************************************
+ *  IsOpen()
+ *
+ *  This method is used for checking whether a file is
+ *  mapped.
+ ***********************************************************/
+bool SceneFile::IsOpen() const
+{
+	return(m_pData != NULL);
+}
+
+/***********************************************************
+ *  Validate()
+ *
+ *  This method is used for checking that the mapped file is
+ *  a scene file of this version, that every section lies
+ *  inside it and that every string offset and index points
+ *  at an entry that exists.
+ ***********************************************************/
+bool SceneFile::Validate() const
+{
+	if (m_size < sizeof(HEADER))
+	{
+		return(false);
+	}
+
+	const HEADER& header = *(const HEADER*)m_pData;
+	if ((header.magic != MAGIC) ||
+		(header.version != VERSION) ||
+		(header.fileSize != m_size) ||
+		(header.stringBytes == 0) ||
+		(header.textureCount > g_MaxEntries) ||
+		(header.materialCount > g_MaxEntries) ||
+		(header.objectCount > g_MaxEntries))
+	{
+		return(false);
+	}
+
+	for (int section = 0; section < SECTION_COUNT; section++)
+	{
+		uint64_t offset = header.sectionOffsets[section];
+		uint64_t bytes = (uint64_t)GetEntryCount(header, (SECTION)section) *
+			GetEntrySize((SECTION)section);
+		if ((offset < sizeof(HEADER)) ||
+			((offset % sizeof(uint32_t)) != 0) ||
+			((offset + bytes) > m_size))
+		{
+			return(false);
+		}
+	}
+
+	// every name ends inside the string section
+	const char* pStrings = (const char*)GetSection(SECTION_STRINGS);
+	if (pStrings[header.stringBytes - 1] != '\0')
+	{
+		return(false);
+	}
+	const SECTION nameSections[] = {
+		SECTION_TEXTURE_FILES,
+		SECTION_TEXTURE_TAGS,
+		SECTION_MATERIAL_TAGS
+	};
+	for (size_t i = 0; i < sizeof(nameSections) / sizeof(nameSections[0]); i++)
+	{
+		const uint32_t* pNames = (const uint32_t*)GetSection(nameSections[i]);
+		size_t count = GetEntryCount(header, nameSections[i]);
+		for (size_t name = 0; name < count; name++)
+		{
+			if (pNames[name] >= header.stringBytes)
+			{
+				return(false);
+			}
+		}
+	}
+
+	// every object names an existing material and texture, or none
+	const int32_t* pMaterials = GetObjectMaterials();
+	const int32_t* pTextures = GetObjectTextures();
+	for (uint32_t object = 0; object < header.objectCount; object++)
+	{
+		if ((pMaterials[object] < -1) ||
+			(pMaterials[object] >= (int32_t)header.materialCount) ||
+			(pTextures[object] < -1) ||
+			(pTextures[object] >= (int32_t)header.textureCount))
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetSection()
+ *
+ *  This method is used for getting the start of a section
+ *  in the mapped file.
+ ***********************************************************/
+const void* SceneFile::GetSection(SECTION section) const
+{
+	const HEADER& header = *(const HEADER*)m_pData;
+
+	return(m_pData + header.sectionOffsets[section]);
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for getting the number of textures
+ *  the scene references.
+ ***********************************************************/
+int SceneFile::GetTextureCount() const
+{
+	return((m_pData != NULL) ? (int)((const HEADER*)m_pData)->textureCount : 0);
+}
+
+/***********************************************************
+ *  GetMaterialCount()
+ *
+ *  This method is used for getting the number of materials
+ *  the scene defines.
+ ***********************************************************/
+int SceneFile::GetMaterialCount() const
+{
+	return((m_pData != NULL) ? (int)((const HEADER*)m_pData)->materialCount : 0);
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method is used for getting the number of objects in
+ *  the scene.
+ ***********************************************************/
+int SceneFile::GetObjectCount() const
+{
+	return((m_pData != NULL) ? (int)((const HEADER*)m_pData)->objectCount : 0);
+}
+
+/***********************************************************
+ *  GetTextureFile()
+ *
+ *  This method is used for getting the image file of a
+ *  texture.
+ ***********************************************************/
+const char* SceneFile::GetTextureFile(int texture) const
+{
+	const char* pStrings = (const char*)GetSection(SECTION_STRINGS);
+
+	return(pStrings + ((const uint32_t*)GetSection(SECTION_TEXTURE_FILES))[texture]);
+}
+
+/***********************************************************
+ *  GetTextureTag()
+ *
+ *  This method is used for getting the tag of a texture.
+ ***********************************************************/
+const char* SceneFile::GetTextureTag(int texture) const
+{
+	const char* pStrings = (const char*)GetSection(SECTION_STRINGS);
+
+	return(pStrings + ((const uint32_t*)GetSection(SECTION_TEXTURE_TAGS))[texture]);
+}
+
+/***********************************************************
+ *  GetMaterialTag()
+ *
+ *  This method is used for getting the tag of a material.
+ ***********************************************************/
+const char* SceneFile::GetMaterialTag(int material) const
+{
+	const char* pStrings = (const char*)GetSection(SECTION_STRINGS);
+
+	return(pStrings + ((const uint32_t*)GetSection(SECTION_MATERIAL_TAGS))[material]);
+}
+
+/***********************************************************
+ *  GetMaterialDiffuse()
+ *
+ *  This method is used for getting the diffuse colors of
+ *  the materials.
+ ***********************************************************/
+const glm::vec3* SceneFile::GetMaterialDiffuse() const
+{
+	return((const glm::vec3*)GetSection(SECTION_MATERIAL_DIFFUSE));
+}
+
+/***********************************************************
+ *  GetMaterialSpecular()
+ *
+ *  This method is used for getting the specular colors of
+ *  the materials.
+ ***********************************************************/
+const glm::vec3* SceneFile::GetMaterialSpecular() const
+{
+	return((const glm::vec3*)GetSection(SECTION_MATERIAL_SPECULAR));
+}
+
+/***********************************************************
+ *  GetMaterialShininess()
+ *
+ *  This method is used for getting the shininess of the
+ *  materials.
+ ***********************************************************/
+const float* SceneFile::GetMaterialShininess() const
+{
+	return((const float*)GetSection(SECTION_MATERIAL_SHININESS));
+}
+
+/***********************************************************
+ *  GetObjectMeshes()
+ *
+ *  This method is used for getting the mesh of every
+ *  object.
+ ***********************************************************/
+const uint32_t* SceneFile::GetObjectMeshes() const
+{
+	return((const uint32_t*)GetSection(SECTION_OBJECT_MESHES));
+}
+
+/***********************************************************
+ *  GetObjectFlags()
+ *
+ *  This method is used for getting the draw flags of every
+ *  object.
+ ***********************************************************/
+const uint32_t* SceneFile::GetObjectFlags() const
+{
+	return((const uint32_t*)GetSection(SECTION_OBJECT_FLAGS));
+}
+
+/***********************************************************
+ *  GetObjectMaterials()
+ *
+ *  This method is used for getting the material index of
+ *  every object.
+ ***********************************************************/
+const int32_t* SceneFile::GetObjectMaterials() const
+{
+	return((const int32_t*)GetSection(SECTION_OBJECT_MATERIALS));
+}
+
+/***********************************************************
+ *  GetObjectTextures()
+ *
+ *  This method is used for getting the texture index of
+ *  every object.
+ ***********************************************************/
+const int32_t* SceneFile::GetObjectTextures() const
+{
+	return((const int32_t*)GetSection(SECTION_OBJECT_TEXTURES));
+}
+
+/***********************************************************
+ *  GetObjectScales()
+ *
+ *  This method is used for getting the scale of every
+ *  object.
+ ***********************************************************/
+const glm::vec3* SceneFile::GetObjectScales() const
+{
+	return((const glm::vec3*)GetSection(SECTION_OBJECT_SCALES));
+}
+
+/***********************************************************
+ *  GetObjectRotations()
+ *
+ *  This method is used for getting the rotation of every
+ *  object, in degrees about X, Y and Z.
+ ***********************************************************/
+const glm::vec3* SceneFile::GetObjectRotations() const
+{
+	return((const glm::vec3*)GetSection(SECTION_OBJECT_ROTATIONS));
+}
+
+/***********************************************************
+ *  GetObjectPositions()
+ *
+ *  This method is used for getting the position of every
+ *  object.
+ ***********************************************************/
+const glm::vec3* SceneFile::GetObjectPositions() const
+{
+	return((const glm::vec3*)GetSection(SECTION_OBJECT_POSITIONS));
+}
+
+/***********************************************************
+ *  GetObjectColors()
+ *
+ *  This method is used for getting the color of every
+ *  object.
+ ***********************************************************/
+const glm::vec4* SceneFile::GetObjectColors() const
+{
+	return((const glm::vec4*)GetSection(SECTION_OBJECT_COLORS));
+}
+
+/***********************************************************
+ *  GetObjectUVScales()
+ *
+ *  This method is used for getting the texture coordinate
+ *  scale of every object.
+ ***********************************************************/
+const glm::vec2* SceneFile::GetObjectUVScales() const
+{
+	return((const glm::vec2*)GetSection(SECTION_OBJECT_UV_SCALES));
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for writing the tables of a scene as
+ *  a scene file.  The file is written under a temporary
+ *  name and then replaces the old one in a single step, so
+ *  a running program that maps the old file never sees a
+ *  partly written one or none.
+ ***********************************************************/
+bool SceneFile::Write(const char* filename, const CONTENT& content)
+{
+	size_t textureCount = content.textureFiles.size();
+	size_t materialCount = content.materialTags.size();
+	size_t objectCount = content.objectMeshes.size();
+	if ((content.textureTags.size() != textureCount) ||
+		(content.materialDiffuse.size() != materialCount) ||
+		(content.materialSpecular.size() != materialCount) ||
+		(content.materialShininess.size() != materialCount) ||
+		(content.objectFlags.size() != objectCount) ||
+		(content.objectMaterials.size() != objectCount) ||
+		(content.objectTextures.size() != objectCount) ||
+		(content.objectScales.size() != objectCount) ||
+		(content.objectRotations.size() != objectCount) ||
+		(content.objectPositions.size() != objectCount) ||
+		(content.objectColors.size() != objectCount) ||
+		(content.objectUVScales.size() != objectCount))
+	{
+		return(false);
+	}
+
+	// offset 0 is the empty name
+	std::string strings(1, '\0');
+	std::vector<uint32_t> textureFiles(textureCount);
+	std::vector<uint32_t> textureTags(textureCount);
+	std::vector<uint32_t> materialTags(materialCount);
+	for (size_t i = 0; i < textureCount; i++)
+	{
+		textureFiles[i] = AddString(strings, content.textureFiles[i]);
+		textureTags[i] = AddString(strings, content.textureTags[i]);
+	}
+	for (size_t i = 0; i < materialCount; i++)
+	{
+		materialTags[i] = AddString(strings, content.materialTags[i]);
+	}
+
+	const void* pSections[SECTION_COUNT] = {
+		strings.data(),
+		textureFiles.data(),
+		textureTags.data(),
+		materialTags.data(),
+		content.materialDiffuse.data(),
+		content.materialSpecular.data(),
+		content.materialShininess.data(),
+		content.objectMeshes.data(),
+		content.objectFlags.data(),
+		content.objectMaterials.data(),
+		content.objectTextures.data(),
+		content.objectScales.data(),
+		content.objectRotations.data(),
+		content.objectPositions.data(),
+		content.objectColors.data(),
+		content.objectUVScales.data()
+	};
+
+	HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.stringBytes = (uint32_t)strings.size();
+	header.textureCount = (uint32_t)textureCount;
+	header.materialCount = (uint32_t)materialCount;
+	header.objectCount = (uint32_t)objectCount;
+
+	// lay the sections out one after another on aligned offsets
+	size_t sectionBytes[SECTION_COUNT];
+	size_t offset = AlignSize(sizeof(HEADER));
+	for (int section = 0; section < SECTION_COUNT; section++)
+	{
+		sectionBytes[section] = GetEntryCount(header, (SECTION)section) * GetEntrySize((SECTION)section);
+		header.sectionOffsets[section] = (uint32_t)offset;
+		offset = AlignSize(offset + sectionBytes[section]);
+	}
+	if (offset > 0xFFFFFFFFu)
+	{
+		return(false);
+	}
+	header.fileSize = (uint32_t)offset;
+
+	std::string tempFile = AtomicFile::GetTempFile(filename);
+	{
+		std::ofstream file(tempFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return(false);
+		}
+
+		const char padding[g_SectionAlignment] = { 0 };
+		file.write((const char*)&header, sizeof(header));
+		size_t written = sizeof(header);
+		for (int section = 0; section < SECTION_COUNT; section++)
+		{
+			file.write(padding, (std::streamsize)(header.sectionOffsets[section] - written));
+			file.write((const char*)pSections[section], (std::streamsize)sectionBytes[section]);
+			written = header.sectionOffsets[section] + sectionBytes[section];
+		}
+		file.write(padding, (std::streamsize)(header.fileSize - written));
+		if (!file.good())
+		{
+			file.close();
+			std::remove(tempFile.c_str());
+			return(false);
+		}
+	}
+
+	return(AtomicFile::Replace(tempFile, filename));
+}
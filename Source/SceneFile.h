@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// read and write the binary scene files that describe the objects of a scene
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class maps a scene file into memory and hands out
+ *  its arrays in place.  A file is a versioned header
+ *  followed by one section per field of the texture,
+ *  material and object tables, each stored as a plain
+ *  little-endian array (structure of arrays), so reading a
+ *  table is a pointer into the mapping and nothing is
+ *  parsed or copied.
+ *
+ *  Strings live in one section of NUL-terminated names and
+ *  are referenced by their byte offset into it.  A material
+ *  or texture index of -1 marks an object without one.
+ *
+ *  Open() checks the header, the section bounds and every
+ *  index once, so the arrays can be used without further
+ *  checks for as long as the file stays open.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+	// first four bytes of every scene file, "CSCN"
+	static const uint32_t MAGIC = 0x4E435343u;
+	// layout of the sections; raised whenever one changes
+	static const uint32_t VERSION = 1;
+
+	// arrays of a scene file, in the order they are stored
+	enum SECTION
+	{
+		// NUL-terminated names
+		SECTION_STRINGS = 0,
+		// per texture: string offsets of the image file and the tag
+		SECTION_TEXTURE_FILES,
+		SECTION_TEXTURE_TAGS,
+		// per material: string offset of the tag and the values
+		SECTION_MATERIAL_TAGS,
+		SECTION_MATERIAL_DIFFUSE,
+		SECTION_MATERIAL_SPECULAR,
+		SECTION_MATERIAL_SHININESS,
+		// per object
+		SECTION_OBJECT_MESHES,
+		SECTION_OBJECT_FLAGS,
+		SECTION_OBJECT_MATERIALS,
+		SECTION_OBJECT_TEXTURES,
+		SECTION_OBJECT_SCALES,
+		SECTION_OBJECT_ROTATIONS,
+		SECTION_OBJECT_POSITIONS,
+		SECTION_OBJECT_COLORS,
+		SECTION_OBJECT_UV_SCALES,
+		SECTION_COUNT
+	};
+
+	// start of every scene file
+	struct HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		// bytes of the whole file, to catch a truncated copy
+		uint32_t fileSize;
+		uint32_t stringBytes;
+		uint32_t textureCount;
+		uint32_t materialCount;
+		uint32_t objectCount;
+		uint32_t padding;
+		// byte offset of each section from the start of the file
+		uint32_t sectionOffsets[SECTION_COUNT];
+	};
+
+	// tables of a scene to be written, indexed like the sections
+	struct CONTENT
+	{
+		std::vector<std::string> textureFiles;
+		std::vector<std::string> textureTags;
+
+		std::vector<std::string> materialTags;
+		std::vector<glm::vec3> materialDiffuse;
+		std::vector<glm::vec3> materialSpecular;
+		std::vector<float> materialShininess;
+
+		std::vector<uint32_t> objectMeshes;
+		std::vector<uint32_t> objectFlags;
+		std::vector<int32_t> objectMaterials;
+		std::vector<int32_t> objectTextures;
+		std::vector<glm::vec3> objectScales;
+		// degrees about X, Y and Z
+		std::vector<glm::vec3> objectRotations;
+		std::vector<glm::vec3> objectPositions;
+		std::vector<glm::vec4> objectColors;
+		std::vector<glm::vec2> objectUVScales;
+	};
+
+private:
+	// mapped bytes of the open file, NULL when none is open
+	const unsigned char* m_pData;
+	size_t m_size;
+	// handle of the file mapping, where the platform keeps one
+	void* m_mapping;
+
+	// bytes of one entry of a section
+	static size_t GetEntrySize(SECTION section);
+	// entries of a section in a file with a header
+	static size_t GetEntryCount(const HEADER& header, SECTION section);
+	// check the header and the tables of the mapped file
+	bool Validate() const;
+	// start of a section in the mapped file
+	const void* GetSection(SECTION section) const;
+
+public:
+	// map a scene file and check it; false when it is missing,
+	// of another version or damaged
+	bool Open(const char* filename);
+	// unmap the file; the arrays handed out are no longer valid
+	void Close();
+	bool IsOpen() const;
+
+	int GetTextureCount() const;
+	int GetMaterialCount() const;
+	int GetObjectCount() const;
+
+	// names of a texture and of a material
+	const char* GetTextureFile(int texture) const;
+	const char* GetTextureTag(int texture) const;
+	const char* GetMaterialTag(int material) const;
+
+	// material tables, GetMaterialCount() entries each
+	const glm::vec3* GetMaterialDiffuse() const;
+	const glm::vec3* GetMaterialSpecular() const;
+	const float* GetMaterialShininess() const;
+
+	// object tables, GetObjectCount() entries each
+	const uint32_t* GetObjectMeshes() const;
+	const uint32_t* GetObjectFlags() const;
+	const int32_t* GetObjectMaterials() const;
+	const int32_t* GetObjectTextures() const;
+	const glm::vec3* GetObjectScales() const;
+	const glm::vec3* GetObjectRotations() const;
+	const glm::vec3* GetObjectPositions() const;
+	const glm::vec4* GetObjectColors() const;
+	const glm::vec2* GetObjectUVScales() const;
+
+	// write the tables of a scene as a scene file; the object and
+	// material tables must all have the same length
+	static bool Write(const char* filename, const CONTENT& content);
+};
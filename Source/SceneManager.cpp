@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "AllocationCounter.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -20,15 +21,130 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
 
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	// uniform handles resolved once per program by ShaderUniformCache
+	typedef ShaderUniformCache U;
+
+	// texture unit sampled by objectTexture; textures outside the
+	// texture array are bound here on demand
+	const int g_ObjectTextureUnit = 0;
+	// texture unit sampled by objectTextureArray, bound once per frame
+	const int g_TextureArrayUnit = 1;
+	// texture unit sampled by shadowAtlas
+	const int g_ShadowTextureUnit = 2;
+
+	// layers of the texture array; textures of the size of the first
+	// texture share it until it is full
+	const int g_TextureArrayLayers = 16;
+
+	// program handles used in the render queue sort keys; the lit
+	// handle of an item adds its permutation features
+	const int g_DepthProgramHandle = 0;
+	const int g_LitProgramHandle = 1;
+	// view depth mapped to the far end of the sort key depth field;
+	// matches the far plane of the camera projection
+	const float g_QueueDepthRange = 100.0f;
+
+	// smallest run of identical items drawn with one instanced draw
+	const size_t g_MinInstanceRun = 2;
+
+	// silhouette error in pixels a coarser level of detail may make,
+	// and the factor of it the shadow pass accepts
+	const float g_DefaultLodError = 1.0f;
+	const float g_DefaultShadowLodBias = 4.0f;
+
+	// scene file shown unless another one is chosen
+	const char* g_DefaultSceneFile = "scenes/mugTable.scene";
+	// draw flags a scene file sets; the texture flag follows from the
+	// texture loading and the dynamic flag from moving the object
+	const uint32_t g_SceneFileFlags =
+		SceneManager::DRAW_TOP | SceneManager::DRAW_BOTTOM | SceneManager::DRAW_SIDES |
+		SceneManager::DRAW_LIT | SceneManager::DRAW_LIQUID | SceneManager::DRAW_CASTS_SHADOW |
+		SceneManager::DRAW_TRANSLUCENT;
+
+	// bytes of decoded texture images uploaded per frame, beyond
+	// the first image, while textures are still loading
+	const size_t g_TextureUploadBudget = 8 * 1024 * 1024;
+
+	// most threads decoding texture images at once
+	const int g_MaxTextureWorkers = 4;
+	// fewest items a per-item loop hands to one job; smaller draw
+	// lists run on the render thread alone
+	const size_t g_MinItemsPerJob = 256;
+
+	// starting block sizes of the arenas; the frame arena grows to
+	// the largest frame within its first frames
+	const size_t g_PersistentArenaSize = 16 * 1024;
+	const size_t g_SceneArenaSize = 16 * 1024;
+	const size_t g_FrameArenaSize = 256 * 1024;
+
+	// largest change of a light matrix element, or of an authored
+	// caster transform value, that keeps the cached shadow map
+	const float g_ShadowCacheTolerance = 1.0e-4f;
+
+	// owners of the shadow atlas tiles; the shadowed point lights
+	// follow in the order they were added
+	const int g_SpotShadowOwner = 0;
+	const int g_DirectionalShadowOwner = 1;
+	const int g_FirstPointShadowOwner = 2;
+	// share of the atlas a point light right at the camera is given
+	// per cube face; it falls off with the distance beyond its range
+	const float g_PointShadowImportance = 0.5f;
+	// the spotlight shadow frustum is slightly larger than the widened
+	// outer cone, to avoid clipping it
+	const float g_SpotShadowFov = 48.0f;
+	const float g_SpotShadowNear = 0.05f;
+	const float g_SpotShadowFar = 80.0f;
+	const float g_PointShadowNear = 0.05f;
+
+	// view directions and up vectors of the six point light faces,
+	// in the order the lit shader picks them by major axis
+	const glm::vec3 g_CubeFaceDirections[6] =
+	{
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 g_CubeFaceUps[6] =
+	{
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+
+	// colors ScatterPointLights() cycles through, and the share of
+	// the color a light reflects specularly
+	const glm::vec3 g_ScatterColors[] =
+	{
+		glm::vec3(1.0f, 0.45f, 0.2f),
+		glm::vec3(0.3f, 0.6f, 1.0f),
+		glm::vec3(0.4f, 1.0f, 0.45f),
+		glm::vec3(1.0f, 0.3f, 0.75f),
+		glm::vec3(1.0f, 0.9f, 0.4f),
+		glm::vec3(0.55f, 0.4f, 1.0f)
+	};
+	const float g_ScatterSpecular = 0.5f;
+
+	// point of a Halton sequence of a prime base, in [0, 1)
+	float GetHalton(uint32_t index, uint32_t base)
+	{
+		float value = 0.0f;
+		float scale = 1.0f / (float)base;
+		for (; index > 0; index /= base)
+		{
+			value += (float)(index % base) * scale;
+			scale /= (float)base;
+		}
+
+		return(value);
+	}
 }
 
 /***********************************************************
@@ -36,17 +152,55 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(
+	ShaderManager *pShaderManager,
+	UniformBufferManager* pUniformBuffers)
+	: m_persistentArena(g_PersistentArenaSize),
+	m_sceneArena(g_SceneArenaSize),
+	m_frameArena(g_FrameArenaSize)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
-	m_loadedTextures = 0;
-    m_shadowFBO = 0;
-    m_shadowDepthTexture = 0;
-    m_shadowMapWidth = 2048;
-    m_shadowMapHeight = 2048;
+	m_pUniformBuffers = pUniformBuffers;
+	m_basicMeshes = m_persistentArena.Create<ShapeMeshes>();
+	m_pLiquidSurface = m_persistentArena.Create<LiquidSurface>();
+	m_dirtyTransforms = 0;
+	m_pTextureLoader = new TextureLoader();
+	m_placeholderTexture = 0;
+	m_usedTextureLayers = 0;
+	m_pJobs = new JobSystem();
+	m_litQueue.SetDepthRange(g_QueueDepthRange);
+	m_shadowQueue.SetDepthRange(g_QueueDepthRange);
+	m_pInstancedMeshes = new InstancedMeshes();
+	m_pInstancedShaderManager = NULL;
+	m_pInstancedDepthShaderManager = NULL;
+	m_bInstancingReady = false;
+	m_bIndirectReady = false;
+	m_pGpuCulling = new GpuCulling();
+	m_bGpuCullingReady = false;
+	m_pClusteredLights = new ClusteredLights();
+	m_bClusteredLightsReady = false;
+	m_bOcclusionCulling = false;
+	m_bDepthPrepass = false;
+	m_lodErrorPixels = g_DefaultLodError;
+	m_shadowLodBias = g_DefaultShadowLodBias;
+	m_bCullRecordsDirty = true;
+	m_pProfiler = NULL;
+	m_passAllocationStart = 0;
+	m_sceneFile = g_DefaultSceneFile;
+	m_sceneCopies = 1;
+	m_sceneRadius = 0.0f;
+    m_pShadowAtlas = new ShadowAtlas();
     m_pDepthShaderManager = nullptr;
-    m_spotLightSpaceMatrix = glm::mat4(1.0f);
+    m_shadowFilter = SHADOW_FILTER_POISSON16;
+    m_shadowView = 0;
+    m_shadowBoundsCenter = glm::vec3(0.0f);
+    m_shadowBoundsRadius = 0.0f;
+    m_bScenePrepared = false;
+    m_bStaticShadowDirty = true;
+    m_bDynamicShadowDirty = true;
+    m_dynamicCasterCount = 0;
+	m_pDynamicResolution = new DynamicResolution();
+	m_bDynamicResolutionReady = false;
 }
 
 /***********************************************************
@@ -57,119 +211,274 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
-	delete m_basicMeshes;
+	m_pUniformBuffers = NULL;
+	m_pProfiler = NULL;
+	delete m_pInstancedMeshes;
+	m_pInstancedMeshes = NULL;
+	delete m_pGpuCulling;
+	m_pGpuCulling = NULL;
+	delete m_pClusteredLights;
+	m_pClusteredLights = NULL;
+	// stop the workers before freeing the textures they fill
+	delete m_pTextureLoader;
+	m_pTextureLoader = NULL;
+	delete m_pJobs;
+	m_pJobs = NULL;
+	DestroyGLTextures();
+    delete m_pShadowAtlas;
+    m_pShadowAtlas = nullptr;
+	delete m_pDynamicResolution;
+	m_pDynamicResolution = NULL;
+
+	// the meshes and programs live in the persistent arena, the
+	// tables of the scene in the scene arena
 	m_basicMeshes = NULL;
-    if (m_shadowDepthTexture != 0)
-    {
-        GLuint tex = m_shadowDepthTexture;
-        glDeleteTextures(1, &tex);
-        m_shadowDepthTexture = 0;
-    }
-    if (m_shadowFBO != 0)
-    {
-        GLuint fbo = m_shadowFBO;
-        glDeleteFramebuffers(1, &fbo);
-        m_shadowFBO = 0;
-    }
-    if (m_pDepthShaderManager != nullptr)
-    {
-        delete m_pDepthShaderManager;
-        m_pDepthShaderManager = nullptr;
-    }
+	m_pLiquidSurface = NULL;
+	m_pInstancedShaderManager = NULL;
+	m_pInstancedDepthShaderManager = NULL;
+	m_pDepthShaderManager = nullptr;
+	m_textureHandles.clear();
+	m_materialHandles.clear();
+	m_sceneArena.Reset();
+	m_persistentArena.Reset();
+}
+
+/***********************************************************
+ *  InternTag()
+ *
+ *  This method is used for keeping a copy of a tag in the
+ *  scene arena, so the tables that name textures and
+ *  materials hold no strings of their own.
+ ***********************************************************/
+const char* SceneManager::InternTag(const char* tag)
+{
+	if (tag == NULL)
+	{
+		return(NULL);
+	}
+
+	return(m_sceneArena.CopyString(tag));
 }
 
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for registering a texture tag and
+ *  queueing its image file for decoding on the worker
+ *  threads.  Only the image header is read here; the tag
+ *  shows the placeholder texture until ProcessTextureLoads()
+ *  swaps in the uploaded image.  Images of the size of the
+ *  first one are given a layer of the shared texture array.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+bool SceneManager::CreateGLTexture(const char* filename, const char* tag)
 {
+	// each tag names exactly one texture
+	if (m_textureHandles.find(tag) != m_textureHandles.end())
+	{
+		std::cout << "Texture tag already loaded:" << tag << std::endl;
+		return false;
+	}
+
 	int width = 0;
 	int height = 0;
 	int colorChannels = 0;
-	GLuint textureID = 0;
+	size_t nameLength = strlen(filename);
+	bool bDDSFile = (nameLength > 4) && (strcmp(filename + nameLength - 4, ".dds") == 0);
 
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+	// reject missing files and unsupported formats right away, so
+	// objects can still fall back to their solid color; DDS files
+	// are left to the loader, which reads their header itself
+	if (bDDSFile)
+	{
+		colorChannels = 4;
+	}
+	else if (!stbi_info(filename, &width, &height, &colorChannels))
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
+	}
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		return false;
+	}
+
+	CreatePlaceholderTexture();
+
+	int layer = -1;
+	if (!bDDSFile)
+	{
+		if (m_pTextureLoader->GetTextureArray() == 0)
+		{
+			m_pTextureLoader->CreateTextureArray(width, height, colorChannels, g_TextureArrayLayers);
+			m_glState.InvalidateTextures();
+		}
+		if (m_pTextureLoader->MatchesTextureArray(width, height, colorChannels))
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			if (!m_freeTextureLayers.empty())
+			{
+				layer = m_freeTextureLayers.back();
+				m_freeTextureLayers.pop_back();
+			}
+			else if (m_usedTextureLayers < m_pTextureLoader->GetTextureArrayLayers())
+			{
+				layer = m_usedTextureLayers++;
+			}
 		}
+	}
+
+	// register the texture and associate its handle with the tag string
+	TEXTURE_INFO texture;
+	texture.ID = m_placeholderTexture;
+	texture.tag = InternTag(tag);
+	texture.filename = InternTag(filename);
+	texture.arrayLayer = layer;
+	int textureHandle = (int)m_textures.size();
+	if (!m_textures.push_back(texture))
+	{
+		std::cout << "Texture table is full:" << tag << std::endl;
+		return false;
+	}
+	m_textureHandles[texture.tag] = textureHandle;
+
+	m_pTextureLoader->Request(textureHandle, filename, layer);
+
+	return true;
+}
+
+/***********************************************************
+ *  CreatePlaceholderTexture()
+ *
+ *  This method is used for creating the small neutral gray
+ *  texture that stands in for images still being loaded.
+ ***********************************************************/
+void SceneManager::CreatePlaceholderTexture()
+{
+	if (m_placeholderTexture != 0)
+	{
+		return;
+	}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+	const unsigned char pixels[2 * 2 * 4] =
+	{
+		128, 128, 128, 255,   144, 144, 144, 255,
+		144, 144, 144, 255,   128, 128, 128, 255
+	};
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_placeholderTexture = textureID;
+	m_glState.InvalidateTextures();
+}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+/***********************************************************
+ *  ProcessTextureLoads()
+ *
+ *  This method is used for uploading the images decoded
+ *  since the last call, within a per-frame byte budget, and
+ *  pointing their handles at the new textures.  Draw items
+ *  look textures up through their handles, and the material
+ *  table is refreshed for the new array layers.
+ ***********************************************************/
+void SceneManager::ProcessTextureLoads(bool bWait)
+{
+	std::vector<TextureLoader::LOADED_TEXTURE> loaded =
+		m_pTextureLoader->ProcessUploads(g_TextureUploadBudget, bWait);
+	if (loaded.empty())
+	{
+		return;
+	}
 
-		return true;
+	for (size_t i = 0; i < loaded.size(); i++)
+	{
+		int textureHandle = loaded[i].handle;
+		if ((textureHandle >= 0) && (textureHandle < (int)m_textures.size()))
+		{
+			// layered textures keep drawing with the placeholder until
+			// the material table names their layer
+			if (loaded[i].layer >= 0)
+			{
+				m_textures[textureHandle].layer = loaded[i].layer;
+			}
+			else
+			{
+				m_textures[textureHandle].ID = loaded[i].textureID;
+			}
+		}
+		else if (loaded[i].textureID != 0)
+		{
+			GLuint textureID = loaded[i].textureID;
+			glDeleteTextures(1, &textureID);
+		}
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	// the uploads bound textures behind the cache
+	m_glState.InvalidateTextures();
+	UpdateMaterialBlock();
+	// textures taking their layer let more items be culled on the GPU
+	m_bCullRecordsDirty = true;
+}
+
+/***********************************************************
+ *  WaitForTextures()
+ *
+ *  This method is used for finishing every queued texture
+ *  load before going on, e.g. before a benchmark run.
+ ***********************************************************/
+void SceneManager::WaitForTextures()
+{
+	ProcessTextureLoads(true);
+}
+
+/***********************************************************
+ *  SetTextureAnisotropy()
+ *
+ *  This method is used for changing the anisotropic filter
+ *  level of every scene texture, including the ones that
+ *  are already loaded.
+ ***********************************************************/
+void SceneManager::SetTextureAnisotropy(float anisotropy)
+{
+	m_pTextureLoader->SetAnisotropy(anisotropy);
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if ((m_textures[i].ID != 0) && (m_textures[i].ID != m_placeholderTexture))
+		{
+			m_pTextureLoader->ApplySampling(m_textures[i].ID);
+		}
+	}
 
-	// Error loading the image
-	return false;
+	// applying the settings bound textures behind the cache
+	m_glState.InvalidateTextures();
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for binding the first loaded texture
+ *  to the object texture unit.  Other textures are bound to
+ *  that same unit when an object using them is drawn.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	// loading the textures changed the bindings behind the cache
+	m_glState.InvalidateTextures();
+	if (m_textures.size() > 0)
 	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		m_glState.BindTexture2D(g_ObjectTextureUnit, m_textures[0].ID);
 	}
-    // ensure default sampler points at unit 0
+    // ensure default sampler points at the object texture unit
     if (NULL != m_pShaderManager)
     {
-        m_pShaderManager->setSampler2DValue("objectTexture", 0);
+        m_uniforms.SetInt(U::U_OBJECT_TEXTURE, g_ObjectTextureUnit);
     }
 }
 
@@ -177,20 +486,53 @@ void SceneManager::BindGLTextures()
  *  DestroyGLTextures()
  *
  *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  loaded textures.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	for (size_t i = 0; i < m_textures.size(); i++)
 	{
-		if (m_textureIDs[i].ID != 0)
+		if ((m_textures[i].ID != 0) && (m_textures[i].ID != m_placeholderTexture))
 		{
-			GLuint id = m_textureIDs[i].ID;
+			GLuint id = m_textures[i].ID;
 			glDeleteTextures(1, &id);
-			m_textureIDs[i].ID = 0;
+			m_textures[i].ID = 0;
 		}
 	}
-	m_loadedTextures = 0;
+	m_textures.clear();
+	m_textureHandles.clear();
+	m_usedTextureLayers = 0;
+	m_freeTextureLayers.clear();
+	if (m_placeholderTexture != 0)
+	{
+		GLuint id = m_placeholderTexture;
+		glDeleteTextures(1, &id);
+		m_placeholderTexture = 0;
+	}
+	m_glState.InvalidateTextures();
+}
+
+/***********************************************************
+ *  FindTextureHandle()
+ *
+ *  This method is used for getting the handle of the
+ *  previously loaded texture associated with the passed in
+ *  tag.  It returns -1 when the tag is unknown.
+ ***********************************************************/
+int SceneManager::FindTextureHandle(const char* tag)
+{
+	if (tag == NULL)
+	{
+		return(-1);
+	}
+
+	TAG_MAP::const_iterator it = m_textureHandles.find(tag);
+	if (it == m_textureHandles.end())
+	{
+		return(-1);
+	}
+
+	return(it->second);
 }
 
 /***********************************************************
@@ -199,50 +541,32 @@ void SceneManager::DestroyGLTextures()
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(const char* tag)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	int handle = FindTextureHandle(tag);
+	if (handle < 0)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
+		return(-1);
 	}
 
-	return(textureID);
+	return((int)m_textures[handle].ID);
 }
 
 /***********************************************************
  *  FindTextureSlot()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for getting the texture unit that
+ *  the texture associated with the passed in tag is sampled
+ *  from, or -1 when the tag is unknown.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const char* tag)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	if (FindTextureHandle(tag) < 0)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		return(-1);
 	}
 
-	return(textureSlot);
+	return(g_ObjectTextureUnit);
 }
 
 /***********************************************************
@@ -251,40 +575,153 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(const char* tag, OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.size() == 0)
+	int index = FindMaterialIndex(tag);
+	if (index < 0)
 	{
 		return(false);
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	material.diffuseColor = m_objectMaterials[index].diffuseColor;
+	material.specularColor = m_objectMaterials[index].specularColor;
+	material.shininess = m_objectMaterials[index].shininess;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the handle of a previously
+ *  defined material associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const char* tag)
+{
+	if (tag == NULL)
+	{
+		return(-1);
+	}
+
+	TAG_MAP::const_iterator it = m_materialHandles.find(tag);
+	if (it == m_materialHandles.end())
+	{
+		return(-1);
+	}
+
+	return(it->second);
+}
+
+/***********************************************************
+ *  AddObjectMaterial()
+ *
+ *  This method is used for appending a material to the
+ *  materials list and registering its tag.  A tag that is
+ *  already defined is replaced, keeping its interned copy.
+ ***********************************************************/
+int SceneManager::AddObjectMaterial(const OBJECT_MATERIAL& material)
+{
+	int index = FindMaterialIndex(material.tag);
+	if (index >= 0)
+	{
+		const char* tag = m_objectMaterials[index].tag;
+		m_objectMaterials[index] = material;
+		m_objectMaterials[index].tag = tag;
+		return(index);
+	}
+
+	index = (int)m_objectMaterials.size();
+	if (!m_objectMaterials.push_back(material))
+	{
+		return(-1);
+	}
+	m_objectMaterials.back().tag = InternTag(material.tag);
+	if (material.tag != NULL)
+	{
+		m_materialHandles[m_objectMaterials.back().tag] = index;
+	}
+
+	return(index);
+}
+
+/***********************************************************
+ *  FindMaterialSlot()
+ *
+ *  This method is used for getting the material table entry
+ *  of a material and texture pair, adding it on first use.
+ *  It returns -1 once the table is full; such items set the
+ *  material uniforms on every draw instead.
+ ***********************************************************/
+int SceneManager::FindMaterialSlot(int materialIndex, int textureHandle)
+{
+	for (size_t i = 0; i < m_materialSlots.size(); i++)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		if ((m_materialSlots[i].materialIndex == materialIndex) &&
+			(m_materialSlots[i].textureHandle == textureHandle))
 		{
-			bFound = true;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			return((int)i);
 		}
-		else
+	}
+
+	if ((int)m_materialSlots.size() >= MAX_MATERIALS)
+	{
+		return(-1);
+	}
+
+	MATERIAL_SLOT slot;
+	slot.materialIndex = materialIndex;
+	slot.textureHandle = textureHandle;
+	m_materialSlots.push_back(slot);
+
+	return((int)m_materialSlots.size() - 1);
+}
+
+/***********************************************************
+ *  UpdateMaterialBlock()
+ *
+ *  This method is used for copying the material values and
+ *  the texture array layer of every material table entry
+ *  into the materials uniform block.  A texture that is not
+ *  in the array, or not loaded yet, gets layer -1 and is
+ *  bound on its own.
+ ***********************************************************/
+void SceneManager::UpdateMaterialBlock()
+{
+	if (NULL == m_pUniformBuffers)
+	{
+		return;
+	}
+
+	UniformBufferManager::MATERIALS_BLOCK& block = m_pUniformBuffers->GetMaterials();
+	for (size_t i = 0; i < m_materialSlots.size(); i++)
+	{
+		const MATERIAL_SLOT& slot = m_materialSlots[i];
+		UniformBufferManager::MATERIAL_RECORD record;
+
+		if ((slot.materialIndex >= 0) && (slot.materialIndex < (int)m_objectMaterials.size()))
 		{
-			index++;
+			const OBJECT_MATERIAL& material = m_objectMaterials[slot.materialIndex];
+			record.diffuseColor = material.diffuseColor;
+			record.specularColor = material.specularColor;
+			record.shininess = material.shininess;
+		}
+		if ((slot.textureHandle >= 0) && (slot.textureHandle < (int)m_textures.size()))
+		{
+			record.textureLayer = m_textures[slot.textureHandle].layer;
 		}
-	}
 
-	return(true);
+		block.materials[i] = record;
+	}
+	m_pUniformBuffers->MarkMaterialsDirty();
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  BuildModelMatrix()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for composing a model matrix from
+ *  the passed in transformation values.
  ***********************************************************/
-void SceneManager::SetTransformations(
+glm::mat4 SceneManager::BuildModelMatrix(
 	glm::vec3 scaleXYZ,
 	float XrotationDegrees,
 	float YrotationDegrees,
@@ -292,7 +729,6 @@ void SceneManager::SetTransformations(
 	glm::vec3 positionXYZ)
 {
 	// variables for this method
-	glm::mat4 modelView;
 	glm::mat4 scale;
 	glm::mat4 rotationX;
 	glm::mat4 rotationY;
@@ -308,11 +744,33 @@ void SceneManager::SetTransformations(
 	// set the translation value in the transform buffer
 	translation = glm::translate(positionXYZ);
 
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	return(translation * rotationZ * rotationY * rotationX * scale);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	glm::mat4 modelView = BuildModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
 
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		m_uniforms.SetMat4(U::U_MODEL, modelView);
+		m_uniforms.SetMat3(U::U_NORMAL_MATRIX, glm::transpose(glm::inverse(glm::mat3(modelView))));
 	}
 }
 
@@ -338,8 +796,8 @@ void SceneManager::SetShaderColor(
 
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_uniforms.SetInt(U::U_USE_TEXTURE, false);
+		m_uniforms.SetVec4(U::U_OBJECT_COLOR, currentColor);
 	}
 }
 
@@ -350,26 +808,30 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const char* textureTag)
+{
+	SetShaderTexture(FindTextureHandle(textureTag));
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data
+ *  associated with the passed in handle into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	int textureHandle)
 {
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		m_uniforms.SetInt(U::U_USE_TEXTURE, true);
 
-        int textureSlot = -1;
-        textureSlot = FindTextureSlot(textureTag);
-        if (textureSlot < 0)
-        {
-            textureSlot = 0;
-        }
-        // activate and bind selected texture before updating sampler
-        glActiveTexture(GL_TEXTURE0 + textureSlot);
-        int textureID = FindTextureID(textureTag);
-        if (textureID > 0)
+        // bind the selected texture unless it is already bound
+        if ((textureHandle >= 0) && (textureHandle < (int)m_textures.size()))
         {
-            glBindTexture(GL_TEXTURE_2D, textureID);
+            m_glState.BindTexture2D(g_ObjectTextureUnit, m_textures[textureHandle].ID);
         }
-        m_pShaderManager->setSampler2DValue(g_TextureValueName, textureSlot);
+        m_uniforms.SetInt(U::U_OBJECT_TEXTURE, g_ObjectTextureUnit);
 	}
 }
 
@@ -383,7 +845,7 @@ void SceneManager::SetTextureUVScale(float u, float v)
 {
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_uniforms.SetVec2(U::U_UV_SCALE, glm::vec2(u, v));
 	}
 }
 
@@ -394,507 +856,2656 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
 {
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+	SetShaderMaterial(FindMaterialIndex(materialTag));
+}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the values of the
+ *  material with the passed in handle into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	int materialHandle)
+{
+	if ((materialHandle >= 0) && (materialHandle < (int)m_objectMaterials.size()))
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[materialHandle];
+		m_uniforms.SetVec3(U::U_MATERIAL_DIFFUSE, material.diffuseColor);
+		m_uniforms.SetVec3(U::U_MATERIAL_SPECULAR, material.specularColor);
+		m_uniforms.SetFloat(U::U_MATERIAL_SHININESS, material.shininess);
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
+/***********************************************************
+ *  SetSceneFile()
+ *
+ *  This method is used for choosing the scene file that
+ *  PrepareScene() loads.
+ ***********************************************************/
+void SceneManager::SetSceneFile(const char* filename)
+{
+	m_sceneFile = filename;
+}
 
 /***********************************************************
- *  PrepareScene()
+ *  GetSceneFile()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for reading the scene file that
+ *  PrepareScene() loads.
  ***********************************************************/
-void SceneManager::PrepareScene()
+const std::string& SceneManager::GetSceneFile() const
 {
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	return(m_sceneFile);
+}
 
-	// load textures once and bind to texture units
-	// NOTE: ensure the exact filename in the textures folder matches below
-	CreateGLTexture("textures/stone.png", "stone");
-	CreateGLTexture("textures/grass.png", "grass");
-	BindGLTextures();
+/***********************************************************
+ *  LoadSceneFile()
+ *
+ *  This method is used for replacing the scene with the one
+ *  of a scene file.  The file is mapped and its tables are
+ *  read in place into new scene tables, taken from the scene
+ *  arena once it is reset: textures the previous scene
+ *  loaded from the same image file are kept, others are
+ *  queued, the materials are defined by tag and the draw
+ *  list is filled straight from the object arrays.  The
+ *  textures and layers the new scene does not use are freed.
+ *  It can be called between frames to swap scenes while
+ *  running.
+ ***********************************************************/
+bool SceneManager::LoadSceneFile(const char* filename)
+{
+	double startTime = glfwGetTime();
 
-    // OPTIONAL: enable basic directional lighting and material defaults
-	if (m_pShaderManager != NULL)
+	SceneFile file;
+	if (!file.Open(filename))
 	{
-		// turn on lighting path in shader
-		m_pShaderManager->setIntValue("bUseLighting", true);
-
-		// basic ceramic-like material
-		m_pShaderManager->setVec3Value("material.diffuseColor", glm::vec3(1.0f, 1.0f, 1.0f));
-		m_pShaderManager->setVec3Value("material.specularColor", glm::vec3(0.5f, 0.5f, 0.5f));
-		m_pShaderManager->setFloatValue("material.shininess", 32.0f);
-
-        // simple white directional light
-		m_pShaderManager->setVec3Value("directionalLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f));
-        m_pShaderManager->setVec3Value("directionalLight.ambient", glm::vec3(0.15f, 0.15f, 0.15f));
-        m_pShaderManager->setVec3Value("directionalLight.diffuse", glm::vec3(0.3f, 0.3f, 0.3f));
-		m_pShaderManager->setVec3Value("directionalLight.specular", glm::vec3(1.0f, 1.0f, 1.0f));
-		m_pShaderManager->setIntValue("directionalLight.bActive", true);
-
-        // soft fill point light to avoid fully dark regions
-        m_pShaderManager->setVec3Value("pointLights[0].position", glm::vec3(2.0f, 6.0f, 2.0f));
-        m_pShaderManager->setVec3Value("pointLights[0].ambient", glm::vec3(0.08f, 0.08f, 0.08f));
-        m_pShaderManager->setVec3Value("pointLights[0].diffuse", glm::vec3(0.35f, 0.35f, 0.35f));
-        m_pShaderManager->setVec3Value("pointLights[0].specular", glm::vec3(0.35f, 0.35f, 0.35f));
-        m_pShaderManager->setIntValue("pointLights[0].bActive", true);
+		std::cout << "Could not load scene file:" << filename << std::endl;
+		return(false);
+	}
+	const uint32_t* pMeshes = file.GetObjectMeshes();
+	for (int object = 0; object < file.GetObjectCount(); object++)
+	{
+		if (pMeshes[object] > MESH_LIQUID_SURFACE)
+		{
+			std::cout << "Scene file uses an unknown mesh:" << filename << std::endl;
+			return(false);
+		}
+	}
 
-        // disable additional point lights
-        m_pShaderManager->setIntValue("pointLights[1].bActive", false);
-        m_pShaderManager->setIntValue("pointLights[2].bActive", false);
-        m_pShaderManager->setIntValue("pointLights[3].bActive", false);
-        m_pShaderManager->setIntValue("pointLights[4].bActive", false);
+	// loads queued for the previous scene finish first, as they name
+	// texture handles of the tables replaced below
+	ProcessTextureLoads(true);
 
-        // initialize a camera-tied spotlight (position/direction updated per-frame in ViewManager)
-        // widen and brighten flashlight slightly
-        m_pShaderManager->setFloatValue("spotLight.cutOff", glm::cos(glm::radians(18.0f)));
-        m_pShaderManager->setFloatValue("spotLight.outerCutOff", glm::cos(glm::radians(26.0f)));
-        m_pShaderManager->setFloatValue("spotLight.constant", 1.0f);
-        m_pShaderManager->setFloatValue("spotLight.linear", 0.045f);
-        m_pShaderManager->setFloatValue("spotLight.quadratic", 0.008f);
-        m_pShaderManager->setVec3Value("spotLight.ambient", glm::vec3(0.02f));
-        m_pShaderManager->setVec3Value("spotLight.diffuse", glm::vec3(1.1f));
-        m_pShaderManager->setVec3Value("spotLight.specular", glm::vec3(1.1f));
-        m_pShaderManager->setIntValue("spotLight.bActive", true);
+	// the textures of the previous scene are set aside in the frame
+	// arena, and the scene arena holding its tables is reset
+	size_t previousCount = m_textures.size();
+	TEXTURE_INFO* pPreviousTextures = m_frameArena.AllocateArray<TEXTURE_INFO>(previousCount);
+	TAG_MAP previousHandles;
+	for (size_t i = 0; i < previousCount; i++)
+	{
+		pPreviousTextures[i] = m_textures[i];
+		pPreviousTextures[i].tag = m_frameArena.CopyString(m_textures[i].tag);
+		pPreviousTextures[i].filename = m_frameArena.CopyString(m_textures[i].filename);
+		previousHandles[pPreviousTextures[i].tag] = (int)i;
 	}
-
+	m_textureHandles.clear();
+	m_materialHandles.clear();
+	m_sceneArena.Reset();
+	size_t itemCount = (size_t)file.GetObjectCount() * (size_t)m_sceneCopies;
+	m_textures.Reserve(m_sceneArena, (size_t)file.GetTextureCount());
+	m_objectMaterials.Reserve(m_sceneArena, (size_t)file.GetMaterialCount());
+	m_materialSlots.Reserve(m_sceneArena, MAX_MATERIALS);
+	m_drawItems.Reserve(m_sceneArena, itemCount);
+	m_objectTransforms.Reserve(m_sceneArena, itemCount);
+
+	// the texture sampler is set on the lit program
+	m_pShaderManager->use();
+
+	// a texture the previous scene loaded under the same tag from the
+	// same image file is kept; a tag naming another file is loaded
+	// again, and its old texture is freed with the other unused ones
+	int* pTextureHandles = m_frameArena.AllocateArray<int>(file.GetTextureCount());
+	for (int texture = 0; texture < file.GetTextureCount(); texture++)
+	{
+		const char* tag = file.GetTextureTag(texture);
+		const char* textureFile = file.GetTextureFile(texture);
+		pTextureHandles[texture] = FindTextureHandle(tag);
+		if (pTextureHandles[texture] >= 0)
+		{
+			continue;
+		}
+
+		TAG_MAP::iterator previous = previousHandles.find(tag);
+		if ((previous != previousHandles.end()) &&
+			(strcmp(pPreviousTextures[previous->second].filename, textureFile) == 0))
+		{
+			TEXTURE_INFO kept = pPreviousTextures[previous->second];
+			kept.tag = InternTag(kept.tag);
+			kept.filename = InternTag(kept.filename);
+			pTextureHandles[texture] = (int)m_textures.size();
+			m_textures.push_back(kept);
+			m_textureHandles[kept.tag] = pTextureHandles[texture];
+			previousHandles.erase(previous);
+		}
+		else if (CreateGLTexture(textureFile, tag))
+		{
+			pTextureHandles[texture] = FindTextureHandle(tag);
+		}
+	}
+	BindGLTextures();
+
+	// materials are defined by tag in the new table
+	int* pMaterialIndices = m_frameArena.AllocateArray<int>(file.GetMaterialCount());
+	for (int index = 0; index < file.GetMaterialCount(); index++)
+	{
+		OBJECT_MATERIAL material;
+		material.diffuseColor = file.GetMaterialDiffuse()[index];
+		material.specularColor = file.GetMaterialSpecular()[index];
+		material.shininess = file.GetMaterialShininess()[index];
+		material.tag = file.GetMaterialTag(index);
+		pMaterialIndices[index] = AddObjectMaterial(material);
+	}
+
+	FillDrawItems(file, pTextureHandles, pMaterialIndices);
+
+	// with the new draw list in place, the textures of the previous
+	// scene that were not kept are freed, and their layers handed out
+	// again to later textures
+	for (TAG_MAP::const_iterator it = previousHandles.begin(); it != previousHandles.end(); ++it)
+	{
+		const TEXTURE_INFO& texture = pPreviousTextures[it->second];
+		if ((texture.ID != 0) && (texture.ID != m_placeholderTexture))
+		{
+			GLuint id = texture.ID;
+			glDeleteTextures(1, &id);
+		}
+		if (texture.arrayLayer >= 0)
+		{
+			m_freeTextureLayers.push_back(texture.arrayLayer);
+		}
+	}
+	m_glState.InvalidateTextures();
+	UpdateMaterialBlock();
+	PrebuildPermutations();
+
+	// the depth of the last frame shows the old scene
+	if (m_bGpuCullingReady)
+	{
+		m_pGpuCulling->InvalidateDepthPyramid();
+	}
+	// loading changed programs and bindings behind the cache
+	m_glState.Invalidate();
+
+	std::cout << "Loaded scene file " << filename << ": " << m_drawItems.size() << " objects in "
+		<< (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FillDrawItems()
+ *
+ *  This method is used for replacing the flat draw list
+ *  with the objects of a mapped scene file.  The material
+ *  and texture lookups are resolved through the tables of
+ *  the file once per object, and copies of the scene are
+ *  laid out side by side on a square grid, spaced by the
+ *  extent of the scene on the ground.
+ ***********************************************************/
+void SceneManager::FillDrawItems(
+	const SceneFile& file,
+	const int* pTextureHandles,
+	const int* pMaterialIndices)
+{
+	size_t objectCount = (size_t)file.GetObjectCount();
+	size_t itemCount = objectCount * (size_t)m_sceneCopies;
+	m_drawItems.assign(itemCount, DRAW_ITEM());
+	m_objectTransforms.assign(itemCount, OBJECT_TRANSFORM());
+	m_materialSlots.clear();
+	m_dynamicCasterCount = 0;
+	m_bStaticShadowDirty = true;
+	m_bDynamicShadowDirty = true;
+	m_sceneRadius = 0.0f;
+
+	const uint32_t* pMeshes = file.GetObjectMeshes();
+	const uint32_t* pFlags = file.GetObjectFlags();
+	const int32_t* pMaterials = file.GetObjectMaterials();
+	const int32_t* pTextures = file.GetObjectTextures();
+	const glm::vec3* pScales = file.GetObjectScales();
+	const glm::vec3* pRotations = file.GetObjectRotations();
+	const glm::vec3* pPositions = file.GetObjectPositions();
+	const glm::vec4* pColors = file.GetObjectColors();
+	const glm::vec2* pUVScales = file.GetObjectUVScales();
+	for (size_t object = 0; object < objectCount; object++)
+	{
+		DRAW_ITEM& item = m_drawItems[object];
+		item.meshID = (int)pMeshes[object];
+		item.flags = pFlags[object] & g_SceneFileFlags;
+		item.materialIndex = (pMaterials[object] >= 0) ? pMaterialIndices[pMaterials[object]] : -1;
+		item.textureHandle = (pTextures[object] >= 0) ? pTextureHandles[pTextures[object]] : -1;
+		item.color = pColors[object];
+		item.uvScale = pUVScales[object];
+		// an item without a loaded texture keeps its solid color
+		if (item.textureHandle >= 0)
+		{
+			item.flags |= DRAW_TEXTURED;
+		}
+		item.materialSlot = FindMaterialSlot(item.materialIndex, item.textureHandle);
+
+		OBJECT_TRANSFORM& transform = m_objectTransforms[object];
+		transform.scaleXYZ = pScales[object];
+		transform.rotationDegrees = pRotations[object];
+		transform.positionXYZ = pPositions[object];
+		transform.bDirty = true;
+	}
+	m_dirtyTransforms = (int)objectCount;
+	UpdateDirtyTransforms();
+
+	if ((m_sceneCopies == 1) || (objectCount == 0))
+	{
+		return;
+	}
+
+	glm::vec3 boxMin = m_drawItems[0].bounds.boxMin;
+	glm::vec3 boxMax = m_drawItems[0].bounds.boxMax;
+	for (size_t object = 1; object < objectCount; object++)
+	{
+		boxMin = glm::min(boxMin, m_drawItems[object].bounds.boxMin);
+		boxMax = glm::max(boxMax, m_drawItems[object].bounds.boxMax);
+	}
+	glm::vec2 spacing(boxMax.x - boxMin.x, boxMax.z - boxMin.z);
+	int columns = (int)std::ceil(std::sqrt((float)m_sceneCopies));
+	int rows = (m_sceneCopies + columns - 1) / columns;
+	glm::vec2 gridHalfExtent(
+		0.5f * (float)(columns - 1) * spacing.x,
+		0.5f * (float)(rows - 1) * spacing.y);
+	m_sceneRadius = glm::length(gridHalfExtent);
+
+	// every copy, the first included, takes its pose from the file
+	// and its other state from the first copy, which only has its
+	// transform written here
+	m_pJobs->ParallelFor(itemCount, g_MinItemsPerJob,
+		[&](size_t, size_t begin, size_t end)
+	{
+		for (size_t index = begin; index < end; index++)
+		{
+			size_t copy = index / objectCount;
+			size_t object = index % objectCount;
+			glm::vec3 offset(
+				(float)(copy % columns) * spacing.x - gridHalfExtent.x,
+				0.0f,
+				(float)(copy / columns) * spacing.y - gridHalfExtent.y);
+			if (copy > 0)
+			{
+				m_drawItems[index] = m_drawItems[object];
+			}
+
+			OBJECT_TRANSFORM& transform = m_objectTransforms[index];
+			transform.scaleXYZ = pScales[object];
+			transform.rotationDegrees = pRotations[object];
+			transform.positionXYZ = pPositions[object] + offset;
+			transform.bDirty = true;
+		}
+	});
+	m_dirtyTransforms = (int)itemCount;
+	UpdateDirtyTransforms();
+}
+
+/***********************************************************
+ *  SaveSceneFile()
+ *
+ *  This method is used for writing the loaded scene as a
+ *  scene file, every copy included, e.g. to turn a scene
+ *  laid out many times into one large scene file.
+ ***********************************************************/
+bool SceneManager::SaveSceneFile(const char* filename) const
+{
+	SceneFile::CONTENT content;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		content.textureFiles.push_back(m_textures[i].filename);
+		content.textureTags.push_back(m_textures[i].tag);
+	}
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		content.materialTags.push_back((material.tag != NULL) ? material.tag : "");
+		content.materialDiffuse.push_back(material.diffuseColor);
+		content.materialSpecular.push_back(material.specularColor);
+		content.materialShininess.push_back(material.shininess);
+	}
+	for (size_t i = 0; i < m_drawItems.size(); i++)
+	{
+		const DRAW_ITEM& item = m_drawItems[i];
+		const OBJECT_TRANSFORM& transform = m_objectTransforms[i];
+		content.objectMeshes.push_back((uint32_t)item.meshID);
+		content.objectFlags.push_back(item.flags & g_SceneFileFlags);
+		content.objectMaterials.push_back(item.materialIndex);
+		content.objectTextures.push_back(item.textureHandle);
+		content.objectScales.push_back(transform.scaleXYZ);
+		content.objectRotations.push_back(transform.rotationDegrees);
+		content.objectPositions.push_back(transform.positionXYZ);
+		content.objectColors.push_back(item.color);
+		content.objectUVScales.push_back(item.uvScale);
+	}
+
+	if (!SceneFile::Write(filename, content))
+	{
+		std::cout << "Could not write scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetObjectTransform()
+ *
+ *  This method is used for moving a scene object.  Only the
+ *  authored values are stored here; the object is flagged so
+ *  its matrices are rebuilt once before the next pass.
+ ***********************************************************/
+void SceneManager::SetObjectTransform(
+	int objectIndex,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	if ((objectIndex < 0) || (objectIndex >= (int)m_objectTransforms.size()))
+	{
+		return;
+	}
+
+	OBJECT_TRANSFORM& transform = m_objectTransforms[objectIndex];
+	if (m_bScenePrepared)
+	{
+		// setting the same pose again changes nothing
+		glm::vec3 rotationDegrees(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+		float change = glm::max(
+			glm::max(
+				glm::length(scaleXYZ - transform.scaleXYZ),
+				glm::length(rotationDegrees - transform.rotationDegrees)),
+			glm::length(positionXYZ - transform.positionXYZ));
+		if (change <= g_ShadowCacheTolerance)
+		{
+			return;
+		}
+
+		// a caster that moves leaves the cached static shadow layer
+		DRAW_ITEM& item = m_drawItems[objectIndex];
+		if (item.flags & DRAW_CASTS_SHADOW)
+		{
+			if ((item.flags & DRAW_DYNAMIC) == 0)
+			{
+				item.flags |= DRAW_DYNAMIC;
+				m_dynamicCasterCount++;
+				m_bStaticShadowDirty = true;
+			}
+			m_bDynamicShadowDirty = true;
+		}
+	}
+
+	transform.scaleXYZ = scaleXYZ;
+	transform.rotationDegrees = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	transform.positionXYZ = positionXYZ;
+	if (!transform.bDirty)
+	{
+		transform.bDirty = true;
+		m_dirtyTransforms++;
+	}
+}
+
+/***********************************************************
+ *  UpdateDirtyTransforms()
+ *
+ *  This method is used for rebuilding the world matrix and
+ *  the inverse-transpose normal matrix of every object that
+ *  moved since the last update.  Static objects cost nothing.
+ *  Every object only touches its own item, so large lists
+ *  are split over the job system.
+ ***********************************************************/
+void SceneManager::UpdateDirtyTransforms()
+{
+	if (m_dirtyTransforms == 0)
+	{
+		return;
+	}
+
+	m_pJobs->ParallelFor(m_objectTransforms.size(), g_MinItemsPerJob,
+		[this](size_t, size_t begin, size_t end)
+	{
+		for (size_t index = begin; index < end; index++)
+		{
+			OBJECT_TRANSFORM& transform = m_objectTransforms[index];
+			if (!transform.bDirty)
+				continue;
+
+			DRAW_ITEM& item = m_drawItems[index];
+			item.model = BuildModelMatrix(
+				transform.scaleXYZ,
+				transform.rotationDegrees.x,
+				transform.rotationDegrees.y,
+				transform.rotationDegrees.z,
+				transform.positionXYZ);
+			item.normalMatrix = glm::transpose(glm::inverse(glm::mat3(item.model)));
+
+			glm::vec3 localMin;
+			glm::vec3 localMax;
+			GetMeshLocalBounds(item.meshID, localMin, localMax);
+			item.bounds = BOUNDING_VOLUME::FromLocalBox(localMin, localMax, item.model);
+			transform.bDirty = false;
+		}
+	});
+	m_dirtyTransforms = 0;
+	m_bCullRecordsDirty = true;
+}
+
+/***********************************************************
+ *  BuildRenderQueue()
+ *
+ *  This method is used for queueing the draw list in sorted
+ *  order for one pass.  The lit pass groups opaque items by
+ *  state and draws translucent items last, far to near; the
+ *  shadow pass only queues the shadow casters of one layer,
+ *  near to far.
+ *
+ *  The items are cut into chunks that are culled, keyed and
+ *  sorted on the job system.  Each chunk writes its commands
+ *  into its own part of one frame arena array, and the
+ *  sorted parts are merged into the queue, which is then the
+ *  same as one sort of the whole list.
+ *
+ *  Each command also gets the level of detail the view picks
+ *  for its item, which is part of its mesh key, so runs of
+ *  one level stay adjacent.
+ ***********************************************************/
+int SceneManager::BuildRenderQueue(
+	RenderQueue& queue,
+	const InstancedMeshes::LOD_VIEW& lodView,
+	const Frustum& frustum,
+	bool bShadowPass,
+	SHADOW_LAYER shadowLayer)
+{
+	// items culled on the GPU in this pass are drawn from there
+	uint32_t gpuPassBit = 0;
+	if (m_bGpuCullingReady)
+	{
+		gpuPassBit = 1u << GetCullPass(bShadowPass, shadowLayer);
+	}
+
+	// a chunk keeps at most one command per item of its range
+	size_t chunkCount = m_pJobs->GetChunkCount(m_drawItems.size(), g_MinItemsPerJob);
+	RenderQueue::RENDER_COMMAND* pCommands =
+		m_frameArena.AllocateArray<RenderQueue::RENDER_COMMAND>(m_drawItems.size());
+	RenderQueue::COMMAND_RUN* pRuns = m_frameArena.AllocateArray<RenderQueue::COMMAND_RUN>(chunkCount);
+	int* pRunCulled = m_frameArena.AllocateArray<int>(chunkCount);
+
+	m_pJobs->ParallelFor(m_drawItems.size(), g_MinItemsPerJob,
+		[&](size_t chunk, size_t begin, size_t end)
+	{
+		RenderQueue::RENDER_COMMAND* pRun = pCommands + begin;
+		size_t runLength = 0;
+		int culled = 0;
+		for (size_t index = begin; index < end; index++)
+		{
+			const DRAW_ITEM& item = m_drawItems[index];
+
+			if (item.gpuCullPasses & gpuPassBit)
+				continue;
+			if (bShadowPass && ((item.flags & DRAW_CASTS_SHADOW) == 0))
+				continue;
+			if ((shadowLayer == SHADOW_LAYER_STATIC) && (item.flags & DRAW_DYNAMIC))
+				continue;
+			if ((shadowLayer == SHADOW_LAYER_DYNAMIC) && ((item.flags & DRAW_DYNAMIC) == 0))
+				continue;
+
+			if (!frustum.IsVisible(item.bounds))
+			{
+				culled++;
+				continue;
+			}
+
+			float viewDepth = glm::length(glm::vec3(item.model[3]) - lodView.viewPosition);
+
+			RenderQueue::RENDER_COMMAND command;
+			command.itemIndex = (int)index;
+			command.lod = InstancedMeshes::SelectLod(
+				GetInstancedMesh(item.meshID),
+				GetLodRadius(item),
+				item.bounds.sphereCenter,
+				lodView);
+			int meshHandle = item.meshID * InstancedMeshes::LOD_COUNT + command.lod;
+			if (bShadowPass)
+			{
+				// the depth program ignores textures and materials
+				command.sortKey = queue.MakeKey(
+					RenderQueue::PASS_OPAQUE,
+					g_DepthProgramHandle,
+					-1,
+					-1,
+					meshHandle,
+					viewDepth);
+			}
+			else
+			{
+				RenderQueue::RENDER_PASS pass = RenderQueue::PASS_OPAQUE;
+				if (item.flags & DRAW_TRANSLUCENT)
+				{
+					pass = RenderQueue::PASS_TRANSLUCENT;
+				}
+
+				int textureHandle = -1;
+				if (item.flags & DRAW_TEXTURED)
+				{
+					textureHandle = item.textureHandle;
+				}
+
+				// items of one permutation share a program, so they are
+				// grouped ahead of textures and materials
+				command.sortKey = queue.MakeKey(
+					pass,
+					g_LitProgramHandle + (int)GetItemFeatures(item),
+					textureHandle,
+					item.materialIndex,
+					meshHandle,
+					viewDepth);
+			}
+			pRun[runLength++] = command;
+		}
+		RenderQueue::SortCommands(pRun, runLength);
+		pRuns[chunk].pCommands = pRun;
+		pRuns[chunk].count = runLength;
+		pRunCulled[chunk] = culled;
+	});
+
+	queue.MergeSorted(pRuns, chunkCount);
+
+	int culled = 0;
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		culled += pRunCulled[chunk];
+	}
+
+	return(culled);
+}
+
+/***********************************************************
+ *  GetLodRadius()
+ *
+ *  This method is used for getting the radius of an item
+ *  about the axis of its mesh, the larger of its X and Z
+ *  scales, which the chord error of the slices grows with.
+ *  The plane and the liquid grid have no slices, and the
+ *  grid picks its own detail when it is drawn.
+ ***********************************************************/
+float SceneManager::GetLodRadius(const DRAW_ITEM& item)
+{
+	if ((item.meshID != MESH_CYLINDER) && (item.meshID != MESH_TAPERED_CYLINDER))
+	{
+		return(0.0f);
+	}
+
+	return(glm::max(glm::length(glm::vec3(item.model[0])), glm::length(glm::vec3(item.model[2]))));
+}
+
+/***********************************************************
+ *  MakeLodView()
+ *
+ *  This method is used for describing a projection for the
+ *  level of detail selection.  A perspective projection has
+ *  0 in its last element and covers 2 / projection[1][1]
+ *  units of height at distance 1; an orthographic one
+ *  covers 2 / projection[1][1] units at every distance.
+ ***********************************************************/
+InstancedMeshes::LOD_VIEW SceneManager::MakeLodView(
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition,
+	int viewportHeight,
+	float maxErrorPixels)
+{
+	InstancedMeshes::LOD_VIEW view;
+	view.viewPosition = viewPosition;
+	view.pixelsPerUnit = 0.5f * (float)viewportHeight * projection[1][1];
+	view.bPerspective = (projection[3][3] == 0.0f);
+	view.maxErrorPixels = maxErrorPixels;
+
+	return(view);
+}
+
+/***********************************************************
+ *  GetMeshLocalBounds()
+ *
+ *  This method is used for getting the box that encloses a
+ *  basic mesh before the object transform: the plane spans
+ *  2 x 2 units in XZ, the cylinders have radius 1 and stand
+ *  1 unit tall on the XZ plane.
+ ***********************************************************/
+void SceneManager::GetMeshLocalBounds(int meshID, glm::vec3& localMin, glm::vec3& localMax)
+{
+	switch (meshID)
+	{
+	case MESH_PLANE:
+		localMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		localMax = glm::vec3(1.0f, 0.0f, 1.0f);
+		break;
+	case MESH_CYLINDER:
+	case MESH_TAPERED_CYLINDER:
+	case MESH_LIQUID_SURFACE:
+	default:
+		localMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		localMax = glm::vec3(1.0f, 1.0f, 1.0f);
+		break;
+	}
+}
+
+/***********************************************************
+ *  GetCullStats()
+ *
+ *  This method is used for reading how many objects the last
+ *  lit pass and shadow pass drew and culled.
+ ***********************************************************/
+const SceneManager::CULL_STATS& SceneManager::GetCullStats() const
+{
+	return(m_cullStats);
+}
+
+/***********************************************************
+ *  SetProfiler()
+ *
+ *  This method is used for attaching the profiler that the
+ *  lit and shadow passes report their counters to.
+ ***********************************************************/
+void SceneManager::SetProfiler(FrameProfiler* pProfiler)
+{
+	m_pProfiler = pProfiler;
+	// the GPU culled counts are only read back for a profiler
+	m_pGpuCulling->SetCollectStats(pProfiler != NULL);
+}
+
+/***********************************************************
+ *  SetOcclusionCulling()
+ *
+ *  This method is used for turning the occlusion test of
+ *  the lit pass on or off.  It only takes effect when the
+ *  items are culled on the GPU.
+ ***********************************************************/
+void SceneManager::SetOcclusionCulling(bool bEnable)
+{
+	m_bOcclusionCulling = bEnable;
+	m_pGpuCulling->InvalidateDepthPyramid();
+}
+
+/***********************************************************
+ *  SetDepthPrepass()
+ *
+ *  This method is used for turning the depth pre-pass of
+ *  the lit pass on or off.  The opaque items are drawn with
+ *  the depth-only programs first, and then shaded with an
+ *  equal depth test, so each pixel runs the lighting once.
+ ***********************************************************/
+void SceneManager::SetDepthPrepass(bool bEnable)
+{
+	m_bDepthPrepass = bEnable;
+}
+
+/***********************************************************
+ *  SetLodError()
+ *
+ *  This method is used for setting how many pixels the
+ *  silhouette of a coarser level of detail may fall inside
+ *  the full one.  Both passes pick the level per object and
+ *  frame, so the change shows from the next frame on.
+ ***********************************************************/
+void SceneManager::SetLodError(float pixels)
+{
+	m_lodErrorPixels = glm::max(pixels, 0.0f);
+	m_bStaticShadowDirty = true;
+}
+
+/***********************************************************
+ *  SetShadowLodBias()
+ *
+ *  This method is used for setting the factor of the level
+ *  of detail error the shadow pass accepts.  The filtered
+ *  shadow edges hide more than the lit silhouettes do, so
+ *  casters can drop to coarser levels sooner.
+ ***********************************************************/
+void SceneManager::SetShadowLodBias(float bias)
+{
+	m_shadowLodBias = glm::max(bias, 1.0f);
+	m_bStaticShadowDirty = true;
+}
+
+/***********************************************************
+ *  SetShadowFilter()
+ *
+ *  This method is used for choosing the filter of the
+ *  spotlight shadow.  The filter is compiled into the lit
+ *  programs, which PrepareScene() builds with it.
+ ***********************************************************/
+void SceneManager::SetShadowFilter(SHADOW_FILTER filter)
+{
+	m_shadowFilter = filter;
+}
+
+/***********************************************************
+ *  SetFrameBudget()
+ *
+ *  This method is used for setting the time in milliseconds
+ *  the shadow and lit passes keep to.  The resolution scale
+ *  is lowered first, and the shadow quality once the scale
+ *  is at its lowest.
+ ***********************************************************/
+void SceneManager::SetFrameBudget(float milliseconds)
+{
+	m_pDynamicResolution->SetFrameBudget(milliseconds);
+}
+
+/***********************************************************
+ *  SetQualityTier()
+ *
+ *  This method is used for setting the highest shadow
+ *  quality, which the frame budget may lower and raise back.
+ ***********************************************************/
+void SceneManager::SetQualityTier(DynamicResolution::QUALITY_TIER tier)
+{
+	m_pDynamicResolution->SetQualityTier(tier);
+}
+
+/***********************************************************
+ *  GetLitShaderDefines()
+ *
+ *  This method is used for listing the definitions that the
+ *  lit programs are compiled with.
+ ***********************************************************/
+ShaderCompiler::DEFINES SceneManager::GetLitShaderDefines() const
+{
+	ShaderCompiler::DEFINES defines;
+	defines.push_back("SHADOW_FILTER " + std::to_string((int)m_shadowFilter));
+	if (m_bClusteredLightsReady)
+	{
+		defines.push_back("CLUSTERED_LIGHTS 1");
+	}
+
+	return(defines);
+}
+
+/***********************************************************
+ *  GetPermutationDefines()
+ *
+ *  This method is used for listing the definitions shared by
+ *  every lit permutation.  When the active point lights come
+ *  first in the lights block, their number is compiled in,
+ *  so the shader loops over them only and skips the checks.
+ ***********************************************************/
+ShaderCompiler::DEFINES SceneManager::GetPermutationDefines() const
+{
+	ShaderCompiler::DEFINES defines = GetLitShaderDefines();
+	if (m_pUniformBuffers == NULL)
+	{
+		return(defines);
+	}
+
+	const UniformBufferManager::LIGHTS_BLOCK& lights = m_pUniformBuffers->GetLights();
+	int activeLights = 0;
+	bool bPacked = true;
+	for (int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+	{
+		if (lights.pointLights[i].bActive)
+		{
+			bPacked = bPacked && (activeLights == i);
+			activeLights++;
+		}
+	}
+	if (bPacked)
+	{
+		defines.push_back("NUM_POINT_LIGHTS " + std::to_string(activeLights));
+	}
+
+	return(defines);
+}
+
+/***********************************************************
+ *  GetItemFeatures()
+ *
+ *  This method is used for mapping the draw flags of an
+ *  item to the features of its lit permutation.
+ ***********************************************************/
+uint32_t SceneManager::GetItemFeatures(const DRAW_ITEM& item)
+{
+	uint32_t features = 0;
+	if (item.flags & DRAW_TEXTURED)
+		features |= ShaderPermutations::FEATURE_TEXTURED;
+	if (item.flags & DRAW_LIT)
+		features |= ShaderPermutations::FEATURE_LIT;
+	if (item.flags & DRAW_LIQUID)
+		features |= ShaderPermutations::FEATURE_LIQUID;
+
+	return(features);
+}
+
+/***********************************************************
+ *  PrebuildPermutations()
+ *
+ *  This method is used for building the lit permutations
+ *  of every item in the draw list before the first frame.
+ *  They are started together, so a driver that compiles on
+ *  several threads builds them at once, and the first frame
+ *  does not wait on compiles one draw at a time.
+ ***********************************************************/
+void SceneManager::PrebuildPermutations()
+{
+	std::vector<uint32_t> features;
+	for (size_t i = 0; i < m_drawItems.size(); i++)
+	{
+		uint32_t itemFeatures = GetItemFeatures(m_drawItems[i]);
+		if (std::find(features.begin(), features.end(), itemFeatures) == features.end())
+		{
+			features.push_back(itemFeatures);
+		}
+	}
+
+	m_litPermutations.Prebuild(features);
+	if (m_bInstancingReady)
+	{
+		m_instancedPermutations.Prebuild(features);
+	}
+}
+
+/***********************************************************
+ *  UseLitProgram()
+ *
+ *  This method is used for making the lit permutation of an
+ *  item current, building it on first use.  The default lit
+ *  program stands in when the permutation did not build.
+ ***********************************************************/
+ShaderUniformCache& SceneManager::UseLitProgram(const DRAW_ITEM& item, bool bInstanced)
+{
+	m_pInstancedMeshes->SetVertexStreams(InstancedMeshes::STREAMS_ALL);
+
+	ShaderPermutations& permutations = bInstanced ? m_instancedPermutations : m_litPermutations;
+	ShaderPermutations::PROGRAM* pProgram = permutations.GetProgram(GetItemFeatures(item));
+	if (NULL == pProgram)
+	{
+		if (bInstanced)
+		{
+			m_glState.UseProgram(m_pInstancedShaderManager);
+			return(m_instancedUniforms);
+		}
+		m_glState.UseProgram(m_pShaderManager);
+		return(m_uniforms);
+	}
+
+	// resolving the uniforms left the new program current
+	if (!pProgram->bPrepared)
+	{
+		pProgram->bPrepared = true;
+		m_glState.InvalidateProgram();
+		if (m_pUniformBuffers != NULL)
+		{
+			m_pUniformBuffers->BindShaderBlocks(pProgram->pShaderManager);
+		}
+		if (m_bClusteredLightsReady)
+		{
+			ClusteredLights::BindShaderBlocks(pProgram->pShaderManager);
+		}
+		m_glState.UseProgram(pProgram->pShaderManager);
+		SetLitProgramDefaults(pProgram->uniforms, bInstanced);
+	}
+
+	m_glState.UseProgram(pProgram->pShaderManager);
+	return(pProgram->uniforms);
+}
+
+/***********************************************************
+ *  SetLitProgramDefaults()
+ *
+ *  This method is used for setting the texture units, the
+ *  ripple and the default material of a lit program.  The
+ *  per-instance attributes supply the color and UV scale of
+ *  instanced programs, so their uniforms stay neutral.  The
+ *  program must be current.
+ ***********************************************************/
+void SceneManager::SetLitProgramDefaults(ShaderUniformCache& uniforms, bool bInstanced)
+{
+	uniforms.SetInt(U::U_USE_LIGHTING, true);
+	uniforms.SetInt(U::U_OBJECT_TEXTURE, g_ObjectTextureUnit);
+	uniforms.SetInt(U::U_OBJECT_TEXTURE_ARRAY, g_TextureArrayUnit);
+	uniforms.SetInt(U::U_SHADOW_ATLAS, g_ShadowTextureUnit);
+	uniforms.SetVec2(U::U_RIPPLE_PARAMS, glm::vec2(1.5f, 22.0f));
+	uniforms.SetVec3(U::U_MATERIAL_DIFFUSE, glm::vec3(1.0f, 1.0f, 1.0f));
+	uniforms.SetVec3(U::U_MATERIAL_SPECULAR, glm::vec3(0.5f, 0.5f, 0.5f));
+	uniforms.SetFloat(U::U_MATERIAL_SHININESS, 32.0f);
+	if (bInstanced)
+	{
+		uniforms.SetVec4(U::U_OBJECT_COLOR, glm::vec4(1.0f));
+		uniforms.SetVec2(U::U_UV_SCALE, glm::vec2(1.0f));
+	}
+}
+
+/***********************************************************
+ *  SetSceneCopies()
+ *
+ *  This method is used for scaling the scene to a number of
+ *  copies of the scene file on a square grid, so the cost
+ *  of submission can be measured against the object count.
+ ***********************************************************/
+void SceneManager::SetSceneCopies(int copies)
+{
+	m_sceneCopies = (copies < 1) ? 1 : copies;
+}
+
+/***********************************************************
+ *  AddPointLight()
+ *
+ *  This method is used for adding a point light that fades
+ *  out at a range.  Any number of them can be added; each
+ *  fragment is lit only by those whose range reaches it.
+ *  A light that casts shadows draws its six cube faces into
+ *  the shadow atlas, at a size that follows how close it is
+ *  to the camera.
+ ***********************************************************/
+int SceneManager::AddPointLight(const glm::vec3& position, const glm::vec3& color, float range, bool bCastsShadow)
+{
+	ClusteredLights::POINT_LIGHT light;
+	light.positionRange = glm::vec4(position, std::max(range, 0.01f));
+	light.diffuse = glm::vec4(color, 0.0f);
+	light.specular = glm::vec4(color * g_ScatterSpecular, 0.0f);
+
+	int index = m_pClusteredLights->AddLight(light);
+	if (bCastsShadow)
+	{
+		m_shadowedPointLights.push_back(index);
+	}
+
+	return(index);
+}
+
+/***********************************************************
+ *  ClearPointLights()
+ *
+ *  This method is used for removing every point light added
+ *  through AddPointLight().
+ ***********************************************************/
+void SceneManager::ClearPointLights()
+{
+	m_pClusteredLights->ClearLights();
+	m_shadowedPointLights.clear();
+}
+
+/***********************************************************
+ *  ScatterPointLights()
+ *
+ *  This method is used for spreading point lights evenly
+ *  over the bounds of the loaded scene, along a Halton
+ *  sequence.  Their range shrinks as their number grows, so
+ *  about as many lights reach every point at any count.  The
+ *  first shadowCount of them cast shadows.
+ ***********************************************************/
+void SceneManager::ScatterPointLights(int count, int shadowCount)
+{
+	glm::vec3 boxMin;
+	glm::vec3 boxMax;
+	if ((count <= 0) || !GetSceneBounds(boxMin, boxMax))
+	{
+		return;
+	}
+
+	glm::vec3 extent = boxMax - boxMin;
+	float spacing = std::sqrt(std::max(extent.x * extent.z, 1.0f) / (float)count);
+	float range = glm::clamp(3.0f * spacing, 0.5f, 8.0f);
+
+	const int colorCount = (int)(sizeof(g_ScatterColors) / sizeof(g_ScatterColors[0]));
+	for (int i = 0; i < count; i++)
+	{
+		glm::vec3 position(
+			boxMin.x + extent.x * GetHalton((uint32_t)i + 1, 2),
+			boxMin.y + extent.y * (0.25f + 0.75f * GetHalton((uint32_t)i + 1, 5)),
+			boxMin.z + extent.z * GetHalton((uint32_t)i + 1, 3));
+		AddPointLight(position, g_ScatterColors[i % colorCount], range, i < shadowCount);
+	}
+}
+
+/***********************************************************
+ *  GetSceneBounds()
+ *
+ *  This method is used for finding the box around the
+ *  bounds of every draw item of the loaded scene.
+ ***********************************************************/
+bool SceneManager::GetSceneBounds(glm::vec3& boxMin, glm::vec3& boxMax) const
+{
+	if (m_drawItems.empty())
+	{
+		return(false);
+	}
+
+	boxMin = m_drawItems[0].bounds.boxMin;
+	boxMax = m_drawItems[0].bounds.boxMax;
+	for (size_t i = 1; i < m_drawItems.size(); i++)
+	{
+		boxMin = glm::min(boxMin, m_drawItems[i].bounds.boxMin);
+		boxMax = glm::max(boxMax, m_drawItems[i].bounds.boxMax);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetSceneRadius()
+ *
+ *  This method is used for reading how far the outermost
+ *  copy of the scene is from the center of the grid.
+ ***********************************************************/
+float SceneManager::GetSceneRadius() const
+{
+	return(m_sceneRadius);
+}
+
+/***********************************************************
+ *  ResetPassCounters()
+ *
+ *  This method is used for restarting the draw, triangle,
+ *  uniform and texture bind counters before a pass.
+ ***********************************************************/
+void SceneManager::ResetPassCounters()
+{
+	m_passCounters = FrameProfiler::PASS_COUNTERS();
+	m_passAllocationStart = AllocationCounter::GetCount();
+	m_uniforms.ResetUploadCount();
+	m_litPermutations.ResetUploadCount();
+	m_instancedPermutations.ResetUploadCount();
+	m_depthUniforms.ResetUploadCount();
+	m_instancedUniforms.ResetUploadCount();
+	m_instancedDepthUniforms.ResetUploadCount();
+	m_glState.ResetChangeCount();
+	m_pInstancedMeshes->ResetDrawCallCount();
+}
+
+/***********************************************************
+ *  ReportPassCounters()
+ *
+ *  This method is used for adding up the counters of the
+ *  pass just rendered and handing them to the profiler.
+ ***********************************************************/
+void SceneManager::ReportPassCounters(
+	FrameProfiler::PROFILE_PASS pass,
+	int objectsDrawn,
+	int objectsCulled)
+{
+	if (NULL == m_pProfiler)
+	{
+		return;
+	}
+
+	FrameProfiler::PASS_COUNTERS counters = m_passCounters;
+	counters.drawCalls += m_pInstancedMeshes->GetDrawCallCount();
+	counters.triangles += m_pInstancedMeshes->GetTriangleCount();
+	counters.uniformUploads =
+		m_uniforms.GetUploadCount() +
+		m_litPermutations.GetUploadCount() +
+		m_instancedPermutations.GetUploadCount() +
+		m_depthUniforms.GetUploadCount() +
+		m_instancedUniforms.GetUploadCount() +
+		m_instancedDepthUniforms.GetUploadCount();
+	counters.textureBinds = m_glState.GetTextureBindCount();
+	counters.objectsDrawn = objectsDrawn;
+	counters.objectsCulled = objectsCulled;
+	counters.allocations = (unsigned int)(AllocationCounter::GetCount() - m_passAllocationStart);
+
+	m_pProfiler->SetPassCounters(pass, counters);
+}
+
+/***********************************************************
+ *  PrepareInstancing()
+ *
+ *  This method is used for loading the instanced lit and
+ *  depth programs and the instanced copies of the meshes.
+ *  Runs of identical items are only batched when both
+ *  programs loaded; otherwise every item is drawn singly.
+ ***********************************************************/
+void SceneManager::PrepareInstancing()
+{
+	if (m_pInstancedShaderManager != NULL)
+	{
+		return;
+	}
+
+	m_pInstancedShaderManager = ShaderCompiler::CreateShaderManager(&m_persistentArena);
+	ShaderCompiler::LoadProgram(
+		m_pInstancedShaderManager,
+		"shaders/instancedVertexShader.glsl",
+		"shaders/fragmentShader.glsl",
+		GetLitShaderDefines());
+	m_pInstancedDepthShaderManager = ShaderCompiler::CreateShaderManager(&m_persistentArena);
+	ShaderCompiler::LoadProgram(
+		m_pInstancedDepthShaderManager,
+		"shaders/instancedVertexShader.glsl",
+		"shaders/shadowDepthFragment.glsl",
+		ShaderCompiler::DEFINES());
+
+	if (m_pUniformBuffers != NULL)
+	{
+		m_pUniformBuffers->BindShaderBlocks(m_pInstancedShaderManager);
+		m_pUniformBuffers->BindShaderBlocks(m_pInstancedDepthShaderManager);
+	}
+	if (m_bClusteredLightsReady)
+	{
+		ClusteredLights::BindShaderBlocks(m_pInstancedShaderManager);
+	}
+
+	bool bLitReady = m_instancedUniforms.Resolve(m_pInstancedShaderManager);
+	if (bLitReady)
+	{
+		SetLitProgramDefaults(m_instancedUniforms, true);
+	}
+
+	bool bDepthReady = m_instancedDepthUniforms.Resolve(m_pInstancedDepthShaderManager);
+	if (bDepthReady)
+	{
+		m_instancedDepthUniforms.SetInt(U::U_DEPTH_ONLY, true);
+	}
+
+	m_pInstancedMeshes->LoadMeshes();
+	m_bInstancingReady = bLitReady && bDepthReady;
+	m_bIndirectReady = m_bInstancingReady && InstancedMeshes::IsIndirectSupported();
+
+	// culling on the GPU needs the indirect draws as well
+	if (m_bIndirectReady && GpuCulling::IsSupported())
+	{
+		m_bGpuCullingReady = m_pGpuCulling->Create();
+		// the compute programs were made current behind the cache
+		m_glState.InvalidateProgram();
+	}
+}
+
+/***********************************************************
+ *  CanInstanceTogether()
+ *
+ *  This method is used for checking whether an item can be
+ *  drawn in the same instanced draw as the first item of a
+ *  run.  Only the transform, color and UV scale may differ,
+ *  as those are per-instance values; the shadow pass only
+ *  needs the same mesh parts.  A lit liquid surface is never
+ *  instanced, as its radial grid is not an instanced mesh.
+ ***********************************************************/
+bool SceneManager::CanInstanceTogether(
+	const DRAW_ITEM& first,
+	const DRAW_ITEM& other,
+	bool bShadowPass)
+{
+	const uint32_t meshParts = DRAW_TOP | DRAW_BOTTOM | DRAW_SIDES;
+
+	if (first.meshID != other.meshID)
+		return(false);
+	if (bShadowPass)
+		return((first.flags & meshParts) == (other.flags & meshParts));
+
+	if (first.meshID == MESH_LIQUID_SURFACE)
+		return(false);
+	if (first.flags != other.flags)
+		return(false);
+	if (first.materialIndex != other.materialIndex)
+		return(false);
+	if ((first.flags & DRAW_TEXTURED) && (first.textureHandle != other.textureHandle))
+		return(false);
+
+	// blending order matters, so translucent items are never merged
+	return((first.flags & DRAW_TRANSLUCENT) == 0);
+}
+
+/***********************************************************
+ *  FindInstanceRun()
+ *
+ *  This method is used for counting the queued commands from
+ *  a start index that can share one instanced draw.  The
+ *  queue sorts by state first, so such items are adjacent;
+ *  they must also be at the same level of detail.
+ ***********************************************************/
+size_t SceneManager::FindInstanceRun(
+	const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+	size_t start,
+	bool bShadowPass)
+{
+	if (!m_bInstancingReady)
+	{
+		return(1);
+	}
+
+	const DRAW_ITEM& first = m_drawItems[commands[start].itemIndex];
+	size_t end = start + 1;
+	while ((end < commands.size()) &&
+		(commands[end].lod == commands[start].lod) &&
+		CanInstanceTogether(first, m_drawItems[commands[end].itemIndex], bShadowPass))
+	{
+		end++;
+	}
+
+	return(end - start);
+}
+
+/***********************************************************
+ *  DrawInstancedRun()
+ *
+ *  This method is used for gathering the per-instance values
+ *  of a run of queued commands and drawing them all with a
+ *  single instanced draw.  The matching instanced program
+ *  must be current.
+ ***********************************************************/
+void SceneManager::DrawInstancedRun(
+	const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+	size_t start,
+	size_t count)
+{
+	InstancedMeshes::INSTANCE_DATA* pInstances =
+		m_frameArena.AllocateArray<InstancedMeshes::INSTANCE_DATA>(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const DRAW_ITEM& item = m_drawItems[commands[start + i].itemIndex];
+		InstancedMeshes::INSTANCE_DATA& instance = pInstances[i];
+
+		instance.model = item.model;
+		instance.normalMatrix[0] = glm::vec4(item.normalMatrix[0], 0.0f);
+		instance.normalMatrix[1] = glm::vec4(item.normalMatrix[1], 0.0f);
+		instance.normalMatrix[2] = glm::vec4(item.normalMatrix[2], 0.0f);
+		instance.color = item.color;
+		instance.uvScale = item.uvScale;
+	}
+
+	InstancedMeshes::INSTANCED_MESH mesh = GetInstancedMesh(m_drawItems[commands[start].itemIndex].meshID);
+	uint32_t flags = m_drawItems[commands[start].itemIndex].flags;
+	m_pInstancedMeshes->DrawInstanced(
+		mesh,
+		commands[start].lod,
+		(flags & DRAW_TOP) != 0,
+		(flags & DRAW_BOTTOM) != 0,
+		(flags & DRAW_SIDES) != 0,
+		pInstances,
+		(int)count);
+}
+
+/***********************************************************
+ *  GetInstancedMesh()
+ *
+ *  This method is used for mapping a basic mesh to its
+ *  instanced copy.  A liquid surface only gets here in the
+ *  shadow pass, which draws it as the flat top cap.
+ ***********************************************************/
+InstancedMeshes::INSTANCED_MESH SceneManager::GetInstancedMesh(int meshID)
+{
+	switch (meshID)
+	{
+	case MESH_CYLINDER:
+	case MESH_LIQUID_SURFACE:
+		return(InstancedMeshes::INSTANCED_CYLINDER);
+	case MESH_TAPERED_CYLINDER:
+		return(InstancedMeshes::INSTANCED_TAPERED_CYLINDER);
+	default:
+		return(InstancedMeshes::INSTANCED_PLANE);
+	}
+}
+
+/***********************************************************
+ *  CanDrawIndirect()
+ *
+ *  This method is used for checking whether a whole queue
+ *  can be drawn by indirect draws.  The shadow pass only
+ *  needs the meshes; in the lit pass every item must have a
+ *  material table entry, and every texture must be a layer
+ *  of the texture array, so no uniform or texture changes
+ *  between items.  Liquid surfaces are left out of the check,
+ *  as DrawIndirectSpans() draws them on their own.  Otherwise,
+ *  e.g. while textures are still loading, the queue is drawn
+ *  run by run.
+ ***********************************************************/
+bool SceneManager::CanDrawIndirect(
+	const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+	bool bShadowPass) const
+{
+	if (!m_bIndirectReady || commands.empty())
+		return(false);
+	if (bShadowPass)
+		return(true);
+
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const DRAW_ITEM& item = m_drawItems[commands[i].itemIndex];
+		if (!IsIndirectItem(item) && (item.meshID != MESH_LIQUID_SURFACE))
+			return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsIndirectItem()
+ *
+ *  This method is used for checking whether an item can be
+ *  lit from its instance alone: it needs a material table
+ *  entry, and its texture, if any, must be a layer of the
+ *  texture array.  A liquid surface never is, as it is drawn
+ *  as its radial grid.
+ ***********************************************************/
+bool SceneManager::IsIndirectItem(const DRAW_ITEM& item) const
+{
+	if (item.meshID == MESH_LIQUID_SURFACE)
+		return(false);
+	if (item.materialSlot < 0)
+		return(false);
+	if ((item.flags & DRAW_TEXTURED) && (m_textures[item.textureHandle].layer < 0))
+		return(false);
+
+	return(true);
+}
+
+/***********************************************************
+ *  FillIndirectInstance()
+ *
+ *  This method is used for packing the transform, color, UV
+ *  scale, material table entry and shading flags of an item
+ *  into one instance.
+ ***********************************************************/
+void SceneManager::FillIndirectInstance(const DRAW_ITEM& item, InstancedMeshes::INSTANCE_DATA& instance)
+{
+	instance.model = item.model;
+	instance.normalMatrix[0] = glm::vec4(item.normalMatrix[0], 0.0f);
+	instance.normalMatrix[1] = glm::vec4(item.normalMatrix[1], 0.0f);
+	instance.normalMatrix[2] = glm::vec4(item.normalMatrix[2], 0.0f);
+	instance.color = item.color;
+	instance.uvScale = item.uvScale;
+	instance.materialSlot = item.materialSlot;
+	instance.drawFlags = 0;
+	if (item.flags & DRAW_TEXTURED)
+		instance.drawFlags |= InstancedMeshes::INSTANCE_TEXTURED;
+	if (item.flags & DRAW_LIT)
+		instance.drawFlags |= InstancedMeshes::INSTANCE_LIT;
+	if (item.flags & DRAW_LIQUID)
+		instance.drawFlags |= InstancedMeshes::INSTANCE_LIQUID;
+}
+
+/***********************************************************
+ *  UseIndirectProgram()
+ *
+ *  This method is used for making the instanced lit program
+ *  current with every per-draw toggle off, so the material
+ *  and flags of each instance decide how it is shaded.
+ ***********************************************************/
+void SceneManager::UseIndirectProgram()
+{
+	m_pInstancedMeshes->SetVertexStreams(InstancedMeshes::STREAMS_ALL);
+	m_glState.UseProgram(m_pInstancedShaderManager);
+	m_instancedUniforms.SetInt(U::U_USE_LIGHTING, false);
+	m_instancedUniforms.SetInt(U::U_USE_TEXTURE, false);
+	m_instancedUniforms.SetInt(U::U_IS_LIQUID_SURFACE, false);
+	m_instancedUniforms.SetInt(U::U_MATERIAL_INDEX, -1);
+}
+
+/***********************************************************
+ *  DrawIndirect()
+ *
+ *  This method is used for drawing a range of queued
+ *  commands with a single multi-draw-indirect call.  Every
+ *  item becomes one instance carrying its material table
+ *  entry and shading flags, and neighbouring items of the
+ *  same mesh, level of detail and parts share one indirect
+ *  command, so the queue order, and with it the blending
+ *  order, is kept.
+ ***********************************************************/
+void SceneManager::DrawIndirect(
+	const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+	size_t start,
+	size_t end)
+{
+	const uint32_t meshParts = DRAW_TOP | DRAW_BOTTOM | DRAW_SIDES;
+
+	// the instances are packed on the job system, the draws are
+	// merged in order on this thread; both lists live in the frame
+	// arena, with room for one draw per item
+	InstancedMeshes::INSTANCE_DATA* pInstances =
+		m_frameArena.AllocateArray<InstancedMeshes::INSTANCE_DATA>(end - start);
+	InstancedMeshes::INDIRECT_DRAW* pDraws =
+		m_frameArena.AllocateArray<InstancedMeshes::INDIRECT_DRAW>(end - start);
+	int drawCount = 0;
+	m_pJobs->ParallelFor(end - start, g_MinItemsPerJob,
+		[&](size_t, size_t begin, size_t finish)
+	{
+		for (size_t i = begin; i < finish; i++)
+		{
+			FillIndirectInstance(m_drawItems[commands[start + i].itemIndex], pInstances[i]);
+		}
+	});
+
+	for (size_t i = start; i < end; i++)
+	{
+		const DRAW_ITEM& item = m_drawItems[commands[i].itemIndex];
+
+		InstancedMeshes::INSTANCED_MESH mesh = GetInstancedMesh(item.meshID);
+		bool bDrawTop = (item.flags & DRAW_TOP) != 0;
+		bool bDrawBottom = (item.flags & DRAW_BOTTOM) != 0;
+		bool bDrawSides = (item.flags & DRAW_SIDES) != 0;
+		if (drawCount > 0)
+		{
+			InstancedMeshes::INDIRECT_DRAW& last = pDraws[drawCount - 1];
+			const DRAW_ITEM& previous = m_drawItems[commands[i - 1].itemIndex];
+			if ((last.mesh == mesh) && (last.lod == commands[i].lod) &&
+				((previous.flags & meshParts) == (item.flags & meshParts)))
+			{
+				last.instanceCount++;
+				continue;
+			}
+		}
+
+		InstancedMeshes::INDIRECT_DRAW draw;
+		draw.mesh = mesh;
+		draw.lod = commands[i].lod;
+		draw.bDrawTop = bDrawTop;
+		draw.bDrawBottom = bDrawBottom;
+		draw.bDrawSides = bDrawSides;
+		draw.firstInstance = (int)(i - start);
+		draw.instanceCount = 1;
+		pDraws[drawCount++] = draw;
+	}
+
+	m_pInstancedMeshes->DrawIndirect(pDraws, drawCount, pInstances, (int)(end - start));
+}
+
+/***********************************************************
+ *  DrawIndirectSpans()
+ *
+ *  This method is used for drawing a range of queued
+ *  commands of the camera view with indirect draws, split
+ *  around the liquid surfaces.  Each of those is drawn on
+ *  its own as its displaced radial grid, and the queue order
+ *  is kept, so translucent items still blend in order.
+ ***********************************************************/
+void SceneManager::DrawIndirectSpans(
+	const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+	size_t start,
+	size_t end,
+	bool bDepth)
+{
+	size_t spanStart = start;
+	for (size_t i = start; i <= end; i++)
+	{
+		bool bLiquid = (i < end) && (m_drawItems[commands[i].itemIndex].meshID == MESH_LIQUID_SURFACE);
+		if ((i < end) && !bLiquid)
+		{
+			continue;
+		}
+
+		// the items before the liquid surface, or the range end
+		if (i > spanStart)
+		{
+			if (bDepth)
+			{
+				UseDepthProgram(true, false);
+			}
+			else
+			{
+				UseIndirectProgram();
+			}
+			DrawIndirect(commands, spanStart, i);
+		}
+
+		if (bLiquid)
+		{
+			const DRAW_ITEM& item = m_drawItems[commands[i].itemIndex];
+			if (bDepth)
+			{
+				UseDepthProgram(false, false);
+				m_depthUniforms.SetMat4(U::U_MODEL, item.model);
+			}
+			else
+			{
+				ShaderUniformCache& uniforms = UseLitProgram(item, false);
+				uniforms.SetMat4(U::U_MODEL, item.model);
+				uniforms.SetMat3(U::U_NORMAL_MATRIX, item.normalMatrix);
+				ApplyItemState(uniforms, item, false);
+			}
+			DrawMeshForItem(item, commands[i].lod);
+		}
+		spanStart = i + 1;
+	}
+}
+
+/***********************************************************
+ *  GetCullPass()
+ *
+ *  This method is used for mapping the lit pass and the
+ *  shadow layers to their GPU cull passes.
+ ***********************************************************/
+GpuCulling::CULL_PASS SceneManager::GetCullPass(bool bShadowPass, SHADOW_LAYER shadowLayer)
+{
+	if (!bShadowPass)
+		return(GpuCulling::CULL_LIT);
+
+	switch (shadowLayer)
+	{
+	case SHADOW_LAYER_STATIC:
+		return(GpuCulling::CULL_SHADOW_STATIC);
+	case SHADOW_LAYER_DYNAMIC:
+		return(GpuCulling::CULL_SHADOW_DYNAMIC);
+	default:
+		return(GpuCulling::CULL_SHADOW_ALL);
+	}
+}
+
+/***********************************************************
+ *  UpdateCullRecords()
+ *
+ *  This method is used for rebuilding the GPU object record
+ *  of every item after items moved or textures loaded.  The
+ *  items are grouped by mesh and parts, and each group gets
+ *  the indirect commands of its mesh at every level of
+ *  detail, each with room for all of its items in the
+ *  instance buffer, as the cull shader may put any item at
+ *  any level.
+ *
+ *  Every shadow caster is culled on the GPU.  The lit pass
+ *  culls the opaque items that can be lit from their
+ *  instance; translucent items stay in the render queue,
+ *  which sorts them far to near for blending.
+ ***********************************************************/
+void SceneManager::UpdateCullRecords()
+{
+	if (!m_bGpuCullingReady || !m_bCullRecordsDirty)
+	{
+		return;
+	}
+
+	const uint32_t meshParts = DRAW_TOP | DRAW_BOTTOM | DRAW_SIDES;
+	const int partCombinations = (int)meshParts + 1;
+
+	// one group per mesh and part combination in use; the tables
+	// live in the frame arena
+	const int keyCount = InstancedMeshes::INSTANCED_MESH_COUNT * partCombinations;
+	int* groupOfKey = m_frameArena.AllocateArray<int>(keyCount);
+	int* groupFirstCommand = m_frameArena.AllocateArray<int>(keyCount);
+	int* groupCommandCount = m_frameArena.AllocateArray<int>(keyCount);
+	int* groupSize = m_frameArena.AllocateArray<int>(keyCount);
+	int* itemGroup = m_frameArena.AllocateArray<int>(m_drawItems.size());
+	int groupCount = 0;
+	for (int key = 0; key < keyCount; key++)
+	{
+		groupOfKey[key] = -1;
+	}
+	m_cullCommands.clear();
+	m_bFirstCullCommand.clear();
+	for (size_t i = 0; i < m_drawItems.size(); i++)
+	{
+		const DRAW_ITEM& item = m_drawItems[i];
+		InstancedMeshes::INSTANCED_MESH mesh = GetInstancedMesh(item.meshID);
+		int key = mesh * partCombinations + (int)(item.flags & meshParts);
+		if (groupOfKey[key] < 0)
+		{
+			groupOfKey[key] = groupCount;
+			groupFirstCommand[groupCount] = (int)m_cullCommands.size();
+			groupSize[groupCount] = 0;
+			for (int lod = 0; lod < InstancedMeshes::LOD_COUNT; lod++)
+			{
+				// every level of a mesh has the same number of ranges
+				InstancedMeshes::DRAW_ELEMENTS_COMMAND commands[2];
+				int commandCount = m_pInstancedMeshes->GetDrawCommands(
+					mesh,
+					lod,
+					(item.flags & DRAW_TOP) != 0,
+					(item.flags & DRAW_BOTTOM) != 0,
+					(item.flags & DRAW_SIDES) != 0,
+					commands);
+				groupCommandCount[groupCount] = commandCount;
+				for (int c = 0; c < commandCount; c++)
+				{
+					m_cullCommands.push_back(commands[c]);
+					m_bFirstCullCommand.push_back(c == 0);
+				}
+			}
+			groupCount++;
+		}
+		itemGroup[i] = groupOfKey[key];
+		groupSize[itemGroup[i]]++;
+	}
+
+	// the instances of each level of a group follow those of the
+	// level before
+	int firstInstance = 0;
+	for (int group = 0; group < groupCount; group++)
+	{
+		for (int lod = 0; lod < InstancedMeshes::LOD_COUNT; lod++)
+		{
+			int lodFirstCommand = groupFirstCommand[group] + lod * groupCommandCount[group];
+			for (int c = 0; c < groupCommandCount[group]; c++)
+			{
+				m_cullCommands[lodFirstCommand + c].baseInstance = (GLuint)firstInstance;
+			}
+			firstInstance += groupSize[group];
+		}
+	}
+
+	// every record only depends on its own item
+	m_cullRecords.resize(m_drawItems.size());
+	m_pJobs->ParallelFor(m_drawItems.size(), g_MinItemsPerJob,
+		[&](size_t, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			DRAW_ITEM& item = m_drawItems[i];
+			GpuCulling::OBJECT_RECORD& record = m_cullRecords[i];
+
+			FillIndirectInstance(item, record.instance);
+			record.sphere = glm::vec4(item.bounds.sphereCenter, item.bounds.sphereRadius);
+			record.boxMin = glm::vec4(item.bounds.boxMin, 1.0f);
+			record.boxMax = glm::vec4(item.bounds.boxMax, 1.0f);
+			record.firstCommand = (uint32_t)groupFirstCommand[itemGroup[i]];
+			record.commandCount = (uint32_t)groupCommandCount[itemGroup[i]];
+			record.lodRadius = GetLodRadius(item);
+
+			record.passMask = 0;
+			if (item.flags & DRAW_CASTS_SHADOW)
+			{
+				record.passMask |= 1u << GpuCulling::CULL_SHADOW_ALL;
+				record.passMask |= 1u << ((item.flags & DRAW_DYNAMIC) ?
+					GpuCulling::CULL_SHADOW_DYNAMIC : GpuCulling::CULL_SHADOW_STATIC);
+			}
+			if (((item.flags & DRAW_TRANSLUCENT) == 0) && IsIndirectItem(item))
+			{
+				record.passMask |= 1u << GpuCulling::CULL_LIT;
+			}
+			item.gpuCullPasses = record.passMask;
+		}
+	});
+
+	m_pGpuCulling->SetObjects(m_cullRecords, m_cullCommands, m_bFirstCullCommand, firstInstance);
+	m_pInstancedMeshes->ReserveInstances(m_pGpuCulling->GetRequiredInstances());
+	m_bCullRecordsDirty = false;
+}
+
+/***********************************************************
+ *  CullGpuPass()
+ *
+ *  This method is used for culling the items of one pass in
+ *  the compute shader, which also picks their levels of
+ *  detail for a view and leaves the commands for
+ *  DrawGpuCulled() behind.  The counts come from the last
+ *  cull whose results were read back, so they trail the
+ *  drawn frame slightly.
+ ***********************************************************/
+int SceneManager::CullGpuPass(
+	GpuCulling::CULL_PASS pass,
+	const Frustum& frustum,
+	const InstancedMeshes::LOD_VIEW& lodView,
+	int& drawn)
+{
+	m_pGpuCulling->Cull(
+		pass,
+		frustum,
+		lodView,
+		m_bOcclusionCulling && (pass == GpuCulling::CULL_LIT),
+		m_pInstancedMeshes->ReserveInstances(m_pGpuCulling->GetRequiredInstances()),
+		m_glState);
+
+	const GpuCulling::PASS_STATS& stats = m_pGpuCulling->GetPassStats(pass);
+	m_passCounters.triangles += stats.triangles;
+	drawn = stats.visible;
+
+	return(stats.candidates - stats.visible);
+}
+
+/***********************************************************
+ *  DrawGpuCulled()
+ *
+ *  This method is used for drawing the items the last cull
+ *  of a pass left visible with one multi-draw-indirect call
+ *  of the current instanced program.  Any instance upload
+ *  in between overwrites the culled instances, so all draws
+ *  of a pass must come right after its cull.
+ ***********************************************************/
+void SceneManager::DrawGpuCulled(GpuCulling::CULL_PASS pass)
+{
+	m_pInstancedMeshes->DrawGpuCommands(
+		m_pGpuCulling->GetCommandBuffer(),
+		m_pGpuCulling->GetFirstCommand(pass),
+		m_pGpuCulling->GetCommandsPerPass());
+}
+
+/***********************************************************
+ *  UseDepthProgram()
+ *
+ *  This method is used for making the single or instanced
+ *  depth-only program current.  Both vertex shaders project
+ *  the camera pass exactly as the lit programs do, so the
+ *  pre-pass depth passes an equal test in the lit pass, and
+ *  the light pass into the atlas view being drawn.
+ *  The instanced meshes drawn from here on read their
+ *  positions alone.
+ ***********************************************************/
+void SceneManager::UseDepthProgram(bool bInstanced, bool bLightSpace)
+{
+	m_pInstancedMeshes->SetVertexStreams(InstancedMeshes::STREAMS_POSITION);
+	if (bInstanced)
+	{
+		m_glState.UseProgram(m_pInstancedDepthShaderManager);
+		m_instancedDepthUniforms.SetInt(U::U_DEPTH_ONLY, bLightSpace);
+		if (bLightSpace)
+		{
+			m_instancedDepthUniforms.SetInt(U::U_SHADOW_VIEW, m_shadowView);
+		}
+	}
+	else
+	{
+		m_glState.UseProgram(m_pDepthShaderManager);
+		m_depthUniforms.SetInt(U::U_DEPTH_ONLY, bLightSpace);
+		if (bLightSpace)
+		{
+			m_depthUniforms.SetInt(U::U_SHADOW_VIEW, m_shadowView);
+		}
+	}
+}
+
+/***********************************************************
+ *  DrawQueueDepth()
+ *
+ *  This method is used for drawing the camera depth of the
+ *  opaque queued commands up to an end index.  Every item
+ *  goes through the same single, instanced or indirect draw
+ *  the lit pass picks for it, so both passes transform the
+ *  vertices in the same way.
+ ***********************************************************/
+void SceneManager::DrawQueueDepth(
+	const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+	size_t end,
+	bool bIndirect)
+{
+	if (bIndirect)
+	{
+		DrawIndirectSpans(commands, 0, end, true);
+		return;
+	}
+
+	size_t i = 0;
+	while (i < end)
+	{
+		const DRAW_ITEM& item = m_drawItems[commands[i].itemIndex];
+
+		size_t runLength = FindInstanceRun(commands, i, false);
+		runLength = std::min(runLength, end - i);
+		if (runLength >= g_MinInstanceRun)
+		{
+			UseDepthProgram(true, false);
+			DrawInstancedRun(commands, i, runLength);
+		}
+		else
+		{
+			runLength = 1;
+			UseDepthProgram(false, false);
+			m_depthUniforms.SetMat4(U::U_MODEL, item.model);
+			DrawMeshForItem(item, commands[i].lod);
+		}
+		i += runLength;
+	}
+}
+
+/***********************************************************
+ *  SetDepthPrepassState()
+ *
+ *  This method is used for switching between the depth
+ *  pre-pass, which writes depth only, and the lit pass
+ *  after it, which shades the surfaces that match it and
+ *  leaves the depth buffer as it is.
+ ***********************************************************/
+void SceneManager::SetDepthPrepassState(bool bPrepass)
+{
+	m_glState.SetColorMask(!bPrepass);
+	m_glState.SetDepthMask(bPrepass);
+	m_glState.SetDepthFunc(bPrepass ? GL_LESS : GL_EQUAL);
+}
+
+/***********************************************************
+ *  ApplyItemState()
+ *
+ *  This method is used for setting the lighting, material,
+ *  texture or color and liquid flag of a draw item into the
+ *  uniforms of the current lit program.  The instanced
+ *  program reads color and UV scale from the instances.
+ ***********************************************************/
+void SceneManager::ApplyItemState(
+	ShaderUniformCache& uniforms,
+	const DRAW_ITEM& item,
+	bool bInstanced)
+{
+	uniforms.SetInt(U::U_USE_LIGHTING, (item.flags & DRAW_LIT) != 0);
+
+	// items in the material table only select their entry; the
+	// material values and texture layer come from the block
+	bool bMaterialTable = (item.materialSlot >= 0) && uniforms.HasUniform(U::U_MATERIAL_INDEX);
+	if (bMaterialTable)
+	{
+		uniforms.SetInt(U::U_MATERIAL_INDEX, item.materialSlot);
+	}
+	else
+	{
+		uniforms.SetInt(U::U_MATERIAL_INDEX, -1);
+		if ((item.materialIndex >= 0) && (item.materialIndex < (int)m_objectMaterials.size()))
+		{
+			const OBJECT_MATERIAL& material = m_objectMaterials[item.materialIndex];
+			uniforms.SetVec3(U::U_MATERIAL_DIFFUSE, material.diffuseColor);
+			uniforms.SetVec3(U::U_MATERIAL_SPECULAR, material.specularColor);
+			uniforms.SetFloat(U::U_MATERIAL_SHININESS, material.shininess);
+		}
+	}
+
+	if (item.flags & DRAW_TEXTURED)
+	{
+		uniforms.SetInt(U::U_USE_TEXTURE, true);
+		// array layers are already bound for the whole frame
+		const TEXTURE_INFO& texture = m_textures[item.textureHandle];
+		if (!bMaterialTable || (texture.layer < 0))
+		{
+			m_glState.BindTexture2D(g_ObjectTextureUnit, texture.ID);
+			uniforms.SetInt(U::U_OBJECT_TEXTURE, g_ObjectTextureUnit);
+		}
+	}
+	else
+	{
+		uniforms.SetInt(U::U_USE_TEXTURE, false);
+		if (!bInstanced)
+		{
+			uniforms.SetVec4(U::U_OBJECT_COLOR, item.color);
+		}
+	}
+	if (!bInstanced)
+	{
+		uniforms.SetVec2(U::U_UV_SCALE, item.uvScale);
+	}
+
+	uniforms.SetInt(U::U_IS_LIQUID_SURFACE, (item.flags & DRAW_LIQUID) != 0);
+}
+
+/***********************************************************
+ *  DrawMeshForItem()
+ *
+ *  This method is used for issuing the draw call of the
+ *  basic mesh referenced by a draw item.  The full detail
+ *  comes from the basic meshes; the coarser levels only
+ *  exist as instanced copies, which are drawn here once
+ *  with the current program.
+ ***********************************************************/
+void SceneManager::DrawMeshForItem(const DRAW_ITEM& item, int lod)
+{
+	bool bDrawTop = (item.flags & DRAW_TOP) != 0;
+	bool bDrawBottom = (item.flags & DRAW_BOTTOM) != 0;
+	bool bDrawSides = (item.flags & DRAW_SIDES) != 0;
+
+	// the instanced copies share the tessellation of the basic
+	// meshes, so they give the triangle count of this draw
+	InstancedMeshes::INSTANCED_MESH instancedMesh = InstancedMeshes::INSTANCED_MESH_COUNT;
+	switch (item.meshID)
+	{
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		instancedMesh = InstancedMeshes::INSTANCED_PLANE;
+		lod = 0;
+		break;
+	case MESH_CYLINDER:
+		instancedMesh = InstancedMeshes::INSTANCED_CYLINDER;
+		if (lod > 0)
+			m_pInstancedMeshes->DrawMesh(instancedMesh, lod, bDrawTop, bDrawBottom, bDrawSides);
+		else
+			m_basicMeshes->DrawCylinderMesh(bDrawTop, bDrawBottom, bDrawSides);
+		break;
+	case MESH_TAPERED_CYLINDER:
+		instancedMesh = InstancedMeshes::INSTANCED_TAPERED_CYLINDER;
+		if (lod > 0)
+			m_pInstancedMeshes->DrawMesh(instancedMesh, lod, bDrawTop, bDrawBottom, bDrawSides);
+		else
+			m_basicMeshes->DrawTaperedCylinderMesh(bDrawTop, bDrawBottom, bDrawSides);
+		break;
+	case MESH_LIQUID_SURFACE:
+		DrawLiquidSurface(item);
+		return;
+	default:
+		return;
+	}
+
+	// a cylinder with all parts drawn is drawn with one call
+	m_passCounters.drawCalls++;
+	m_passCounters.triangles += m_pInstancedMeshes->GetMeshTriangleCount(
+		instancedMesh, lod, bDrawTop, bDrawBottom, bDrawSides);
+}
+
+/***********************************************************
+ *  DrawLiquidSurface()
+ *
+ *  This method is used for drawing the liquid grid of an
+ *  item, as fine as its size on screen calls for.  The
+ *  camera distance picks the grid in every pass, so a
+ *  surface keeps one grid within a frame.
+ ***********************************************************/
+void SceneManager::DrawLiquidSurface(const DRAW_ITEM& item)
+{
+	glm::vec3 viewPosition(0.0f);
+	if (m_pUniformBuffers != NULL)
+	{
+		viewPosition = m_pUniformBuffers->GetViewPosition();
+	}
+	int lod = LiquidSurface::SelectLod(
+		item.bounds.sphereRadius,
+		glm::length(item.bounds.sphereCenter - viewPosition));
+
+	// the grid has its own vertex array, which the state cache
+	// does not track
+	m_pLiquidSurface->Draw(lod);
+	m_passCounters.drawCalls++;
+	m_passCounters.triangles += m_pLiquidSurface->GetTriangleCount(lod);
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// with storage buffers the lit programs also read the clustered
+	// point lights, so the lit program is rebuilt with them first;
+	// it is also rebuilt for any shadow filter other than the default
+	// the shader compiles in without definitions
+	if (ClusteredLights::IsSupported())
+	{
+		m_bClusteredLightsReady = m_pClusteredLights->Create();
+	}
+	if (m_bClusteredLightsReady || (m_shadowFilter != SHADOW_FILTER_POISSON16))
+	{
+		ShaderCompiler::LoadProgram(
+			m_pShaderManager,
+			"shaders/vertexShader.glsl",
+			"shaders/fragmentShader.glsl",
+			GetLitShaderDefines());
+		m_glState.InvalidateProgram();
+	}
+
+	// resolve the per-draw uniform names of the lit program once
+	m_uniforms.Resolve(m_pShaderManager);
+
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+
+	// decode the texture images in the background, leaving one
+	// core for the render thread
+	int workerCount = (int)std::thread::hardware_concurrency() - 1;
+	m_pTextureLoader->Start(std::max(1, std::min(workerCount, g_MaxTextureWorkers)));
+	// the frame loops use every core, the render thread included;
+	// the decoders only compete with them while textures load
+	m_pJobs->Start(workerCount);
+
+    // OPTIONAL: enable basic directional lighting and material defaults
+	if (m_pShaderManager != NULL)
+	{
+		// turn on lighting path in shader
+		m_uniforms.SetInt(U::U_USE_LIGHTING, true);
+		m_uniforms.SetInt(U::U_OBJECT_TEXTURE_ARRAY, g_TextureArrayUnit);
+
+		// basic ceramic-like material
+		m_uniforms.SetVec3(U::U_MATERIAL_DIFFUSE, glm::vec3(1.0f, 1.0f, 1.0f));
+		m_uniforms.SetVec3(U::U_MATERIAL_SPECULAR, glm::vec3(0.5f, 0.5f, 0.5f));
+		m_uniforms.SetFloat(U::U_MATERIAL_SHININESS, 32.0f);
+
+		// ripple (speed, radial frequency); the speed is halved from 3.0
+		// for a slower, subtle oscillation without lateral drift
+		m_uniforms.SetVec2(U::U_RIPPLE_PARAMS, glm::vec2(1.5f, 22.0f));
+	}
+
+	// scene lights live in the shared lights uniform block
+	if (m_pUniformBuffers != NULL)
+	{
+		UniformBufferManager::LIGHTS_BLOCK& lights = m_pUniformBuffers->GetLights();
+
+        // simple white directional light
+		lights.directionalLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+		lights.directionalLight.ambient = glm::vec3(0.15f, 0.15f, 0.15f);
+		lights.directionalLight.diffuse = glm::vec3(0.3f, 0.3f, 0.3f);
+		lights.directionalLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+		lights.directionalLight.bActive = true;
+
+        // soft fill point light to avoid fully dark regions
+		lights.pointLights[0].position = glm::vec3(2.0f, 6.0f, 2.0f);
+		lights.pointLights[0].ambient = glm::vec3(0.08f, 0.08f, 0.08f);
+		lights.pointLights[0].diffuse = glm::vec3(0.35f, 0.35f, 0.35f);
+		lights.pointLights[0].specular = glm::vec3(0.35f, 0.35f, 0.35f);
+		lights.pointLights[0].bActive = true;
+
+        // disable additional point lights
+		for (int i = 1; i < TOTAL_POINT_LIGHTS; i++)
+		{
+			lights.pointLights[i].bActive = false;
+		}
+
+        // initialize a camera-tied spotlight (position/direction updated per-frame in RenderShadowMap)
+        // widen and brighten flashlight slightly
+		lights.spotLight.cutOff = glm::cos(glm::radians(18.0f));
+		lights.spotLight.outerCutOff = glm::cos(glm::radians(26.0f));
+		lights.spotLight.constant = 1.0f;
+		lights.spotLight.linear = 0.045f;
+		lights.spotLight.quadratic = 0.008f;
+		lights.spotLight.ambient = glm::vec3(0.02f);
+		lights.spotLight.diffuse = glm::vec3(1.1f);
+		lights.spotLight.specular = glm::vec3(1.1f);
+		lights.spotLight.bActive = true;
+
+		m_pUniformBuffers->MarkLightsDirty();
+		m_pUniformBuffers->UploadDirtyBlocks();
+	}
+
 	m_basicMeshes->LoadPlaneMesh();
 	m_basicMeshes->LoadTaperedCylinderMesh();
 	m_basicMeshes->LoadCylinderMesh();
+	m_pLiquidSurface->LoadMesh();
 
-    // initialize shadow map resources (spotlight shadows)
-    if (m_shadowFBO == 0)
-    {
-        glGenFramebuffers(1, &m_shadowFBO);
-        glGenTextures(1, &m_shadowDepthTexture);
-        glBindTexture(GL_TEXTURE_2D, m_shadowDepthTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, m_shadowMapWidth, m_shadowMapHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-        glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFBO);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowDepthTexture, 0);
-        glDrawBuffer(GL_NONE);
-        glReadBuffer(GL_NONE);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    }
+    // initialize the shadow atlas shared by every shadowed light,
+    // at the size of the highest quality tier
+    m_pShadowAtlas->Create(DynamicResolution::GetShadowAtlasSize(m_pDynamicResolution->GetQualityTier()));
+    // the raw binds of the atlas bypassed the state cache
+    m_glState.InvalidateTextures();
+
+	// the scene is drawn offscreen and scaled into the window; where
+	// the present program does not load it is drawn into the window
+	m_bDynamicResolutionReady = m_pDynamicResolution->Create();
 
     // depth-only shader program can reuse the same vertex shader with a minimalist fragment shader
     if (m_pDepthShaderManager == nullptr)
     {
-        m_pDepthShaderManager = new ShaderManager();
+        m_pDepthShaderManager = ShaderCompiler::CreateShaderManager(&m_persistentArena);
         // Reuse existing vertex shader; create a tiny fragment shader at runtime for depth pass
         // We'll write the fragment shader to a temp file if needed, but here we embed a path to an included minimal shader
         // Provide minimal depth-only shaders in project shaders folder
-        m_pDepthShaderManager->LoadShaders("shaders/vertexShader.glsl", "shaders/shadowDepthFragment.glsl");
+        ShaderCompiler::LoadProgram(
+            m_pDepthShaderManager,
+            "shaders/vertexShader.glsl",
+            "shaders/shadowDepthFragment.glsl",
+            ShaderCompiler::DEFINES());
+
+        // the depth program reads the atlas view matrices from the shared shadow block
+        if (m_pUniformBuffers != NULL)
+        {
+            m_pUniformBuffers->BindShaderBlocks(m_pDepthShaderManager);
+        }
+        m_depthUniforms.Resolve(m_pDepthShaderManager);
+        m_depthUniforms.SetInt(U::U_DEPTH_ONLY, true);
+    }
+
+    // instanced programs and meshes for runs of identical items
+    PrepareInstancing();
+
+	// the lit permutations have the lights set above compiled in,
+	// and are prebuilt once the draw list exists
+	m_litPermutations.SetShaderFiles("shaders/vertexShader.glsl", "shaders/fragmentShader.glsl");
+	m_instancedPermutations.SetShaderFiles("shaders/instancedVertexShader.glsl", "shaders/fragmentShader.glsl");
+	m_litPermutations.SetSharedDefines(GetPermutationDefines());
+	m_instancedPermutations.SetSharedDefines(GetPermutationDefines());
+
+    // attach the lit program to the shared uniform blocks and leave it current
+    if (m_pUniformBuffers != NULL)
+    {
+        m_pUniformBuffers->BindShaderBlocks(m_pShaderManager);
     }
+	if (m_bClusteredLightsReady)
+	{
+		ClusteredLights::BindShaderBlocks(m_pShaderManager);
+	}
+    m_pShaderManager->use();
+
+	// load the textures, materials and the flat draw list shared
+	// by the shadow pass and the lit pass
+	LoadSceneFile(m_sceneFile.c_str());
+
+	// loading above changed programs and bindings behind the cache
+	m_glState.Invalidate();
+
+	// objects moved from now on are dynamic shadow casters
+	m_bScenePrepared = true;
 }
 
 /***********************************************************
- *  RenderScene()
+ *  BeginFrame()
  *
- *  This method is used for rendering the 3D scene by
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for fitting the resolution scale and
+ *  the shadow quality to the newest frame the profiler
+ *  finished, and the offscreen target to the window.  The
+ *  viewport is set to the window for the passes before the
+ *  scene; a new quality tier reallocates the shadow atlas,
+ *  whose views are then drawn again.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::BeginFrame(int windowWidth, int windowHeight)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	if ((windowWidth > 0) && (windowHeight > 0))
+	{
+		glViewport(0, 0, windowWidth, windowHeight);
+	}
+	if (!m_bDynamicResolutionReady)
+	{
+		return;
+	}
 
-    // ensure shadow map and light-space matrix are bound before drawing
-    if (m_shadowDepthTexture != 0)
-    {
-        glActiveTexture(GL_TEXTURE7);
-        glBindTexture(GL_TEXTURE_2D, m_shadowDepthTexture);
-        m_pShaderManager->setSampler2DValue("spotShadowMap", 7);
-        m_pShaderManager->setMat4Value("spotLightSpaceMatrix", m_spotLightSpaceMatrix);
-    }
+	if (NULL != m_pProfiler)
+	{
+		m_pDynamicResolution->Update(*m_pProfiler);
+	}
+	m_pDynamicResolution->Resize(windowWidth, windowHeight);
 
-	/******************************************************************/
-	/*** RENDER THE DARK SURFACE PLANE                             ***/
-	/******************************************************************/
-	// set the XYZ scale for the plane (table surface)
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
+	int atlasSize = DynamicResolution::GetShadowAtlasSize(m_pDynamicResolution->GetQualityTier());
+	if (atlasSize != m_pShadowAtlas->GetSize())
+	{
+		m_pShadowAtlas->Create(atlasSize);
+		// the raw binds of the atlas bypassed the state cache
+		m_glState.InvalidateTextures();
+	}
+}
 
-	// set the XYZ rotation for the plane
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by
+ *  walking the draw list loaded from the scene file
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	// draw into the offscreen target at the scale of this frame
+	if (m_bDynamicResolutionReady)
+	{
+		m_pDynamicResolution->BeginScene(m_glState);
+	}
 
-	// set the XYZ position for the plane
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
+	// swap in any textures that finished loading
+	ProcessTextureLoads(false);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	ResetPassCounters();
 
-    // ensure plane uses lighting and a balanced material
-    m_pShaderManager->setIntValue("bUseLighting", true);
-    m_pShaderManager->setVec3Value("material.diffuseColor", glm::vec3(1.0f));
-    m_pShaderManager->setVec3Value("material.specularColor", glm::vec3(0.4f));
-    m_pShaderManager->setFloatValue("material.shininess", 32.0f);
-
-	// apply stone texture to the plane and increase tiling for larger scale detail
-	SetShaderTexture("stone");
-	SetTextureUVScale(16.0f, 16.0f);
-
-	// draw the plane mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-
-	/******************************************************************/
-	/*** RENDER A CERAMIC SAUCER/PLATE UNDER THE MUG               ***/
-	/******************************************************************/
-	// large thin cylinder as a saucer beneath the cup
-	scaleXYZ = glm::vec3(2.6f, 0.02f, 2.6f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	// place directly on the ground (center at half-height)
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-	// glossy white ceramic
-	m_pShaderManager->setIntValue("bUseLighting", true);
-	// glass-like: lower diffuse, strong specular, high shininess
-	m_pShaderManager->setVec3Value("material.diffuseColor", glm::vec3(0.6f));
-	m_pShaderManager->setVec3Value("material.specularColor", glm::vec3(1.0f));
-	m_pShaderManager->setFloatValue("material.shininess", 128.0f);
-	// cream-tinted, opaque, reflective
-	SetShaderColor(1.00f, 0.97f, 0.88f, 1.00f);
-	SetTextureUVScale(1.0f, 1.0f);
-	// ensure opaque saucer writes depth
-	glDepthMask(GL_TRUE);
-	m_basicMeshes->DrawCylinderMesh(true, true, true);
-
-	// add a shallow raised rim (thin ring) to make it look like a plate
-	scaleXYZ = glm::vec3(2.6f, 0.03f, 2.6f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(0.0f, 0.03f, 0.0f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-	// slightly dimmer tint for rim but still glassy
-	m_pShaderManager->setVec3Value("material.diffuseColor", glm::vec3(0.55f));
-	m_pShaderManager->setVec3Value("material.specularColor", glm::vec3(1.0f));
-	m_pShaderManager->setFloatValue("material.shininess", 128.0f);
-	SetShaderColor(0.98f, 0.95f, 0.86f, 1.00f);
-	m_basicMeshes->DrawCylinderMesh(false, true, true);
-	// keep depth writes enabled for subsequent draws
-	glDepthMask(GL_TRUE);
-
-	/******************************************************************/
-	/*** RENDER THE GREEN TAPERED MUG BODY (OUTER)                 ***/
-	/******************************************************************/
-	// set the XYZ scale for the outer mug body
-	scaleXYZ = glm::vec3(1.5f, 2.0f, 1.5f);
-
-	// set the XYZ rotation for the mug body (flip 180° to make wider at top)
-	XrotationDegrees = 180.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mug body (slightly above plane to avoid z-fighting)
-	positionXYZ = glm::vec3(0.0f, 2.10f, 0.0f);
-
-	// set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+    // ensure the shadow atlas is bound before drawing; the view
+    // matrices and tiles are already in the shared shadow block
+    m_glState.UseProgram(m_pShaderManager);
+    if (m_pShadowAtlas->GetTexture() != 0)
+    {
+        m_glState.BindTexture2D(g_ShadowTextureUnit, m_pShadowAtlas->GetTexture());
+        m_uniforms.SetInt(U::U_SHADOW_ATLAS, g_ShadowTextureUnit);
+    }
+	// every layered texture of the frame is sampled through one bind
+	m_glState.BindTextureArray(g_TextureArrayUnit, m_pTextureLoader->GetTextureArray());
 
-    // mug body material
-    m_pShaderManager->setIntValue("bUseLighting", true);
-    m_pShaderManager->setVec3Value("material.diffuseColor", glm::vec3(1.0f));
-    m_pShaderManager->setVec3Value("material.specularColor", glm::vec3(0.25f));
-    m_pShaderManager->setFloatValue("material.shininess", 24.0f);
-    // texture the outer mug body with grass and set moderate tiling
-	// texture the outer mug body with grass and set moderate tiling
-	SetShaderTexture("grass");
-	SetTextureUVScale(2.0f, 1.0f);
+	// send the camera state if the shadow pass did not already do so
+	if (m_pUniformBuffers != NULL)
+	{
+		m_pUniformBuffers->UploadDirtyBlocks();
+	}
 
-	// draw the tapered cylinder mesh (outer mug body - with top, no bottom)
-	m_basicMeshes->DrawTaperedCylinderMesh(true, false, true);
+	// pick up any objects that moved since the shadow pass
+	UpdateDirtyTransforms();
+	UpdateCullRecords();
 
+	// cull against the camera volume of this frame, perspective or
+	// orthographic alike, and pick the levels of detail for the
+	// pixels of the viewport
+	InstancedMeshes::LOD_VIEW lodView;
+	if (m_pUniformBuffers != NULL)
+	{
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		lodView = MakeLodView(
+			m_pUniformBuffers->GetProjection(),
+			m_pUniformBuffers->GetViewPosition(),
+			viewport[3],
+			m_lodErrorPixels);
+		m_cameraFrustum.SetFromMatrix(
+			m_pUniformBuffers->GetProjection() * m_pUniformBuffers->GetView());
+
+		// the point lights are sorted into the clusters of this camera
+		// before any lit fragment reads them
+		if (m_bClusteredLightsReady)
+		{
+			m_pClusteredLights->Update(
+				m_pUniformBuffers->GetView(),
+				m_pUniformBuffers->GetProjection(),
+				viewport[2],
+				viewport[3],
+				*m_pJobs);
+		}
+	}
+	m_cullStats.litCulled = BuildRenderQueue(m_litQueue, lodView, m_cameraFrustum, false, SHADOW_LAYER_ALL);
+	m_cullStats.litDrawn = (int)m_litQueue.GetCommands().size();
+
+	// opaque geometry writes depth without blending
+	m_glState.SetDepthTest(true);
+	m_glState.SetDepthMask(true);
+	m_glState.SetDepthFunc(GL_LESS);
+	m_glState.SetBlend(false);
+
+	// the opaque items culled on the GPU go first; the queue then
+	// holds the translucent items and any the GPU cannot light
+	if (m_bGpuCullingReady)
+	{
+		int gpuDrawn = 0;
+		m_cullStats.litCulled += CullGpuPass(GpuCulling::CULL_LIT, m_cameraFrustum, lodView, gpuDrawn);
+		m_cullStats.litDrawn += gpuDrawn;
 
+		if (m_bDepthPrepass)
+		{
+			SetDepthPrepassState(true);
+			UseDepthProgram(true, false);
+			DrawGpuCulled(GpuCulling::CULL_LIT);
+			SetDepthPrepassState(false);
+		}
+		UseIndirectProgram();
+		DrawGpuCulled(GpuCulling::CULL_LIT);
+	}
 
-	/******************************************************************/
-	/*** RENDER THE WHITE TAPERED MUG INTERIOR                     ***/
-	/******************************************************************/
-	// set the XYZ scale for the inner mug (tucked slightly inside outer to fuse rim)
-	scaleXYZ = glm::vec3(1.46f, 1.96f, 1.46f);
+	// the opaque commands come before the translucent ones
+	const std::vector<RenderQueue::RENDER_COMMAND>& commands = m_litQueue.GetCommands();
+	size_t translucentStart = 0;
+	while ((translucentStart < commands.size()) &&
+		(RenderQueue::GetPass(commands[translucentStart].sortKey) != RenderQueue::PASS_TRANSLUCENT))
+	{
+		translucentStart++;
+	}
+	bool bIndirect = CanDrawIndirect(commands, false);
 
-	// set the XYZ rotation for the inner mug (flip 180° to match outer mug)
-	XrotationDegrees = 180.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	if (m_bDepthPrepass && (translucentStart > 0))
+	{
+		SetDepthPrepassState(true);
+		DrawQueueDepth(commands, translucentStart, bIndirect);
+		SetDepthPrepassState(false);
+	}
 
-	// set the XYZ position for the inner mug so its rim meets the outer top (align heights)
-	positionXYZ = glm::vec3(0.0f, 2.11f, 0.0f);
+	size_t i = 0;
+	if (bIndirect)
+	{
+		// every item takes its material and flags from its instance,
+		// so the uniforms of the instanced program stay neutral; one
+		// draw for the opaque items and one for the translucent items,
+		// which blend without writing depth, each split only around
+		// the liquid surfaces
+		if (translucentStart > 0)
+		{
+			DrawIndirectSpans(commands, 0, translucentStart, false);
+		}
+		if (translucentStart < commands.size())
+		{
+			m_glState.SetBlend(true);
+			m_glState.SetDepthMask(false);
+			m_glState.SetDepthFunc(GL_LESS);
+			DrawIndirectSpans(commands, translucentStart, commands.size(), false);
+		}
+		i = commands.size();
+	}
+	while (i < commands.size())
+	{
+		const DRAW_ITEM& item = m_drawItems[commands[i].itemIndex];
 
-	// set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		// translucent surfaces blend over the finished opaque image
+		// and are depth tested without writing depth
+		if (i == translucentStart)
+		{
+			m_glState.SetBlend(true);
+			m_glState.SetDepthMask(false);
+			m_glState.SetDepthFunc(GL_LESS);
+		}
 
-    // inner surface material
-    m_pShaderManager->setIntValue("bUseLighting", true);
-    m_pShaderManager->setVec3Value("material.diffuseColor", glm::vec3(1.0f));
-    m_pShaderManager->setVec3Value("material.specularColor", glm::vec3(0.25f));
-    m_pShaderManager->setFloatValue("material.shininess", 24.0f);
-	// texture the inner mug cavity with grass and 1:1 tiling
-	SetShaderTexture("grass");
-	SetTextureUVScale(1.0f, 1.0f);
-
-	// draw the tapered cylinder mesh (inner mug - no top, no bottom)
-	m_basicMeshes->DrawTaperedCylinderMesh(false, false, true);
-
-	/******************************************************************/
-	/*** RENDER A STRAW INSIDE THE CUP (before water for visibility) ***/
-	/******************************************************************/
-	// thin cylinder leaning and resting near inner rim
-	scaleXYZ = glm::vec3(0.08f, 2.96f, 0.08f);
-	XrotationDegrees = -32.25f;
-	YrotationDegrees = 150.0f;
-	ZrotationDegrees = 0.0f;
-	// move inside cup near inner wall; center height so bottom is within liquid
-	positionXYZ = glm::vec3(-0.45f, 0.25f, -0.12f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-	// off-white plastic straw
-	m_pShaderManager->setVec3Value("material.diffuseColor", glm::vec3(1.0f));
-	m_pShaderManager->setVec3Value("material.specularColor", glm::vec3(0.35f));
-	m_pShaderManager->setFloatValue("material.shininess", 32.0f);
-	SetShaderColor(0.96f, 0.96f, 0.92f, 1.0f);
-	m_basicMeshes->DrawCylinderMesh(true, true, true);
-
-	/******************************************************************/
-	/*** RENDER LIQUID SURFACE INSIDE CUP (RIPPLE)                  ***/
-	/******************************************************************/
-	// set scale for a thin disk slightly smaller than inner mug radius
-	scaleXYZ = glm::vec3(1.30f, 0.01f, 1.30f);
-
-	// rotation: slight tilt to catch lighting highlights
-	XrotationDegrees = 0.5f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.3f;
-
-	// position: slightly below the inner mug rim height (raised with cup)
-	positionXYZ = glm::vec3(0.0f, 1.78f, 0.0f);
-
-	// set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		size_t runLength = FindInstanceRun(commands, i, false);
+		if (i < translucentStart)
+		{
+			runLength = std::min(runLength, translucentStart - i);
+		}
+		if (runLength >= g_MinInstanceRun)
+		{
+			// identical items differ only in per-instance values
+			ShaderUniformCache& uniforms = UseLitProgram(item, true);
+			ApplyItemState(uniforms, item, true);
+			DrawInstancedRun(commands, i, runLength);
+		}
+		else
+		{
+			runLength = 1;
+			ShaderUniformCache& uniforms = UseLitProgram(item, false);
+			uniforms.SetMat4(U::U_MODEL, item.model);
+			uniforms.SetMat3(U::U_NORMAL_MATRIX, item.normalMatrix);
+			ApplyItemState(uniforms, item, false);
+			DrawMeshForItem(item, commands[i].lod);
+		}
+		i += runLength;
+	}
 
-    // re-enable lighting for liquid to catch highlights on ripples
-    m_pShaderManager->setIntValue("bUseLighting", true);
-    // semi-transparent liquid tint (cool blue)
-	SetShaderColor(0.2f, 0.45f, 0.9f, 0.7f);
+	// keep this frame's depth for the occlusion test of the next
+	if (m_bGpuCullingReady && m_bOcclusionCulling && (m_pUniformBuffers != NULL))
+	{
+		m_pGpuCulling->BuildDepthPyramid(
+			m_pUniformBuffers->GetProjection() * m_pUniformBuffers->GetView(), m_glState);
+	}
 
-	// enable ripple effect uniforms and switch to radial ripple behavior
-	m_pShaderManager->setIntValue("bIsLiquidSurface", true);
-	// freeze time-based drift to avoid lateral flow look; use slower time for subtle oscillation
-	m_pShaderManager->setFloatValue("timeSeconds", (float)glfwGetTime() * 0.5f);
-	// reinterpret rippleParams as (speed, radial frequency) in shader
-	m_pShaderManager->setVec2Value("rippleParams", glm::vec2(3.0f, 22.0f));
+    // restore the default blend and depth write state
+	m_glState.SetBlend(true);
+	m_glState.SetDepthMask(true);
+	m_glState.SetDepthFunc(GL_LESS);
+	m_glState.SetColorMask(true);
+	// leave the lit program current for the resets below
+	m_glState.UseProgram(m_pShaderManager);
 
-    // glossy liquid material settings for strong specular
-	m_pShaderManager->setVec3Value("material.diffuseColor", glm::vec3(1.0f, 0.95f, 0.8f));
-	m_pShaderManager->setVec3Value("material.specularColor", glm::vec3(1.0f, 1.0f, 1.0f));
-	m_pShaderManager->setFloatValue("material.shininess", 96.0f);
+    // disable liquid flag for subsequent draws
+	m_uniforms.SetInt(U::U_IS_LIQUID_SURFACE, false);
+	// restore lighting for any subsequent draws
+	m_uniforms.SetInt(U::U_USE_LIGHTING, true);
+	ReportPassCounters(FrameProfiler::PASS_LIT, m_cullStats.litDrawn, m_cullStats.litCulled);
 
-	// ripple amplitude will be driven at runtime (U/I keys) from View updates;
-	// keep a reasonable fallback value if not set yet
-	m_pShaderManager->setFloatValue("rippleAmplitude", 0.10f);
+	// the streamed instances of every pass of the frame are issued,
+	// and nothing built in the frame arena is needed any more
+	m_pInstancedMeshes->FinishFrame();
+	m_frameArena.Reset();
+}
 
-	// draw only the top cap of a cylinder to represent the liquid surface
-	m_basicMeshes->DrawCylinderMesh(true, false, false);
+/***********************************************************
+ *  PresentFrame()
+ *
+ *  This method is used for scaling the scene drawn by
+ *  RenderScene() up into the window.  Without the offscreen
+ *  target the scene is already there.
+ ***********************************************************/
+void SceneManager::PresentFrame()
+{
+	if (m_bDynamicResolutionReady)
+	{
+		m_pDynamicResolution->Present(m_glState);
+	}
+}
 
-	// restore depth writes after translucent draw
-	glDepthMask(GL_TRUE);
+/***********************************************************
+ *  DrawShadowLayer()
+ *
+ *  This method is used for drawing the shadow casters of
+ *  one layer that lie inside the volume of the atlas view
+ *  being drawn, near to the light first, into the bound
+ *  tile, at the levels of detail of the light view
+ ***********************************************************/
+int SceneManager::DrawShadowLayer(const InstancedMeshes::LOD_VIEW& lodView, SHADOW_LAYER layer, int& drawn)
+{
+    int culled = BuildRenderQueue(m_shadowQueue, lodView, m_lightFrustum, true, layer);
+    const std::vector<RenderQueue::RENDER_COMMAND>& commands = m_shadowQueue.GetCommands();
+    drawn = (int)commands.size();
 
-    // disable liquid flag for subsequent draws
-	m_pShaderManager->setIntValue("bIsLiquidSurface", false);
+    // every caster is culled on the GPU when it can be
+    if (m_bGpuCullingReady)
+    {
+        int gpuDrawn = 0;
+        GpuCulling::CULL_PASS pass = GetCullPass(true, layer);
+        culled += CullGpuPass(pass, m_lightFrustum, lodView, gpuDrawn);
+        drawn += gpuDrawn;
+        UseDepthProgram(true, true);
+        DrawGpuCulled(pass);
+    }
 
+    size_t i = 0;
+    if (CanDrawIndirect(commands, true))
+    {
+        UseDepthProgram(true, true);
+        DrawIndirect(commands, 0, commands.size());
+        i = commands.size();
+    }
+    while (i < commands.size())
+    {
+        const DRAW_ITEM& item = m_drawItems[commands[i].itemIndex];
 
+        size_t runLength = FindInstanceRun(commands, i, true);
+        if (runLength >= g_MinInstanceRun)
+        {
+            UseDepthProgram(true, true);
+            DrawInstancedRun(commands, i, runLength);
+        }
+        else
+        {
+            runLength = 1;
+            UseDepthProgram(false, true);
+            m_depthUniforms.SetMat4(U::U_MODEL, item.model);
+            DrawMeshForItem(item, commands[i].lod);
+        }
+        i += runLength;
+    }
 
+    return(culled);
+}
 
+/***********************************************************
+ *  UpdateShadowViews()
+ *
+ *  This method is used for handing out the shadow atlas
+ *  tiles of a frame and setting the light matrix of every
+ *  view.  The spotlight and the directional light always
+ *  ask for the largest tile; a shadowed point light asks for
+ *  six, one per cube face, sized by how close its light is
+ *  to the camera, and none while its light is out of view.
+ *  The directional light covers the static casters from
+ *  outside their bounding sphere.
+ ***********************************************************/
+void SceneManager::UpdateShadowViews(const glm::vec3& lightPosition, const glm::vec3& lightDirection)
+{
+    const UniformBufferManager::LIGHTS_BLOCK& lights = m_pUniformBuffers->GetLights();
 
-	/******************************************************************/
-	/*** RENDER THE GREEN MUG BOTTOM                               ***/
-	/******************************************************************/
-	// set the XYZ scale for the mug bottom (flat cylinder)
-	scaleXYZ = glm::vec3(1.0f, 0.1f, 1.0f);
+    // the bounds of the static casters only change along with them
+    if (m_bStaticShadowDirty)
+    {
+        glm::vec3 boxMin;
+        glm::vec3 boxMax;
+        if (GetSceneBounds(boxMin, boxMax))
+        {
+            m_shadowBoundsCenter = 0.5f * (boxMin + boxMax);
+            m_shadowBoundsRadius = std::max(0.5f * glm::length(boxMax - boxMin), 0.01f);
+        }
+        else
+        {
+            m_shadowBoundsRadius = 0.0f;
+        }
+    }
 
-	// set the XYZ rotation for the bottom
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+    m_shadowRequests.clear();
+    ShadowAtlas::LIGHT_REQUEST request;
+    request.owner = g_SpotShadowOwner;
+    request.importance = lights.spotLight.bActive ? 1.0f : 0.0f;
+    m_shadowRequests.push_back(request);
+    request.owner = g_DirectionalShadowOwner;
+    request.importance = (lights.directionalLight.bActive && (m_shadowBoundsRadius > 0.0f)) ? 1.0f : 0.0f;
+    m_shadowRequests.push_back(request);
+
+    // a point light matters as much as its range fills of the view
+    // around it; one whose range is out of view lights nothing seen
+    Frustum cameraFrustum;
+    cameraFrustum.SetFromMatrix(m_pUniformBuffers->GetProjection() * m_pUniformBuffers->GetView());
+    const glm::vec3& viewPosition = m_pUniformBuffers->GetViewPosition();
+    request.viewCount = 6;
+    for (size_t i = 0; i < m_shadowedPointLights.size(); i++)
+    {
+        const ClusteredLights::POINT_LIGHT& light = m_pClusteredLights->GetLight(m_shadowedPointLights[i]);
+        glm::vec3 position = glm::vec3(light.positionRange);
+        float range = light.positionRange.w;
 
-	// set the XYZ position for the bottom (raised slightly to avoid z-fighting with plane)
-	positionXYZ = glm::vec3(0.0f, 0.06f, 0.0f);
+        request.owner = g_FirstPointShadowOwner + (int)i;
+        request.importance = 0.0f;
+        if (m_bClusteredLightsReady && cameraFrustum.IntersectsSphere(position, range))
+        {
+            float distance = glm::length(position - viewPosition);
+            request.importance = g_PointShadowImportance * range / std::max(distance, range);
+        }
+        m_shadowRequests.push_back(request);
+    }
+    m_pShadowAtlas->AllocateTiles(m_shadowRequests, m_shadowFirstViews);
 
-	// set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+    UniformBufferManager::SHADOW_BLOCK& shadows = m_pUniformBuffers->GetShadows();
+    int view = m_shadowFirstViews[g_SpotShadowOwner];
+    shadows.lightViews.x = view;
+    if (view >= 0)
+    {
+        m_shadowProjections[view] = glm::perspective(
+            glm::radians(g_SpotShadowFov), 1.0f, g_SpotShadowNear, g_SpotShadowFar);
+        m_shadowPositions[view] = lightPosition;
+        glm::mat4 lightView = glm::lookAt(
+            lightPosition, lightPosition + glm::normalize(lightDirection), glm::vec3(0.0f, 1.0f, 0.0f));
+        m_pShadowAtlas->SetViewMatrix(view, m_shadowProjections[view] * lightView, g_ShadowCacheTolerance);
+    }
 
-    // bottom: lit as well for continuity
-    m_pShaderManager->setIntValue("bUseLighting", true);
-	// texture the mug bottom with grass and 1:1 tiling
-	SetShaderTexture("grass");
-	SetTextureUVScale(1.0f, 1.0f);
+    view = m_shadowFirstViews[g_DirectionalShadowOwner];
+    shadows.lightViews.y = view;
+    if (view >= 0)
+    {
+        glm::vec3 direction = glm::normalize(lights.directionalLight.direction);
+        glm::vec3 up = (std::abs(direction.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        float radius = m_shadowBoundsRadius;
+        glm::vec3 eye = m_shadowBoundsCenter - direction * (2.0f * radius);
+        m_shadowProjections[view] = glm::ortho(-radius, radius, -radius, radius, 0.0f, 4.0f * radius);
+        m_shadowPositions[view] = eye;
+        glm::mat4 lightView = glm::lookAt(eye, m_shadowBoundsCenter, up);
+        m_pShadowAtlas->SetViewMatrix(view, m_shadowProjections[view] * lightView, g_ShadowCacheTolerance);
+    }
 
-    // draw the cylinder mesh (mug bottom)
-	m_basicMeshes->DrawCylinderMesh(true, true, false);
+    // the lit shader finds the first view of a point light in it
+    bool bLightsChanged = false;
+    for (size_t i = 0; i < m_shadowedPointLights.size(); i++)
+    {
+        ClusteredLights::POINT_LIGHT& light = m_pClusteredLights->GetLight(m_shadowedPointLights[i]);
+        view = m_shadowFirstViews[g_FirstPointShadowOwner + i];
+        if (light.ambient.w != (float)view)
+        {
+            light.ambient.w = (float)view;
+            bLightsChanged = true;
+        }
+        if (view < 0)
+            continue;
 
-	// restore lighting for any subsequent draws
-	m_pShaderManager->setIntValue("bUseLighting", true);
+        glm::vec3 position = glm::vec3(light.positionRange);
+        glm::mat4 projection = glm::perspective(
+            glm::radians(90.0f), 1.0f, g_PointShadowNear, std::max(light.positionRange.w, 2.0f * g_PointShadowNear));
+        for (int face = 0; face < 6; face++)
+        {
+            m_shadowProjections[view + face] = projection;
+            m_shadowPositions[view + face] = position;
+            glm::mat4 lightView = glm::lookAt(position, position + g_CubeFaceDirections[face], g_CubeFaceUps[face]);
+            m_pShadowAtlas->SetViewMatrix(view + face, projection * lightView, g_ShadowCacheTolerance);
+        }
+    }
+    if (bLightsChanged)
+    {
+        m_pClusteredLights->MarkLightsDirty();
+    }
 
-    // after geometry draw, bind spotlight shadow texture and light-space matrix for main shader
-    // Note: These uniforms are consumed by the fragment shader to compute shadowing for the spotlight
-    if (m_shadowDepthTexture != 0)
+    float atlasSize = (float)m_pShadowAtlas->GetSize();
+    for (view = 0; view < m_pShadowAtlas->GetViewCount(); view++)
     {
-        glActiveTexture(GL_TEXTURE7);
-        glBindTexture(GL_TEXTURE_2D, m_shadowDepthTexture);
-        m_pShaderManager->setSampler2DValue("spotShadowMap", 7);
-        m_pShaderManager->setMat4Value("spotLightSpaceMatrix", m_spotLightSpaceMatrix);
+        const ShadowAtlas::TILE& tile = m_pShadowAtlas->GetTile(view);
+        shadows.matrices[view] = m_pShadowAtlas->GetViewMatrix(view);
+        shadows.tiles[view] = glm::vec4(
+            (float)tile.x / atlasSize, (float)tile.y / atlasSize, (float)tile.size / atlasSize, 0.0f);
     }
-	/****************************************************************/
+    m_pUniformBuffers->MarkShadowsDirty();
 }
 
+/***********************************************************
+ *  RenderShadowMap()
+ *
+ *  This method is used for rendering the atlas views of the
+ *  shadowed lights from the same draw list that the lit pass
+ *  uses, so the shadows always match the rendered geometry.
+ *  Every tile is kept between frames, and only the views
+ *  whose tile, light or shadow casters changed are drawn.
+ ***********************************************************/
 void SceneManager::RenderShadowMap(const glm::vec3& lightPosition, const glm::vec3& lightDirection)
 {
-    if (m_shadowFBO == 0 || m_pDepthShaderManager == nullptr)
+    if (m_pShadowAtlas->GetTexture() == 0 || m_pDepthShaderManager == nullptr || m_pUniformBuffers == NULL)
         return;
 
-    // define light-space transform for spotlight (perspective projection)
-    float nearPlane = 0.05f;
-    float farPlane = 80.0f;
-    float fov = 48.0f; // slightly larger than widened spot outer cone to avoid clipping
-    glm::mat4 lightProjection = glm::perspective(glm::radians(fov), (float)m_shadowMapWidth / (float)m_shadowMapHeight, nearPlane, farPlane);
-    glm::mat4 lightView = glm::lookAt(lightPosition, lightPosition + glm::normalize(lightDirection), glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-    m_spotLightSpaceMatrix = lightSpaceMatrix;
+    ResetPassCounters();
+
+    // rebuild the matrices of objects that moved since the last frame
+    UpdateDirtyTransforms();
+    UpdateCullRecords();
+
+    // a view whose light or tile moved was marked by the atlas, and
+    // moved casters may fall into any of them
+    UpdateShadowViews(lightPosition, lightDirection);
+    if (m_bStaticShadowDirty || m_bDynamicShadowDirty)
+    {
+        m_pShadowAtlas->InvalidateTiles(m_bStaticShadowDirty);
+    }
+    m_bStaticShadowDirty = false;
+    m_bDynamicShadowDirty = false;
+
+    // one buffer update publishes the spotlight pose and the views to
+    // both programs, together with the camera state from PrepareSceneView()
+    m_pUniformBuffers->SetSpotLightPose(lightPosition, glm::normalize(lightDirection));
+    m_pUniformBuffers->UploadDirtyBlocks();
 
-    // save current viewport and switch to shadow map viewport
+    // save current viewport; every tile sets its own
     GLint prevViewport[4];
     glGetIntegerv(GL_VIEWPORT, prevViewport);
-    glViewport(0, 0, m_shadowMapWidth, m_shadowMapHeight);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
-
-    // bind depth-only program
-    m_pDepthShaderManager->use();
-    m_pDepthShaderManager->setMat4Value("view", lightView);
-    m_pDepthShaderManager->setMat4Value("projection", lightProjection);
-
-    auto setDepthModel = [&](const glm::vec3& scaleXYZ,
-                             float Xdeg, float Ydeg, float Zdeg,
-                             const glm::vec3& posXYZ)
+    m_glState.SetDepthTest(true);
+    m_glState.SetDepthMask(true);
+
+    int drawn = 0;
+    int culled = 0;
+    bool bTileDrawn = false;
+    for (int view = 0; view < m_pShadowAtlas->GetViewCount(); view++)
+    {
+        if (m_pShadowAtlas->IsTileValid(view))
+            continue;
+
+        m_shadowView = view;
+        m_lightFrustum.SetFromMatrix(m_pShadowAtlas->GetViewMatrix(view));
+        // casters are picked a coarser level of detail than the lit
+        // pass would give them, for the texels of the tile
+        InstancedMeshes::LOD_VIEW lodView = MakeLodView(
+            m_shadowProjections[view], m_shadowPositions[view],
+            m_pShadowAtlas->GetTile(view).size, m_lodErrorPixels * m_shadowLodBias);
+
+        int layerDrawn = 0;
+        if (m_dynamicCasterCount == 0)
+        {
+            // every caster is static; draw them straight into the tile
+            m_pShadowAtlas->BeginTile(view, false);
+            culled += DrawShadowLayer(lodView, SHADOW_LAYER_ALL, layerDrawn);
+            drawn += layerDrawn;
+        }
+        else
+        {
+            // redraw the static layer only when it changed
+            if (!m_pShadowAtlas->IsStaticTileValid(view))
+            {
+                m_pShadowAtlas->BeginTile(view, true);
+                culled += DrawShadowLayer(lodView, SHADOW_LAYER_STATIC, layerDrawn);
+                drawn += layerDrawn;
+            }
+
+            // start from the static layer and add the dynamic casters
+            m_pShadowAtlas->BeginTileFromStatic(view);
+            culled += DrawShadowLayer(lodView, SHADOW_LAYER_DYNAMIC, layerDrawn);
+            drawn += layerDrawn;
+        }
+        bTileDrawn = true;
+    }
+    m_cullStats.shadowDrawn = drawn;
+    m_cullStats.shadowCulled = culled;
+
+    if (bTileDrawn)
     {
-        glm::mat4 scale = glm::scale(scaleXYZ);
-        glm::mat4 rotX = glm::rotate(glm::radians(Xdeg), glm::vec3(1.0f, 0.0f, 0.0f));
-        glm::mat4 rotY = glm::rotate(glm::radians(Ydeg), glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 rotZ = glm::rotate(glm::radians(Zdeg), glm::vec3(0.0f, 0.0f, 1.0f));
-        glm::mat4 trans = glm::translate(posXYZ);
-        glm::mat4 model = trans * rotZ * rotY * rotX * scale;
-        m_pDepthShaderManager->setMat4Value("model", model);
-    };
-
-    // render depth for plane
-    setDepthModel(glm::vec3(20.0f, 1.0f, 10.0f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f));
-    m_basicMeshes->DrawPlaneMesh();
-
-    // saucer/plate
-    setDepthModel(glm::vec3(2.6f, 0.02f, 2.6f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
-    m_basicMeshes->DrawCylinderMesh(true, true, true);
-    // saucer rim
-    setDepthModel(glm::vec3(2.6f, 0.03f, 2.6f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.03f, 0.0f));
-    m_basicMeshes->DrawCylinderMesh(false, true, true);
-
-    // outer mug
-    setDepthModel(glm::vec3(1.5f, 2.0f, 1.5f), 180.0f, 0.0f, 0.0f, glm::vec3(0.0f, 2.10f, 0.0f));
-    m_basicMeshes->DrawTaperedCylinderMesh(true, false, true);
-
-    // inner mug
-    setDepthModel(glm::vec3(1.46f, 1.96f, 1.46f), 180.0f, 0.0f, 0.0f, glm::vec3(0.0f, 2.11f, 0.0f));
-    m_basicMeshes->DrawTaperedCylinderMesh(false, false, true);
-
-    // liquid surface
-    setDepthModel(glm::vec3(1.30f, 0.01f, 1.30f), 0.5f, 0.0f, 0.3f, glm::vec3(0.0f, 1.78f, 0.0f));
-    m_basicMeshes->DrawCylinderMesh(true, false, false);
-
-    // mug bottom
-    setDepthModel(glm::vec3(1.0f, 0.1f, 1.0f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.06f, 0.0f));
-    m_basicMeshes->DrawCylinderMesh(true, true, false);
-
-    // straw
-    setDepthModel(glm::vec3(0.08f, 2.96f, 0.08f), -24.0f, -18.0f, 0.0f, glm::vec3(-0.45f, 2.60f, -0.12f));
-    m_basicMeshes->DrawCylinderMesh(true, true, true);
-
-    // unbind FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    // restore viewport to previous
-    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+        // unbind the atlas and restore viewport to previous
+        m_pShadowAtlas->EndTiles();
+        glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+    }
+    ReportPassCounters(FrameProfiler::PASS_SHADOW, m_cullStats.shadowDrawn, m_cullStats.shadowCulled);
 }
+
@@ -11,8 +11,28 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "InstancedMeshes.h"
+#include "LiquidSurface.h"
+#include "GpuCulling.h"
+#include "ClusteredLights.h"
+#include "ShadowAtlas.h"
+#include "DynamicResolution.h"
+#include "ShaderUniformCache.h"
+#include "UniformBufferManager.h"
+#include "RenderQueue.h"
+#include "RenderStateCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderPermutations.h"
+#include "Frustum.h"
+#include "FrameProfiler.h"
+#include "TextureLoader.h"
+#include "JobSystem.h"
+#include "LinearArena.h"
+#include "SceneFile.h"
 
+#include <cstring>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /***********************************************************
@@ -25,14 +45,24 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(
+		ShaderManager *pShaderManager,
+		UniformBufferManager* pUniformBuffers);
 	// destructor
 	~SceneManager();
 
+	// a texture either has an ID of its own or lives in a layer
+	// of the shared texture array
 	struct TEXTURE_INFO
 	{
-		std::string tag;
+		// interned in the scene arena
+		const char* tag = NULL;
+		const char* filename = NULL;
 		uint32_t ID = 0;
+		int layer = -1;
+		// layer handed out when the image was requested; layer is
+		// only set once the image is in it
+		int arrayLayer = -1;
 	};
 
 	struct OBJECT_MATERIAL
@@ -40,40 +70,448 @@ public:
 		glm::vec3 diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
 		glm::vec3 specularColor = glm::vec3(0.5f, 0.5f, 0.5f);
 		float shininess = 32.0f;
-		std::string tag;
+		// interned in the scene arena once the material is added
+		const char* tag = NULL;
+	};
+
+	// primitive meshes that a draw item can reference
+	enum MESH_ID
+	{
+		MESH_PLANE = 0,
+		MESH_CYLINDER,
+		MESH_TAPERED_CYLINDER,
+		// displaced radial grid in place of the cylinder top cap;
+		// the instanced and shadow draws keep the flat cap
+		MESH_LIQUID_SURFACE
+	};
+
+	// per-item flags for mesh parts and shading options
+	enum DRAW_FLAGS : uint32_t
+	{
+		DRAW_TOP = 1u << 0,
+		DRAW_BOTTOM = 1u << 1,
+		DRAW_SIDES = 1u << 2,
+		DRAW_TEXTURED = 1u << 3,
+		DRAW_LIT = 1u << 4,
+		DRAW_LIQUID = 1u << 5,
+		DRAW_CASTS_SHADOW = 1u << 6,
+		DRAW_TRANSLUCENT = 1u << 7,
+		// set on a shadow caster once it moves after PrepareScene()
+		DRAW_DYNAMIC = 1u << 8
+	};
+
+	// subsets of the shadow casters drawn by one shadow queue
+	enum SHADOW_LAYER
+	{
+		SHADOW_LAYER_ALL = 0,
+		SHADOW_LAYER_STATIC,
+		SHADOW_LAYER_DYNAMIC
+	};
+
+	// filters of the light shadows, compiled into the lit
+	// programs; each tap is one hardware 2x2 compare
+	enum SHADOW_FILTER
+	{
+		// a single tap
+		SHADOW_FILTER_HARDWARE = 0,
+		// four taps on a 2x2 texel grid
+		SHADOW_FILTER_PCF4,
+		// 16 taps on a Poisson disk, rotated per pixel
+		SHADOW_FILTER_POISSON16
+	};
+
+	// authored transform of a scene object; the world matrix
+	// is only rebuilt from it when bDirty is set
+	struct OBJECT_TRANSFORM
+	{
+		glm::vec3 scaleXYZ = glm::vec3(1.0f);
+		glm::vec3 rotationDegrees = glm::vec3(0.0f);
+		glm::vec3 positionXYZ = glm::vec3(0.0f);
+		bool bDirty = false;
+	};
+
+	// one entry of the flat scene draw list, walked by both the
+	// shadow pass and the lit pass
+	struct DRAW_ITEM
+	{
+		glm::mat4 model = glm::mat4(1.0f);
+		glm::mat3 normalMatrix = glm::mat3(1.0f);
+		glm::vec4 color = glm::vec4(1.0f);
+		glm::vec2 uvScale = glm::vec2(1.0f);
+		int meshID = MESH_PLANE;
+		int materialIndex = -1;
+		int textureHandle = -1;
+		// entry of the GPU material table, -1 when it is full
+		int materialSlot = -1;
+		uint32_t flags = 0;
+		// bits of the GpuCulling passes that draw the item, which the
+		// render queues of those passes then leave out
+		uint32_t gpuCullPasses = 0;
+		// world bounds, rebuilt together with the matrices
+		BOUNDING_VOLUME bounds;
+	};
+
+	// one entry of the GPU material table: a material paired
+	// with the texture drawn with it
+	struct MATERIAL_SLOT
+	{
+		int materialIndex = -1;
+		int textureHandle = -1;
+	};
+
+	// visibility counts of the last frame, per pass
+	struct CULL_STATS
+	{
+		int litDrawn = 0;
+		int litCulled = 0;
+		int shadowDrawn = 0;
+		int shadowCulled = 0;
 	};
 
 private:
+	// hash and equality of tags by their characters, so a map keyed
+	// by interned tags is searched with any string without copying it
+	struct TAG_HASH
+	{
+		size_t operator()(const char* tag) const
+		{
+			size_t hash = 2166136261u;
+			for (; *tag != '\0'; tag++)
+			{
+				hash = (hash ^ (unsigned char)*tag) * 16777619u;
+			}
+			return(hash);
+		}
+	};
+	struct TAG_EQUAL
+	{
+		bool operator()(const char* a, const char* b) const
+		{
+			return(strcmp(a, b) == 0);
+		}
+	};
+	typedef std::unordered_map<const char*, int, TAG_HASH, TAG_EQUAL> TAG_MAP;
+
+	// holds the meshes and programs that live as long as the scene
+	// manager; reset when it is destroyed
+	LinearArena m_persistentArena;
+	// holds the tables and interned tags of the loaded scene; reset
+	// by LoadSceneFile() before it reads the next scene
+	LinearArena m_sceneArena;
+	// holds the lists built while rendering a frame; reset at the end
+	// of every frame
+	LinearArena m_frameArena;
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the shared uniform buffer objects
+	UniformBufferManager* m_pUniformBuffers;
+	// uniform handles and last uploaded values of the lit program
+	ShaderUniformCache m_uniforms;
+	// lit programs with the features of one single or instanced
+	// draw compiled in; the default lit programs, which branch on
+	// the uniforms and instance flags, take the mixed indirect draws
+	// and any permutation that did not build
+	ShaderPermutations m_litPermutations;
+	ShaderPermutations m_instancedPermutations;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
-	// defined object materials
-	std::vector<OBJECT_MATERIAL> m_objectMaterials;
-
-    // shadow mapping resources (spotlight)
-    unsigned int m_shadowFBO;
-    unsigned int m_shadowDepthTexture;
-    int m_shadowMapWidth;
-    int m_shadowMapHeight;
+	// rippled liquid grids with their levels of detail
+	LiquidSurface* m_pLiquidSurface;
+	// loaded textures info, indexed by texture handle
+	ArenaArray<TEXTURE_INFO> m_textures;
+	// texture tag to texture handle, filled at load time
+	TAG_MAP m_textureHandles;
+	// decodes the texture images in the background; every handle
+	// shows the placeholder texture until its image is uploaded
+	TextureLoader* m_pTextureLoader;
+	uint32_t m_placeholderTexture;
+	// layers of the texture array handed out to textures so far,
+	// and the ones given back by textures a scene no longer uses
+	int m_usedTextureLayers;
+	std::vector<int> m_freeTextureLayers;
+	// worker threads the per-item loops of a frame are split over
+	JobSystem* m_pJobs;
+	// defined object materials, indexed by material handle
+	ArenaArray<OBJECT_MATERIAL> m_objectMaterials;
+	// material tag to material handle, filled when materials are defined
+	TAG_MAP m_materialHandles;
+	// material and texture pairs used by the draw list; mirrored
+	// into the materials uniform block
+	ArenaArray<MATERIAL_SLOT> m_materialSlots;
+	// flat draw list filled from the scene file
+	ArenaArray<DRAW_ITEM> m_drawItems;
+	// authored transforms, parallel to m_drawItems
+	ArenaArray<OBJECT_TRANSFORM> m_objectTransforms;
+	// number of entries in m_objectTransforms waiting for an update
+	int m_dirtyTransforms;
+	// per-frame sorted draw order of the lit pass and the shadow pass
+	RenderQueue m_litQueue;
+	RenderQueue m_shadowQueue;
+	// current OpenGL bindings, used to skip redundant state changes
+	RenderStateCache m_glState;
+	// view volumes of the camera and the shadow view being drawn
+	// for culling
+	Frustum m_cameraFrustum;
+	Frustum m_lightFrustum;
+	CULL_STATS m_cullStats;
+	// scene file loaded by PrepareScene(), the number of copies of
+	// it laid out side by side, and the distance from the center to
+	// the outermost copy
+	std::string m_sceneFile;
+	int m_sceneCopies;
+	float m_sceneRadius;
+	// optional profiler that receives the counters of each pass
+	FrameProfiler* m_pProfiler;
+	// draw calls and triangles of the pass being rendered
+	FrameProfiler::PASS_COUNTERS m_passCounters;
+	// heap allocations made before the pass being rendered began
+	unsigned long long m_passAllocationStart;
+
+	// instanced copies of the basic shapes and the programs that
+	// draw them; runs of identical queued items share one draw
+	InstancedMeshes* m_pInstancedMeshes;
+	ShaderManager* m_pInstancedShaderManager;
+	ShaderUniformCache m_instancedUniforms;
+	ShaderManager* m_pInstancedDepthShaderManager;
+	ShaderUniformCache m_instancedDepthUniforms;
+	// set when both instanced programs loaded
+	bool m_bInstancingReady;
+	// set when whole passes can also be drawn with one
+	// multi-draw-indirect call through the instanced programs
+	bool m_bIndirectReady;
+
+	// culls the items on the GPU and writes their indirect commands,
+	// when compute shaders are supported
+	GpuCulling* m_pGpuCulling;
+	bool m_bGpuCullingReady;
+	// point lights of limited range on top of the lights block,
+	// sorted into the clusters of the camera when storage buffers
+	// are supported
+	ClusteredLights* m_pClusteredLights;
+	bool m_bClusteredLightsReady;
+	// clustered lights that cast shadows through the shadow atlas
+	std::vector<int> m_shadowedPointLights;
+	// test the lit pass against the depth of the previous frame
+	bool m_bOcclusionCulling;
+	// lay down the opaque depth first and shade with GL_EQUAL
+	bool m_bDepthPrepass;
+	// largest silhouette error of a level of detail in pixels, and
+	// the factor the shadow pass accepts beyond it
+	float m_lodErrorPixels;
+	float m_shadowLodBias;
+	// set when the object records no longer match the draw list
+	bool m_bCullRecordsDirty;
+	std::vector<GpuCulling::OBJECT_RECORD> m_cullRecords;
+	std::vector<InstancedMeshes::DRAW_ELEMENTS_COMMAND> m_cullCommands;
+	std::vector<bool> m_bFirstCullCommand;
+
+    // shadow mapping resources; every shadowed light draws its
+    // views into tiles of one atlas
+    ShadowAtlas* m_pShadowAtlas;
     ShaderManager* m_pDepthShaderManager;
-    glm::mat4 m_spotLightSpaceMatrix;
+    ShaderUniformCache m_depthUniforms;
+    SHADOW_FILTER m_shadowFilter;
+    // atlas view the depth programs project into
+    int m_shadowView;
+    // lights asking for tiles this frame, the first view each got,
+    // and the projection and position of every view
+    std::vector<ShadowAtlas::LIGHT_REQUEST> m_shadowRequests;
+    std::vector<int> m_shadowFirstViews;
+    glm::mat4 m_shadowProjections[ShadowAtlas::MAX_VIEWS];
+    glm::vec3 m_shadowPositions[ShadowAtlas::MAX_VIEWS];
+    // sphere around the static casters that the directional light
+    // shadow covers
+    glm::vec3 m_shadowBoundsCenter;
+    float m_shadowBoundsRadius;
+    // the atlas tiles are kept between frames and only redrawn when
+    // their light matrix or a caster changed
+    bool m_bScenePrepared;
+    bool m_bStaticShadowDirty;
+    bool m_bDynamicShadowDirty;
+    // casters moved since PrepareScene() are drawn each time over a
+    // cached depth layer holding the static casters
+    int m_dynamicCasterCount;
 
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	// offscreen target the scene is drawn into at the resolution
+	// scale of the frame budget, and scaled up into the window
+	DynamicResolution* m_pDynamicResolution;
+	bool m_bDynamicResolutionReady;
+
+	// copy of a tag that lives as long as the scene
+	const char* InternTag(const char* tag);
+	// queue a texture image for loading and register its tag
+	bool CreateGLTexture(const char* filename, const char* tag);
+	// create the texture shown while images are still loading
+	void CreatePlaceholderTexture();
+	// swap in the textures uploaded since the last call
+	void ProcessTextureLoads(bool bWait);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const char* tag);
+	int FindTextureSlot(const char* tag);
+	// find the handle of a loaded texture by tag
+	int FindTextureHandle(const char* tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const char* tag, OBJECT_MATERIAL& material);
+	// find the index of a defined material by tag
+	int FindMaterialIndex(const char* tag);
+	// register a material so it can be found by tag
+	int AddObjectMaterial(const OBJECT_MATERIAL& material);
+	// find or add the material table entry of a material and texture
+	int FindMaterialSlot(int materialIndex, int textureHandle);
+	// copy the material table into the materials uniform block
+	void UpdateMaterialBlock();
+
+	// build a model matrix from scale, rotation and position
+	static glm::mat4 BuildModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// fill the draw list with the objects of a mapped scene file,
+	// laid out m_sceneCopies times
+	void FillDrawItems(
+		const SceneFile& file,
+		const int* pTextureHandles,
+		const int* pMaterialIndices);
+	// issue the mesh draw call for a draw item at a level of detail
+	void DrawMeshForItem(const DRAW_ITEM& item, int lod);
+	// draw the liquid grid of an item at the detail of its distance
+	void DrawLiquidSurface(const DRAW_ITEM& item);
+	// rebuild the world and normal matrices of moved objects
+	void UpdateDirtyTransforms();
+	// local bounds of a mesh before the object transform
+	static void GetMeshLocalBounds(int meshID, glm::vec3& localMin, glm::vec3& localMax);
+	// radius about the mesh axis that picks the level of detail of
+	// an item; 0 for meshes with a single level
+	static float GetLodRadius(const DRAW_ITEM& item);
+	// level of detail view of a projection drawn at a viewport height
+	static InstancedMeshes::LOD_VIEW MakeLodView(
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition,
+		int viewportHeight,
+		float maxErrorPixels);
+	// fill a render queue with the items inside a view volume,
+	// sorted and given their level of detail for a view; the shadow
+	// pass only queues the casters of one layer; returns the number
+	// culled
+	int BuildRenderQueue(
+		RenderQueue& queue,
+		const InstancedMeshes::LOD_VIEW& lodView,
+		const Frustum& frustum,
+		bool bShadowPass,
+		SHADOW_LAYER shadowLayer);
+	// load the instanced programs and meshes
+	void PrepareInstancing();
+	// definitions the lit programs are compiled with
+	ShaderCompiler::DEFINES GetLitShaderDefines() const;
+	// definitions shared by the lit permutations, once the lights are set
+	ShaderCompiler::DEFINES GetPermutationDefines() const;
+	// permutation features of a draw item
+	static uint32_t GetItemFeatures(const DRAW_ITEM& item);
+	// build the permutations of every draw item in parallel
+	void PrebuildPermutations();
+	// make the lit program for the features of an item current and
+	// return its uniforms
+	ShaderUniformCache& UseLitProgram(const DRAW_ITEM& item, bool bInstanced);
+	// set the uniforms of a lit program that do not change per draw
+	void SetLitProgramDefaults(ShaderUniformCache& uniforms, bool bInstanced);
+	// box around the bounds of every draw item; false when empty
+	bool GetSceneBounds(glm::vec3& boxMin, glm::vec3& boxMax) const;
+	// ask the atlas for the tiles of the shadowed lights and set the
+	// light matrix of every view that got one
+	void UpdateShadowViews(const glm::vec3& lightPosition, const glm::vec3& lightDirection);
+	// queue and draw one layer of shadow casters into the bound
+	// atlas tile; returns the number culled
+	int DrawShadowLayer(const InstancedMeshes::LOD_VIEW& lodView, SHADOW_LAYER layer, int& drawn);
+	// check whether two draw items can share one instanced draw
+	static bool CanInstanceTogether(
+		const DRAW_ITEM& first,
+		const DRAW_ITEM& other,
+		bool bShadowPass);
+	// count the queued commands from a start index that can be
+	// drawn together with it
+	size_t FindInstanceRun(
+		const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+		size_t start,
+		bool bShadowPass);
+	// draw a run of queued commands with one instanced draw
+	void DrawInstancedRun(
+		const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+		size_t start,
+		size_t count);
+	// instanced copy of a basic mesh
+	static InstancedMeshes::INSTANCED_MESH GetInstancedMesh(int meshID);
+	// check whether an item can be lit from its instance alone,
+	// i.e. needs no per-draw uniform or texture bind
+	bool IsIndirectItem(const DRAW_ITEM& item) const;
+	// pack an item into an instance that carries all of its state
+	static void FillIndirectInstance(const DRAW_ITEM& item, InstancedMeshes::INSTANCE_DATA& instance);
+	// make the instanced lit program current with neutral uniforms,
+	// for instances that carry their own state
+	void UseIndirectProgram();
+	// check whether every queued item but the liquid surfaces can
+	// be drawn by one indirect draw, i.e. needs no per-draw uniform
+	// or bind
+	bool CanDrawIndirect(
+		const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+		bool bShadowPass) const;
+	// draw a range of queued commands with one indirect draw; the
+	// matching instanced program must be current
+	void DrawIndirect(
+		const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+		size_t start,
+		size_t end);
+	// draw a range of queued commands of the camera view with
+	// indirect draws, and each liquid surface in it on its own;
+	// bDepth draws the camera depth only
+	void DrawIndirectSpans(
+		const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+		size_t start,
+		size_t end,
+		bool bDepth);
+	// GPU cull pass of a render queue pass
+	static GpuCulling::CULL_PASS GetCullPass(bool bShadowPass, SHADOW_LAYER shadowLayer);
+	// rebuild the GPU object records after the draw list changed
+	void UpdateCullRecords();
+	// cull one pass on the GPU; returns the number culled
+	int CullGpuPass(
+		GpuCulling::CULL_PASS pass,
+		const Frustum& frustum,
+		const InstancedMeshes::LOD_VIEW& lodView,
+		int& drawn);
+	// draw what the last cull of a pass left visible with the
+	// current instanced program
+	void DrawGpuCulled(GpuCulling::CULL_PASS pass);
+	// make a depth-only program current, projecting into the atlas
+	// view being drawn or into the camera for the pre-pass
+	void UseDepthProgram(bool bInstanced, bool bLightSpace);
+	// draw the depth of the opaque queued commands before the lit
+	// pass, through the same draw paths the lit pass takes
+	void DrawQueueDepth(
+		const std::vector<RenderQueue::RENDER_COMMAND>& commands,
+		size_t end,
+		bool bIndirect);
+	// switch between the depth pre-pass and the lit pass after it
+	void SetDepthPrepassState(bool bPrepass);
+	// restart the counters of every cache before a pass
+	void ResetPassCounters();
+	// hand the counters of a finished pass to the profiler
+	void ReportPassCounters(
+		FrameProfiler::PROFILE_PASS pass,
+		int objectsDrawn,
+		int objectsCulled);
+	// set the material, texture, color and shading flags of an item
+	// into the uniforms of the current lit program
+	void ApplyItemState(
+		ShaderUniformCache& uniforms,
+		const DRAW_ITEM& item,
+		bool bInstanced);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -93,7 +531,9 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
+	void SetShaderTexture(
+		int textureHandle);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -101,15 +541,82 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
+	void SetShaderMaterial(
+		int materialHandle);
 
 public:
 
-	// The following methods are for the students to 
-	// customize for their own 3D scene
+	// scene file loaded by PrepareScene(); call before it
+	void SetSceneFile(const char* filename);
+	// scene file PrepareScene() loads, the mug table unless set
+	const std::string& GetSceneFile() const;
+	// replace the textures, materials and objects with those of a
+	// scene file; the current scene is kept when it does not load
+	bool LoadSceneFile(const char* filename);
+	// write the loaded scene, every copy included, as a scene file
+	bool SaveSceneFile(const char* filename) const;
+
 	void PrepareScene();
+	// fit the resolution scale and the shadow quality to the last
+	// finished frame and size the target to the window; call before
+	// the shadow pass
+	void BeginFrame(int windowWidth, int windowHeight);
 	void RenderScene();
-    // render spotlight shadow map each frame
+	// scale the scene drawn by RenderScene() up into the window
+	void PresentFrame();
+    // render the shadow atlas views that changed, each frame
     void RenderShadowMap(const glm::vec3& lightPosition, const glm::vec3& lightDirection);
 
+	// objects drawn and culled by the last lit and shadow passes
+	const CULL_STATS& GetCullStats() const;
+	// report the work of every pass to a profiler; NULL stops it
+	void SetProfiler(FrameProfiler* pProfiler);
+	// block until every queued texture has been uploaded
+	void WaitForTextures();
+	// anisotropic filtering level of the scene textures; 1 turns it off
+	void SetTextureAnisotropy(float anisotropy);
+	// skip objects hidden in the last frame's depth; needs GPU culling
+	void SetOcclusionCulling(bool bEnable);
+	// draw the opaque depth before shading it, so hidden fragments
+	// are rejected before the lighting runs
+	void SetDepthPrepass(bool bEnable);
+	// largest silhouette error in pixels a coarser level of detail
+	// may make; 0 keeps every mesh at full detail
+	void SetLodError(float pixels);
+	// factor the shadow map accepts beyond that error, as its
+	// silhouettes are blurred by the filter
+	void SetShadowLodBias(float bias);
+	// filter of the light shadows; compiled into the lit programs
+	// by PrepareScene(), so call before it
+	void SetShadowFilter(SHADOW_FILTER filter);
+	// time in milliseconds the shadow and lit passes keep to by
+	// lowering the resolution scale and then the shadow quality;
+	// 0 draws every frame at full resolution and quality
+	void SetFrameBudget(float milliseconds);
+	// highest shadow quality, which sizes the shadow atlas
+	void SetQualityTier(DynamicResolution::QUALITY_TIER tier);
+	// add a point light of limited range on top of the lights
+	// block; it lights the scene where OpenGL 4.3 is present, and
+	// a shadowed one gets shadow atlas tiles while its light shows
+	int AddPointLight(const glm::vec3& position, const glm::vec3& color, float range, bool bCastsShadow = false);
+	void ClearPointLights();
+	// spread a number of colored point lights over the loaded scene,
+	// the first of them casting shadows
+	void ScatterPointLights(int count, int shadowCount = 0);
+	// lay out several copies of the scene side by side; applies to
+	// the scene files loaded from then on
+	void SetSceneCopies(int copies);
+	// distance from the center to the outermost copy of the scene
+	float GetSceneRadius() const;
+
+	// move a scene object; its matrices are rebuilt before the next pass
+	void SetObjectTransform(
+		int objectIndex,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
 };
\ No newline at end of file
@@ -0,0 +1,521 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercompiler.cpp
+// ============
+// compile GLSL files with preprocessor definitions into shader programs
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderCompiler.h"
+#include "AtomicFile.h"
+#include "LinearArena.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// first word of a program binary cache file, "GLP2"; the words
+	// after it are the binary format and the two halves of the hash
+	// of the sources the binary was built from
+	const uint32_t g_BinaryMagic = 0x32504C47u;
+	const int g_BinaryHeaderWords = 4;
+}
+
+/***********************************************************
+ *  ReadSource()
+ *
+ *  This method is used for reading a GLSL file and putting
+ *  one #define line per definition right after its #version
+ *  line, which must stay the first statement of the source.
+ ***********************************************************/
+bool ShaderCompiler::ReadSource(const char* filename, const DEFINES& defines, std::string& source)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open shader " << filename << std::endl;
+		return(false);
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	source = stream.str();
+
+	if (defines.empty())
+	{
+		return(true);
+	}
+
+	// the definitions go after the #version line; its line ending
+	// is where the second line of the file starts
+	size_t insertAt = 0;
+	int nextLine = 1;
+	size_t version = source.find("#version");
+	if (version != std::string::npos)
+	{
+		size_t lineEnd = source.find('\n', version);
+		insertAt = (lineEnd == std::string::npos) ? source.size() : lineEnd + 1;
+		for (size_t i = 0; i < insertAt; i++)
+		{
+			if (source[i] == '\n')
+			{
+				nextLine++;
+			}
+		}
+	}
+
+	std::string header = (insertAt == source.size()) ? "\n" : "";
+	for (size_t i = 0; i < defines.size(); i++)
+	{
+		header += "#define " + defines[i] + "\n";
+	}
+	header += "#line " + std::to_string(nextLine) + "\n";
+	source.insert(insertAt, header);
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginStages()
+ *
+ *  This method is used for starting the build of a program
+ *  from the final sources of its shader files, the last of
+ *  which names it.  A cached binary of the same sources and
+ *  driver is loaded instead when there is one;
+ *  otherwise the stages are compiled and linked without
+ *  reading the results, which FinishProgram() does later.
+ ***********************************************************/
+bool ShaderCompiler::BeginStages(
+	const GLenum stages[],
+	const char* const files[],
+	const std::string sources[],
+	int stageCount,
+	const DEFINES& defines,
+	PENDING_PROGRAM& pending)
+{
+	pending = PENDING_PROGRAM();
+	pending.name = files[stageCount - 1];
+	if (IsBinaryCacheSupported())
+	{
+		pending.cacheFile = GetCacheFile(files, stageCount, defines);
+		pending.sourceHash = GetSourceHash(sources, stageCount);
+	}
+
+	pending.program = glCreateProgram();
+	if (!pending.cacheFile.empty() && LoadBinary(pending.cacheFile, pending.sourceHash, pending.program))
+	{
+		pending.bFromCache = true;
+		return(true);
+	}
+
+	// a rejected binary may leave the program in any state
+	glDeleteProgram(pending.program);
+	pending.program = glCreateProgram();
+
+	for (int i = 0; i < stageCount; i++)
+	{
+		const char* pSource = sources[i].c_str();
+		GLuint shader = glCreateShader(stages[i]);
+		glShaderSource(shader, 1, &pSource, NULL);
+		glCompileShader(shader);
+		glAttachShader(pending.program, shader);
+		pending.shaders[pending.shaderCount++] = shader;
+	}
+	if (!pending.cacheFile.empty())
+	{
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(pending.program);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CheckStage()
+ *
+ *  This method is used for reading the compile status of a
+ *  stage, and printing its log when it did not compile.
+ ***********************************************************/
+bool ShaderCompiler::CheckStage(GLuint shader, const std::string& name)
+{
+	GLint success = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		char infoLog[1024];
+		glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Shader " << name << " failed to compile:\n" << infoLog << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  FinishProgram()
+ *
+ *  This method is used for waiting for a started program,
+ *  checking every stage and the link, and caching the
+ *  binary of a program that was built from source.  It
+ *  returns 0 and prints the logs when the program failed.
+ ***********************************************************/
+GLuint ShaderCompiler::FinishProgram(PENDING_PROGRAM& pending)
+{
+	GLuint program = pending.program;
+	if (pending.bFromCache || (program == 0))
+	{
+		pending = PENDING_PROGRAM();
+		return(program);
+	}
+
+	bool bCompiled = true;
+	for (int i = 0; i < pending.shaderCount; i++)
+	{
+		bCompiled = CheckStage(pending.shaders[i], pending.name) && bCompiled;
+		glDetachShader(program, pending.shaders[i]);
+		glDeleteShader(pending.shaders[i]);
+	}
+
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!bCompiled || !success)
+	{
+		if (bCompiled)
+		{
+			char infoLog[1024];
+			glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+			std::cout << "Program " << pending.name << " failed to link:\n" << infoLog << std::endl;
+		}
+		glDeleteProgram(program);
+		pending = PENDING_PROGRAM();
+		return(0);
+	}
+
+	if (!pending.cacheFile.empty())
+	{
+		SaveBinary(pending.cacheFile, pending.sourceHash, program);
+	}
+	pending = PENDING_PROGRAM();
+
+	return(program);
+}
+
+/***********************************************************
+ *  IsBinaryCacheSupported()
+ *
+ *  This method is used for checking that the driver can
+ *  hand out program binaries in at least one format.
+ ***********************************************************/
+bool ShaderCompiler::IsBinaryCacheSupported()
+{
+	if (!GLEW_ARB_get_program_binary)
+	{
+		return(false);
+	}
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return(formatCount > 0);
+}
+
+/***********************************************************
+ *  HashStrings()
+ *
+ *  This method is used for computing a 64-bit FNV-1a hash of
+ *  a list of strings.
+ ***********************************************************/
+uint64_t ShaderCompiler::HashStrings(const std::vector<std::string>& parts)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t part = 0; part < parts.size(); part++)
+	{
+		// the zero byte after each part keeps the boundaries apart
+		const std::string& text = parts[part];
+		for (size_t i = 0; i <= text.size(); i++)
+		{
+			unsigned char byte = (i < text.size()) ? (unsigned char)text[i] : 0;
+			hash ^= byte;
+			hash *= 1099511628211ull;
+		}
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  GetCacheFile()
+ *
+ *  This method is used for naming the cache file of a
+ *  program after its last shader file.  The name holds a
+ *  hash of every shader file name and definition, which
+ *  stay the same when a shader is edited, so each program
+ *  keeps to one file that a rebuild writes over.
+ ***********************************************************/
+std::string ShaderCompiler::GetCacheFile(const char* const files[], int stageCount, const DEFINES& defines)
+{
+	std::vector<std::string> parts(files, files + stageCount);
+	parts.insert(parts.end(), defines.begin(), defines.end());
+
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%016llx.cache.bin", (unsigned long long)HashStrings(parts));
+	return(std::string(files[stageCount - 1]) + suffix);
+}
+
+/***********************************************************
+ *  GetSourceHash()
+ *
+ *  This method is used for hashing the final sources of a
+ *  program, which include the definitions, together with
+ *  the vendor, renderer and version of the driver, so an
+ *  edited shader or an updated driver misses the old binary.
+ ***********************************************************/
+uint64_t ShaderCompiler::GetSourceHash(const std::string sources[], int stageCount)
+{
+	std::vector<std::string> parts(sources, sources + stageCount);
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (int i = 0; i < 3; i++)
+	{
+		const GLubyte* pString = glGetString(driverStrings[i]);
+		parts.push_back((pString != NULL) ? (const char*)pString : "");
+	}
+
+	return(HashStrings(parts));
+}
+
+/***********************************************************
+ *  LoadBinary()
+ *
+ *  This method is used for reading a cached program binary
+ *  into a program.  It returns false when there is no such
+ *  file, when it was built from other sources, or when the
+ *  driver rejects the binary; the rebuilt program is then
+ *  written over it.
+ ***********************************************************/
+bool ShaderCompiler::LoadBinary(const std::string& cacheFile, uint64_t sourceHash, GLuint program)
+{
+	std::ifstream file(cacheFile.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return(false);
+	}
+
+	uint32_t header[g_BinaryHeaderWords] = {};
+	file.read((char*)header, sizeof(header));
+	if (!file.good() || (header[0] != g_BinaryMagic) ||
+		(header[2] != (uint32_t)sourceHash) || (header[3] != (uint32_t)(sourceHash >> 32)))
+	{
+		return(false);
+	}
+	std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	if (binary.empty())
+	{
+		return(false);
+	}
+
+	glProgramBinary(program, (GLenum)header[1], binary.data(), (GLsizei)binary.size());
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	return(success != 0);
+}
+
+/***********************************************************
+ *  SaveBinary()
+ *
+ *  This method is used for writing the binary of a linked
+ *  program with its format and the hash of its sources,
+ *  replacing the cached one through AtomicFile.
+ ***********************************************************/
+void ShaderCompiler::SaveBinary(const std::string& cacheFile, uint64_t sourceHash, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary((size_t)length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, NULL, &format, binary.data());
+	uint32_t header[g_BinaryHeaderWords] = {
+		g_BinaryMagic, (uint32_t)format, (uint32_t)sourceHash, (uint32_t)(sourceHash >> 32) };
+
+	std::string tempFile = AtomicFile::GetTempFile(cacheFile);
+	{
+		std::ofstream file(tempFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return;
+		}
+		file.write((const char*)header, sizeof(header));
+		file.write(binary.data(), (std::streamsize)binary.size());
+		if (!file.good())
+		{
+			file.close();
+			std::remove(tempFile.c_str());
+			return;
+		}
+	}
+
+	AtomicFile::Replace(tempFile, cacheFile);
+}
+
+/***********************************************************
+ *  EnableParallelCompile()
+ *
+ *  This method is used for letting the driver pick as many
+ *  compiler threads as it likes.  Programs started together
+ *  with Begin*() then build at the same time.
+ ***********************************************************/
+void ShaderCompiler::EnableParallelCompile()
+{
+	if (GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+}
+
+/***********************************************************
+ *  BeginProgram()
+ *
+ *  This method is used for starting the build of a program
+ *  from a vertex and a fragment shader file with the given
+ *  definitions.
+ ***********************************************************/
+bool ShaderCompiler::BeginProgram(
+	const char* vertexFile,
+	const char* fragmentFile,
+	const DEFINES& defines,
+	PENDING_PROGRAM& pending)
+{
+	std::string sources[2];
+	if (!ReadSource(vertexFile, defines, sources[0]) ||
+		!ReadSource(fragmentFile, defines, sources[1]))
+	{
+		pending = PENDING_PROGRAM();
+		return(false);
+	}
+
+	const GLenum stages[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const char* const files[2] = { vertexFile, fragmentFile };
+	return(BeginStages(stages, files, sources, 2, defines, pending));
+}
+
+/***********************************************************
+ *  BeginComputeProgram()
+ *
+ *  This method is used for starting the build of a program
+ *  from a compute shader file with the given definitions.
+ ***********************************************************/
+bool ShaderCompiler::BeginComputeProgram(const char* filename, const DEFINES& defines, PENDING_PROGRAM& pending)
+{
+	std::string source;
+	if (!ReadSource(filename, defines, source))
+	{
+		pending = PENDING_PROGRAM();
+		return(false);
+	}
+
+	const GLenum stage = GL_COMPUTE_SHADER;
+	return(BeginStages(&stage, &filename, &source, 1, defines, pending));
+}
+
+/***********************************************************
+ *  CreateShaderManager()
+ *
+ *  This method is used for creating a shader manager with
+ *  no program.  ShaderManager leaves m_programID unset, and
+ *  AssignProgram() deletes any program it finds there.
+ ***********************************************************/
+ShaderManager* ShaderCompiler::CreateShaderManager(LinearArena* pArena)
+{
+	ShaderManager* pShaderManager = NULL;
+	if (pArena != NULL)
+	{
+		pShaderManager = pArena->Create<ShaderManager>();
+	}
+	else
+	{
+		pShaderManager = new ShaderManager();
+	}
+	pShaderManager->m_programID = 0;
+
+	return(pShaderManager);
+}
+
+/***********************************************************
+ *  AssignProgram()
+ *
+ *  This method is used for handing a finished program to a
+ *  shader manager and deleting the one it held.  Locations
+ *  and block bindings of the old program no longer apply,
+ *  so resolve them again afterwards.
+ ***********************************************************/
+void ShaderCompiler::AssignProgram(ShaderManager* pShaderManager, GLuint program)
+{
+	// CreateShaderManager() sets m_programID to 0, so a shader
+	// manager that never loaded holds no program to delete
+	if (pShaderManager->m_programID != 0)
+	{
+		glDeleteProgram(pShaderManager->m_programID);
+	}
+	pShaderManager->m_programID = program;
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for building a program from a vertex
+ *  and a fragment shader file with the given definitions,
+ *  and handing it to a shader manager in place of the one it
+ *  held.
+ ***********************************************************/
+bool ShaderCompiler::LoadProgram(
+	ShaderManager* pShaderManager,
+	const char* vertexFile,
+	const char* fragmentFile,
+	const DEFINES& defines)
+{
+	if (NULL == pShaderManager)
+	{
+		return(false);
+	}
+
+	PENDING_PROGRAM pending;
+	if (!BeginProgram(vertexFile, fragmentFile, defines, pending))
+	{
+		return(false);
+	}
+	GLuint program = FinishProgram(pending);
+	if (program == 0)
+	{
+		return(false);
+	}
+
+	AssignProgram(pShaderManager, program);
+	return(true);
+}
+
+/***********************************************************
+ *  LoadComputeProgram()
+ *
+ *  This method is used for building a program from a compute
+ *  shader file with the given definitions.  It returns 0
+ *  when the shader does not build.
+ ***********************************************************/
+GLuint ShaderCompiler::LoadComputeProgram(const char* filename, const DEFINES& defines)
+{
+	PENDING_PROGRAM pending;
+	if (!BeginComputeProgram(filename, defines, pending))
+	{
+		return(0);
+	}
+
+	return(FinishProgram(pending));
+}
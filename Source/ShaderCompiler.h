@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercompiler.h
+// ============
+// compile GLSL files with preprocessor definitions into shader programs
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class LinearArena;
+
+/***********************************************************
+ *  ShaderCompiler
+ *
+ *  This class builds programs from the GLSL files the same
+ *  way ShaderManager::LoadShaders() does, but first puts a
+ *  list of #define lines right after the #version line of
+ *  every stage.  Features chosen at startup, e.g. the shadow
+ *  filter, are then compiled into the program instead of
+ *  being branched on per fragment.
+ *
+ *  A #line directive follows the definitions, so compile
+ *  errors still report the line numbers of the file.
+ *
+ *  Linked programs are kept as driver binaries next to
+ *  their shader file, so later startups skip compilation.
+ *  Each program has one cache file, named by a hash of its
+ *  shader files and definitions; the file holds a hash of
+ *  the final sources and the driver, and a binary that no
+ *  longer matches them, or that the driver rejects, is
+ *  rebuilt from source and written over the old one.
+ *
+ *  Several programs can be started with Begin*() before any
+ *  is finished, so a driver with KHR_parallel_shader_compile
+ *  builds them at the same time.
+ ***********************************************************/
+class ShaderCompiler
+{
+public:
+	// definitions put in front of the source, each written as
+	// "NAME" or "NAME VALUE"
+	typedef std::vector<std::string> DEFINES;
+
+	// a program handed to the driver whose result was not read yet
+	struct PENDING_PROGRAM
+	{
+		GLuint program = 0;
+		// stages still attached; none when read from the cache
+		GLuint shaders[2] = { 0, 0 };
+		int shaderCount = 0;
+		// file named after the shader, used in messages
+		std::string name;
+		// binary cache file of the program, empty when not cached,
+		// and the hash of the sources and driver it must hold
+		std::string cacheFile;
+		uint64_t sourceHash = 0;
+		bool bFromCache = false;
+	};
+
+private:
+	// read a GLSL file and insert the definitions after #version
+	static bool ReadSource(const char* filename, const DEFINES& defines, std::string& source);
+	// start building a program from the final sources of its shader
+	// files, from the binary cache when it holds a matching program
+	static bool BeginStages(
+		const GLenum stages[],
+		const char* const files[],
+		const std::string sources[],
+		int stageCount,
+		const DEFINES& defines,
+		PENDING_PROGRAM& pending);
+	// check the compile status of a stage, printing its log
+	static bool CheckStage(GLuint shader, const std::string& name);
+
+	// check whether the driver can hand out program binaries
+	static bool IsBinaryCacheSupported();
+	// 64-bit FNV-1a hash of a list of strings
+	static uint64_t HashStrings(const std::vector<std::string>& parts);
+	// name of the cache file of a program, from its files and definitions
+	static std::string GetCacheFile(const char* const files[], int stageCount, const DEFINES& defines);
+	// hash of the final sources of a program and of the driver
+	static uint64_t GetSourceHash(const std::string sources[], int stageCount);
+	// read a cached binary of the given sources into a program;
+	// false when missing, out of date or rejected
+	static bool LoadBinary(const std::string& cacheFile, uint64_t sourceHash, GLuint program);
+	// write the binary of a linked program over its cache file
+	static void SaveBinary(const std::string& cacheFile, uint64_t sourceHash, GLuint program);
+
+public:
+	// let the driver build programs on several threads, where
+	// KHR_parallel_shader_compile is supported; call once after GLEW
+	static void EnableParallelCompile();
+
+	// start building a vertex and fragment program
+	static bool BeginProgram(
+		const char* vertexFile,
+		const char* fragmentFile,
+		const DEFINES& defines,
+		PENDING_PROGRAM& pending);
+	// start building a compute program
+	static bool BeginComputeProgram(const char* filename, const DEFINES& defines, PENDING_PROGRAM& pending);
+	// wait for a started program and cache its binary; returns the
+	// program, or 0 and prints the log when it did not build
+	static GLuint FinishProgram(PENDING_PROGRAM& pending);
+
+	// create a shader manager that holds no program yet, in the
+	// arena when one is given and on the heap otherwise
+	static ShaderManager* CreateShaderManager(LinearArena* pArena);
+	// hand a finished program to a shader manager in place of the
+	// one it held; the shader manager must come from CreateShaderManager()
+	static void AssignProgram(ShaderManager* pShaderManager, GLuint program);
+
+	// build a vertex and fragment program into a shader manager,
+	// replacing the program it held; the old program is kept when
+	// the new one does not build
+	static bool LoadProgram(
+		ShaderManager* pShaderManager,
+		const char* vertexFile,
+		const char* fragmentFile,
+		const DEFINES& defines);
+	// build a compute program; returns 0 when it does not build
+	static GLuint LoadComputeProgram(const char* filename, const DEFINES& defines);
+};
@@ -0,0 +1,268 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.cpp
+// ============
+// build and cache one program per combination of compiled-in draw features
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderPermutations.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  ShaderPermutations()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderPermutations::ShaderPermutations()
+{
+	m_vertexFile = NULL;
+	m_fragmentFile = NULL;
+}
+
+/***********************************************************
+ *  ~ShaderPermutations()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderPermutations::~ShaderPermutations()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  SetShaderFiles()
+ *
+ *  This method is used for choosing the vertex and fragment
+ *  shader files that every permutation is built from.
+ ***********************************************************/
+void ShaderPermutations::SetShaderFiles(const char* vertexFile, const char* fragmentFile)
+{
+	m_vertexFile = vertexFile;
+	m_fragmentFile = fragmentFile;
+	Clear();
+}
+
+/***********************************************************
+ *  SetSharedDefines()
+ *
+ *  This method is used for replacing the definitions that
+ *  go into every permutation.  The built programs no longer
+ *  match new definitions, so they are dropped and rebuilt
+ *  on demand.
+ ***********************************************************/
+void ShaderPermutations::SetSharedDefines(const ShaderCompiler::DEFINES& defines)
+{
+	if (defines == m_sharedDefines)
+	{
+		return;
+	}
+
+	m_sharedDefines = defines;
+	Clear();
+}
+
+/***********************************************************
+ *  BeginProgram()
+ *
+ *  This method is used for starting the build of the
+ *  program of a set of features, with the shared
+ *  definitions in front of the feature definitions.
+ ***********************************************************/
+bool ShaderPermutations::BeginProgram(uint32_t features, ShaderCompiler::PENDING_PROGRAM& pending)
+{
+	if ((NULL == m_vertexFile) || (NULL == m_fragmentFile))
+	{
+		return(false);
+	}
+
+	ShaderCompiler::DEFINES defines = m_sharedDefines;
+	ShaderCompiler::DEFINES featureDefines = GetFeatureDefines(features);
+	defines.insert(defines.end(), featureDefines.begin(), featureDefines.end());
+
+	return(ShaderCompiler::BeginProgram(m_vertexFile, m_fragmentFile, defines, pending));
+}
+
+/***********************************************************
+ *  FinishProgram()
+ *
+ *  This method is used for finishing a started program and
+ *  keeping it.  A program that fails to build is remembered
+ *  as NULL, so the caller falls back without a rebuild
+ *  every frame.
+ ***********************************************************/
+ShaderPermutations::PROGRAM* ShaderPermutations::FinishProgram(
+	uint32_t features,
+	ShaderCompiler::PENDING_PROGRAM& pending)
+{
+	PROGRAM* pProgram = NULL;
+	GLuint program = ShaderCompiler::FinishProgram(pending);
+	if (program != 0)
+	{
+		pProgram = new PROGRAM();
+		pProgram->pShaderManager = ShaderCompiler::CreateShaderManager(NULL);
+		ShaderCompiler::AssignProgram(pProgram->pShaderManager, program);
+		if (!pProgram->uniforms.Resolve(pProgram->pShaderManager))
+		{
+			glDeleteProgram(program);
+			pProgram->pShaderManager->m_programID = 0;
+			delete pProgram->pShaderManager;
+			delete pProgram;
+			pProgram = NULL;
+		}
+	}
+	if (NULL == pProgram)
+	{
+		std::cout << "Shader permutation " << features << " of " << m_fragmentFile
+			<< " did not build; using the default program" << std::endl;
+	}
+
+	m_programs[features] = pProgram;
+
+	return(pProgram);
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for looking up the program of a set
+ *  of features, and for building it on the first request.
+ ***********************************************************/
+ShaderPermutations::PROGRAM* ShaderPermutations::GetProgram(uint32_t features)
+{
+	std::unordered_map<uint32_t, PROGRAM*>::const_iterator found = m_programs.find(features);
+	if (found != m_programs.end())
+	{
+		return(found->second);
+	}
+
+	ShaderCompiler::PENDING_PROGRAM pending;
+	if (!BeginProgram(features, pending))
+	{
+		return(NULL);
+	}
+
+	return(FinishProgram(features, pending));
+}
+
+/***********************************************************
+ *  Prebuild()
+ *
+ *  This method is used for building the missing programs of
+ *  a list of feature sets.  Every build is started before
+ *  any is finished, so the driver can compile them on its
+ *  own threads while the first one is waited on.
+ ***********************************************************/
+void ShaderPermutations::Prebuild(const std::vector<uint32_t>& features)
+{
+	std::vector<uint32_t> started;
+	std::vector<ShaderCompiler::PENDING_PROGRAM> pending;
+	for (size_t i = 0; i < features.size(); i++)
+	{
+		bool bKnown = (m_programs.find(features[i]) != m_programs.end());
+		for (size_t j = 0; !bKnown && (j < started.size()); j++)
+		{
+			bKnown = (started[j] == features[i]);
+		}
+		if (bKnown)
+		{
+			continue;
+		}
+
+		ShaderCompiler::PENDING_PROGRAM program;
+		if (BeginProgram(features[i], program))
+		{
+			started.push_back(features[i]);
+			pending.push_back(program);
+		}
+	}
+
+	for (size_t i = 0; i < started.size(); i++)
+	{
+		FinishProgram(started[i], pending[i]);
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for deleting every built program.
+ ***********************************************************/
+void ShaderPermutations::Clear()
+{
+	std::unordered_map<uint32_t, PROGRAM*>::iterator program = m_programs.begin();
+	for (; program != m_programs.end(); ++program)
+	{
+		if (program->second != NULL)
+		{
+			ShaderManager* pShaderManager = program->second->pShaderManager;
+			if (pShaderManager->m_programID != 0)
+			{
+				glDeleteProgram(pShaderManager->m_programID);
+				pShaderManager->m_programID = 0;
+			}
+			delete pShaderManager;
+			delete program->second;
+		}
+	}
+	m_programs.clear();
+}
+
+/***********************************************************
+ *  GetUploadCount()
+ *
+ *  This method is used for adding up the uniform uploads of
+ *  every built program.
+ ***********************************************************/
+unsigned int ShaderPermutations::GetUploadCount() const
+{
+	unsigned int uploads = 0;
+	std::unordered_map<uint32_t, PROGRAM*>::const_iterator program = m_programs.begin();
+	for (; program != m_programs.end(); ++program)
+	{
+		if (program->second != NULL)
+		{
+			uploads += program->second->uniforms.GetUploadCount();
+		}
+	}
+
+	return(uploads);
+}
+
+/***********************************************************
+ *  ResetUploadCount()
+ *
+ *  This method is used for restarting the upload counter of
+ *  every built program.
+ ***********************************************************/
+void ShaderPermutations::ResetUploadCount()
+{
+	std::unordered_map<uint32_t, PROGRAM*>::iterator program = m_programs.begin();
+	for (; program != m_programs.end(); ++program)
+	{
+		if (program->second != NULL)
+		{
+			program->second->uniforms.ResetUploadCount();
+		}
+	}
+}
+
+/***********************************************************
+ *  GetFeatureDefines()
+ *
+ *  This method is used for listing the definitions that
+ *  compile a set of features into the fragment shader.
+ *  Every feature is defined, to 0 or 1, so none of them is
+ *  left to the per-draw uniforms.
+ ***********************************************************/
+ShaderCompiler::DEFINES ShaderPermutations::GetFeatureDefines(uint32_t features)
+{
+	ShaderCompiler::DEFINES defines;
+	defines.push_back((features & FEATURE_TEXTURED) ? "TEXTURED 1" : "TEXTURED 0");
+	defines.push_back((features & FEATURE_LIT) ? "LIT 1" : "LIT 0");
+	defines.push_back((features & FEATURE_LIQUID) ? "LIQUID 1" : "LIQUID 0");
+
+	return(defines);
+}
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.h
+// ============
+// build and cache one program per combination of compiled-in draw features
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderCompiler.h"
+#include "ShaderManager.h"
+#include "ShaderUniformCache.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  ShaderPermutations
+ *
+ *  This class keeps the programs built from one pair of
+ *  shader files for different sets of draw features.  The
+ *  features are compiled in as TEXTURED, LIT and LIQUID, so
+ *  the fragment shader takes no per-draw branches on them.
+ *  Definitions shared by every permutation, e.g. the shadow
+ *  filter, are set once for the whole cache.
+ *
+ *  A permutation is built the first time it is asked for
+ *  and kept, with its resolved uniforms, until the shared
+ *  definitions change.  The permutations a scene needs can
+ *  be prebuilt together, so the driver compiles them in
+ *  parallel and no draw waits on a compile.
+ ***********************************************************/
+class ShaderPermutations
+{
+public:
+	// constructor
+	ShaderPermutations();
+	// destructor
+	~ShaderPermutations();
+
+	// draw features a permutation is specialized for
+	enum FEATURE_FLAGS
+	{
+		FEATURE_TEXTURED = 1u << 0,
+		FEATURE_LIT = 1u << 1,
+		FEATURE_LIQUID = 1u << 2
+	};
+	// number of distinct permutation keys
+	static const int PERMUTATION_COUNT = 8;
+
+	// one linked permutation and the uniforms resolved against it
+	struct PROGRAM
+	{
+		ShaderManager* pShaderManager = NULL;
+		ShaderUniformCache uniforms;
+		// set by the caller once it bound the blocks and defaults
+		bool bPrepared = false;
+	};
+
+private:
+	// shader files every permutation is built from
+	const char* m_vertexFile;
+	const char* m_fragmentFile;
+	// definitions shared by every permutation
+	ShaderCompiler::DEFINES m_sharedDefines;
+	// built permutations by key; NULL marks one that did not build,
+	// so it is not retried every frame
+	std::unordered_map<uint32_t, PROGRAM*> m_programs;
+
+	// start building the program of a feature set
+	bool BeginProgram(uint32_t features, ShaderCompiler::PENDING_PROGRAM& pending);
+	// finish a started program and keep it, or NULL when it failed
+	PROGRAM* FinishProgram(uint32_t features, ShaderCompiler::PENDING_PROGRAM& pending);
+
+public:
+	// choose the shader files; call before the first GetProgram()
+	void SetShaderFiles(const char* vertexFile, const char* fragmentFile);
+	// replace the shared definitions, dropping every built program
+	// when they changed
+	void SetSharedDefines(const ShaderCompiler::DEFINES& defines);
+
+	// get the program of a feature set, building it when needed;
+	// bPrepared is false until the caller bound its blocks and set
+	// its defaults; NULL when it failed
+	PROGRAM* GetProgram(uint32_t features);
+	// build every missing program of a list of feature sets at once
+	void Prebuild(const std::vector<uint32_t>& features);
+	// free every built program
+	void Clear();
+
+	// uniform uploads of every built program
+	unsigned int GetUploadCount() const;
+	void ResetUploadCount();
+
+	// definitions that compile in one feature set
+	static ShaderCompiler::DEFINES GetFeatureDefines(uint32_t features);
+};
@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniformcache.cpp
+// ============
+// resolve shader uniform locations once and skip redundant uniform uploads
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderUniformCache.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// uniform names, indexed by ShaderUniformCache::UNIFORM_ID
+	const char* g_UniformNames[ShaderUniformCache::UNIFORM_COUNT] =
+	{
+		"model",
+		"normalMatrix",
+		"objectColor",
+		"objectTexture",
+		"bUseTexture",
+		"bUseLighting",
+		"UVscale",
+		"material.diffuseColor",
+		"material.specularColor",
+		"material.shininess",
+		"bIsLiquidSurface",
+		"rippleParams",
+		"shadowAtlas",
+		"bDepthOnly",
+		"materialIndex",
+		"objectTextureArray",
+		"shadowView"
+	};
+}
+
+/***********************************************************
+ *  ShaderUniformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderUniformCache::ShaderUniformCache()
+{
+	m_programID = 0;
+	m_uploadCount = 0;
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_locations[i] = -1;
+	}
+	Invalidate();
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method is used for looking up the location of every
+ *  handle once, right after the program has been loaded.
+ *  The program is made current to read back its ID.
+ ***********************************************************/
+bool ShaderUniformCache::Resolve(ShaderManager* pShaderManager)
+{
+	if (NULL == pShaderManager)
+	{
+		return(false);
+	}
+
+	GLint programID = 0;
+	pShaderManager->use();
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	if (programID == 0)
+	{
+		std::cout << "Cannot resolve uniforms: shader program is not loaded" << std::endl;
+		return(false);
+	}
+
+	m_programID = (GLuint)programID;
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_locations[i] = glGetUniformLocation(m_programID, g_UniformNames[i]);
+	}
+	Invalidate();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting the cached values so
+ *  the next set of every uniform is uploaded.
+ ***********************************************************/
+void ShaderUniformCache::Invalidate()
+{
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_values[i].bValid = false;
+	}
+}
+
+/***********************************************************
+ *  HasUniform()
+ *
+ *  This method is used for checking whether the resolved
+ *  program contains an active uniform for the handle.
+ ***********************************************************/
+bool ShaderUniformCache::HasUniform(UNIFORM_ID id) const
+{
+	return(m_locations[id] >= 0);
+}
+
+/***********************************************************
+ *  UpdateCache()
+ *
+ *  This method is used for comparing a new value against the
+ *  last uploaded one.  It returns true and remembers the new
+ *  value when an upload is needed.
+ ***********************************************************/
+bool ShaderUniformCache::UpdateCache(UNIFORM_ID id, const float* data, int count)
+{
+	// uniforms the program does not use are never uploaded
+	if (m_locations[id] < 0)
+	{
+		return(false);
+	}
+
+	CACHED_VALUE& cached = m_values[id];
+	size_t size = sizeof(float) * count;
+	if (cached.bValid && (memcmp(cached.data, data, size) == 0))
+	{
+		return(false);
+	}
+
+	memcpy(cached.data, data, size);
+	cached.bValid = true;
+	m_uploadCount++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetInt()
+ *
+ *  This method is used for setting an int, bool or sampler
+ *  uniform through its handle.
+ ***********************************************************/
+void ShaderUniformCache::SetInt(UNIFORM_ID id, int value)
+{
+	float bits;
+	memcpy(&bits, &value, sizeof(bits));
+	if (UpdateCache(id, &bits, 1))
+	{
+		glUniform1i(m_locations[id], value);
+	}
+}
+
+/***********************************************************
+ *  SetFloat()
+ *
+ *  This method is used for setting a float uniform through
+ *  its handle.
+ ***********************************************************/
+void ShaderUniformCache::SetFloat(UNIFORM_ID id, float value)
+{
+	if (UpdateCache(id, &value, 1))
+	{
+		glUniform1f(m_locations[id], value);
+	}
+}
+
+/***********************************************************
+ *  SetVec2()
+ *
+ *  This method is used for setting a vec2 uniform through
+ *  its handle.
+ ***********************************************************/
+void ShaderUniformCache::SetVec2(UNIFORM_ID id, const glm::vec2& value)
+{
+	if (UpdateCache(id, glm::value_ptr(value), 2))
+	{
+		glUniform2fv(m_locations[id], 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetVec3()
+ *
+ *  This method is used for setting a vec3 uniform through
+ *  its handle.
+ ***********************************************************/
+void ShaderUniformCache::SetVec3(UNIFORM_ID id, const glm::vec3& value)
+{
+	if (UpdateCache(id, glm::value_ptr(value), 3))
+	{
+		glUniform3fv(m_locations[id], 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetVec4()
+ *
+ *  This method is used for setting a vec4 uniform through
+ *  its handle.
+ ***********************************************************/
+void ShaderUniformCache::SetVec4(UNIFORM_ID id, const glm::vec4& value)
+{
+	if (UpdateCache(id, glm::value_ptr(value), 4))
+	{
+		glUniform4fv(m_locations[id], 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetMat3()
+ *
+ *  This method is used for setting a mat3 uniform through
+ *  its handle.
+ ***********************************************************/
+void ShaderUniformCache::SetMat3(UNIFORM_ID id, const glm::mat3& value)
+{
+	if (UpdateCache(id, glm::value_ptr(value), 9))
+	{
+		glUniformMatrix3fv(m_locations[id], 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetMat4()
+ *
+ *  This method is used for setting a mat4 uniform through
+ *  its handle.
+ ***********************************************************/
+void ShaderUniformCache::SetMat4(UNIFORM_ID id, const glm::mat4& value)
+{
+	if (UpdateCache(id, glm::value_ptr(value), 16))
+	{
+		glUniformMatrix4fv(m_locations[id], 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  GetUploadCount()
+ *
+ *  This method is used for reading the number of uniform
+ *  uploads that were not skipped as redundant.
+ ***********************************************************/
+unsigned int ShaderUniformCache::GetUploadCount() const
+{
+	return(m_uploadCount);
+}
+
+/***********************************************************
+ *  ResetUploadCount()
+ *
+ *  This method is used for restarting the upload counter.
+ ***********************************************************/
+void ShaderUniformCache::ResetUploadCount()
+{
+	m_uploadCount = 0;
+}
@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniformcache.h
+// ============
+// resolve shader uniform locations once and skip redundant uniform uploads
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  ShaderUniformCache
+ *
+ *  This class resolves the per-draw uniform names of one
+ *  program into locations when the program is loaded, so
+ *  the draw loop passes small integer handles instead of
+ *  strings.  The last value sent to each uniform is kept,
+ *  and a setter only calls glUniform* when it changes.
+ *
+ *  The setters write to the current program, so the owning
+ *  program must be bound with use() before they are called.
+ ***********************************************************/
+class ShaderUniformCache
+{
+public:
+	// constructor
+	ShaderUniformCache();
+
+	// handles of the uniforms set from C++; keep in step with
+	// the name table in shaderuniformcache.cpp
+	enum UNIFORM_ID
+	{
+		U_MODEL = 0,
+		U_NORMAL_MATRIX,
+		U_OBJECT_COLOR,
+		U_OBJECT_TEXTURE,
+		U_USE_TEXTURE,
+		U_USE_LIGHTING,
+		U_UV_SCALE,
+		U_MATERIAL_DIFFUSE,
+		U_MATERIAL_SPECULAR,
+		U_MATERIAL_SHININESS,
+		U_IS_LIQUID_SURFACE,
+		U_RIPPLE_PARAMS,
+		U_SHADOW_ATLAS,
+		U_DEPTH_ONLY,
+		U_MATERIAL_INDEX,
+		U_OBJECT_TEXTURE_ARRAY,
+		U_SHADOW_VIEW,
+		UNIFORM_COUNT
+	};
+
+private:
+	// last value sent to one uniform, stored as raw 32-bit words
+	struct CACHED_VALUE
+	{
+		float data[16];
+		bool bValid;
+	};
+
+	// program the locations were resolved against
+	GLuint m_programID;
+	// resolved location per handle, -1 when the program lacks it
+	GLint m_locations[UNIFORM_COUNT];
+	// last uploaded value per handle
+	CACHED_VALUE m_values[UNIFORM_COUNT];
+	// number of glUniform* calls actually issued
+	unsigned int m_uploadCount;
+
+	// compare against the cached value and remember the new one;
+	// returns true when an upload is needed
+	bool UpdateCache(UNIFORM_ID id, const float* data, int count);
+
+public:
+	// resolve every handle against the program of the shader manager
+	bool Resolve(ShaderManager* pShaderManager);
+	// forget the cached values, e.g. after the program was relinked
+	void Invalidate();
+
+	// check whether the program uses a uniform
+	bool HasUniform(UNIFORM_ID id) const;
+
+	// set uniform values through their handles
+	void SetInt(UNIFORM_ID id, int value);
+	void SetFloat(UNIFORM_ID id, float value);
+	void SetVec2(UNIFORM_ID id, const glm::vec2& value);
+	void SetVec3(UNIFORM_ID id, const glm::vec3& value);
+	void SetVec4(UNIFORM_ID id, const glm::vec4& value);
+	void SetMat3(UNIFORM_ID id, const glm::mat3& value);
+	void SetMat4(UNIFORM_ID id, const glm::mat4& value);
+
+	// number of uploads issued since the counter was last reset
+	unsigned int GetUploadCount() const;
+	void ResetUploadCount();
+};
@@ -0,0 +1,458 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowatlas.cpp
+// ============
+// share one depth texture between the shadow maps of every shadowed light
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <cstdint>
+
+// declaration of global variables
+namespace
+{
+	// range of ideal sizes, as a factor of the size a light had last
+	// frame, over which it keeps that size, so a light near the edge
+	// of two sizes does not redraw its tiles back and forth
+	const float g_KeepSizeBelow = 0.75f;
+	const float g_KeepSizeAbove = 2.5f;
+
+	// every other bit of a Morton code, packed together
+	uint32_t CompactBits(uint32_t code)
+	{
+		code &= 0x55555555u;
+		code = (code | (code >> 1)) & 0x33333333u;
+		code = (code | (code >> 2)) & 0x0F0F0F0Fu;
+		code = (code | (code >> 4)) & 0x00FF00FFu;
+		code = (code | (code >> 8)) & 0x0000FFFFu;
+
+		return(code);
+	}
+}
+
+/***********************************************************
+ *  ShadowAtlas()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowAtlas::ShadowAtlas()
+{
+	m_atlasFBO = 0;
+	m_atlasTexture = 0;
+	m_staticFBO = 0;
+	m_staticTexture = 0;
+	m_size = 0;
+	m_views.resize(MAX_VIEWS);
+	m_viewCount = 0;
+}
+
+/***********************************************************
+ *  ~ShadowAtlas()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowAtlas::~ShadowAtlas()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  CreateDepthTarget()
+ *
+ *  This method is used for creating a square depth texture
+ *  and a framebuffer that renders into it.  Outside the
+ *  atlas every lookup reads the far plane, so it is lit.
+ ***********************************************************/
+void ShadowAtlas::CreateDepthTarget(int size, GLuint& fbo, GLuint& texture)
+{
+	glGenFramebuffers(1, &fbo);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	// the lit pass samples through sampler2DShadow, so each lookup
+	// compares and filters the 2x2 texels around it in hardware
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  DestroyDepthTarget()
+ *
+ *  This method is used for freeing a depth texture and the
+ *  framebuffer that renders into it.
+ ***********************************************************/
+void ShadowAtlas::DestroyDepthTarget(GLuint& fbo, GLuint& texture)
+{
+	if (texture != 0)
+	{
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+	if (fbo != 0)
+	{
+		glDeleteFramebuffers(1, &fbo);
+		fbo = 0;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the atlas with a number
+ *  of texels along each side.  An atlas of another size is
+ *  replaced, and every tile is drawn again.
+ ***********************************************************/
+bool ShadowAtlas::Create(int size)
+{
+	if ((m_atlasFBO != 0) && (size == m_size))
+	{
+		return(true);
+	}
+
+	Destroy();
+	m_size = size;
+	CreateDepthTarget(m_size, m_atlasFBO, m_atlasTexture);
+	InvalidateTiles(true);
+
+	return((m_atlasFBO != 0) && (m_atlasTexture != 0));
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing both atlases.
+ ***********************************************************/
+void ShadowAtlas::Destroy()
+{
+	DestroyDepthTarget(m_atlasFBO, m_atlasTexture);
+	DestroyDepthTarget(m_staticFBO, m_staticTexture);
+	m_size = 0;
+	m_viewCount = 0;
+}
+
+/***********************************************************
+ *  GetSize()
+ *
+ *  This method is used for reading the texels along each
+ *  side of the atlas.
+ ***********************************************************/
+int ShadowAtlas::GetSize() const
+{
+	return(m_size);
+}
+
+/***********************************************************
+ *  GetTexture()
+ *
+ *  This method is used for getting the depth texture the
+ *  lit pass samples.
+ ***********************************************************/
+GLuint ShadowAtlas::GetTexture() const
+{
+	return(m_atlasTexture);
+}
+
+/***********************************************************
+ *  GetTileSize()
+ *
+ *  This method is used for turning the importance of a light
+ *  into the power of two tile size that covers that share of
+ *  the largest tile.  A light keeps the size it had while
+ *  the ideal size stays close to it.
+ ***********************************************************/
+int ShadowAtlas::GetTileSize(int owner, float importance) const
+{
+	if (importance <= 0.0f)
+	{
+		return(0);
+	}
+
+	int minSize = m_size / MIN_TILE_DIVISOR;
+	int maxSize = m_size / MAX_TILE_DIVISOR;
+	float ideal = glm::min(importance, 1.0f) * (float)maxSize;
+
+	int lastSize = ((size_t)owner < m_ownerSizes.size()) ? m_ownerSizes[owner] : 0;
+	if ((lastSize > 0) &&
+		(ideal >= g_KeepSizeBelow * (float)lastSize) &&
+		(ideal < g_KeepSizeAbove * (float)lastSize))
+	{
+		return(lastSize);
+	}
+
+	int size = minSize;
+	while ((size * 2 <= maxSize) && ((float)(size * 2) <= ideal))
+	{
+		size *= 2;
+	}
+
+	return(size);
+}
+
+/***********************************************************
+ *  AllocateTiles()
+ *
+ *  This method is used for handing out the tiles of a frame.
+ *  The lights are placed from the largest tiles down, each
+ *  at the next free run of smallest tiles in Z order, which
+ *  for powers of two placed largest first is always one
+ *  aligned square.  A light that does not fit is halved
+ *  until it does, and the lights after it are kept no
+ *  larger.  A view whose owner or place changed is drawn
+ *  again.
+ ***********************************************************/
+void ShadowAtlas::AllocateTiles(const std::vector<LIGHT_REQUEST>& requests, std::vector<int>& firstViews)
+{
+	firstViews.assign(requests.size(), -1);
+	m_viewCount = 0;
+	if (m_size == 0)
+	{
+		return;
+	}
+
+	m_sizes.assign(requests.size(), 0);
+	m_order.clear();
+	int maxOwner = -1;
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		m_sizes[i] = GetTileSize(requests[i].owner, requests[i].importance);
+		if (m_sizes[i] > 0)
+		{
+			m_order.push_back((int)i);
+		}
+		maxOwner = std::max(maxOwner, requests[i].owner);
+	}
+	std::stable_sort(m_order.begin(), m_order.end(),
+		[this](int a, int b) { return(m_sizes[a] > m_sizes[b]); });
+
+	int minSize = m_size / MIN_TILE_DIVISOR;
+	uint32_t capacity = (uint32_t)(MIN_TILE_DIVISOR * MIN_TILE_DIVISOR);
+	uint32_t used = 0;
+	int sizeLimit = m_size / MAX_TILE_DIVISOR;
+	m_ownerSizes.assign((size_t)(maxOwner + 1), 0);
+	for (size_t i = 0; i < m_order.size(); i++)
+	{
+		const LIGHT_REQUEST& request = requests[m_order[i]];
+		if (m_viewCount + request.viewCount > MAX_VIEWS)
+			continue;
+
+		int size = std::min(m_sizes[m_order[i]], sizeLimit);
+		uint32_t units = (uint32_t)((size / minSize) * (size / minSize));
+		while ((size >= minSize) && (used + units * (uint32_t)request.viewCount > capacity))
+		{
+			size /= 2;
+			units = (uint32_t)((size / minSize) * (size / minSize));
+		}
+		if (size < minSize)
+		{
+			sizeLimit = 0;
+			continue;
+		}
+		sizeLimit = size;
+
+		firstViews[m_order[i]] = m_viewCount;
+		m_ownerSizes[request.owner] = size;
+		for (int v = 0; v < request.viewCount; v++)
+		{
+			TILE tile;
+			tile.x = (int)CompactBits(used) * minSize;
+			tile.y = (int)CompactBits(used >> 1) * minSize;
+			tile.size = size;
+			used += units;
+
+			VIEW_STATE& view = m_views[m_viewCount];
+			if ((view.owner != request.owner) || (view.tile.x != tile.x) ||
+				(view.tile.y != tile.y) || (view.tile.size != tile.size))
+			{
+				view.owner = request.owner;
+				view.tile = tile;
+				view.bStaticValid = false;
+				view.bValid = false;
+			}
+			m_viewCount++;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetViewCount()
+ *
+ *  This method is used for reading how many views got a
+ *  tile in the last allocation.
+ ***********************************************************/
+int ShadowAtlas::GetViewCount() const
+{
+	return(m_viewCount);
+}
+
+/***********************************************************
+ *  GetTile()
+ *
+ *  This method is used for reading the tile of a view.
+ ***********************************************************/
+const ShadowAtlas::TILE& ShadowAtlas::GetTile(int view) const
+{
+	return(m_views[view].tile);
+}
+
+/***********************************************************
+ *  SetViewMatrix()
+ *
+ *  This method is used for setting the light matrix of a
+ *  view.  A matrix within the tolerance of the one the tile
+ *  was drawn with keeps that one, so lookups stay consistent
+ *  with the depth in the tile.
+ ***********************************************************/
+void ShadowAtlas::SetViewMatrix(int view, const glm::mat4& matrix, float tolerance)
+{
+	VIEW_STATE& state = m_views[view];
+	float change = 0.0f;
+	for (int column = 0; column < 4; column++)
+	{
+		glm::vec4 delta = glm::abs(matrix[column] - state.matrix[column]);
+		change = glm::max(change, glm::max(glm::max(delta.x, delta.y), glm::max(delta.z, delta.w)));
+	}
+	if (change > tolerance)
+	{
+		state.matrix = matrix;
+		state.bStaticValid = false;
+		state.bValid = false;
+	}
+}
+
+/***********************************************************
+ *  GetViewMatrix()
+ *
+ *  This method is used for reading the light matrix a view
+ *  is drawn and looked up with.
+ ***********************************************************/
+const glm::mat4& ShadowAtlas::GetViewMatrix(int view) const
+{
+	return(m_views[view].matrix);
+}
+
+/***********************************************************
+ *  InvalidateTiles()
+ *
+ *  This method is used for marking every tile for drawing,
+ *  and optionally the static layer of every tile as well.
+ ***********************************************************/
+void ShadowAtlas::InvalidateTiles(bool bStaticLayers)
+{
+	for (size_t i = 0; i < m_views.size(); i++)
+	{
+		m_views[i].bValid = false;
+		if (bStaticLayers)
+		{
+			m_views[i].bStaticValid = false;
+		}
+	}
+}
+
+/***********************************************************
+ *  IsTileValid()
+ *
+ *  This method is used for checking whether the atlas tile
+ *  of a view still holds every caster.
+ ***********************************************************/
+bool ShadowAtlas::IsTileValid(int view) const
+{
+	return(m_views[view].bValid);
+}
+
+/***********************************************************
+ *  IsStaticTileValid()
+ *
+ *  This method is used for checking whether the static
+ *  layer of a view is still current.
+ ***********************************************************/
+bool ShadowAtlas::IsStaticTileValid(int view) const
+{
+	return(m_views[view].bStaticValid && (m_staticFBO != 0));
+}
+
+/***********************************************************
+ *  BeginTile()
+ *
+ *  This method is used for binding the tile of a view,
+ *  clipped to its square, and clearing it.  The atlas of
+ *  the static casters is created on its first use.  The
+ *  depth mask must be on for the clear.
+ ***********************************************************/
+void ShadowAtlas::BeginTile(int view, bool bStaticLayer)
+{
+	VIEW_STATE& state = m_views[view];
+	if (bStaticLayer && (m_staticFBO == 0))
+	{
+		CreateDepthTarget(m_size, m_staticFBO, m_staticTexture);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, bStaticLayer ? m_staticFBO : m_atlasFBO);
+	glViewport(state.tile.x, state.tile.y, state.tile.size, state.tile.size);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(state.tile.x, state.tile.y, state.tile.size, state.tile.size);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	if (bStaticLayer)
+	{
+		state.bStaticValid = true;
+	}
+	else
+	{
+		state.bValid = true;
+	}
+}
+
+/***********************************************************
+ *  BeginTileFromStatic()
+ *
+ *  This method is used for copying the static layer of a
+ *  view into its atlas tile and binding the tile, so the
+ *  moving casters are drawn over the static ones.
+ ***********************************************************/
+void ShadowAtlas::BeginTileFromStatic(int view)
+{
+	VIEW_STATE& state = m_views[view];
+	const TILE& tile = state.tile;
+
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(tile.x, tile.y, tile.size, tile.size);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staticFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_atlasFBO);
+	glBlitFramebuffer(
+		tile.x, tile.y, tile.x + tile.size, tile.y + tile.size,
+		tile.x, tile.y, tile.x + tile.size, tile.y + tile.size,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_atlasFBO);
+	glViewport(tile.x, tile.y, tile.size, tile.size);
+
+	state.bValid = true;
+}
+
+/***********************************************************
+ *  EndTiles()
+ *
+ *  This method is used for unbinding the atlas and turning
+ *  the clipping to a tile off again.
+ ***********************************************************/
+void ShadowAtlas::EndTiles()
+{
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowatlas.h
+// ============
+// share one depth texture between the shadow maps of every shadowed light
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  ShadowAtlas
+ *
+ *  This class splits one square depth texture into tiles,
+ *  one per view of a shadowed light: a spotlight or a
+ *  directional light has one view, a point light one per
+ *  cube face.  Every frame the lights ask for tiles by how
+ *  much of the screen their shadows matter on; the sizes
+ *  are powers of two, so the tiles sorted from large to
+ *  small pack the atlas in Z order without gaps, and the
+ *  lights that no longer fit drop to smaller tiles or none.
+ *
+ *  A tile keeps its depth between frames for as long as its
+ *  place, its light matrix and the casters stay the same,
+ *  so only the views that changed are drawn again.  Where
+ *  casters move, a second atlas keeps the static casters of
+ *  every tile, and the moving ones are drawn over a copy.
+ ***********************************************************/
+class ShadowAtlas
+{
+public:
+	// constructor
+	ShadowAtlas();
+	// destructor
+	~ShadowAtlas();
+
+	// one shadowed light of a frame
+	struct LIGHT_REQUEST
+	{
+		// number of the light that stays the same across frames
+		int owner = 0;
+		// views of the light, each with a tile of the same size
+		int viewCount = 1;
+		// share of the screen the shadows of the light fall on, from
+		// 0 for none, which gets no tile, to 1
+		float importance = 0.0f;
+	};
+
+	// square of the atlas one view draws into, in texels
+	struct TILE
+	{
+		int x = 0;
+		int y = 0;
+		int size = 0;
+	};
+
+private:
+	// tile and cache state of one view
+	struct VIEW_STATE
+	{
+		TILE tile;
+		int owner = -1;
+		glm::mat4 matrix = glm::mat4(1.0f);
+		// set while the static layer of the tile is current
+		bool bStaticValid = false;
+		// set while the atlas tile holds every caster
+		bool bValid = false;
+	};
+
+	// atlas sampled by the lit pass, and the static casters alone
+	GLuint m_atlasFBO;
+	GLuint m_atlasTexture;
+	GLuint m_staticFBO;
+	GLuint m_staticTexture;
+	// texels along each side of the atlas
+	int m_size;
+
+	std::vector<VIEW_STATE> m_views;
+	int m_viewCount;
+	// tile size each owner had last frame, to hold it steady
+	std::vector<int> m_ownerSizes;
+	// requests in the order they are placed, and their sizes
+	std::vector<int> m_order;
+	std::vector<int> m_sizes;
+
+	// create a depth texture and a framebuffer that draws into it
+	static void CreateDepthTarget(int size, GLuint& fbo, GLuint& texture);
+	// free a depth texture and its framebuffer
+	static void DestroyDepthTarget(GLuint& fbo, GLuint& texture);
+	// tile size for an importance, kept while it stays near the last
+	int GetTileSize(int owner, float importance) const;
+
+public:
+	// most views of one frame; must match MAX_SHADOW_VIEWS in the shaders
+	static const int MAX_VIEWS = 32;
+	// smallest and largest tile as a fraction of the atlas side
+	static const int MIN_TILE_DIVISOR = 32;
+	static const int MAX_TILE_DIVISOR = 2;
+
+	// create the atlas with a number of texels along each side
+	bool Create(int size);
+	// free the textures and framebuffers
+	void Destroy();
+	int GetSize() const;
+	// depth texture sampled by the lit pass
+	GLuint GetTexture() const;
+
+	// lay out the tiles of the lights of a frame; the views of a
+	// light are the consecutive ones from its entry in firstViews,
+	// or it has none there and the entry is -1
+	void AllocateTiles(const std::vector<LIGHT_REQUEST>& requests, std::vector<int>& firstViews);
+	int GetViewCount() const;
+	const TILE& GetTile(int view) const;
+	// set the light matrix of a view; one that changed by more than
+	// a tolerance has its tile drawn again
+	void SetViewMatrix(int view, const glm::mat4& matrix, float tolerance);
+	const glm::mat4& GetViewMatrix(int view) const;
+
+	// forget the drawn tiles, and the static layers with them when
+	// the static casters changed
+	void InvalidateTiles(bool bStaticLayers);
+	// whether a view still holds all casters, or the static ones
+	bool IsTileValid(int view) const;
+	bool IsStaticTileValid(int view) const;
+	// bind and clear the tile of a view in the atlas, or in the
+	// atlas of the static casters, and mark it drawn
+	void BeginTile(int view, bool bStaticLayer);
+	// start the atlas tile of a view from its static casters, to
+	// draw the moving casters over them, and mark it drawn
+	void BeginTileFromStatic(int view);
+	// unbind the atlas and stop clipping to a tile
+	void EndTiles();
+};
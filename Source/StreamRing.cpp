@@ -0,0 +1,251 @@
+///////////////////////////////////////////////////////////////////////////////
+// streamring.cpp
+// ============
+// stream per-frame data through a persistently mapped, fenced ring buffer
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StreamRing.h"
+
+// declaration of global variables
+namespace
+{
+	// longest single wait for a fence; waiting repeats until it passes
+	const GLuint64 g_FenceWaitNanoseconds = 100000000;
+	// flags the buffer is created and mapped with
+	const GLbitfield g_MapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+/***********************************************************
+ *  StreamRing()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StreamRing::StreamRing()
+{
+	m_buffer = 0;
+	m_pMapped = NULL;
+	m_regionSize = 0;
+	m_head = 0;
+	m_region = 0;
+	m_demand = 0;
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		m_fences[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~StreamRing()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StreamRing::~StreamRing()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking for buffer storage,
+ *  which keeps a buffer mapped while the GPU reads it.
+ ***********************************************************/
+bool StreamRing::IsSupported()
+{
+	return(GLEW_ARB_buffer_storage != 0);
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating the immutable buffer of
+ *  every region and mapping all of it once.  The copy target
+ *  is used so no binding of the draws is disturbed.
+ ***********************************************************/
+bool StreamRing::CreateBuffer(size_t regionSize)
+{
+	GLsizeiptr size = (GLsizeiptr)(regionSize * REGION_COUNT);
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, g_MapFlags);
+	m_pMapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, g_MapFlags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (m_pMapped == NULL)
+	{
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+		return(false);
+	}
+
+	m_regionSize = regionSize;
+	m_head = 0;
+	m_region = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyBuffer()
+ *
+ *  This method is used for unmapping and freeing the
+ *  buffer.  Draws still queued keep reading the old storage
+ *  until they finish, so the fences are simply dropped.
+ ***********************************************************/
+void StreamRing::DestroyBuffer()
+{
+	if (m_buffer != 0)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+	m_pMapped = NULL;
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		if (m_fences[i] != NULL)
+		{
+			glDeleteSync(m_fences[i]);
+			m_fences[i] = NULL;
+		}
+	}
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the ring with a region
+ *  size in bytes that later frames can grow.
+ ***********************************************************/
+bool StreamRing::Create(size_t regionSize)
+{
+	if ((m_buffer != 0) || !IsSupported() || (regionSize == 0))
+	{
+		return(m_buffer != 0);
+	}
+
+	m_demand = 0;
+
+	return(CreateBuffer(regionSize));
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the buffer.
+ ***********************************************************/
+void StreamRing::Destroy()
+{
+	DestroyBuffer();
+	m_regionSize = 0;
+	m_head = 0;
+	m_region = 0;
+	m_demand = 0;
+}
+
+/***********************************************************
+ *  GetBuffer()
+ *
+ *  This method is used for getting the buffer object the
+ *  allocations are made in.
+ ***********************************************************/
+GLuint StreamRing::GetBuffer() const
+{
+	return(m_buffer);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for handing out room in the region
+ *  of the current frame.  The request counts toward the
+ *  demand of the frame even when it does not fit, so the
+ *  next region size covers the whole frame.
+ ***********************************************************/
+void* StreamRing::Allocate(size_t size, size_t alignment, GLintptr& offset)
+{
+	if (alignment == 0)
+	{
+		alignment = 1;
+	}
+
+	// upper bound of the room the request takes, with its padding
+	m_demand += size + alignment - 1;
+	size_t start = (m_head + alignment - 1) & ~(alignment - 1);
+	if ((m_pMapped == NULL) || (size == 0) || (start + size > m_regionSize))
+	{
+		return(NULL);
+	}
+
+	m_head = start + size;
+	offset = (GLintptr)(m_regionSize * m_region + start);
+
+	return(m_pMapped + offset);
+}
+
+/***********************************************************
+ *  WaitForRegion()
+ *
+ *  This method is used for blocking until the frame that
+ *  last wrote a region is finished on the GPU.  With three
+ *  regions this only waits when the GPU is two frames
+ *  behind.
+ ***********************************************************/
+void StreamRing::WaitForRegion(int region)
+{
+	if (m_fences[region] == NULL)
+	{
+		return;
+	}
+
+	while (glClientWaitSync(m_fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceWaitNanoseconds) == GL_TIMEOUT_EXPIRED)
+	{
+	}
+	glDeleteSync(m_fences[region]);
+	m_fences[region] = NULL;
+}
+
+/***********************************************************
+ *  FinishFrame()
+ *
+ *  This method is used for closing the region of the frame
+ *  behind a fence and making the next region ready to be
+ *  written.  When the frame asked for more than a region
+ *  holds, the buffer is recreated with twice that room, so
+ *  the ring settles after a frame or two of fallbacks.
+ ***********************************************************/
+void StreamRing::FinishFrame()
+{
+	if (m_buffer == 0)
+	{
+		m_demand = 0;
+		return;
+	}
+
+	if (m_demand > m_regionSize)
+	{
+		size_t regionSize = m_demand * 2;
+		DestroyBuffer();
+		if (!CreateBuffer(regionSize))
+		{
+			m_regionSize = 0;
+		}
+		m_demand = 0;
+		return;
+	}
+
+	if (m_head > 0)
+	{
+		m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	m_region = (m_region + 1) % REGION_COUNT;
+	m_head = 0;
+	m_demand = 0;
+	WaitForRegion(m_region);
+}
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// streamring.h
+// ============
+// stream per-frame data through a persistently mapped, fenced ring buffer
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  StreamRing
+ *
+ *  This class keeps one buffer object, mapped once for its
+ *  whole lifetime, cut into a region per frame in flight.
+ *  A frame writes its data straight into its region and the
+ *  draws read it from there, so nothing is copied by the
+ *  driver and no buffer is orphaned.
+ *
+ *  Each region is fenced when its frame is finished, and
+ *  the ring waits for that fence before the region is
+ *  written again, so the CPU never overwrites data the GPU
+ *  still reads.  A frame that asks for more than a region
+ *  holds gets NULL back and the caller uploads the usual
+ *  way; the regions grow to fit at the end of the frame.
+ ***********************************************************/
+class StreamRing
+{
+public:
+	// constructor
+	StreamRing();
+	// destructor
+	~StreamRing();
+
+	// frames that can be in flight at once
+	static const int REGION_COUNT = 3;
+
+private:
+	GLuint m_buffer;
+	unsigned char* m_pMapped;
+	// bytes per region and the position of the next allocation in
+	// the current region
+	size_t m_regionSize;
+	size_t m_head;
+	int m_region;
+	// fence of the last frame that wrote each region
+	GLsync m_fences[REGION_COUNT];
+	// bytes this frame asked for, including the ones refused
+	size_t m_demand;
+
+	// create the buffer for a region size and map it
+	bool CreateBuffer(size_t regionSize);
+	// unmap and free the buffer and forget the fences
+	void DestroyBuffer();
+	// wait until the GPU finished reading a region
+	void WaitForRegion(int region);
+
+public:
+	// check for persistent buffer mapping; call with a current
+	// OpenGL context
+	static bool IsSupported();
+
+	// create the ring with a starting region size in bytes
+	bool Create(size_t regionSize);
+	// free the buffer
+	void Destroy();
+
+	// buffer object every allocation lives in; bind it to any target
+	GLuint GetBuffer() const;
+	// room in the current region for a number of bytes, aligned to
+	// a power of two; offset receives its place in the buffer; NULL
+	// when the region is full or the ring was not created
+	void* Allocate(size_t size, size_t alignment, GLintptr& offset);
+	// fence the region of the finished frame and move on to the
+	// next one, growing the regions when this frame ran out of room
+	void FinishFrame();
+};
@@ -0,0 +1,518 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ============
+// block-compress texture images with mip chains and cache them as DDS files
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.h"
+#include "AtomicFile.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// DDS file layout; the header is 31 little-endian words after
+	// the magic number, followed by an optional DX10 extension
+	const uint32_t g_DDSMagic = 0x20534444; // "DDS "
+	const int g_DDSHeaderWords = 31;
+	const int g_DX10HeaderWords = 5;
+
+	const uint32_t DDSD_CAPS = 0x1;
+	const uint32_t DDSD_HEIGHT = 0x2;
+	const uint32_t DDSD_WIDTH = 0x4;
+	const uint32_t DDSD_PIXELFORMAT = 0x1000;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_LINEARSIZE = 0x80000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDSCAPS_COMPLEX = 0x8;
+	const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+	// DXGI formats accepted from DX10 headers
+	const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+	const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+	const uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+
+	uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return((uint32_t)(unsigned char)a | ((uint32_t)(unsigned char)b << 8) |
+			((uint32_t)(unsigned char)c << 16) | ((uint32_t)(unsigned char)d << 24));
+	}
+
+	// bytes per 4x4 block of a compressed format
+	int GetBlockBytes(GLenum format)
+	{
+		return(((format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ||
+			(format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)) ? 8 : 16);
+	}
+
+	// pack and unpack colors of the BC1 endpoint format
+	uint16_t To565(const int color[3])
+	{
+		return((uint16_t)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3)));
+	}
+
+	void From565(uint16_t packed, int color[3])
+	{
+		int r = (packed >> 11) & 0x1F;
+		int g = (packed >> 5) & 0x3F;
+		int b = packed & 0x1F;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	void WriteLittleEndian(unsigned char* pOut, uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; i++)
+		{
+			pOut[i] = (unsigned char)((value >> (8 * i)) & 0xFF);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for naming the cache file of a source
+ *  image; it sits next to the source.
+ ***********************************************************/
+std::string TextureCache::GetCachePath(const std::string& sourceFile)
+{
+	return(sourceFile + ".cache.dds");
+}
+
+/***********************************************************
+ *  IsCacheFresh()
+ *
+ *  This method is used for checking that a cache file exists
+ *  and was written after the source image last changed.
+ ***********************************************************/
+bool TextureCache::IsCacheFresh(const std::string& sourceFile, const std::string& cacheFile)
+{
+	struct stat sourceInfo;
+	struct stat cacheInfo;
+	if (stat(cacheFile.c_str(), &cacheInfo) != 0)
+	{
+		return(false);
+	}
+	if (stat(sourceFile.c_str(), &sourceInfo) != 0)
+	{
+		// the cache still serves when only it was shipped
+		return(true);
+	}
+
+	return(cacheInfo.st_mtime >= sourceInfo.st_mtime);
+}
+
+/***********************************************************
+ *  CompressColorBlock()
+ *
+ *  This method is used for encoding the colors of a 4x4
+ *  block as BC1.  The endpoints span the bounding box of the
+ *  block colors, inset slightly, and every pixel takes the
+ *  nearest of the four palette entries.
+ ***********************************************************/
+void TextureCache::CompressColorBlock(const unsigned char block[16][4], unsigned char* pOut)
+{
+	int minColor[3] = { 255, 255, 255 };
+	int maxColor[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			minColor[c] = std::min(minColor[c], (int)block[i][c]);
+			maxColor[c] = std::max(maxColor[c], (int)block[i][c]);
+		}
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		int inset = (maxColor[c] - minColor[c]) >> 4;
+		minColor[c] += inset;
+		maxColor[c] -= inset;
+	}
+
+	uint16_t color0 = To565(maxColor);
+	uint16_t color1 = To565(minColor);
+	// color0 > color1 selects the four color palette
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	int palette[4][3];
+	From565(color0, palette[0]);
+	From565(color1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestError = 0x7FFFFFFF;
+			for (int p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int delta = (int)block[i][c] - palette[p][c];
+					error += delta * delta;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			indices |= (uint32_t)bestIndex << (2 * i);
+		}
+	}
+
+	WriteLittleEndian(pOut, color0, 2);
+	WriteLittleEndian(pOut + 2, color1, 2);
+	WriteLittleEndian(pOut + 4, indices, 4);
+}
+
+/***********************************************************
+ *  CompressAlphaBlock()
+ *
+ *  This method is used for encoding the alpha of a 4x4
+ *  block as the alpha half of BC3, with the block minimum
+ *  and maximum as endpoints and six values between them.
+ ***********************************************************/
+void TextureCache::CompressAlphaBlock(const unsigned char block[16][4], unsigned char* pOut)
+{
+	int alpha0 = 0;
+	int alpha1 = 255;
+	for (int i = 0; i < 16; i++)
+	{
+		alpha0 = std::max(alpha0, (int)block[i][3]);
+		alpha1 = std::min(alpha1, (int)block[i][3]);
+	}
+
+	uint64_t indices = 0;
+	if (alpha0 != alpha1)
+	{
+		// alpha0 > alpha1 selects the eight value palette
+		int palette[8];
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		for (int k = 1; k <= 6; k++)
+		{
+			palette[k + 1] = ((7 - k) * alpha0 + k * alpha1) / 7;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestError = 256;
+			for (int p = 0; p < 8; p++)
+			{
+				int error = std::abs((int)block[i][3] - palette[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			indices |= (uint64_t)bestIndex << (3 * i);
+		}
+	}
+
+	pOut[0] = (unsigned char)alpha0;
+	pOut[1] = (unsigned char)alpha1;
+	WriteLittleEndian(pOut + 2, indices, 6);
+}
+
+/***********************************************************
+ *  Downsample()
+ *
+ *  This method is used for halving an RGBA image with a 2x2
+ *  box filter.  Odd edges repeat their last row or column.
+ ***********************************************************/
+void TextureCache::Downsample(
+	const std::vector<unsigned char>& source,
+	int width,
+	int height,
+	std::vector<unsigned char>& target)
+{
+	int targetWidth = std::max(1, width / 2);
+	int targetHeight = std::max(1, height / 2);
+	target.resize((size_t)targetWidth * (size_t)targetHeight * 4);
+
+	for (int y = 0; y < targetHeight; y++)
+	{
+		int y0 = std::min(2 * y, height - 1);
+		int y1 = std::min(2 * y + 1, height - 1);
+		for (int x = 0; x < targetWidth; x++)
+		{
+			int x0 = std::min(2 * x, width - 1);
+			int x1 = std::min(2 * x + 1, width - 1);
+			for (int c = 0; c < 4; c++)
+			{
+				int sum =
+					source[((size_t)y0 * width + x0) * 4 + c] +
+					source[((size_t)y0 * width + x1) * 4 + c] +
+					source[((size_t)y1 * width + x0) * 4 + c] +
+					source[((size_t)y1 * width + x1) * 4 + c];
+				target[((size_t)y * targetWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  Compress()
+ *
+ *  This method is used for building the full mip chain of a
+ *  decoded image and compressing every level, BC1 for RGB
+ *  images and BC3 for RGBA images.
+ ***********************************************************/
+void TextureCache::Compress(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	int channels,
+	COMPRESSED_IMAGE& image)
+{
+	bool bAlpha = (channels == 4);
+	image.format = bAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	image.levels.clear();
+	image.data.clear();
+	int blockBytes = GetBlockBytes(image.format);
+
+	// work in RGBA so every level downsamples the same way
+	std::vector<unsigned char> level((size_t)width * (size_t)height * 4);
+	for (size_t i = 0; i < (size_t)width * (size_t)height; i++)
+	{
+		level[i * 4 + 0] = pixels[i * channels + 0];
+		level[i * 4 + 1] = pixels[i * channels + 1];
+		level[i * 4 + 2] = pixels[i * channels + 2];
+		level[i * 4 + 3] = bAlpha ? pixels[i * channels + 3] : 255;
+	}
+
+	std::vector<unsigned char> nextLevel;
+	while (true)
+	{
+		MIP_LEVEL mip;
+		mip.width = width;
+		mip.height = height;
+		mip.offset = image.data.size();
+		int blocksWide = (width + 3) / 4;
+		int blocksHigh = (height + 3) / 4;
+		mip.size = (size_t)blocksWide * (size_t)blocksHigh * blockBytes;
+		image.data.resize(mip.offset + mip.size);
+
+		unsigned char* pOut = &image.data[mip.offset];
+		for (int by = 0; by < blocksHigh; by++)
+		{
+			for (int bx = 0; bx < blocksWide; bx++)
+			{
+				// gather the block, repeating edge pixels of small levels
+				unsigned char block[16][4];
+				for (int py = 0; py < 4; py++)
+				{
+					int y = std::min(by * 4 + py, height - 1);
+					for (int px = 0; px < 4; px++)
+					{
+						int x = std::min(bx * 4 + px, width - 1);
+						memcpy(block[py * 4 + px], &level[((size_t)y * width + x) * 4], 4);
+					}
+				}
+
+				if (bAlpha)
+				{
+					CompressAlphaBlock(block, pOut);
+					CompressColorBlock(block, pOut + 8);
+				}
+				else
+				{
+					CompressColorBlock(block, pOut);
+				}
+				pOut += blockBytes;
+			}
+		}
+		image.levels.push_back(mip);
+
+		if ((width == 1) && (height == 1))
+		{
+			break;
+		}
+		Downsample(level, width, height, nextLevel);
+		level.swap(nextLevel);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+}
+
+/***********************************************************
+ *  LoadDDS()
+ *
+ *  This method is used for reading a block-compressed DDS
+ *  file with all the mip levels it contains.
+ ***********************************************************/
+bool TextureCache::LoadDDS(const std::string& filename, COMPRESSED_IMAGE& image)
+{
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return(false);
+	}
+	std::vector<unsigned char> bytes(
+		(std::istreambuf_iterator<char>(file)),
+		std::istreambuf_iterator<char>());
+
+	size_t headerBytes = 4 + g_DDSHeaderWords * 4;
+	if (bytes.size() < headerBytes)
+	{
+		return(false);
+	}
+
+	uint32_t magic = 0;
+	uint32_t header[g_DDSHeaderWords];
+	memcpy(&magic, &bytes[0], 4);
+	memcpy(header, &bytes[4], sizeof(header));
+	if ((magic != g_DDSMagic) || (header[0] != 124) || ((header[19] & DDPF_FOURCC) == 0))
+	{
+		std::cout << "Not a block-compressed DDS file:" << filename << std::endl;
+		return(false);
+	}
+
+	image.format = 0;
+	uint32_t fourCC = header[20];
+	if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+	{
+		image.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	}
+	else if (fourCC == MakeFourCC('D', 'X', 'T', '5'))
+	{
+		image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+	else if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (bytes.size() < headerBytes + g_DX10HeaderWords * 4)
+		{
+			return(false);
+		}
+		uint32_t dxgiFormat = 0;
+		memcpy(&dxgiFormat, &bytes[headerBytes], 4);
+		headerBytes += g_DX10HeaderWords * 4;
+
+		if (dxgiFormat == DXGI_FORMAT_BC1_UNORM)
+			image.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		else if (dxgiFormat == DXGI_FORMAT_BC3_UNORM)
+			image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		else if (dxgiFormat == DXGI_FORMAT_BC7_UNORM)
+			image.format = GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+	if (image.format == 0)
+	{
+		std::cout << "Unsupported DDS format in " << filename << std::endl;
+		return(false);
+	}
+
+	int width = (int)header[3];
+	int height = (int)header[2];
+	int levelCount = 1;
+	if ((header[1] & DDSD_MIPMAPCOUNT) && (header[6] > 0))
+	{
+		levelCount = (int)header[6];
+	}
+
+	int blockBytes = GetBlockBytes(image.format);
+	image.levels.clear();
+	size_t offset = 0;
+	size_t dataBytes = bytes.size() - headerBytes;
+	for (int i = 0; (i < levelCount) && (width > 0) && (height > 0); i++)
+	{
+		MIP_LEVEL mip;
+		mip.width = width;
+		mip.height = height;
+		mip.offset = offset;
+		mip.size = (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * blockBytes;
+		if (offset + mip.size > dataBytes)
+		{
+			std::cout << "Truncated DDS file:" << filename << std::endl;
+			return(false);
+		}
+		image.levels.push_back(mip);
+		offset += mip.size;
+
+		if ((width == 1) && (height == 1))
+			break;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	image.data.assign(bytes.begin() + headerBytes, bytes.begin() + headerBytes + offset);
+
+	return(!image.levels.empty());
+}
+
+/***********************************************************
+ *  SaveDDS()
+ *
+ *  This method is used for writing a compressed image as a
+ *  DXT1 or DXT5 DDS file, replacing the cached one through
+ *  AtomicFile.
+ ***********************************************************/
+bool TextureCache::SaveDDS(const std::string& filename, const COMPRESSED_IMAGE& image)
+{
+	if (image.levels.empty() ||
+		((image.format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT) &&
+		 (image.format != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)))
+	{
+		return(false);
+	}
+
+	uint32_t header[g_DDSHeaderWords];
+	memset(header, 0, sizeof(header));
+	header[0] = 124;
+	header[1] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header[2] = (uint32_t)image.levels[0].height;
+	header[3] = (uint32_t)image.levels[0].width;
+	header[4] = (uint32_t)image.levels[0].size;
+	header[6] = (uint32_t)image.levels.size();
+	header[18] = 32;
+	header[19] = DDPF_FOURCC;
+	header[20] = (image.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ?
+		MakeFourCC('D', 'X', 'T', '1') : MakeFourCC('D', 'X', 'T', '5');
+	header[26] = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+	std::string tempFile = AtomicFile::GetTempFile(filename);
+	{
+		std::ofstream file(tempFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return(false);
+		}
+		file.write((const char*)&g_DDSMagic, 4);
+		file.write((const char*)header, sizeof(header));
+		file.write((const char*)image.data.data(), (std::streamsize)image.data.size());
+		if (!file.good())
+		{
+			file.close();
+			std::remove(tempFile.c_str());
+			return(false);
+		}
+	}
+
+	return(AtomicFile::Replace(tempFile, filename));
+}
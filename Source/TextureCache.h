@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ============
+// block-compress texture images with mip chains and cache them as DDS files
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  This class turns decoded images into BC1 (RGB) or BC3
+ *  (RGBA) textures with a full mip chain, and stores them
+ *  next to the source image as <image>.cache.dds.  Later
+ *  startups read the cached file instead of decoding the
+ *  image, as long as it is newer than the source.
+ *
+ *  DDS files are read with DXT1, DXT5 or DX10 BC1/BC3/BC7
+ *  data.  Rows are expected bottom-up as OpenGL samples
+ *  them, which is how the cache writes them.
+ *
+ *  Only static methods are provided; every call is safe to
+ *  make from the loader worker threads.
+ ***********************************************************/
+class TextureCache
+{
+public:
+	// one level of a mip chain inside COMPRESSED_IMAGE::data
+	struct MIP_LEVEL
+	{
+		int width = 0;
+		int height = 0;
+		size_t offset = 0;
+		size_t size = 0;
+	};
+
+	// a block-compressed texture with all its mip levels
+	struct COMPRESSED_IMAGE
+	{
+		GLenum format = 0;
+		std::vector<MIP_LEVEL> levels;
+		std::vector<unsigned char> data;
+	};
+
+	// name of the cache file for a source image
+	static std::string GetCachePath(const std::string& sourceFile);
+	// check whether a cache file exists and is newer than its source
+	static bool IsCacheFresh(const std::string& sourceFile, const std::string& cacheFile);
+
+	// build the mip chain of an 8-bit RGB or RGBA image and
+	// compress every level
+	static void Compress(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int channels,
+		COMPRESSED_IMAGE& image);
+
+	// read and write block-compressed DDS files
+	static bool LoadDDS(const std::string& filename, COMPRESSED_IMAGE& image);
+	static bool SaveDDS(const std::string& filename, const COMPRESSED_IMAGE& image);
+
+private:
+	// compress one 4x4 block of RGBA pixels
+	static void CompressColorBlock(const unsigned char block[16][4], unsigned char* pOut);
+	static void CompressAlphaBlock(const unsigned char block[16][4], unsigned char* pOut);
+	// halve an RGBA image with a box filter
+	static void Downsample(
+		const std::vector<unsigned char>& source,
+		int width,
+		int height,
+		std::vector<unsigned char>& target);
+};
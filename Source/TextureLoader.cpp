@@ -0,0 +1,851 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture images on worker threads and stream them to the GPU
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+
+// the implementation is compiled into scenemanager.cpp
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// size of the staging ring; one 2048 x 2048 RGBA image fits
+	const size_t g_StagingSize = 16 * 1024 * 1024;
+
+	// longest single wait for a staging fence when blocking
+	const GLuint64 g_FenceWaitNanoseconds = 100000000;
+
+	// check the extension of an image filename
+	bool IsDDSFile(const std::string& filename)
+	{
+		size_t length = filename.size();
+		if (length < 4)
+		{
+			return(false);
+		}
+		std::string extension = filename.substr(length - 4);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		return(extension == ".dds");
+	}
+}
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader()
+{
+	m_pendingCount = 0;
+	m_bStopping = false;
+	m_bCompressTextures = false;
+	m_anisotropy = 1.0f;
+	m_maxAnisotropy = 1.0f;
+	m_stagingPBO = 0;
+	m_pMappedStaging = NULL;
+	m_stagingSize = 0;
+	m_stagingHead = 0;
+	m_bPersistentStaging = false;
+	m_textureArray = 0;
+	m_arrayWidth = 0;
+	m_arrayHeight = 0;
+	m_arrayLayers = 0;
+	m_arrayLevels = 0;
+	m_arrayFormat = 0;
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for creating the staging ring and
+ *  starting the worker threads.  The texture format support
+ *  of the driver is read here, on the GL thread.
+ ***********************************************************/
+void TextureLoader::Start(int workerCount)
+{
+	if (!m_workers.empty())
+	{
+		return;
+	}
+
+	// the flip flag is global to stb_image, so set it once here
+	// rather than from the workers
+	stbi_set_flip_vertically_on_load(true);
+
+	m_bCompressTextures = (GLEW_EXT_texture_compression_s3tc != 0);
+	m_maxAnisotropy = 1.0f;
+	if (GLEW_EXT_texture_filter_anisotropic)
+	{
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &m_maxAnisotropy);
+	}
+
+	CreateStaging();
+
+	m_bStopping = false;
+	if (workerCount < 1)
+	{
+		workerCount = 1;
+	}
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&TextureLoader::WorkerMain, this));
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for joining the worker threads and
+ *  freeing every image and GPU object still held.
+ ***********************************************************/
+void TextureLoader::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_workAvailable.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	for (size_t i = 0; i < m_decoded.size(); i++)
+	{
+		if (m_decoded[i].pixels != NULL)
+		{
+			stbi_image_free(m_decoded[i].pixels);
+		}
+	}
+	m_decoded.clear();
+	m_requests.clear();
+	m_pendingCount = 0;
+
+	for (size_t i = 0; i < m_stagingFences.size(); i++)
+	{
+		glDeleteSync(m_stagingFences[i].fence);
+	}
+	m_stagingFences.clear();
+
+	if (m_stagingPBO != 0)
+	{
+		if (m_pMappedStaging != NULL)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_stagingPBO);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			m_pMappedStaging = NULL;
+		}
+		glDeleteBuffers(1, &m_stagingPBO);
+		m_stagingPBO = 0;
+	}
+	m_stagingSize = 0;
+	m_stagingHead = 0;
+
+	if (m_textureArray != 0)
+	{
+		glDeleteTextures(1, &m_textureArray);
+		m_textureArray = 0;
+	}
+	m_arrayLayers = 0;
+}
+
+/***********************************************************
+ *  CreateStaging()
+ *
+ *  This method is used for creating the pixel buffer that
+ *  decoded images are copied through.  With buffer storage
+ *  it is mapped once for its whole lifetime.
+ ***********************************************************/
+void TextureLoader::CreateStaging()
+{
+	if (m_stagingPBO != 0)
+	{
+		return;
+	}
+
+	glGenBuffers(1, &m_stagingPBO);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_stagingPBO);
+
+	m_bPersistentStaging = (GLEW_ARB_buffer_storage != 0);
+	if (m_bPersistentStaging)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, g_StagingSize, NULL, flags);
+		m_pMappedStaging = (unsigned char*)glMapBufferRange(
+			GL_PIXEL_UNPACK_BUFFER, 0, g_StagingSize, flags);
+		if (m_pMappedStaging == NULL)
+		{
+			// fall back to a plain buffer mapped per upload
+			glDeleteBuffers(1, &m_stagingPBO);
+			glGenBuffers(1, &m_stagingPBO);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_stagingPBO);
+			m_bPersistentStaging = false;
+		}
+	}
+	if (!m_bPersistentStaging)
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, g_StagingSize, NULL, GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	m_stagingSize = g_StagingSize;
+	m_stagingHead = 0;
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method is used by each worker thread for decoding
+ *  queued image files until the loader stops.  No OpenGL
+ *  calls are made here.
+ ***********************************************************/
+void TextureLoader::WorkerMain()
+{
+	while (true)
+	{
+		LOAD_REQUEST request;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workAvailable.wait(lock, [this]() { return m_bStopping || !m_requests.empty(); });
+			if (m_bStopping)
+			{
+				return;
+			}
+			request = m_requests.front();
+			m_requests.pop_front();
+		}
+
+		DECODED_IMAGE image;
+		image.handle = request.handle;
+		image.filename = request.filename;
+		image.layer = request.layer;
+		DecodeImage(image);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_decoded.push_back(std::move(image));
+		}
+		m_imageDecoded.notify_all();
+	}
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used on a worker thread for filling one
+ *  image.  DDS files are read as they are.  Other images
+ *  come from their cache file while it is newer than the
+ *  image; otherwise the image is decoded, compressed and
+ *  cached for the next run.  Without S3TC support the raw
+ *  pixels are kept.
+ ***********************************************************/
+void TextureLoader::DecodeImage(DECODED_IMAGE& image)
+{
+	if (IsDDSFile(image.filename))
+	{
+		image.bCompressed = TextureCache::LoadDDS(image.filename, image.compressed);
+		return;
+	}
+
+	std::string cacheFile;
+	if (m_bCompressTextures)
+	{
+		cacheFile = TextureCache::GetCachePath(image.filename);
+		if (TextureCache::IsCacheFresh(image.filename, cacheFile) &&
+			TextureCache::LoadDDS(cacheFile, image.compressed))
+		{
+			image.bCompressed = true;
+			return;
+		}
+	}
+
+	image.pixels = stbi_load(
+		image.filename.c_str(),
+		&image.width,
+		&image.height,
+		&image.channels,
+		0);
+	if (!m_bCompressTextures || (image.pixels == NULL) ||
+		((image.channels != 3) && (image.channels != 4)))
+	{
+		return;
+	}
+
+	TextureCache::Compress(image.pixels, image.width, image.height, image.channels, image.compressed);
+	if (!TextureCache::SaveDDS(cacheFile, image.compressed))
+	{
+		std::cout << "Could not write texture cache:" << cacheFile << std::endl;
+	}
+	stbi_image_free(image.pixels);
+	image.pixels = NULL;
+	image.bCompressed = true;
+}
+
+/***********************************************************
+ *  GetUploadSize()
+ *
+ *  This method is used for sizing the staging region and
+ *  the upload budget share of one image.
+ ***********************************************************/
+size_t TextureLoader::GetUploadSize(const DECODED_IMAGE& image)
+{
+	if (image.bCompressed)
+	{
+		return(image.compressed.data.size());
+	}
+
+	return((size_t)image.width * (size_t)image.height * (size_t)image.channels);
+}
+
+/***********************************************************
+ *  SetAnisotropy()
+ *
+ *  This method is used for choosing the anisotropic filter
+ *  level of the textures uploaded from now on.  The level is
+ *  limited to what the driver supports when it is applied.
+ ***********************************************************/
+void TextureLoader::SetAnisotropy(float anisotropy)
+{
+	m_anisotropy = std::max(1.0f, anisotropy);
+}
+
+/***********************************************************
+ *  SetSampling()
+ *
+ *  This method is used for setting the filtering of the
+ *  texture bound to a target: trilinear across the mip
+ *  chain, plus anisotropic filtering for surfaces seen at
+ *  grazing angles.
+ ***********************************************************/
+void TextureLoader::SetSampling(GLenum target)
+{
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (GLEW_EXT_texture_filter_anisotropic)
+	{
+		glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+			std::min(m_anisotropy, m_maxAnisotropy));
+	}
+}
+
+/***********************************************************
+ *  ApplySampling()
+ *
+ *  This method is used for applying the current filtering
+ *  settings to a loaded texture and to the texture array.
+ *  Pass 0 to update only the array.
+ ***********************************************************/
+void TextureLoader::ApplySampling(GLuint textureID)
+{
+	if (textureID != 0)
+	{
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		SetSampling(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	if (m_textureArray != 0)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+		SetSampling(GL_TEXTURE_2D_ARRAY);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+}
+
+/***********************************************************
+ *  GetUploadFormat()
+ *
+ *  This method is used for reading the internal format that
+ *  an image with the given channel count is uploaded in.
+ ***********************************************************/
+GLenum TextureLoader::GetUploadFormat(int channels) const
+{
+	if (m_bCompressTextures)
+	{
+		return((channels == 4) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+	}
+
+	return((channels == 4) ? GL_RGBA8 : GL_RGB8);
+}
+
+/***********************************************************
+ *  CreateTextureArray()
+ *
+ *  This method is used for creating the array texture that
+ *  same-sized images are uploaded into, one per layer, with
+ *  storage for the full mip chain of every layer.  All the
+ *  layers are sampled through a single binding.
+ ***********************************************************/
+bool TextureLoader::CreateTextureArray(int width, int height, int channels, int layerCount)
+{
+	if ((m_textureArray != 0) || (width < 1) || (height < 1) || (layerCount < 1))
+	{
+		return(false);
+	}
+
+	m_arrayWidth = width;
+	m_arrayHeight = height;
+	m_arrayLayers = layerCount;
+	m_arrayFormat = GetUploadFormat(channels);
+	m_arrayLevels = 1;
+	while (((width >> m_arrayLevels) > 0) || ((height >> m_arrayLevels) > 0))
+	{
+		m_arrayLevels++;
+	}
+
+	glGenTextures(1, &m_textureArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_arrayLevels - 1);
+	SetSampling(GL_TEXTURE_2D_ARRAY);
+
+	bool bCompressed = m_bCompressTextures;
+	int blockBytes = (m_arrayFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ? 8 : 16;
+	GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
+	for (int level = 0; level < m_arrayLevels; level++)
+	{
+		int levelWidth = std::max(1, m_arrayWidth >> level);
+		int levelHeight = std::max(1, m_arrayHeight >> level);
+		if (bCompressed)
+		{
+			GLsizei size = ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockBytes * layerCount;
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, m_arrayFormat,
+				levelWidth, levelHeight, layerCount, 0, size, NULL);
+		}
+		else
+		{
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, m_arrayFormat,
+				levelWidth, levelHeight, layerCount, 0, format, GL_UNSIGNED_BYTE, NULL);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetTextureArray()
+ *
+ *  This method is used for reading the array texture, or 0
+ *  when none was created.
+ ***********************************************************/
+GLuint TextureLoader::GetTextureArray() const
+{
+	return(m_textureArray);
+}
+
+/***********************************************************
+ *  GetTextureArrayLayers()
+ *
+ *  This method is used for reading the layer count of the
+ *  array texture.
+ ***********************************************************/
+int TextureLoader::GetTextureArrayLayers() const
+{
+	return(m_arrayLayers);
+}
+
+/***********************************************************
+ *  MatchesTextureArray()
+ *
+ *  This method is used for checking, from the image header,
+ *  whether an image would be uploaded in the size and format
+ *  of the array layers.
+ ***********************************************************/
+bool TextureLoader::MatchesTextureArray(int width, int height, int channels) const
+{
+	return((m_textureArray != 0) &&
+		(width == m_arrayWidth) &&
+		(height == m_arrayHeight) &&
+		(GetUploadFormat(channels) == m_arrayFormat));
+}
+
+/***********************************************************
+ *  FitsTextureArray()
+ *
+ *  This method is used for checking a decoded image against
+ *  the array layers.  A cached or DDS image must also bring
+ *  exactly the mip levels of the array.
+ ***********************************************************/
+bool TextureLoader::FitsTextureArray(const DECODED_IMAGE& image) const
+{
+	if ((m_textureArray == 0) || (image.layer < 0) || (image.layer >= m_arrayLayers))
+	{
+		return(false);
+	}
+
+	if (image.bCompressed)
+	{
+		const TextureCache::COMPRESSED_IMAGE& compressed = image.compressed;
+		return((compressed.format == m_arrayFormat) &&
+			((int)compressed.levels.size() == m_arrayLevels) &&
+			(compressed.levels[0].width == m_arrayWidth) &&
+			(compressed.levels[0].height == m_arrayHeight));
+	}
+
+	return(MatchesTextureArray(image.width, image.height, image.channels));
+}
+
+/***********************************************************
+ *  Request()
+ *
+ *  This method is used for queueing an image file for
+ *  decoding on the worker threads.  The image goes into the
+ *  given array layer if it fits the array.
+ ***********************************************************/
+void TextureLoader::Request(int handle, const std::string& filename, int layer)
+{
+	LOAD_REQUEST request;
+	request.handle = handle;
+	request.filename = filename;
+	request.layer = layer;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_requests.push_back(request);
+		m_pendingCount++;
+	}
+	m_workAvailable.notify_one();
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for reading how many requested images
+ *  are still being decoded or waiting for upload.
+ ***********************************************************/
+int TextureLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_pendingCount);
+}
+
+/***********************************************************
+ *  ReserveStaging()
+ *
+ *  This method is used for finding room for an upload in the
+ *  staging ring.  Regions are handed out in order, and the
+ *  oldest fences are retired until the new region is free.
+ ***********************************************************/
+long long TextureLoader::ReserveStaging(size_t size, bool bWait)
+{
+	size_t offset = m_stagingHead;
+	if (offset + size > m_stagingSize)
+	{
+		offset = 0;
+	}
+
+	while (!m_stagingFences.empty())
+	{
+		bool bOverlaps = false;
+		for (size_t i = 0; i < m_stagingFences.size(); i++)
+		{
+			const STAGING_FENCE& region = m_stagingFences[i];
+			if ((region.start < offset + size) && (offset < region.end))
+			{
+				bOverlaps = true;
+				break;
+			}
+		}
+		if (!bOverlaps)
+		{
+			break;
+		}
+
+		STAGING_FENCE& oldest = m_stagingFences.front();
+		GLenum result = glClientWaitSync(
+			oldest.fence,
+			GL_SYNC_FLUSH_COMMANDS_BIT,
+			bWait ? g_FenceWaitNanoseconds : 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			if (!bWait)
+			{
+				return(-1);
+			}
+			continue;
+		}
+
+		glDeleteSync(oldest.fence);
+		m_stagingFences.pop_front();
+	}
+
+	m_stagingHead = offset + size;
+
+	return((long long)offset);
+}
+
+/***********************************************************
+ *  UploadImage()
+ *
+ *  This method is used for creating a texture from a decoded
+ *  image, or filling its layer of the texture array.  The
+ *  pixels are copied into the staging ring and the texture
+ *  is filled from there, so the driver copies from
+ *  GPU-visible memory without a second CPU copy.
+ ***********************************************************/
+bool TextureLoader::UploadImage(const DECODED_IMAGE& image, bool bWait, LOADED_TEXTURE& texture)
+{
+	texture.handle = image.handle;
+	texture.textureID = 0;
+	texture.layer = -1;
+
+	if (image.bCompressed)
+	{
+		GLenum format = image.compressed.format;
+		if ((format == GL_COMPRESSED_RGBA_BPTC_UNORM) ? !GLEW_ARB_texture_compression_bptc :
+			!GLEW_EXT_texture_compression_s3tc)
+		{
+			std::cout << "Compressed texture format not supported by the driver:" << image.filename << std::endl;
+			return(true);
+		}
+	}
+	else if ((image.channels != 3) && (image.channels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << image.channels << " channels" << std::endl;
+		return(true);
+	}
+
+	const unsigned char* pixels = image.bCompressed ? image.compressed.data.data() : image.pixels;
+	size_t size = GetUploadSize(image);
+	long long offset = -1;
+	if ((m_stagingPBO != 0) && (size <= m_stagingSize))
+	{
+		offset = ReserveStaging(size, bWait);
+		if (offset < 0)
+		{
+			return(false);
+		}
+	}
+
+	GLenum target = GL_TEXTURE_2D;
+	if (FitsTextureArray(image))
+	{
+		// the array already has its storage and sampling
+		target = GL_TEXTURE_2D_ARRAY;
+		texture.layer = image.layer;
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+	}
+	else
+	{
+		glGenTextures(1, &texture.textureID);
+		glBindTexture(GL_TEXTURE_2D, texture.textureID);
+
+		// set the texture wrapping parameters
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	}
+
+	// rows of RGB images are not padded to four bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (offset >= 0)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_stagingPBO);
+		if (m_bPersistentStaging)
+		{
+			memcpy(m_pMappedStaging + offset, pixels, size);
+		}
+		else
+		{
+			// the fences already keep this region out of use, so
+			// the driver need not synchronize the mapping
+			void* pStaging = glMapBufferRange(
+				GL_PIXEL_UNPACK_BUFFER,
+				(GLintptr)offset,
+				(GLsizeiptr)size,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (pStaging != NULL)
+			{
+				memcpy(pStaging, pixels, size);
+			}
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+
+		// with a pixel buffer bound the pointers are buffer offsets
+		CopyStagedImage(image, (const unsigned char*)(uintptr_t)offset, texture.layer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		STAGING_FENCE region;
+		region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region.start = (size_t)offset;
+		region.end = (size_t)offset + size;
+		m_stagingFences.push_back(region);
+	}
+	else
+	{
+		// larger than the whole ring; upload from client memory
+		CopyStagedImage(image, pixels, texture.layer);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	if (!image.bCompressed)
+	{
+		// generate the texture mipmaps for mapping textures to lower
+		// resolutions; for the array this redoes every loaded layer
+		glGenerateMipmap(target);
+	}
+	if (target == GL_TEXTURE_2D)
+	{
+		// set texture filtering parameters
+		SetSampling(GL_TEXTURE_2D);
+	}
+	glBindTexture(target, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CopyStagedImage()
+ *
+ *  This method is used for filling the bound texture, or one
+ *  layer of the bound array texture, from image data either
+ *  in client memory or at an offset in the bound pixel
+ *  buffer.  Compressed images bring their own mip levels,
+ *  which are uploaded one by one.
+ ***********************************************************/
+void TextureLoader::CopyStagedImage(const DECODED_IMAGE& image, const unsigned char* pixels, int layer)
+{
+	if (!image.bCompressed)
+	{
+		GLenum internalFormat = (image.channels == 4) ? GL_RGBA8 : GL_RGB8;
+		GLenum format = (image.channels == 4) ? GL_RGBA : GL_RGB;
+		if (layer >= 0)
+		{
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, image.width, image.height, 1,
+				format, GL_UNSIGNED_BYTE, pixels);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0,
+				format, GL_UNSIGNED_BYTE, pixels);
+		}
+		return;
+	}
+
+	const TextureCache::COMPRESSED_IMAGE& compressed = image.compressed;
+	for (size_t i = 0; i < compressed.levels.size(); i++)
+	{
+		const TextureCache::MIP_LEVEL& level = compressed.levels[i];
+		if (layer >= 0)
+		{
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, layer,
+				level.width, level.height, 1, compressed.format,
+				(GLsizei)level.size, pixels + level.offset);
+		}
+		else
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, compressed.format,
+				level.width, level.height, 0, (GLsizei)level.size, pixels + level.offset);
+		}
+	}
+	if (layer < 0)
+	{
+		// a DDS file may stop short of the 1x1 level
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)compressed.levels.size() - 1);
+	}
+}
+
+/***********************************************************
+ *  ProcessUploads()
+ *
+ *  This method is used on the GL thread for uploading the
+ *  images the workers have decoded.  At least one image is
+ *  uploaded per call, and more while the byte budget lasts.
+ ***********************************************************/
+std::vector<TextureLoader::LOADED_TEXTURE> TextureLoader::ProcessUploads(size_t byteBudget, bool bWait)
+{
+	std::vector<LOADED_TEXTURE> loaded;
+	size_t usedBytes = 0;
+
+	while (true)
+	{
+		DECODED_IMAGE image;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (bWait)
+			{
+				m_imageDecoded.wait(lock, [this]() { return !m_decoded.empty() || (m_pendingCount == 0); });
+			}
+			if (m_decoded.empty())
+			{
+				break;
+			}
+
+			DECODED_IMAGE& next = m_decoded.front();
+			size_t size = GetUploadSize(next);
+			if (!bWait && (usedBytes > 0) && (usedBytes + size > byteBudget))
+			{
+				break;
+			}
+			image = std::move(next);
+			m_decoded.pop_front();
+		}
+
+		LOADED_TEXTURE texture;
+		bool bLoaded = false;
+		if ((image.pixels == NULL) && !image.bCompressed)
+		{
+			std::cout << "Could not load image:" << image.filename << std::endl;
+		}
+		else
+		{
+			if (!UploadImage(image, bWait, texture))
+			{
+				// the staging ring is still in use; retry next call
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_decoded.push_front(std::move(image));
+				break;
+			}
+
+			bLoaded = (texture.textureID != 0) || (texture.layer >= 0);
+			if (bLoaded && image.bCompressed)
+			{
+				std::cout << "Successfully loaded compressed image:" << image.filename << ", width:" << image.compressed.levels[0].width << ", height:" << image.compressed.levels[0].height << ", levels:" << image.compressed.levels.size() << std::endl;
+			}
+			else if (bLoaded)
+			{
+				std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.channels << std::endl;
+			}
+			usedBytes += GetUploadSize(image);
+			if (image.pixels != NULL)
+			{
+				stbi_image_free(image.pixels);
+			}
+		}
+
+		if (bLoaded)
+		{
+			loaded.push_back(texture);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pendingCount--;
+	}
+
+	return(loaded);
+}
@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture images on worker threads and stream them to the GPU
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class decodes image files on a small pool of worker
+ *  threads and uploads the decoded pixels on the GL thread.
+ *  Uploads go through a ring of pixel buffer memory, which
+ *  is persistently mapped when the driver supports buffer
+ *  storage and mapped per upload otherwise.  A fence guards
+ *  each region of the ring until the GPU has read it.
+ *
+ *  When the driver supports S3TC, images are compressed on
+ *  the workers and kept in the texture cache, and DDS files
+ *  are uploaded with their own mip chains as they are.
+ *
+ *  A request may name a layer of the shared texture array.
+ *  Images that match the size and format of the array are
+ *  uploaded into that layer; any other image still gets a
+ *  texture of its own.
+ *
+ *  Requests are identified by a caller-chosen handle.  The
+ *  caller keeps drawing with a placeholder until
+ *  ProcessUploads() reports the finished texture for it.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor
+	TextureLoader();
+	// destructor
+	~TextureLoader();
+
+	// texture finished by ProcessUploads(); either a texture of
+	// its own or a layer of the texture array
+	struct LOADED_TEXTURE
+	{
+		int handle = -1;
+		GLuint textureID = 0;
+		int layer = -1;
+	};
+
+private:
+	// an image waiting for a worker
+	struct LOAD_REQUEST
+	{
+		int handle = -1;
+		std::string filename;
+		int layer = -1;
+	};
+
+	// a decoded image waiting for the GL thread
+	struct DECODED_IMAGE
+	{
+		int handle = -1;
+		std::string filename;
+		int layer = -1;
+		unsigned char* pixels = NULL;
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		// set when the image is block-compressed instead of raw pixels
+		bool bCompressed = false;
+		TextureCache::COMPRESSED_IMAGE compressed;
+	};
+
+	// a region of the staging ring still being read by the GPU
+	struct STAGING_FENCE
+	{
+		GLsync fence = 0;
+		size_t start = 0;
+		size_t end = 0;
+	};
+
+	// worker pool and the queues shared with it
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_imageDecoded;
+	std::deque<LOAD_REQUEST> m_requests;
+	std::deque<DECODED_IMAGE> m_decoded;
+	int m_pendingCount;
+	bool m_bStopping;
+	// compress images on the workers; fixed for the lifetime of the workers
+	bool m_bCompressTextures;
+
+	// sampling applied to every uploaded texture
+	float m_anisotropy;
+	float m_maxAnisotropy;
+
+	// staging ring for the uploads
+	GLuint m_stagingPBO;
+	unsigned char* m_pMappedStaging;
+	size_t m_stagingSize;
+	size_t m_stagingHead;
+	bool m_bPersistentStaging;
+	std::deque<STAGING_FENCE> m_stagingFences;
+
+	// shared array texture and the layout of its layers
+	GLuint m_textureArray;
+	int m_arrayWidth;
+	int m_arrayHeight;
+	int m_arrayLayers;
+	int m_arrayLevels;
+	GLenum m_arrayFormat;
+
+	// decode requests until the loader stops
+	void WorkerMain();
+	// fill one image from its file or from the texture cache
+	void DecodeImage(DECODED_IMAGE& image);
+	// bytes an image takes up in the staging ring
+	static size_t GetUploadSize(const DECODED_IMAGE& image);
+	// create the staging buffer on the GL thread
+	void CreateStaging();
+	// release ring regions the GPU has finished with; returns the
+	// offset of a free region of the given size, or -1
+	long long ReserveStaging(size_t size, bool bWait);
+	// copy one decoded image into a new texture; returns false,
+	// leaving the image untouched, while the staging ring is busy
+	bool UploadImage(const DECODED_IMAGE& image, bool bWait, LOADED_TEXTURE& texture);
+	// copy a staged image into the bound texture, or into one
+	// layer of the bound array texture
+	void CopyStagedImage(const DECODED_IMAGE& image, const unsigned char* pixels, int layer);
+	// check whether an image can go into its requested array layer
+	bool FitsTextureArray(const DECODED_IMAGE& image) const;
+	// set the filtering of the texture bound to a target
+	void SetSampling(GLenum target);
+
+public:
+	// start the worker threads; needs a current OpenGL context
+	void Start(int workerCount);
+	// finish the workers and free the staging buffer
+	void Stop();
+
+	// anisotropic filtering level of later uploads; 1 turns it off
+	void SetAnisotropy(float anisotropy);
+	// apply the current filtering settings to a loaded texture
+	// and to the texture array
+	void ApplySampling(GLuint textureID);
+
+	// internal format an image with the given channels is uploaded in
+	GLenum GetUploadFormat(int channels) const;
+	// create the array texture that requests can name layers of;
+	// call after Start()
+	bool CreateTextureArray(int width, int height, int channels, int layerCount);
+	GLuint GetTextureArray() const;
+	int GetTextureArrayLayers() const;
+	// check whether an image of this size and channel count is
+	// uploaded in the format of the array layers
+	bool MatchesTextureArray(int width, int height, int channels) const;
+
+	// queue an image file for decoding, optionally into an array
+	// layer; pass -1 for a texture of its own
+	void Request(int handle, const std::string& filename, int layer);
+
+	// upload decoded images until the byte budget is used up, and
+	// return the textures finished by this call; bWait blocks until
+	// every queued image is uploaded
+	std::vector<LOADED_TEXTURE> ProcessUploads(size_t byteBudget, bool bWait);
+
+	// number of requested images not uploaded yet
+	int GetPendingCount();
+};
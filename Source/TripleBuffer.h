@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// hand the latest value from one thread to another without locking
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  This class passes values of T from one writing thread to
+ *  one reading thread.  The writer fills its own slot and
+ *  publishes it by swapping it with the shared slot; the
+ *  reader takes the shared slot by swapping it with its own.
+ *  Neither side ever waits, and the reader always sees the
+ *  most recently published value whole.  Values published
+ *  between two reads are skipped, so T should carry totals
+ *  rather than increments.
+ ***********************************************************/
+template <typename T>
+class TripleBuffer
+{
+public:
+	// constructor
+	TripleBuffer()
+		: m_shared(1)
+	{
+		m_writeIndex = 0;
+		m_readIndex = 2;
+	}
+
+private:
+	// the shared slot index is kept in the low bits, with a flag
+	// set while it holds a value the reader has not taken
+	static const uint32_t INDEX_MASK = 3u;
+	static const uint32_t FRESH_FLAG = 4u;
+
+	T m_slots[3];
+	std::atomic<uint32_t> m_shared;
+	// slots owned by the writer and the reader
+	uint32_t m_writeIndex;
+	uint32_t m_readIndex;
+
+public:
+	// slot the writer fills before Publish(); writer thread only
+	T& GetWriteSlot()
+	{
+		return(m_slots[m_writeIndex]);
+	}
+	// hand the filled slot to the reader; writer thread only
+	void Publish()
+	{
+		uint32_t previous = m_shared.exchange(m_writeIndex | FRESH_FLAG, std::memory_order_acq_rel);
+		m_writeIndex = previous & INDEX_MASK;
+	}
+
+	// take the latest published value, if there is a new one;
+	// returns false when the read slot is unchanged; reader only
+	bool Acquire()
+	{
+		if ((m_shared.load(std::memory_order_acquire) & FRESH_FLAG) == 0)
+		{
+			return(false);
+		}
+		uint32_t previous = m_shared.exchange(m_readIndex, std::memory_order_acq_rel);
+		m_readIndex = previous & INDEX_MASK;
+		return(true);
+	}
+	// the value last taken by Acquire(); reader thread only
+	const T& GetReadSlot() const
+	{
+		return(m_slots[m_readIndex]);
+	}
+};
@@ -0,0 +1,352 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffermanager.cpp
+// ============
+// manage the std140 uniform buffer objects shared by all shader programs
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformBufferManager.h"
+
+#include <iostream>
+
+// the C++ mirrors must match the std140 layout of the shader blocks
+static_assert(sizeof(UniformBufferManager::FRAME_BLOCK) == 160, "FrameBlock layout mismatch");
+static_assert(sizeof(UniformBufferManager::DIRECTIONAL_LIGHT) == 64, "DirectionalLight layout mismatch");
+static_assert(sizeof(UniformBufferManager::POINT_LIGHT) == 64, "PointLight layout mismatch");
+static_assert(sizeof(UniformBufferManager::SPOT_LIGHT) == 96, "SpotLight layout mismatch");
+static_assert(sizeof(UniformBufferManager::MATERIAL_RECORD) == 32, "MaterialRecord layout mismatch");
+static_assert(sizeof(UniformBufferManager::SHADOW_BLOCK) == 2576, "ShadowBlock layout mismatch");
+
+// declaration of global variables
+namespace
+{
+	const char* g_FrameBlockName = "FrameBlock";
+	const char* g_LightsBlockName = "LightsBlock";
+	const char* g_MaterialsBlockName = "MaterialsBlock";
+	const char* g_ShadowBlockName = "ShadowBlock";
+}
+
+/***********************************************************
+ *  UniformBufferManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformBufferManager::UniformBufferManager()
+{
+	m_frameUBO = 0;
+	m_lightsUBO = 0;
+	m_materialsUBO = 0;
+	m_shadowUBO = 0;
+	m_bFrameDirty = true;
+	m_bLightsDirty = true;
+	m_bMaterialsDirty = true;
+	m_bShadowDirty = true;
+}
+
+/***********************************************************
+ *  ~UniformBufferManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformBufferManager::~UniformBufferManager()
+{
+	DestroyBuffers();
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for creating the uniform buffer
+ *  objects and attaching them to their binding points.
+ ***********************************************************/
+bool UniformBufferManager::CreateBuffers()
+{
+	if (m_frameUBO != 0)
+	{
+		return(true);
+	}
+
+	glGenBuffers(1, &m_frameUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FRAME_BLOCK), &m_frameData, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &m_lightsUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_lightsUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(LIGHTS_BLOCK), &m_lightsData, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &m_materialsUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_materialsUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(MATERIALS_BLOCK), &m_materialsData, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &m_shadowUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_shadowUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(SHADOW_BLOCK), &m_shadowData, GL_DYNAMIC_DRAW);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// the binding points stay attached for the lifetime of the buffers
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, m_frameUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, m_lightsUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, MATERIALS_BLOCK_BINDING, m_materialsUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_BLOCK_BINDING, m_shadowUBO);
+
+	m_bFrameDirty = false;
+	m_bLightsDirty = false;
+	m_bMaterialsDirty = false;
+	m_bShadowDirty = false;
+
+	return((m_frameUBO != 0) && (m_lightsUBO != 0) && (m_materialsUBO != 0) && (m_shadowUBO != 0));
+}
+
+/***********************************************************
+ *  DestroyBuffers()
+ *
+ *  This method is used for freeing the buffer objects.
+ ***********************************************************/
+void UniformBufferManager::DestroyBuffers()
+{
+	if (m_frameUBO != 0)
+	{
+		glDeleteBuffers(1, &m_frameUBO);
+		m_frameUBO = 0;
+	}
+	if (m_lightsUBO != 0)
+	{
+		glDeleteBuffers(1, &m_lightsUBO);
+		m_lightsUBO = 0;
+	}
+	if (m_materialsUBO != 0)
+	{
+		glDeleteBuffers(1, &m_materialsUBO);
+		m_materialsUBO = 0;
+	}
+	if (m_shadowUBO != 0)
+	{
+		glDeleteBuffers(1, &m_shadowUBO);
+		m_shadowUBO = 0;
+	}
+}
+
+/***********************************************************
+ *  BindBlock()
+ *
+ *  This method is used for attaching one named uniform block
+ *  of a program to a binding point.  Programs that do not
+ *  use the block are silently skipped.
+ ***********************************************************/
+void UniformBufferManager::BindBlock(GLuint programID, const char* blockName, GLuint binding)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(programID, blockName);
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programID, blockIndex, binding);
+	}
+}
+
+/***********************************************************
+ *  BindShaderBlocks()
+ *
+ *  This method is used for attaching the FrameBlock,
+ *  LightsBlock, MaterialsBlock and ShadowBlock of a loaded
+ *  program to the shared buffers.
+ *  The program is made current to read back its ID.
+ ***********************************************************/
+void UniformBufferManager::BindShaderBlocks(ShaderManager* pShaderManager)
+{
+	if (NULL == pShaderManager)
+	{
+		return;
+	}
+
+	GLint programID = 0;
+	pShaderManager->use();
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	if (programID == 0)
+	{
+		std::cout << "Cannot bind uniform blocks: shader program is not loaded" << std::endl;
+		return;
+	}
+
+	BindBlock((GLuint)programID, g_FrameBlockName, FRAME_BLOCK_BINDING);
+	BindBlock((GLuint)programID, g_LightsBlockName, LIGHTS_BLOCK_BINDING);
+	BindBlock((GLuint)programID, g_MaterialsBlockName, MATERIALS_BLOCK_BINDING);
+	BindBlock((GLuint)programID, g_ShadowBlockName, SHADOW_BLOCK_BINDING);
+}
+
+/***********************************************************
+ *  SetCamera()
+ *
+ *  This method is used for updating the camera matrices and
+ *  position in the CPU copy of the per-frame block.
+ ***********************************************************/
+void UniformBufferManager::SetCamera(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition)
+{
+	m_frameData.view = view;
+	m_frameData.projection = projection;
+	m_frameData.viewPosition = viewPosition;
+	m_bFrameDirty = true;
+}
+
+/***********************************************************
+ *  GetView()
+ *
+ *  This method is used for reading the view matrix last set
+ *  through SetCamera().
+ ***********************************************************/
+const glm::mat4& UniformBufferManager::GetView() const
+{
+	return(m_frameData.view);
+}
+
+/***********************************************************
+ *  GetProjection()
+ *
+ *  This method is used for reading the projection matrix
+ *  last set through SetCamera().
+ ***********************************************************/
+const glm::mat4& UniformBufferManager::GetProjection() const
+{
+	return(m_frameData.projection);
+}
+
+/***********************************************************
+ *  GetViewPosition()
+ *
+ *  This method is used for reading the camera position last
+ *  set through SetCamera().
+ ***********************************************************/
+const glm::vec3& UniformBufferManager::GetViewPosition() const
+{
+	return(m_frameData.viewPosition);
+}
+
+/***********************************************************
+ *  SetFrameTime()
+ *
+ *  This method is used for updating the animation time and
+ *  the liquid ripple amplitude in the per-frame block.
+ ***********************************************************/
+void UniformBufferManager::SetFrameTime(float timeSeconds, float rippleAmplitude)
+{
+	m_frameData.timeSeconds = timeSeconds;
+	m_frameData.rippleAmplitude = rippleAmplitude;
+	m_bFrameDirty = true;
+}
+
+/***********************************************************
+ *  GetLights()
+ *
+ *  This method is used for editing the CPU copy of the
+ *  lights block.
+ ***********************************************************/
+UniformBufferManager::LIGHTS_BLOCK& UniformBufferManager::GetLights()
+{
+	return(m_lightsData);
+}
+
+/***********************************************************
+ *  MarkLightsDirty()
+ *
+ *  This method is used for flagging the lights block for
+ *  upload after it was edited through GetLights().
+ ***********************************************************/
+void UniformBufferManager::MarkLightsDirty()
+{
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  SetSpotLightPose()
+ *
+ *  This method is used for moving the camera-tied spotlight.
+ ***********************************************************/
+void UniformBufferManager::SetSpotLightPose(const glm::vec3& position, const glm::vec3& direction)
+{
+	m_lightsData.spotLight.position = position;
+	m_lightsData.spotLight.direction = direction;
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetMaterials()
+ *
+ *  This method is used for editing the CPU copy of the
+ *  material table.
+ ***********************************************************/
+UniformBufferManager::MATERIALS_BLOCK& UniformBufferManager::GetMaterials()
+{
+	return(m_materialsData);
+}
+
+/***********************************************************
+ *  MarkMaterialsDirty()
+ *
+ *  This method is used for flagging the material table for
+ *  upload after it was edited through GetMaterials().
+ ***********************************************************/
+void UniformBufferManager::MarkMaterialsDirty()
+{
+	m_bMaterialsDirty = true;
+}
+
+/***********************************************************
+ *  GetShadows()
+ *
+ *  This method is used for editing the CPU copy of the
+ *  shadow atlas views.
+ ***********************************************************/
+UniformBufferManager::SHADOW_BLOCK& UniformBufferManager::GetShadows()
+{
+	return(m_shadowData);
+}
+
+/***********************************************************
+ *  MarkShadowsDirty()
+ *
+ *  This method is used for flagging the shadow views for
+ *  upload after they were edited through GetShadows().
+ ***********************************************************/
+void UniformBufferManager::MarkShadowsDirty()
+{
+	m_bShadowDirty = true;
+}
+
+/***********************************************************
+ *  UploadDirtyBlocks()
+ *
+ *  This method is used for sending each changed block to
+ *  the GPU with one buffer update.
+ ***********************************************************/
+void UniformBufferManager::UploadDirtyBlocks()
+{
+	if (m_bFrameDirty && (m_frameUBO != 0))
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FRAME_BLOCK), &m_frameData);
+		m_bFrameDirty = false;
+	}
+	if (m_bLightsDirty && (m_lightsUBO != 0))
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_lightsUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LIGHTS_BLOCK), &m_lightsData);
+		m_bLightsDirty = false;
+	}
+	if (m_bMaterialsDirty && (m_materialsUBO != 0))
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_materialsUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MATERIALS_BLOCK), &m_materialsData);
+		m_bMaterialsDirty = false;
+	}
+	if (m_bShadowDirty && (m_shadowUBO != 0))
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_shadowUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SHADOW_BLOCK), &m_shadowData);
+		m_bShadowDirty = false;
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
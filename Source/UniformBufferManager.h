@@ -0,0 +1,193 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffermanager.h
+// ============
+// manage the std140 uniform buffer objects shared by all shader programs
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// must match TOTAL_POINT_LIGHTS in fragmentShader.glsl
+const int TOTAL_POINT_LIGHTS = 5;
+// must match MAX_MATERIALS in fragmentShader.glsl
+const int MAX_MATERIALS = 64;
+// must match MAX_SHADOW_VIEWS in the shaders and ShadowAtlas::MAX_VIEWS
+const int MAX_SHADOW_VIEWS = 32;
+
+/***********************************************************
+ *  UniformBufferManager
+ *
+ *  This class owns the per-frame, lights, materials and
+ *  shadow uniform buffer objects.  Every program binds its blocks
+ *  to the same binding points, so one buffer update is seen
+ *  by the lit pass and the depth pass alike.
+ ***********************************************************/
+class UniformBufferManager
+{
+public:
+	// constructor
+	UniformBufferManager();
+	// destructor
+	~UniformBufferManager();
+
+	// binding points shared by every program
+	enum BLOCK_BINDING
+	{
+		FRAME_BLOCK_BINDING = 0,
+		LIGHTS_BLOCK_BINDING = 1,
+		MATERIALS_BLOCK_BINDING = 2,
+		SHADOW_BLOCK_BINDING = 3
+	};
+
+	// std140 mirror of FrameBlock in the shaders
+	struct FRAME_BLOCK
+	{
+		glm::mat4 view = glm::mat4(1.0f);
+		glm::mat4 projection = glm::mat4(1.0f);
+		glm::vec3 viewPosition = glm::vec3(0.0f);
+		float timeSeconds = 0.0f;
+		float rippleAmplitude = 0.0f;
+		float padding[3] = { 0.0f, 0.0f, 0.0f };
+	};
+
+	// std140 mirrors of the light structs in fragmentShader.glsl;
+	// each vec3 is followed by a scalar that fills its 16 byte slot
+	struct DIRECTIONAL_LIGHT
+	{
+		glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+		int32_t bActive = 0;
+		glm::vec3 ambient = glm::vec3(0.0f);
+		float padding0 = 0.0f;
+		glm::vec3 diffuse = glm::vec3(0.0f);
+		float padding1 = 0.0f;
+		glm::vec3 specular = glm::vec3(0.0f);
+		float padding2 = 0.0f;
+	};
+
+	struct POINT_LIGHT
+	{
+		glm::vec3 position = glm::vec3(0.0f);
+		int32_t bActive = 0;
+		glm::vec3 ambient = glm::vec3(0.0f);
+		float padding0 = 0.0f;
+		glm::vec3 diffuse = glm::vec3(0.0f);
+		float padding1 = 0.0f;
+		glm::vec3 specular = glm::vec3(0.0f);
+		float padding2 = 0.0f;
+	};
+
+	struct SPOT_LIGHT
+	{
+		glm::vec3 position = glm::vec3(0.0f);
+		int32_t bActive = 0;
+		glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+		float cutOff = 1.0f;
+		glm::vec3 ambient = glm::vec3(0.0f);
+		float outerCutOff = 1.0f;
+		glm::vec3 diffuse = glm::vec3(0.0f);
+		float constant = 1.0f;
+		glm::vec3 specular = glm::vec3(0.0f);
+		float linear = 0.0f;
+		float quadratic = 0.0f;
+		float padding[3] = { 0.0f, 0.0f, 0.0f };
+	};
+
+	// std140 mirror of LightsBlock in fragmentShader.glsl
+	struct LIGHTS_BLOCK
+	{
+		DIRECTIONAL_LIGHT directionalLight;
+		POINT_LIGHT pointLights[TOTAL_POINT_LIGHTS];
+		SPOT_LIGHT spotLight;
+	};
+
+	// std140 mirror of one MaterialRecord in fragmentShader.glsl;
+	// textureLayer is the layer of the scene texture array, or -1
+	// when the surface is untextured or uses a separate texture
+	struct MATERIAL_RECORD
+	{
+		glm::vec3 diffuseColor = glm::vec3(1.0f);
+		float shininess = 32.0f;
+		glm::vec3 specularColor = glm::vec3(0.5f);
+		int32_t textureLayer = -1;
+	};
+
+	// std140 mirror of MaterialsBlock in fragmentShader.glsl
+	struct MATERIALS_BLOCK
+	{
+		MATERIAL_RECORD materials[MAX_MATERIALS];
+	};
+
+	// std140 mirror of ShadowBlock in the shaders
+	struct SHADOW_BLOCK
+	{
+		// light matrix of every view of the shadow atlas
+		glm::mat4 matrices[MAX_SHADOW_VIEWS];
+		// tile of every view; xy: corner and z: side, as fractions of
+		// the atlas, w: unused
+		glm::vec4 tiles[MAX_SHADOW_VIEWS];
+		// view of the spotlight and the directional light, or -1 for
+		// an unshadowed light; zw: unused
+		glm::ivec4 lightViews = glm::ivec4(-1);
+	};
+
+private:
+	// OpenGL buffer objects
+	GLuint m_frameUBO;
+	GLuint m_lightsUBO;
+	GLuint m_materialsUBO;
+	GLuint m_shadowUBO;
+	// CPU copies of the buffer contents
+	FRAME_BLOCK m_frameData;
+	LIGHTS_BLOCK m_lightsData;
+	MATERIALS_BLOCK m_materialsData;
+	SHADOW_BLOCK m_shadowData;
+	// set when the CPU copy differs from the GPU buffer
+	bool m_bFrameDirty;
+	bool m_bLightsDirty;
+	bool m_bMaterialsDirty;
+	bool m_bShadowDirty;
+
+	// attach one named block of a program to a binding point
+	void BindBlock(GLuint programID, const char* blockName, GLuint binding);
+
+public:
+	// create the buffer objects and attach them to their binding points
+	bool CreateBuffers();
+	// free the buffer objects
+	void DestroyBuffers();
+
+	// attach the uniform blocks of a program to the shared buffers
+	void BindShaderBlocks(ShaderManager* pShaderManager);
+
+	// per-frame camera and time state
+	void SetCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition);
+	void SetFrameTime(float timeSeconds, float rippleAmplitude);
+	const glm::mat4& GetView() const;
+	const glm::mat4& GetProjection() const;
+	const glm::vec3& GetViewPosition() const;
+
+	// light state; call MarkLightsDirty() after editing
+	LIGHTS_BLOCK& GetLights();
+	void MarkLightsDirty();
+	void SetSpotLightPose(const glm::vec3& position, const glm::vec3& direction);
+
+	// material table state; call MarkMaterialsDirty() after editing
+	MATERIALS_BLOCK& GetMaterials();
+	void MarkMaterialsDirty();
+
+	// shadow atlas views; call MarkShadowsDirty() after editing
+	SHADOW_BLOCK& GetShadows();
+	void MarkShadowsDirty();
+
+	// send any changed block to the GPU with a single buffer update each
+	void UploadDirtyBlocks();
+};
@@ -13,12 +13,15 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 
 // Additional includes for console output and OpenGL
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <cstdlib>
 #include <cmath>    
+#include <chrono>
 
 // declaration of the global variables and defines
 namespace
@@ -26,8 +29,6 @@ namespace
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -37,14 +38,30 @@ namespace
 	float gLastX = WINDOW_WIDTH / 2.0f;
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
-
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+	// mouse and scroll offsets summed over every event, read when
+	// the input is sampled; the callbacks run on the render thread
+	double gMouseOffsetX = 0.0;
+	double gMouseOffsetY = 0.0;
+	double gScrollOffset = 0.0;
+
+	// seconds per simulation tick of the camera and ripple
+	const double g_TickInterval = 1.0 / 120.0;
+	// longest stretch of ticks run at once; after a longer stall
+	// the simulation skips ahead rather than replaying it
+	const double g_MaxCatchUp = 0.25;
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// seconds between refreshes of the on-screen display
+	const double g_InfoUpdateInterval = 0.5;
+
+	// seconds per orbit of the benchmark camera, and its height
+	// and look-at point above the table
+	const float g_OrbitPeriod = 20.0f;
+	const float g_OrbitHeight = 5.0f;
+	const float g_OrbitTargetHeight = 1.0f;
 }
 
 /***********************************************************
@@ -53,14 +70,14 @@ namespace
  *  The constructor for the class
  ***********************************************************/
 ViewManager::ViewManager(
-	ShaderManager *pShaderManager)
+	ShaderManager *pShaderManager,
+	UniformBufferManager* pUniformBuffers)
 {
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
+	m_pUniformBuffers = pUniformBuffers;
 	m_pWindow = NULL;
 	m_bPerspectiveProjection = true;  // start in perspective mode
-	m_bPKeyPressed = false;
-	m_bOKeyPressed = false;
 	// initialize smooth movement variables
 	m_currentVelocity = glm::vec3(0.0f);
 	m_accelerationRate = 25.0f;  // smooth acceleration
@@ -71,7 +88,17 @@ ViewManager::ViewManager(
 
 	// initialize liquid ripple control
 	m_rippleAmplitude = 0.10f;
-	m_rippleStep = 0.01f;
+	// the former step of 0.01 per frame, at 60 frames per second
+	m_rippleRate = 0.6f;
+
+	m_pProfiler = NULL;
+	m_lastInfoUpdate = 0.0;
+
+	// interactive until SetBenchmarkMode() is called
+	m_bScriptedCamera = false;
+	m_fixedTimeStep = 0.0f;
+	m_scriptedTime = 0.0f;
+	m_orbitRadius = 12.0f;
 	
 	g_pCamera = new Camera();
 	// default camera view parameters
@@ -80,6 +107,16 @@ ViewManager::ViewManager(
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
 	g_pCamera->MovementSpeed = 20;
+
+	// the first frames draw the starting view until a tick runs
+	m_nextTickTime = 0.0;
+	m_simulationTime = 0.0f;
+	m_bStopUpdates = false;
+	m_viewState = CaptureViewState();
+	VIEW_SNAPSHOT& snapshot = m_snapshots.GetWriteSlot();
+	snapshot.previous = m_viewState;
+	snapshot.current = m_viewState;
+	m_snapshots.Publish();
 }
 
 /***********************************************************
@@ -89,9 +126,14 @@ ViewManager::ViewManager(
  ***********************************************************/
 ViewManager::~ViewManager()
 {
+	// the update thread uses the camera until it is joined
+	StopUpdateThread();
+
 	// free up allocated memory
 	m_pShaderManager = NULL;
+	m_pUniformBuffers = NULL;
 	m_pWindow = NULL;
+	m_pProfiler = NULL;
 	if (NULL != g_pCamera)
 	{
 		delete g_pCamera;
@@ -135,6 +177,7 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	m_pWindow = window;
+	m_windowTitle = windowTitle;
 
 	return(window);
 }
@@ -165,8 +208,9 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	// move the 3D camera according to the calculated offsets with increased sensitivity
-	g_pCamera->ProcessMouseMovement(xOffset * 3.0f, yOffset * 3.0f);
+	// the camera is turned by these on the next tick
+	gMouseOffsetX += xOffset;
+	gMouseOffsetY += yOffset;
 }
 
 /***********************************************************
@@ -177,23 +221,18 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
  ***********************************************************/
 void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset)
 {
-	// get the ViewManager instance (we'll need to store this globally)
-	// for now, we'll access the camera directly through the global pointer
-	if (g_pCamera != nullptr)
-	{
-		// adjust movement speed based on scroll direction
-		float speedChange = yOffset * 2.0f;  // scroll sensitivity
-		g_pCamera->MovementSpeed = glm::clamp(g_pCamera->MovementSpeed + speedChange, 1.0f, 100.0f);
-	}
+	// the movement speed is adjusted by this on the next tick
+	gScrollOffset += yOffset;
 }
 
 /***********************************************************
- *  ProcessKeyboardEvents()
+ *  SampleInput()
  *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  This method is called on the render thread to read the
+ *  keyboard and the summed mouse movement, which GLFW only
+ *  reports there, and hand them to the update thread.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::SampleInput()
 {
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -201,50 +240,210 @@ void ViewManager::ProcessKeyboardEvents()
 		glfwSetWindowShouldClose(m_pWindow, true);
 	}
 
+	const struct
+	{
+		int key;
+		uint32_t bit;
+	} keyBits[] = {
+		{ GLFW_KEY_W, KEY_FORWARD },
+		{ GLFW_KEY_S, KEY_BACK },
+		{ GLFW_KEY_A, KEY_LEFT },
+		{ GLFW_KEY_D, KEY_RIGHT },
+		{ GLFW_KEY_Q, KEY_UP },
+		{ GLFW_KEY_SPACE, KEY_UP },
+		{ GLFW_KEY_E, KEY_DOWN },
+		{ GLFW_KEY_LEFT_CONTROL, KEY_DOWN },
+		{ GLFW_KEY_P, KEY_PERSPECTIVE },
+		{ GLFW_KEY_O, KEY_ORTHOGRAPHIC },
+		{ GLFW_KEY_I, KEY_RIPPLE_UP },
+		{ GLFW_KEY_U, KEY_RIPPLE_DOWN }
+	};
+
+	INPUT_STATE& input = m_input.GetWriteSlot();
+	input.keys = 0;
+	for (size_t i = 0; i < sizeof(keyBits) / sizeof(keyBits[0]); i++)
+	{
+		if (glfwGetKey(m_pWindow, keyBits[i].key) == GLFW_PRESS)
+		{
+			input.keys |= keyBits[i].bit;
+		}
+	}
+	input.mouseX = gMouseOffsetX;
+	input.mouseY = gMouseOffsetY;
+	input.scroll = gScrollOffset;
+	m_input.Publish();
+}
+
+/***********************************************************
+ *  Tick()
+ *
+ *  This method is used for advancing the camera and the
+ *  ripple control by one fixed tick of the latest input.
+ ***********************************************************/
+void ViewManager::Tick(const INPUT_STATE& input, float deltaTime)
+{
+	// turn the camera and change its speed by the mouse movement
+	// since the last tick, with increased sensitivity
+	float xOffset = (float)(input.mouseX - m_appliedInput.mouseX);
+	float yOffset = (float)(input.mouseY - m_appliedInput.mouseY);
+	if ((xOffset != 0.0f) || (yOffset != 0.0f))
+	{
+		g_pCamera->ProcessMouseMovement(xOffset * m_mouseSensitivity, yOffset * m_mouseSensitivity);
+	}
+	float scrollOffset = (float)(input.scroll - m_appliedInput.scroll);
+	if (scrollOffset != 0.0f)
+	{
+		// adjust movement speed based on scroll direction
+		float speedChange = scrollOffset * 2.0f;  // scroll sensitivity
+		g_pCamera->MovementSpeed = glm::clamp(g_pCamera->MovementSpeed + speedChange, 1.0f, 100.0f);
+	}
+	m_appliedInput = input;
+
 	// process smooth camera movement
-	ProcessSmoothMovement();
+	ProcessSmoothMovement(input, deltaTime);
 
 	// process projection mode switching
-	ProcessProjectionKeys();
+	ProcessProjectionKeys(input);
 
 	// process ripple amplitude controls (U/I)
-	ProcessRippleControls();
+	ProcessRippleControls(input, deltaTime);
+
+	m_simulationTime += deltaTime;
 }
 
 /***********************************************************
- *  ProcessProjectionKeys()
+ *  AdvanceTicks()
  *
- *  This method processes the P and O keys for switching
- *  between perspective and orthographic projection modes
+ *  This method is used for running every tick that is due
+ *  by a clock time, and publishing the view state of the
+ *  last one together with the state before it.
  ***********************************************************/
-void ViewManager::ProcessProjectionKeys()
+void ViewManager::AdvanceTicks(double now)
 {
-	// handle P key for perspective projection
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+	if ((now - m_nextTickTime) > g_MaxCatchUp)
 	{
-		if (!m_bPKeyPressed)
-		{
-			m_bPerspectiveProjection = true;
-			m_bPKeyPressed = true;
-		}
+		m_nextTickTime = now;
 	}
-	else
+	if (m_nextTickTime > now)
 	{
-		m_bPKeyPressed = false;
+		return;
 	}
 
-	// handle O key for orthographic projection
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+	m_input.Acquire();
+	const INPUT_STATE& input = m_input.GetReadSlot();
+
+	VIEW_STATE previous;
+	double tickTime = m_nextTickTime;
+	while (m_nextTickTime <= now)
 	{
-		if (!m_bOKeyPressed)
+		previous = CaptureViewState();
+		Tick(input, (float)g_TickInterval);
+		tickTime = m_nextTickTime;
+		m_nextTickTime += g_TickInterval;
+	}
+
+	VIEW_SNAPSHOT& snapshot = m_snapshots.GetWriteSlot();
+	snapshot.previous = previous;
+	snapshot.current = CaptureViewState();
+	snapshot.tickTime = tickTime;
+	m_snapshots.Publish();
+}
+
+/***********************************************************
+ *  CaptureViewState()
+ *
+ *  This method is used for reading the camera, projection
+ *  mode and ripple into a view state.
+ ***********************************************************/
+ViewManager::VIEW_STATE ViewManager::CaptureViewState() const
+{
+	VIEW_STATE state;
+	state.position = g_pCamera->Position;
+	state.front = g_pCamera->Front;
+	state.up = g_pCamera->Up;
+	state.zoom = g_pCamera->Zoom;
+	state.rippleAmplitude = m_rippleAmplitude;
+	state.timeSeconds = m_simulationTime;
+	state.bPerspective = m_bPerspectiveProjection;
+
+	return(state);
+}
+
+/***********************************************************
+ *  UpdateMain()
+ *
+ *  This method is the body of the update thread: it runs
+ *  the due ticks and sleeps until the next one.
+ ***********************************************************/
+void ViewManager::UpdateMain()
+{
+	while (!m_bStopUpdates.load())
+	{
+		// glfwGetTime() may be called from any thread
+		AdvanceTicks(glfwGetTime());
+
+		double wait = m_nextTickTime - glfwGetTime();
+		if (wait > 0.0)
 		{
-			m_bPerspectiveProjection = false;
-			m_bOKeyPressed = true;
+			std::this_thread::sleep_for(std::chrono::duration<double>(wait));
 		}
 	}
-	else
+}
+
+/***********************************************************
+ *  StartUpdateThread()
+ *
+ *  This method is used for moving the camera and ripple
+ *  ticks onto their own thread.  The camera belongs to that
+ *  thread until StopUpdateThread() joins it.
+ ***********************************************************/
+void ViewManager::StartUpdateThread()
+{
+	if (m_updateThread.joinable() || m_bScriptedCamera)
 	{
-		m_bOKeyPressed = false;
+		return;
+	}
+
+	m_bStopUpdates = false;
+	m_nextTickTime = glfwGetTime();
+	m_updateThread = std::thread(&ViewManager::UpdateMain, this);
+}
+
+/***********************************************************
+ *  StopUpdateThread()
+ *
+ *  This method is used for joining the update thread, after
+ *  which PrepareSceneView() runs the ticks itself.
+ ***********************************************************/
+void ViewManager::StopUpdateThread()
+{
+	if (!m_updateThread.joinable())
+	{
+		return;
+	}
+
+	m_bStopUpdates = true;
+	m_updateThread.join();
+}
+
+/***********************************************************
+ *  ProcessProjectionKeys()
+ *
+ *  This method processes the P and O keys for switching
+ *  between perspective and orthographic projection modes
+ ***********************************************************/
+void ViewManager::ProcessProjectionKeys(const INPUT_STATE& input)
+{
+	// handle P key for perspective projection
+	if (input.keys & KEY_PERSPECTIVE)
+	{
+		m_bPerspectiveProjection = true;
+	}
+
+	// handle O key for orthographic projection
+	if (input.keys & KEY_ORTHOGRAPHIC)
+	{
+		m_bPerspectiveProjection = false;
 	}
 }
 
@@ -254,25 +453,23 @@ void ViewManager::ProcessProjectionKeys()
  *  This method processes smooth camera movement with 
  *  acceleration and deceleration for comfortable navigation
  ***********************************************************/
-void ViewManager::ProcessSmoothMovement()
+void ViewManager::ProcessSmoothMovement(const INPUT_STATE& input, float deltaTime)
 {
 	glm::vec3 targetVelocity(0.0f);
 	float baseSpeed = g_pCamera->MovementSpeed;
 
 	// determine target velocity based on key presses
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	if (input.keys & KEY_FORWARD)
 		targetVelocity += g_pCamera->Front;
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+	if (input.keys & KEY_BACK)
 		targetVelocity -= g_pCamera->Front;
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+	if (input.keys & KEY_LEFT)
 		targetVelocity -= g_pCamera->Right;
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+	if (input.keys & KEY_RIGHT)
 		targetVelocity += g_pCamera->Right;
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS || 
-		glfwGetKey(m_pWindow, GLFW_KEY_SPACE) == GLFW_PRESS)
+	if (input.keys & KEY_UP)
 		targetVelocity += g_pCamera->Up;
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS || 
-		glfwGetKey(m_pWindow, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+	if (input.keys & KEY_DOWN)
 		targetVelocity -= g_pCamera->Up;
 
 	// normalize target velocity if moving diagonally
@@ -281,7 +478,7 @@ void ViewManager::ProcessSmoothMovement()
 
 	// smooth interpolation between current and target velocity
 	float lerpFactor = (glm::length(targetVelocity) > 0.0f) ? 
-		m_accelerationRate * gDeltaTime : m_decelerationRate * gDeltaTime;
+		m_accelerationRate * deltaTime : m_decelerationRate * deltaTime;
 	lerpFactor = glm::clamp(lerpFactor, 0.0f, 1.0f);
 	
 	m_currentVelocity = glm::mix(m_currentVelocity, targetVelocity, lerpFactor);
@@ -289,10 +486,30 @@ void ViewManager::ProcessSmoothMovement()
 	// apply movement if velocity is significant
 	if (glm::length(m_currentVelocity) > 0.01f)
 	{
-		g_pCamera->Position += m_currentVelocity * gDeltaTime;
+		g_pCamera->Position += m_currentVelocity * deltaTime;
 	}
 }
 
+/***********************************************************
+ *  ProcessScriptedMovement()
+ *
+ *  This method moves the camera along the benchmark path, a
+ *  slow orbit around the table that always looks at its
+ *  center, so that each frame depends only on the frame
+ *  number
+ ***********************************************************/
+void ViewManager::ProcessScriptedMovement()
+{
+	float angle = glm::two_pi<float>() * (m_scriptedTime / g_OrbitPeriod);
+	glm::vec3 target(0.0f, g_OrbitTargetHeight, 0.0f);
+
+	g_pCamera->Position = glm::vec3(
+		m_orbitRadius * std::sin(angle),
+		g_OrbitHeight,
+		m_orbitRadius * std::cos(angle));
+	g_pCamera->Front = glm::normalize(target - g_pCamera->Position);
+}
+
 /***********************************************************
  *  PrepareSceneView()
  *
@@ -305,24 +522,64 @@ void ViewManager::PrepareSceneView()
 	glm::mat4 view;
 	glm::mat4 projection;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	if (m_bScriptedCamera)
+	{
+		// the benchmark advances by a fixed step per frame so every
+		// run renders the same frames
+		m_scriptedTime += m_fixedTimeStep;
+		ProcessScriptedMovement();
+		m_simulationTime = m_scriptedTime;
+		m_viewState = CaptureViewState();
+	}
+	else
+	{
+		// hand the waiting input to the ticks, and run them here
+		// when there is no update thread
+		double now = glfwGetTime();
+		SampleInput();
+		if (!m_updateThread.joinable())
+		{
+			AdvanceTicks(now);
+		}
+
+		// draw the state one tick behind the clock, between the
+		// two latest ticks, so motion stays smooth at any frame rate
+		m_snapshots.Acquire();
+		const VIEW_SNAPSHOT& snapshot = m_snapshots.GetReadSlot();
+		float blend = glm::clamp((float)((now - snapshot.tickTime) / g_TickInterval), 0.0f, 1.0f);
+		m_viewState = snapshot.current;
+		m_viewState.position = glm::mix(snapshot.previous.position, snapshot.current.position, blend);
+		m_viewState.front = glm::normalize(glm::mix(snapshot.previous.front, snapshot.current.front, blend));
+		m_viewState.up = glm::normalize(glm::mix(snapshot.previous.up, snapshot.current.up, blend));
+		m_viewState.zoom = glm::mix(snapshot.previous.zoom, snapshot.current.zoom, blend);
+		m_viewState.rippleAmplitude = glm::mix(
+			snapshot.previous.rippleAmplitude, snapshot.current.rippleAmplitude, blend);
+		m_viewState.timeSeconds = glm::mix(snapshot.previous.timeSeconds, snapshot.current.timeSeconds, blend);
+	}
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// get the current view matrix from the camera state
+	view = glm::lookAt(m_viewState.position, m_viewState.position + m_viewState.front, m_viewState.up);
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	// the scene keeps the aspect of the window at any resolution
+	// scale; a minimized window has no size and keeps the default
+	int framebufferWidth = WINDOW_WIDTH;
+	int framebufferHeight = WINDOW_HEIGHT;
+	if (NULL != m_pWindow)
+	{
+		glfwGetFramebufferSize(m_pWindow, &framebufferWidth, &framebufferHeight);
+		if ((framebufferWidth <= 0) || (framebufferHeight <= 0))
+		{
+			framebufferWidth = WINDOW_WIDTH;
+			framebufferHeight = WINDOW_HEIGHT;
+		}
+	}
 
 	// define the current projection matrix based on mode
-	if (m_bPerspectiveProjection)
+	if (m_viewState.bPerspective)
 	{
 		// perspective projection (3D view)
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), 
-			(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(m_viewState.zoom), 
+			(GLfloat)framebufferWidth / (GLfloat)framebufferHeight, 0.1f, 100.0f);
 	}
 	else
 	{
@@ -331,23 +588,13 @@ void ViewManager::PrepareSceneView()
 		projection = glm::ortho(-orthoSize, orthoSize, -orthoSize, orthoSize, 0.1f, 100.0f);
 	}
 
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+	// camera and time go into the shared per-frame uniform block; it is
+	// uploaded once for every program before the first pass draws
+	if (NULL != m_pUniformBuffers)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_pUniformBuffers->SetCamera(view, projection, m_viewState.position);
 		// push current ripple amplitude (U/I controls) every frame
-		m_pShaderManager->setFloatValue("rippleAmplitude", m_rippleAmplitude);
-
-        // update camera-tied spotlight each frame so it follows the camera like a flashlight
-        m_pShaderManager->setVec3Value("spotLight.position", g_pCamera->Position);
-        // ensure Front is normalized for direction
-        glm::vec3 camDir = glm::normalize(g_pCamera->Front);
-        m_pShaderManager->setVec3Value("spotLight.direction", camDir);
+		m_pUniformBuffers->SetFrameTime(m_viewState.timeSeconds, m_viewState.rippleAmplitude);
 	}
 
 	// render camera information on screen
@@ -356,42 +603,100 @@ void ViewManager::PrepareSceneView()
 
 glm::vec3 ViewManager::GetCameraPosition() const
 {
-    return (g_pCamera != nullptr) ? g_pCamera->Position : glm::vec3(0.0f);
+    return m_viewState.position;
 }
 
 glm::vec3 ViewManager::GetCameraFront() const
 {
-    return (g_pCamera != nullptr) ? g_pCamera->Front : glm::vec3(0.0f, 0.0f, -1.0f);
+    return m_viewState.front;
+}
+
+/***********************************************************
+ *  SetProfiler()
+ *
+ *  This method is used for attaching the profiler whose
+ *  statistics are shown in the on-screen display.
+ ***********************************************************/
+void ViewManager::SetProfiler(FrameProfiler* pProfiler)
+{
+	m_pProfiler = pProfiler;
+}
+
+/***********************************************************
+ *  SetBenchmarkMode()
+ *
+ *  This method is used for switching the view to the fixed
+ *  time step and scripted camera of the benchmark.  Mouse
+ *  and keyboard input are ignored from then on.
+ ***********************************************************/
+void ViewManager::SetBenchmarkMode(float fixedTimeStep, float orbitRadius)
+{
+	// the scripted camera is moved on the render thread
+	StopUpdateThread();
+
+	m_bScriptedCamera = true;
+	m_fixedTimeStep = fixedTimeStep;
+	m_scriptedTime = 0.0f;
+	m_orbitRadius = orbitRadius;
+	m_currentVelocity = glm::vec3(0.0f);
+
+	if (NULL != m_pWindow)
+	{
+		glfwSetCursorPosCallback(m_pWindow, NULL);
+		glfwSetScrollCallback(m_pWindow, NULL);
+	}
 }
 
 /***********************************************************
  *  RenderCameraInfo()
  *
- *  Minimal stub to keep build intact; HUD was removed.
+ *  This method is used for showing the camera position and
+ *  the rolling frame statistics in the window title.  The
+ *  title is refreshed twice a second so it stays readable
+ *  and costs nothing per frame.
  ***********************************************************/
 void ViewManager::RenderCameraInfo()
 {
-	// No-op: HUD disabled. Keep function to satisfy references.
+	if ((NULL == m_pWindow) || (NULL == m_pProfiler))
+	{
+		return;
+	}
+
+	double now = glfwGetTime();
+	if ((now - m_lastInfoUpdate) < g_InfoUpdateInterval)
+	{
+		return;
+	}
+	m_lastInfoUpdate = now;
+
+	std::ostringstream info;
+	info << std::fixed << std::setprecision(1);
+	info << m_windowTitle
+		<< " | cam (" << m_viewState.position.x
+		<< ", " << m_viewState.position.y
+		<< ", " << m_viewState.position.z << ")"
+		<< " | " << m_pProfiler->GetSummary();
+
+	glfwSetWindowTitle(m_pWindow, info.str().c_str());
 }
 
 /***********************************************************
  *  ProcessRippleControls()
  *
- *  Adjust rippleAmplitude using U (decrease) and I (increase)
+ *  Adjust rippleAmplitude using U (decrease) and I (increase),
+ *  at a fixed rate per second while the key is held
  ***********************************************************/
-void ViewManager::ProcessRippleControls()
+void ViewManager::ProcessRippleControls(const INPUT_STATE& input, float deltaTime)
 {
-	if (!m_pWindow) return;
-
 	// Increase ripple amplitude with 'I'
-	if (glfwGetKey(m_pWindow, GLFW_KEY_I) == GLFW_PRESS)
+	if (input.keys & KEY_RIPPLE_UP)
 	{
-		m_rippleAmplitude = glm::clamp(m_rippleAmplitude + m_rippleStep, m_rippleMin, m_rippleMax);
+		m_rippleAmplitude = glm::clamp(m_rippleAmplitude + m_rippleRate * deltaTime, m_rippleMin, m_rippleMax);
 	}
 
 	// Decrease ripple amplitude with 'U'
-	if (glfwGetKey(m_pWindow, GLFW_KEY_U) == GLFW_PRESS)
+	if (input.keys & KEY_RIPPLE_DOWN)
 	{
-		m_rippleAmplitude = glm::clamp(m_rippleAmplitude - m_rippleStep, m_rippleMin, m_rippleMax);
+		m_rippleAmplitude = glm::clamp(m_rippleAmplitude - m_rippleRate * deltaTime, m_rippleMin, m_rippleMax);
 	}
-}
\ No newline at end of file
+}
@@ -10,17 +10,39 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "UniformBufferManager.h"
+#include "FrameProfiler.h"
+#include "TripleBuffer.h"
 #include "camera.h"
 
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
 // GLFW library
 #include "GLFW/glfw3.h" 
 
+/***********************************************************
+ *  ViewManager
+ *
+ *  This class owns the camera and the liquid ripple control.
+ *  Interactive runs advance them on an update thread at a
+ *  fixed tick, from the input the render thread samples each
+ *  frame, so movement does not depend on the frame rate and
+ *  a slow frame does not hold up the simulation.
+ *
+ *  Each tick publishes the view state before and after it
+ *  through a triple buffer, and every frame renders the
+ *  state interpolated between the two.
+ ***********************************************************/
 class ViewManager
 {
 public:
 	// constructor
 	ViewManager(
-		ShaderManager* pShaderManager);
+		ShaderManager* pShaderManager,
+		UniformBufferManager* pUniformBuffers);
 	// destructor
 	~ViewManager();
 
@@ -29,16 +51,62 @@ public:
 	// mouse scroll callback for speed adjustment
 	static void Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset);
 
+	// keys the update thread reacts to, sampled by the render thread
+	enum INPUT_KEYS : uint32_t
+	{
+		KEY_FORWARD = 1u << 0,
+		KEY_BACK = 1u << 1,
+		KEY_LEFT = 1u << 2,
+		KEY_RIGHT = 1u << 3,
+		KEY_UP = 1u << 4,
+		KEY_DOWN = 1u << 5,
+		KEY_PERSPECTIVE = 1u << 6,
+		KEY_ORTHOGRAPHIC = 1u << 7,
+		KEY_RIPPLE_UP = 1u << 8,
+		KEY_RIPPLE_DOWN = 1u << 9
+	};
+
+	// input of one frame; the mouse and scroll offsets are summed
+	// from the start, so a tick that misses a frame loses nothing
+	struct INPUT_STATE
+	{
+		uint32_t keys = 0;
+		double mouseX = 0.0;
+		double mouseY = 0.0;
+		double scroll = 0.0;
+	};
+
+	// everything a frame needs from the simulation
+	struct VIEW_STATE
+	{
+		glm::vec3 position = glm::vec3(0.0f);
+		glm::vec3 front = glm::vec3(0.0f, 0.0f, -1.0f);
+		glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+		float zoom = 45.0f;
+		float rippleAmplitude = 0.0f;
+		// simulated seconds, which drive the ripple animation
+		float timeSeconds = 0.0f;
+		bool bPerspective = true;
+	};
+
+	// the states before and after the last tick, and the clock
+	// time the tick was due
+	struct VIEW_SNAPSHOT
+	{
+		VIEW_STATE previous;
+		VIEW_STATE current;
+		double tickTime = 0.0;
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the shared uniform buffer objects
+	UniformBufferManager* m_pUniformBuffers;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
 	// projection mode flag (true = perspective, false = orthographic)
 	bool m_bPerspectiveProjection;
-	// key press tracking for projection switching
-	bool m_bPKeyPressed;
-	bool m_bOKeyPressed;
 	// smooth movement variables
 	glm::vec3 m_currentVelocity;
 	float m_accelerationRate;
@@ -49,20 +117,58 @@ private:
 
 	// ripple control state (for liquid surface)
 	float m_rippleAmplitude;     // current amplitude
-	float m_rippleStep;          // step change per key press
+	float m_rippleRate;          // change per second while a key is held
 	float m_rippleMin = 0.0f;    // lower clamp
 	float m_rippleMax = 0.2f;    // upper clamp
 
-	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	// optional profiler shown by the on-screen display
+	FrameProfiler* m_pProfiler;
+	// title given at window creation, prefixed to the display
+	std::string m_windowTitle;
+	// time of the last on-screen display refresh
+	double m_lastInfoUpdate;
+
+	// benchmark mode: fixed time step and scripted camera path
+	bool m_bScriptedCamera;
+	float m_fixedTimeStep;
+	float m_scriptedTime;
+	float m_orbitRadius;
+
+	// input handed from the render thread to the update thread,
+	// and view states handed back
+	TripleBuffer<INPUT_STATE> m_input;
+	TripleBuffer<VIEW_SNAPSHOT> m_snapshots;
+	// update thread state: the clock time the next tick is due,
+	// the simulated time and the input offsets already applied
+	double m_nextTickTime;
+	float m_simulationTime;
+	INPUT_STATE m_appliedInput;
+	// view state the render thread drew the current frame with
+	VIEW_STATE m_viewState;
+	// fixed-tick update thread, when started
+	std::thread m_updateThread;
+	std::atomic<bool> m_bStopUpdates;
+
+	// sample the keyboard and mouse for the update thread
+	void SampleInput();
+	// run every tick due by a clock time
+	void AdvanceTicks(double now);
+	// advance the camera and ripple by one fixed tick
+	void Tick(const INPUT_STATE& input, float deltaTime);
+	// read the camera and ripple into a view state
+	VIEW_STATE CaptureViewState() const;
+	// body of the update thread
+	void UpdateMain();
 	// process projection mode switching keys
-	void ProcessProjectionKeys();
+	void ProcessProjectionKeys(const INPUT_STATE& input);
 	// process smooth camera movement
-	void ProcessSmoothMovement();
+	void ProcessSmoothMovement(const INPUT_STATE& input, float deltaTime);
+	// move the camera along the benchmark path
+	void ProcessScriptedMovement();
 	// render on-screen display for camera info
 	void RenderCameraInfo();
 	// handle ripple amplitude controls (U/I)
-	void ProcessRippleControls();
+	void ProcessRippleControls(const INPUT_STATE& input, float deltaTime);
 
 public:
 	// create the initial OpenGL display window
@@ -71,7 +177,20 @@ public:
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
 
-    // camera accessors for systems that need light-aligned data (e.g., shadows)
+	// advance the camera on its own thread at a fixed tick; without
+	// it, PrepareSceneView() runs the due ticks itself
+	void StartUpdateThread();
+	void StopUpdateThread();
+
+    // camera accessors for systems that need light-aligned data (e.g., shadows);
+    // they return the view of the frame being rendered
     glm::vec3 GetCameraPosition() const;
     glm::vec3 GetCameraFront() const;
+
+	// show the statistics of a profiler in the on-screen display
+	void SetProfiler(FrameProfiler* pProfiler);
+
+	// replace input and wall clock time with a scripted camera orbit
+	// of the given radius advanced by a fixed time step per frame
+	void SetBenchmarkMode(float fixedTimeStep, float orbitRadius);
 };
\ No newline at end of file
@@ -0,0 +1,184 @@
+#version 430 core
+// one invocation per scene object; must match g_CullGroupSize
+layout (local_size_x = 64) in;
+
+// std430 mirror of InstancedMeshes::INSTANCE_DATA
+struct InstanceRecord
+{
+    mat4 model;
+    vec4 normalMatrix[3];
+    vec4 color;
+    vec2 uvScale;
+    int materialSlot;
+    uint drawFlags;
+};
+
+// std430 mirror of GpuCulling::OBJECT_RECORD
+struct ObjectRecord
+{
+    InstanceRecord instance;
+    vec4 sphere;
+    vec4 boxMin;
+    vec4 boxMax;
+    uint passMask;
+    uint firstCommand;
+    uint commandCount;
+    float lodRadius;
+};
+
+layout (std430, binding = 0) readonly buffer ObjectBlock
+{
+    ObjectRecord objects[];
+};
+
+// DrawElementsIndirectCommand as five words: count,
+// instanceCount, firstIndex, baseVertex, baseInstance
+layout (std430, binding = 1) buffer CommandBlock
+{
+    uint commandWords[];
+};
+
+layout (std430, binding = 2) writeonly buffer InstanceBlock
+{
+    InstanceRecord instances[];
+};
+
+uniform uint objectCount;
+// bit of the cull pass in ObjectRecord.passMask
+uniform uint passBit;
+// first command of the pass in the command buffer
+uniform uint firstCommand;
+// inward facing unit planes, same order as Frustum::FRUSTUM_PLANE
+uniform vec4 frustumPlanes[6];
+
+// occlusion test against the depth pyramid of the previous frame
+uniform bool bOcclusion = false;
+uniform mat4 occlusionViewProjection;
+uniform sampler2D hiZ;
+uniform int hiZLevels;
+
+// levels of detail of every mesh; must match InstancedMeshes::LOD_COUNT
+const uint LOD_COUNT = 3u;
+// view the level of detail is chosen for, as InstancedMeshes::LOD_VIEW
+uniform vec3 lodViewPosition;
+uniform float lodPixelsPerUnit;
+uniform bool bLodPerspective = true;
+uniform float lodMaxError = 1.0;
+// chord error of each level as a fraction of the radius
+uniform float lodErrors[LOD_COUNT];
+
+// same sphere then box test as Frustum::IsVisible()
+bool IsInsideFrustum(ObjectRecord object)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(frustumPlanes[i].xyz, object.sphere.xyz) + frustumPlanes[i].w < -object.sphere.w)
+            return false;
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        vec3 normal = frustumPlanes[i].xyz;
+        vec3 corner = mix(object.boxMin.xyz, object.boxMax.xyz, greaterThanEqual(normal, vec3(0.0)));
+        if (dot(normal, corner) + frustumPlanes[i].w < 0.0)
+            return false;
+    }
+    return true;
+}
+
+// true when the box lies behind the farthest depth of every
+// pyramid texel its screen rectangle covers
+bool IsOccluded(ObjectRecord object)
+{
+    vec2 rectMin = vec2(1.0);
+    vec2 rectMax = vec2(0.0);
+    float nearestDepth = 1.0;
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = vec3(
+            ((i & 1) != 0) ? object.boxMax.x : object.boxMin.x,
+            ((i & 2) != 0) ? object.boxMax.y : object.boxMin.y,
+            ((i & 4) != 0) ? object.boxMax.z : object.boxMin.z);
+        vec4 clip = occlusionViewProjection * vec4(corner, 1.0);
+        // boxes reaching behind the camera are never occluded
+        if (clip.w <= 1.0e-4)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+        rectMin = min(rectMin, uv);
+        rectMax = max(rectMax, uv);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+    }
+    rectMin = clamp(rectMin, vec2(0.0), vec2(1.0));
+    rectMax = clamp(rectMax, vec2(0.0), vec2(1.0));
+
+    // pick the level where the rectangle spans at most 2 x 2 texels
+    vec2 extent = (rectMax - rectMin) * vec2(textureSize(hiZ, 0));
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, hiZLevels - 1);
+    ivec2 texelMin;
+    ivec2 texelMax;
+    for (;;)
+    {
+        ivec2 levelSize = textureSize(hiZ, level);
+        texelMin = clamp(ivec2(rectMin * vec2(levelSize)), ivec2(0), levelSize - 1);
+        texelMax = clamp(ivec2(rectMax * vec2(levelSize)), ivec2(0), levelSize - 1);
+        if (all(lessThanEqual(texelMax - texelMin, ivec2(1))) || (level >= hiZLevels - 1))
+            break;
+        level++;
+    }
+
+    float farthestDepth = max(
+        max(texelFetch(hiZ, texelMin, level).r, texelFetch(hiZ, ivec2(texelMax.x, texelMin.y), level).r),
+        max(texelFetch(hiZ, ivec2(texelMin.x, texelMax.y), level).r, texelFetch(hiZ, texelMax, level).r));
+
+    return nearestDepth > farthestDepth;
+}
+
+// coarsest level whose projected error stays within lodMaxError,
+// as InstancedMeshes::SelectLod() picks it
+uint SelectLod(ObjectRecord object)
+{
+    float radius = object.lodRadius;
+    if ((radius <= 0.0) || (lodPixelsPerUnit <= 0.0))
+        return 0u;
+
+    float pixelsPerUnit = lodPixelsPerUnit;
+    if (bLodPerspective)
+    {
+        float distance = length(object.sphere.xyz - lodViewPosition);
+        if (distance <= radius)
+            return 0u;
+        pixelsPerUnit /= distance;
+    }
+
+    uint lod = 0u;
+    while ((lod + 1u < LOD_COUNT) && (lodErrors[lod + 1u] * radius * pixelsPerUnit <= lodMaxError))
+        lod++;
+    return lod;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= objectCount)
+        return;
+
+    ObjectRecord object = objects[index];
+    if ((object.passMask & passBit) == 0u)
+        return;
+    if (!IsInsideFrustum(object))
+        return;
+    if (bOcclusion && IsOccluded(object))
+        return;
+
+    // append to the first command of the mesh at its level of
+    // detail; further commands draw other parts of the same
+    // instances and only count up
+    uint command = firstCommand + object.firstCommand + SelectLod(object) * object.commandCount;
+    uint slot = atomicAdd(commandWords[command * 5u + 1u], 1u);
+    for (uint i = 1u; i < object.commandCount; i++)
+    {
+        atomicAdd(commandWords[(command + i) * 5u + 1u], 1u);
+    }
+
+    instances[commandWords[command * 5u + 4u] + slot] = object.instance;
+}
@@ -1,9 +1,37 @@
 #version 330 core
+// the clustered point lights are read from storage buffers, so the
+// app compiles CLUSTERED_LIGHTS in only where OpenGL 4.3 is present
+#ifdef CLUSTERED_LIGHTS
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
 out vec4 fragmentColor;
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+// per-instance color and UV scale; white and 1.0 for single draws
+flat in vec4 fragmentInstanceColor;
+flat in vec2 fragmentInstanceUVScale;
+// per-instance material table entry and INSTANCE_* flags of
+// indirect draws; -1 and 0 leave the uniforms in charge
+flat in int fragmentInstanceMaterial;
+flat in int fragmentInstanceFlags;
+// ripple wave of a liquid surface, computed per vertex
+in float fragmentRippleWave;
+
+// must match INSTANCE_FLAGS in instancedmeshes.h
+#define INSTANCE_TEXTURED 1
+#define INSTANCE_LIT 2
+#define INSTANCE_LIQUID 4
+
+// shadow filters; must match SHADOW_FILTER in scenemanager.h,
+// which compiles its choice in as SHADOW_FILTER
+#define SHADOW_FILTER_HARDWARE 0
+#define SHADOW_FILTER_PCF4 1
+#define SHADOW_FILTER_POISSON16 2
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER SHADOW_FILTER_POISSON16
+#endif
 
 struct Material {
     vec3 diffuseColor;
@@ -11,93 +39,221 @@ struct Material {
     float shininess;
 };
 
+// light structs follow the std140 layout of LightsBlock: each vec3
+// is followed by a scalar that fills the rest of its 16 byte slot
 struct DirectionalLight {
     vec3 direction;
+    bool bActive;
 
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
-
-    bool bActive;
 };
 
 struct PointLight {
     vec3 position;
+    bool bActive;
 
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
-
-    bool bActive;
 };
 
 struct SpotLight {
     vec3 position;
+    bool bActive;
     vec3 direction;
     float cutOff;
+    vec3 ambient;
     float outerCutOff;
-
+    vec3 diffuse;
     float constant;
+    vec3 specular;
     float linear;
     float quadratic;
+};
 
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    bool bActive;
+// one entry of the material table; textureLayer selects a layer of
+// objectTextureArray, or is -1 for objectTexture or no texture
+struct MaterialRecord {
+    vec3 diffuseColor;
+    float shininess;
+    vec3 specularColor;
+    int textureLayer;
 };
 
 #define TOTAL_POINT_LIGHTS 5
+#define MAX_MATERIALS 64
+
+#ifdef CLUSTERED_LIGHTS
+// point light of limited range; must match POINT_LIGHT in
+// clusteredlights.h
+struct ClusteredPointLight {
+    vec4 positionRange; // xyz: world position, w: range
+    vec4 ambient; // w: first of the six shadow atlas views, or -1
+    vec4 diffuse;
+    vec4 specular;
+};
+#endif
 
 uniform bool bUseTexture=false;
 uniform bool bUseLighting=false;
 uniform vec4 objectColor = vec4(1.0f);
-uniform vec3 viewPosition;
-uniform DirectionalLight directionalLight;
-uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
-uniform SpotLight spotLight;
 uniform Material material;
 uniform sampler2D objectTexture;
+// scene textures of one size, one per layer, bound once per frame
+uniform sampler2DArray objectTextureArray;
+// entry of MaterialsBlock used by this draw; -1 uses material and objectTexture
+uniform int materialIndex = -1;
 uniform vec2 UVscale = vec2(1.0f, 1.0f);
 
-// Shadow mapping (spotlight)
-uniform sampler2D spotShadowMap;
-uniform mat4 spotLightSpaceMatrix;
-uniform int spotShadowMapTextureUnit = 7; // default unit; app will bind accordingly
+// per-frame camera and time state, shared with every program
+layout (std140) uniform FrameBlock
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+    float timeSeconds;
+    float rippleAmplitude;
+};
+
+// scene lights, uploaded once and updated only when a light changes
+layout (std140) uniform LightsBlock
+{
+    DirectionalLight directionalLight;
+    PointLight pointLights[TOTAL_POINT_LIGHTS];
+    SpotLight spotLight;
+};
+
+// materials of every draw item, uploaded once and updated when a texture loads
+layout (std140) uniform MaterialsBlock
+{
+    MaterialRecord materials[MAX_MATERIALS];
+};
+
+// light views of the shadow atlas, updated when a light or tile moves;
+// must match MAX_SHADOW_VIEWS in uniformbuffermanager.h
+#define MAX_SHADOW_VIEWS 32
+layout (std140) uniform ShadowBlock
+{
+    mat4 shadowMatrices[MAX_SHADOW_VIEWS];
+    vec4 shadowTiles[MAX_SHADOW_VIEWS]; // xy: corner, z: side, in atlas UV
+    ivec4 shadowLightViews; // x: spotlight, y: directional light, -1: none
+};
+
+#ifdef CLUSTERED_LIGHTS
+// every clustered light of the scene, uploaded when one changes
+layout (std430) buffer ClusteredLightsBlock
+{
+    ClusteredPointLight clusteredLights[];
+};
+
+// the view volume cut into screen tiles and log-spaced depth slices;
+// every cluster holds the first entry and the number of its lights
+// in clusterLightIndices, refilled every frame
+layout (std430) buffer LightClustersBlock
+{
+    uvec4 clusterCounts;
+    vec4 clusterScale; // xy: clusters per pixel, zw: log depth to slice
+    uvec2 clusterRanges[];
+};
+
+layout (std430) buffer LightIndicesBlock
+{
+    uint clusterLightIndices[];
+};
+#endif
+
+// Shadow mapping; the depth of every shadowed light view lives in a
+// tile of one atlas, and every lookup compares against the reference
+// depth and filters the 2x2 texels around it
+uniform sampler2DShadow shadowAtlas;
 
 // Liquid ripple uniforms
 uniform bool bIsLiquidSurface = false;
-uniform float timeSeconds = 0.0;
 uniform vec2 rippleParams = vec2(4.0, 12.0); // x: speed, y: radial frequency
-uniform float rippleAmplitude = 0.04;
+
+// object color and UV scale combined with the per-instance values
+vec4 surfaceColor;
+vec2 surfaceUVScale;
+// material of this draw and its texture color, sampled once
+Material surfaceMaterial;
+vec4 surfaceTexel;
+// draw features; a permutation compiles them in as TEXTURED, LIT and
+// LIQUID, otherwise they combine the toggles with the per-instance flags
+#ifdef TEXTURED
+const bool surfaceTextured = (TEXTURED != 0);
+#else
+bool surfaceTextured;
+#endif
+#ifdef LIT
+const bool surfaceLit = (LIT != 0);
+#else
+bool surfaceLit;
+#endif
+#ifdef LIQUID
+const bool surfaceLiquid = (LIQUID != 0);
+#else
+bool surfaceLiquid;
+#endif
 
 // function prototypes
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+#ifdef CLUSTERED_LIGHTS
+uint GetLightCluster(vec3 fragPos);
+vec3 CalcClusteredPointLight(ClusteredPointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+#endif
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-float CalcSpotShadow(vec3 fragPos, vec3 normal, vec3 lightDir);
+float CalcAtlasShadow(int view, vec3 fragPos, vec3 normal, vec3 lightDir);
+vec4 ApplyLiquidSurface(vec4 baseColor, float edgeStart, float edgeWidth);
 
 void main()
 {
-    // base normal
-    vec3 norm = normalize(fragmentVertexNormal);
+    surfaceColor = objectColor * fragmentInstanceColor;
+    surfaceUVScale = UVscale * fragmentInstanceUVScale;
+#ifndef TEXTURED
+    surfaceTextured = bUseTexture || ((fragmentInstanceFlags & INSTANCE_TEXTURED) != 0);
+#endif
+#ifndef LIT
+    surfaceLit = bUseLighting || ((fragmentInstanceFlags & INSTANCE_LIT) != 0);
+#endif
+#ifndef LIQUID
+    surfaceLiquid = bIsLiquidSurface || ((fragmentInstanceFlags & INSTANCE_LIQUID) != 0);
+#endif
+
+    // look up the material table entry of this draw, if any;
+    // an instance entry wins over the uniform one
+    int drawMaterial = (fragmentInstanceMaterial >= 0) ? fragmentInstanceMaterial : materialIndex;
+    surfaceMaterial = material;
+    int textureLayer = -1;
+    if (drawMaterial >= 0)
+    {
+        surfaceMaterial.diffuseColor = materials[drawMaterial].diffuseColor;
+        surfaceMaterial.specularColor = materials[drawMaterial].specularColor;
+        surfaceMaterial.shininess = materials[drawMaterial].shininess;
+        textureLayer = materials[drawMaterial].textureLayer;
+    }
 
-    // optional ripple normal perturbation for liquid surface
-    if (bIsLiquidSurface)
+    surfaceTexel = vec4(1.0);
+    if (surfaceTextured)
     {
-        // center UVs around 0.5 and compute radial distance
-        vec2 centered = (fragmentTextureCoordinate - vec2(0.5)) * UVscale;
-        float r = length(centered);
-        // radial wave: concentric rings emanating from center
-        float wave = sin(r * rippleParams.y - timeSeconds * rippleParams.x);
-        // perturb along the local tangent direction to suggest circular ripple normals
-        vec2 tangent = normalize(vec2(-centered.y, centered.x) + 1e-6);
-        vec3 rippleN = vec3(tangent.x, 0.0, tangent.y) * (wave * rippleAmplitude);
-        norm = normalize(norm + rippleN);
+        vec2 uv = fragmentTextureCoordinate * surfaceUVScale;
+        if (textureLayer >= 0)
+        {
+            surfaceTexel = texture(objectTextureArray, vec3(uv, float(textureLayer)));
+        }
+        else
+        {
+            surfaceTexel = texture(objectTexture, uv);
+        }
     }
 
-    if(bUseLighting == true)
+    // base normal; a liquid surface arrives displaced, with the ripple
+    // already in its vertex normals
+    vec3 norm = normalize(fragmentVertexNormal);
+
+    if(surfaceLit)
     {
         vec3 phongResult = vec3(0.0f);
         // properties
@@ -112,9 +268,16 @@ void main()
         // phase 1: directional lighting
         if(directionalLight.bActive == true)
         {
-            phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
+            phongResult += CalcDirectionalLight(directionalLight, norm, fragmentPosition, viewDir);
         }
         // phase 2: point lights
+#ifdef NUM_POINT_LIGHTS
+        // a permutation knows how many lights are on, and they come first
+        for(int i = 0; i < NUM_POINT_LIGHTS; i++)
+        {
+            phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);
+        }
+#else
         for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
         {
             if(pointLights[i].bActive == true)
@@ -122,89 +285,72 @@ void main()
                 phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);
             }
         }
+#endif
+#ifdef CLUSTERED_LIGHTS
+        // only the local lights that reach the cluster of this fragment
+        uvec2 clusterRange = clusterRanges[GetLightCluster(fragmentPosition)];
+        for(uint i = 0u; i < clusterRange.y; i++)
+        {
+            uint lightIndex = clusterLightIndices[clusterRange.x + i];
+            phongResult += CalcClusteredPointLight(clusteredLights[lightIndex], norm, fragmentPosition, viewDir);
+        }
+#endif
         // phase 3: spot light
         if(spotLight.bActive == true)
         {
             phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);
         }
 
-        if(bUseTexture == true)
+        if(surfaceTextured)
         {
-            fragmentColor = vec4(phongResult, texture(objectTexture, fragmentTextureCoordinate * UVscale).a);
+            fragmentColor = vec4(phongResult, surfaceTexel.a);
         }
         else
         {
-            fragmentColor = vec4(phongResult, objectColor.a);
+            fragmentColor = vec4(phongResult, surfaceColor.a);
         }
     }
     else
     {
-        if(bUseTexture == true)
+        // unlit surfaces show their texture or color as is
+        vec4 baseColor = surfaceTextured ? surfaceTexel : surfaceColor;
+        if (surfaceLiquid)
         {
-            // base textured color
-            vec4 baseTex = texture(objectTexture, fragmentTextureCoordinate * UVscale);
-            // apply subtle shimmer when liquid is active
-            if (bIsLiquidSurface)
+            // the meniscus of a textured liquid starts further out and
+            // spreads wider, to enlarge the center opening
+            if (surfaceTextured)
             {
-                // radial shimmer tied to concentric ripples
-                vec2 centered = (fragmentTextureCoordinate - vec2(0.5)) * UVscale;
-                float r = length(centered);
-                float wave = sin(r * rippleParams.y - timeSeconds * rippleParams.x);
-                float shimmer = 0.95 + 0.05 * wave;
-                baseTex.rgb *= shimmer;
+                baseColor = ApplyLiquidSurface(baseColor, 0.5, 0.5);
             }
-            // apply subtle meniscus effect near edge to make liquid feel rounded
-            if (bIsLiquidSurface)
+            else
             {
-                // treat UV as radial domain around center (0.5, 0.5). Adjust if needed.
-                vec2 centered = (fragmentTextureCoordinate - vec2(0.5)) * UVscale;
-                float r = length(centered);
-                // meniscus band adjusted to enlarge center opening
-                float edgeStart = 0.5;  // moved inward to enlarge inner opening
-                float edgeWidth = 0.5;  // wider band for a more pronounced rim
-                float edgeT = smoothstep(edgeStart, edgeStart + edgeWidth, r);
-                // darken slightly toward edge, then small bright band at the rim
-                float darken = mix(1.0, 0.92, edgeT);
-                float highlight = smoothstep(edgeStart + edgeWidth * 0.7, edgeStart + edgeWidth, r) * 0.08;
-                baseTex.rgb = baseTex.rgb * darken + highlight;
+                baseColor = ApplyLiquidSurface(baseColor, 0.38, 0.10);
             }
-            fragmentColor = baseTex;
-        }
-        else
-        {
-            vec4 baseCol = objectColor;
-            // apply subtle shimmer to solid color if liquid
-            if (bIsLiquidSurface)
-            {
-                // radial shimmer tied to concentric ripples
-                vec2 centered = (fragmentTextureCoordinate - vec2(0.5)) * UVscale;
-                float r = length(centered);
-                float wave = sin(r * rippleParams.y - timeSeconds * rippleParams.x);
-                float shimmer = 0.95 + 0.05 * wave;
-                baseCol.rgb *= shimmer;
-            }
-            // apply subtle meniscus effect near edge to make liquid feel rounded
-            if (bIsLiquidSurface)
-            {
-                // treat UV as radial domain around center (0.5, 0.5). Adjust if needed.
-                vec2 centered = (fragmentTextureCoordinate - vec2(0.5)) * UVscale;
-                float r = length(centered);
-                // meniscus band adjusted to enlarge center opening
-                float edgeStart = 0.38;  // moved inward to enlarge inner opening
-                float edgeWidth = 0.10;  // wider band for a more pronounced rim
-                float edgeT = smoothstep(edgeStart, edgeStart + edgeWidth, r);
-                // darken slightly toward edge, then small bright band at the rim
-                float darken = mix(1.0, 0.92, edgeT);
-                float highlight = smoothstep(edgeStart + edgeWidth * 0.7, edgeStart + edgeWidth, r) * 0.08;
-                baseCol.rgb = baseCol.rgb * darken + highlight;
-            }
-            fragmentColor = baseCol;
         }
+        fragmentColor = baseColor;
     }
 }
 
+// adds the ripple shimmer and the meniscus to the unlit color of a liquid
+// surface; the meniscus band starts edgeStart from the center
+vec4 ApplyLiquidSurface(vec4 baseColor, float edgeStart, float edgeWidth)
+{
+    // treat UV as radial domain around center (0.5, 0.5)
+    vec2 centered = (fragmentTextureCoordinate - vec2(0.5)) * surfaceUVScale;
+    float r = length(centered);
+    // radial shimmer tied to the ripple of the vertices
+    float shimmer = 0.95 + 0.05 * fragmentRippleWave;
+    baseColor.rgb *= shimmer;
+    // darken slightly toward edge, then small bright band at the rim
+    float edgeT = smoothstep(edgeStart, edgeStart + edgeWidth, r);
+    float darken = mix(1.0, 0.92, edgeT);
+    float highlight = smoothstep(edgeStart + edgeWidth * 0.7, edgeStart + edgeWidth, r) * 0.08;
+    baseColor.rgb = baseColor.rgb * darken + highlight;
+    return baseColor;
+}
+
 // calculates the color when using a directional light.
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
@@ -215,19 +361,25 @@ vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
     float diff = max(dot(normal, lightDirection), 0.0);
     // specular shading
     vec3 reflectDir = reflect(-lightDirection, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // combine results
-    if(bUseTexture == true)
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surfaceMaterial.shininess);
+    // shadow factor, when the light has an atlas view
+    float shadow = 0.0;
+    if (shadowLightViews.y >= 0 && (diff > 0.0 || spec > 0.0))
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate * UVscale));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate * UVscale));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate * UVscale));
+        shadow = CalcAtlasShadow(shadowLightViews.y, fragPos, normal, lightDirection);
+    }
+    // combine results (apply shadow only to direct lighting terms)
+    if(surfaceTextured)
+    {
+        ambient = light.ambient * vec3(surfaceTexel);
+        diffuse = (1.0 - shadow) * light.diffuse * diff * surfaceMaterial.diffuseColor * vec3(surfaceTexel);
+        specular = (1.0 - shadow) * light.specular * spec * surfaceMaterial.specularColor * vec3(surfaceTexel);
     }
     else
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
+        ambient = light.ambient * vec3(surfaceColor);
+        diffuse = (1.0 - shadow) * light.diffuse * diff * surfaceMaterial.diffuseColor * vec3(surfaceColor);
+        specular = (1.0 - shadow) * light.specular * spec * surfaceMaterial.specularColor * vec3(surfaceColor);
     }
 
     return (ambient + diffuse + specular);
@@ -246,25 +398,82 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
     // Calculate specular component
-    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), surfaceMaterial.shininess);
 
     // combine results
-    if(bUseTexture == true)
+    if(surfaceTextured)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate * UVscale));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate * UVscale));
-        specular = light.specular * specularComponent * material.specularColor;
+        ambient = light.ambient * vec3(surfaceTexel);
+        diffuse = light.diffuse * diff * surfaceMaterial.diffuseColor * vec3(surfaceTexel);
+        specular = light.specular * specularComponent * surfaceMaterial.specularColor;
     }
     else
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * specularComponent * material.specularColor;
+        ambient = light.ambient * vec3(surfaceColor);
+        diffuse = light.diffuse * diff * surfaceMaterial.diffuseColor * vec3(surfaceColor);
+        specular = light.specular * specularComponent * surfaceMaterial.specularColor;
     }
 
     return (ambient + diffuse + specular);
 }
 
+#ifdef CLUSTERED_LIGHTS
+// index of the cluster a fragment falls into, from its pixel and the
+// log of its view depth
+uint GetLightCluster(vec3 fragPos)
+{
+    float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    vec2 tile = clamp(gl_FragCoord.xy * clusterScale.xy, vec2(0.0), vec2(clusterCounts.xy - 1u));
+    float slice = clamp(log(max(viewDepth, 0.001)) * clusterScale.z + clusterScale.w,
+        0.0, float(clusterCounts.z - 1u));
+
+    return ((uint(slice) * clusterCounts.y + uint(tile.y)) * clusterCounts.x + uint(tile.x));
+}
+
+// calculates the color of a clustered point light, which fades out
+// smoothly to nothing at its range
+vec3 CalcClusteredPointLight(ClusteredPointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 toFragment = fragPos - light.positionRange.xyz;
+    float ratio = length(toFragment) / light.positionRange.w;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    if (window <= 0.0)
+    {
+        return (vec3(0.0));
+    }
+
+    PointLight pointLight;
+    pointLight.position = light.positionRange.xyz;
+    pointLight.bActive = true;
+    pointLight.ambient = light.ambient.rgb;
+    pointLight.diffuse = light.diffuse.rgb;
+    pointLight.specular = light.specular.rgb;
+    vec3 color = CalcPointLight(pointLight, normal, fragPos, viewDir);
+
+    // a shadowed light has one atlas view per cube face, in the order
+    // +X, -X, +Y, -Y, +Z, -Z; the face is the major axis toward the
+    // fragment, and the shadow dims all but the ambient term
+    int firstView = int(light.ambient.w);
+    if (firstView >= 0)
+    {
+        vec3 axis = abs(toFragment);
+        int face;
+        if (axis.x >= axis.y && axis.x >= axis.z)
+            face = (toFragment.x >= 0.0) ? 0 : 1;
+        else if (axis.y >= axis.z)
+            face = (toFragment.y >= 0.0) ? 2 : 3;
+        else
+            face = (toFragment.z >= 0.0) ? 4 : 5;
+        float shadow = CalcAtlasShadow(firstView + face, fragPos, normal, -toFragment);
+
+        vec3 ambient = light.ambient.rgb * vec3(surfaceTextured ? surfaceTexel : surfaceColor);
+        color = ambient + (color - ambient) * (1.0 - shadow);
+    }
+
+    return (color * (window * window));
+}
+#endif
+
 // calculates the color when using a spot light.
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
@@ -273,32 +482,42 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     vec3 specular = vec3(0.0f);
 
     vec3 lightDir = normalize(light.position - fragPos);
+    // spotlight intensity; every term is scaled by it, so fragments
+    // outside the cone skip the shading and the shadow lookups
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    if (intensity <= 0.0)
+    {
+        return vec3(0.0);
+    }
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surfaceMaterial.shininess);
     // attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    // spotlight intensity
-    float theta = dot(lightDir, normalize(-light.direction));
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-    // shadow factor for spotlight (attenuates only diffuse/specular)
-    float shadow = CalcSpotShadow(fragPos, normal, lightDir);
+    // shadow factor for spotlight (attenuates only diffuse/specular),
+    // not needed when there is no direct light to attenuate
+    float shadow = 0.0;
+    if (shadowLightViews.x >= 0 && (diff > 0.0 || spec > 0.0))
+    {
+        shadow = CalcAtlasShadow(shadowLightViews.x, fragPos, normal, lightDir);
+    }
     // combine results (apply shadow only to direct lighting terms)
-    if(bUseTexture == true)
+    if(surfaceTextured)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate * UVscale));
-        diffuse = (1.0 - shadow) * light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate * UVscale));
-        specular = (1.0 - shadow) * light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate * UVscale));
+        ambient = light.ambient * vec3(surfaceTexel);
+        diffuse = (1.0 - shadow) * light.diffuse * diff * surfaceMaterial.diffuseColor * vec3(surfaceTexel);
+        specular = (1.0 - shadow) * light.specular * spec * surfaceMaterial.specularColor * vec3(surfaceTexel);
     }
     else
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = (1.0 - shadow) * light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = (1.0 - shadow) * light.specular * spec * material.specularColor * vec3(objectColor);
+        ambient = light.ambient * vec3(surfaceColor);
+        diffuse = (1.0 - shadow) * light.diffuse * diff * surfaceMaterial.diffuseColor * vec3(surfaceColor);
+        specular = (1.0 - shadow) * light.specular * spec * surfaceMaterial.specularColor * vec3(surfaceColor);
     }
 
     ambient *= attenuation * intensity;
@@ -307,11 +526,18 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     return (ambient + diffuse + specular);
 }
 
-// Shadow calculation for spotlight using 2D depth map with simple PCF
-float CalcSpotShadow(vec3 fragPos, vec3 normal, vec3 lightDir)
+// one filtered shadow tap, kept inside the texels of its own tile so
+// the filter never reads the depth of another light
+float SampleShadowTile(vec2 uv, vec4 tileBounds, float reference)
+{
+    return texture(shadowAtlas, vec3(clamp(uv, tileBounds.xy, tileBounds.zw), reference));
+}
+
+// Shadow calculation for one view of the shadow atlas with PCF
+float CalcAtlasShadow(int view, vec3 fragPos, vec3 normal, vec3 lightDir)
 {
     // transform fragment position to light clip space
-    vec4 fragPosLightSpace = spotLightSpaceMatrix * vec4(fragPos, 1.0);
+    vec4 fragPosLightSpace = shadowMatrices[view] * vec4(fragPos, 1.0);
     // perform perspective divide to get NDC
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     // transform to [0,1]
@@ -323,18 +549,51 @@ float CalcSpotShadow(vec3 fragPos, vec3 normal, vec3 lightDir)
 
     // bias to reduce shadow acne; slope-scaled using normal vs light
     float bias = max(0.0008 * (1.0 - dot(normalize(normal), normalize(lightDir))), 0.0002);
-
-    // Percentage-closer filtering (3x3 kernel)
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / vec2(textureSize(spotShadowMap, 0));
-    for (int x = -2; x <= 2; ++x)
+    float reference = projCoords.z - bias;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    // the view covers its tile, and the taps stay a texel within it
+    vec4 tile = shadowTiles[view];
+    vec2 center = tile.xy + projCoords.xy * tile.z;
+    vec4 tileBounds = vec4(tile.xy + texelSize, tile.xy + vec2(tile.z) - texelSize);
+
+    // fraction of the filter footprint that sees the light
+    float lit = 0.0;
+#if SHADOW_FILTER == SHADOW_FILTER_HARDWARE
+    lit = SampleShadowTile(center, tileBounds, reference);
+#elif SHADOW_FILTER == SHADOW_FILTER_PCF4
+    // four filtered taps a texel from the center cover a 4x4 texel block
+    for (int x = 0; x < 2; ++x)
     {
-        for (int y = -2; y <= 2; ++y)
+        for (int y = 0; y < 2; ++y)
         {
-            float pcfDepth = texture(spotShadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-            shadow += (projCoords.z - bias) > pcfDepth ? 1.0 : 0.0;
+            vec2 offset = vec2(float(x) * 2.0 - 1.0, float(y) * 2.0 - 1.0) * texelSize;
+            lit += SampleShadowTile(center + offset, tileBounds, reference);
         }
     }
-    shadow /= 25.0;
-    return shadow;
+    lit /= 4.0;
+#else
+    // the disk is turned by a noise angle per pixel, which trades
+    // banding at the penumbra for fine noise
+    const vec2 poissonDisk[16] = vec2[](
+        vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+        vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+        vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+        vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+        vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+        vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+        vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+        vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790));
+    // radius in texels, about that of the former 5x5 kernel
+    const float diskRadius = 2.5;
+    float noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    float angle = 6.28318531 * noise;
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+    for (int i = 0; i < 16; ++i)
+    {
+        vec2 offset = rotation * poissonDisk[i] * diskRadius * texelSize;
+        lit += SampleShadowTile(center + offset, tileBounds, reference);
+    }
+    lit /= 16.0;
+#endif
+    return 1.0 - lit;
 }
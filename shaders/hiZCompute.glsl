@@ -0,0 +1,46 @@
+#version 430 core
+// one invocation per texel of the level being written; must
+// match g_HiZGroupSize
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (r32f, binding = 0) uniform writeonly image2D destinationLevel;
+
+// the depth copy for level 0, the pyramid itself above that
+uniform sampler2D sourceDepth;
+uniform int sourceLevel;
+// level 0 copies the depth copy texel by texel
+uniform bool bCopy;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(destinationLevel);
+    if (any(greaterThanEqual(texel, size)))
+        return;
+
+    if (bCopy)
+    {
+        imageStore(destinationLevel, texel, vec4(texelFetch(sourceDepth, texel, 0).r));
+        return;
+    }
+
+    // keep the farthest depth of the source texels below; an odd
+    // source size folds its last row or column into the edge texel
+    ivec2 sourceSize = textureSize(sourceDepth, sourceLevel);
+    ivec2 first = texel * 2;
+    ivec2 last = min(first + 1, sourceSize - 1);
+    if ((texel.x == size.x - 1) && ((sourceSize.x & 1) != 0))
+        last.x = sourceSize.x - 1;
+    if ((texel.y == size.y - 1) && ((sourceSize.y & 1) != 0))
+        last.y = sourceSize.y - 1;
+
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++)
+    {
+        for (int x = first.x; x <= last.x; x++)
+        {
+            depth = max(depth, texelFetch(sourceDepth, ivec2(x, y), sourceLevel).r);
+        }
+    }
+    imageStore(destinationLevel, texel, vec4(depth));
+}
@@ -0,0 +1,112 @@
+#version 330 core
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+// per-instance attributes, advanced once per instance
+layout (location = 3) in mat4 inInstanceModel;
+layout (location = 7) in mat3 inInstanceNormalMatrix;
+layout (location = 10) in vec4 inInstanceColor;
+layout (location = 11) in vec2 inInstanceUVScale;
+// x: material table entry or -1, y: INSTANCE_* flags
+layout (location = 12) in ivec2 inInstanceMaterial;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out vec4 fragmentInstanceColor;
+flat out vec2 fragmentInstanceUVScale;
+flat out int fragmentInstanceMaterial;
+flat out int fragmentInstanceFlags;
+// ripple wave of a liquid surface, for its shimmer
+out float fragmentRippleWave;
+// the depth pre-pass and the lit pass must agree on every depth
+invariant gl_Position;
+
+// per-frame camera and time state, shared with every program
+layout (std140) uniform FrameBlock
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+    float timeSeconds;
+    float rippleAmplitude;
+};
+
+// light views of the shadow atlas, shared with every program;
+// must match MAX_SHADOW_VIEWS in uniformbuffermanager.h
+#define MAX_SHADOW_VIEWS 32
+layout (std140) uniform ShadowBlock
+{
+    mat4 shadowMatrices[MAX_SHADOW_VIEWS];
+    vec4 shadowTiles[MAX_SHADOW_VIEWS];
+    ivec4 shadowLightViews;
+};
+
+// depth pass toggle: project into the light space of one atlas view
+// instead of the camera
+uniform bool bDepthOnly = false;
+uniform int shadowView = 0;
+
+// per-instance shading flag; must match InstancedMeshes::INSTANCE_LIQUID
+#define INSTANCE_LIQUID 4
+
+// liquid surfaces ripple here, once per vertex of the liquid grid;
+// a permutation compiles the choice in as LIQUID
+uniform bool bIsLiquidSurface = false;
+uniform vec2 rippleParams = vec2(4.0, 12.0); // x: speed, y: radial frequency
+// world units a ripple of amplitude 1 lifts the surface
+const float RIPPLE_HEIGHT = 0.15;
+
+// lifts a liquid vertex by concentric waves around the center of the
+// disk and tilts its normal by their slope; the disk has radius 1 and
+// the waves are laid out over its texture radius of 0.5
+float ApplyRipple(mat4 model, inout vec4 worldPos, inout vec3 normal)
+{
+   vec2 radial = inVertexPosition.xz * 0.5;
+   float r = length(radial);
+   float phase = r * rippleParams.y - timeSeconds * rippleParams.x;
+   float wave = sin(phase);
+   worldPos.xyz += normal * (wave * rippleAmplitude * RIPPLE_HEIGHT);
+   if (r > 0.0001)
+   {
+      vec3 outward = normalize(mat3(model) * vec3(radial.x, 0.0, radial.y));
+      normal = normalize(normal - outward * (cos(phase) * rippleAmplitude));
+   }
+   return wave;
+}
+
+void main()
+{
+   vec4 worldPos = inInstanceModel * vec4(inVertexPosition, 1.0);
+
+   // the inverse-transpose is precomputed per instance on the CPU
+   vec3 normal = normalize(inInstanceNormalMatrix * inVertexNormal);
+
+   // shadows keep the flat surface, the ripples are far below a texel
+#ifdef LIQUID
+   bool bLiquid = (LIQUID != 0);
+#else
+   bool bLiquid = bIsLiquidSurface || ((inInstanceMaterial.y & INSTANCE_LIQUID) != 0);
+#endif
+   fragmentRippleWave = 0.0;
+   if (bLiquid && !bDepthOnly)
+   {
+      fragmentRippleWave = ApplyRipple(inInstanceModel, worldPos, normal);
+   }
+   fragmentPosition = vec3(worldPos);
+   fragmentVertexNormal = normal;
+
+   if (bDepthOnly)
+   {
+      gl_Position = shadowMatrices[shadowView] * worldPos;
+   }
+   else
+   {
+      gl_Position = projection * view * worldPos;
+   }
+   fragmentTextureCoordinate = inTextureCoordinate;
+   fragmentInstanceColor = inInstanceColor;
+   fragmentInstanceUVScale = inInstanceUVScale;
+   fragmentInstanceMaterial = inInstanceMaterial.x;
+   fragmentInstanceFlags = inInstanceMaterial.y;
+}
@@ -0,0 +1,30 @@
+#version 330 core
+// scales the HDR scene target up to the window and maps it to the
+// display range
+in vec2 presentTextureCoordinate;
+
+out vec4 fragmentColor;
+
+uniform sampler2D sceneColor;
+// part of the target the scene was drawn into, and the last texel
+// center within it, both in target UV
+uniform vec2 sourceScale = vec2(1.0);
+uniform vec2 sourceMax = vec2(1.0);
+
+// colors up to the knee are shown as rendered; above it they roll off
+// smoothly toward white instead of clipping
+const float TONE_KNEE = 0.8;
+
+vec3 ToneMap(vec3 color)
+{
+    vec3 over = max(color - TONE_KNEE, 0.0);
+    return min(color, vec3(TONE_KNEE)) + (1.0 - TONE_KNEE) * (1.0 - exp(-over / (1.0 - TONE_KNEE)));
+}
+
+void main()
+{
+    // bilinear filtering does the upscale; the taps stay inside the
+    // drawn part, as the rest of the target holds older frames
+    vec2 uv = min(presentTextureCoordinate * sourceScale, sourceMax);
+    fragmentColor = vec4(ToneMap(max(texture(sceneColor, uv).rgb, 0.0)), 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+// one triangle that covers the window, from the vertex number alone
+// so the present pass needs no vertex buffer
+out vec2 presentTextureCoordinate;
+
+void main()
+{
+    vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    presentTextureCoordinate = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
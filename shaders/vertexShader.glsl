@@ -6,22 +6,101 @@ layout (location = 2) in vec2 inTextureCoordinate;
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+// single draws take their color, UV scale and material from uniforms only
+flat out vec4 fragmentInstanceColor;
+flat out vec2 fragmentInstanceUVScale;
+flat out int fragmentInstanceMaterial;
+flat out int fragmentInstanceFlags;
+// ripple wave of a liquid surface, for its shimmer
+out float fragmentRippleWave;
+// the depth pre-pass and the lit pass must agree on every depth
+invariant gl_Position;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-// depth pass toggle: render worldPos only, other varyings not needed
+// inverse-transpose of the model matrix, precomputed on the CPU
+uniform mat3 normalMatrix;
+// per-frame camera and time state, shared with every program
+layout (std140) uniform FrameBlock
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+    float timeSeconds;
+    float rippleAmplitude;
+};
+
+// light views of the shadow atlas, shared with every program;
+// must match MAX_SHADOW_VIEWS in uniformbuffermanager.h
+#define MAX_SHADOW_VIEWS 32
+layout (std140) uniform ShadowBlock
+{
+    mat4 shadowMatrices[MAX_SHADOW_VIEWS];
+    vec4 shadowTiles[MAX_SHADOW_VIEWS];
+    ivec4 shadowLightViews;
+};
+
+// depth pass toggle: project into the light space of one atlas view
+// instead of the camera
 uniform bool bDepthOnly = false;
+uniform int shadowView = 0;
+
+// liquid surfaces ripple here, once per vertex of the liquid grid;
+// a permutation compiles the choice in as LIQUID
+uniform bool bIsLiquidSurface = false;
+uniform vec2 rippleParams = vec2(4.0, 12.0); // x: speed, y: radial frequency
+// world units a ripple of amplitude 1 lifts the surface
+const float RIPPLE_HEIGHT = 0.15;
+
+// lifts a liquid vertex by concentric waves around the center of the
+// disk and tilts its normal by their slope; the disk has radius 1 and
+// the waves are laid out over its texture radius of 0.5
+float ApplyRipple(mat4 model, inout vec4 worldPos, inout vec3 normal)
+{
+   vec2 radial = inVertexPosition.xz * 0.5;
+   float r = length(radial);
+   float phase = r * rippleParams.y - timeSeconds * rippleParams.x;
+   float wave = sin(phase);
+   worldPos.xyz += normal * (wave * rippleAmplitude * RIPPLE_HEIGHT);
+   if (r > 0.0001)
+   {
+      vec3 outward = normalize(mat3(model) * vec3(radial.x, 0.0, radial.y));
+      normal = normalize(normal - outward * (cos(phase) * rippleAmplitude));
+   }
+   return wave;
+}
 
 void main()
 {
    vec4 worldPos = model * vec4(inVertexPosition, 1.0);
-   fragmentPosition = vec3(worldPos);
 
    // Transform normals with inverse-transpose of the model matrix
-   mat3 normalMatrix = mat3(transpose(inverse(model)));
-   fragmentVertexNormal = normalize(normalMatrix * inVertexNormal);
+   vec3 normal = normalize(normalMatrix * inVertexNormal);
+
+   // shadows keep the flat surface, the ripples are far below a texel
+#ifdef LIQUID
+   bool bLiquid = (LIQUID != 0);
+#else
+   bool bLiquid = bIsLiquidSurface;
+#endif
+   fragmentRippleWave = 0.0;
+   if (bLiquid && !bDepthOnly)
+   {
+      fragmentRippleWave = ApplyRipple(model, worldPos, normal);
+   }
+   fragmentPosition = vec3(worldPos);
+   fragmentVertexNormal = normal;
 
-   gl_Position = projection * view * worldPos;
+   if (bDepthOnly)
+   {
+      gl_Position = shadowMatrices[shadowView] * worldPos;
+   }
+   else
+   {
+      gl_Position = projection * view * worldPos;
+   }
    fragmentTextureCoordinate = inTextureCoordinate;
+   fragmentInstanceColor = vec4(1.0);
+   fragmentInstanceUVScale = vec2(1.0);
+   fragmentInstanceMaterial = -1;
+   fragmentInstanceFlags = 0;
 }